@@ -249,6 +249,80 @@ function TEST_rados_put_get_shec() {
     ceph osd erasure-code-profile rm $profile
 }
 
+#
+# Overwrites confined to a stripe update the coding chunk from the
+# difference between the old and new data.  Check the coding chunk is
+# right by reading the object back without its first data chunk.
+#
+function TEST_rados_parity_delta_overwrite() {
+    local dir=$1
+    local poolname=pool-parity-delta
+    local profile=profile-parity-delta
+
+    ceph osd erasure-code-profile set $profile \
+        plugin=jerasure \
+        k=2 m=1 \
+        crush-failure-domain=osd || return 1
+    create_pool $poolname 1 1 erasure $profile \
+        || return 1
+    ceph osd pool set $poolname allow_ec_overwrites true || return 1
+    ceph osd pool set $poolname min_size 2 || return 1
+    wait_for_clean || return 1
+    ceph tell 'osd.*' config set osd_ec_parity_delta_writes true || return 1
+
+    local chunk=$(chunk_size)
+    local stripe_width=$((chunk * 2))
+    dd if=/dev/urandom of=$dir/ORIGINAL bs=$stripe_width count=4 || return 1
+    rados --pool $poolname put SOMETHING $dir/ORIGINAL || return 1
+
+    local primary=$(get_primary $poolname SOMETHING)
+    local before=$(ceph tell osd.$primary perf dump osd | jq '.osd.ec_parity_delta')
+
+    # one after the other, overwriting the same bytes twice
+    local offset
+    for offset in 100 $((stripe_width + 5)) $((stripe_width * 2 + chunk + 7)) 100 ; do
+        dd if=/dev/urandom of=$dir/PATCH bs=64 count=1 || return 1
+        rados --pool $poolname put SOMETHING $dir/PATCH --offset $offset || return 1
+        dd if=$dir/PATCH of=$dir/ORIGINAL bs=1 seek=$offset conv=notrunc || return 1
+    done
+
+    # concurrently, to both data chunks of the last stripe
+    local -a pids
+    for offset in $((stripe_width * 3 + 11)) $((stripe_width * 3 + chunk + 13)) ; do
+        dd if=/dev/urandom of=$dir/PATCH.$offset bs=64 count=1 || return 1
+        rados --pool $poolname put SOMETHING $dir/PATCH.$offset --offset $offset &
+        pids+=($!)
+    done
+    local pid
+    for pid in ${pids[@]} ; do
+        wait $pid || return 1
+    done
+    for offset in $((stripe_width * 3 + 11)) $((stripe_width * 3 + chunk + 13)) ; do
+        dd if=$dir/PATCH.$offset of=$dir/ORIGINAL bs=1 seek=$offset conv=notrunc || return 1
+        rm $dir/PATCH.$offset
+    done
+
+    local after=$(ceph tell osd.$primary perf dump osd | jq '.osd.ec_parity_delta')
+    test $after -gt $before || return 1
+
+    rados --pool $poolname get SOMETHING $dir/COPY || return 1
+    cmp $dir/ORIGINAL $dir/COPY || return 1
+    rm $dir/COPY
+
+    # rebuild the first data chunk from the second and the coding chunk
+    local -a osds=($(get_osds $poolname SOMETHING))
+    kill_daemons $dir TERM osd.${osds[0]} || return 1
+    ceph osd down osd.${osds[0]} || return 1
+    rados --pool $poolname get SOMETHING $dir/COPY || return 1
+    cmp $dir/ORIGINAL $dir/COPY || return 1
+    activate_osd $dir ${osds[0]} || return 1
+    wait_for_clean || return 1
+
+    rm $dir/ORIGINAL $dir/PATCH $dir/COPY
+    delete_pool $poolname
+    ceph osd erasure-code-profile rm $profile
+}
+
 function TEST_alignment_constraints() {
     local payload=ABC
     echo "$payload" > $dir/ORIGINAL
@@ -91,6 +91,17 @@ uint64_t IOContext::get_num_ios() const
   return ios;
 }
 
+uint64_t IOContext::get_pending_bytes() const
+{
+  uint64_t bytes = 0;
+#if defined(HAVE_LIBAIO) || defined(HAVE_POSIXAIO)
+  for (auto& aio : pending_aios) {
+    bytes += aio.length;
+  }
+#endif
+  return bytes;
+}
+
 void IOContext::release_running_aios()
 {
   ceph_assert(!num_running);
@@ -115,6 +115,7 @@ public:
   void release_running_aios();
   void aio_wait();
   uint64_t get_num_ios() const;
+  uint64_t get_pending_bytes() const; ///< of the aios not yet submitted
 
   void try_aio_wake() {
     assert(num_running >= 1);
@@ -103,6 +103,17 @@ struct io_queue_t {
   virtual int submit_batch(aio_iter begin, aio_iter end, uint16_t aios_size,
 			   void *priv, int *retries) = 0;
   virtual int get_next_completed(int timeout_ms, aio_t **paio, int max) = 0;
+
+  /// size of the buffers create_fixed_buffer() hands out, 0 if none
+  virtual size_t get_fixed_buffer_size() const {
+    return 0;
+  }
+  /// a buffer the queue does I/O to or from without mapping it for each
+  /// request, or nullptr if none is free
+  virtual ceph::unique_leakable_ptr<ceph::buffer::raw> create_fixed_buffer(
+    unsigned len) {
+    return nullptr;
+  }
 };
 
 struct aio_queue_t final : public io_queue_t {
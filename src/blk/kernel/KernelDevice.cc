@@ -80,7 +80,11 @@ KernelDevice::KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, ai
   if (use_ioring && ioring_queue_t::supported()) {
     bool use_ioring_hipri = cct->_conf.get_val<bool>("bdev_ioring_hipri");
     bool use_ioring_sqthread_poll = cct->_conf.get_val<bool>("bdev_ioring_sqthread_poll");
-    io_queue = std::make_unique<ioring_queue_t>(iodepth, use_ioring_hipri, use_ioring_sqthread_poll);
+    io_queue = std::make_unique<ioring_queue_t>(
+      iodepth, use_ioring_hipri, use_ioring_sqthread_poll,
+      cct->_conf.get_val<uint64_t>("bdev_ioring_sqthread_idle_ms"),
+      cct->_conf.get_val<Option::size_t>("bdev_ioring_fixed_buffers"),
+      cct->_conf.get_val<Option::size_t>("bdev_ioring_fixed_buffer_size"));
   } else {
     static bool once;
     if (use_ioring && !once) {
@@ -514,6 +518,12 @@ int KernelDevice::_aio_start()
       }
       return r;
     }
+    if (cct->_conf.get_val<bool>("bdev_ioring") &&
+	cct->_conf.get_val<Option::size_t>("bdev_ioring_fixed_buffers") &&
+	!io_queue->get_fixed_buffer_size()) {
+      derr << __func__ << " WARNING: could not register io_uring fixed "
+	   << "buffers, check RLIMIT_MEMLOCK" << dendl;
+    }
     aio_thread.create("bstore_aio");
   }
   return 0;
@@ -988,6 +998,18 @@ int KernelDevice::aio_write(
     return 0;
   }
 
+  if (aio && dio && !buffered &&
+      len <= io_queue->get_fixed_buffer_size() &&
+      !bl.is_aligned_size_and_memory(block_size, block_size)) {
+    // it has to be copied anyway, copy it into a fixed buffer
+    if (auto raw = io_queue->create_fixed_buffer(len); raw) {
+      bufferptr p(std::move(raw));
+      bl.begin().copy(len, p.c_str());
+      bl.clear();
+      bl.push_back(std::move(p));
+      dout(20) << __func__ << " copied into a fixed buffer" << dendl;
+    }
+  }
   if ((!buffered || bl.get_num_buffers() >= IOV_MAX) &&
       bl.rebuild_aligned_size_and_memory(block_size, block_size, IOV_MAX)) {
     dout(20) << __func__ << " rebuilding buffer to be aligned" << dendl;
@@ -1239,6 +1261,15 @@ ceph::unique_leakable_ptr<buffer::raw> KernelDevice::create_custom_aligned(
            << " len=" << len
            << " custom_alignment=" << custom_alignment
            << dendl;
+  if (cct->_conf->bdev_read_use_hugepage_pool) {
+    auto raw = ceph::buffer::create_hugepage_pooled(len, custom_alignment);
+    if (raw->mempool == mempool::mempool_buffer_hugepage) {
+      // like the preallocated buffers above: a cached chunk would stay
+      // pinned, and count for less than it holds
+      ioc->flags |= IOContext::FLAG_DONT_CACHE;
+    }
+    return raw;
+  }
   return ceph::buffer::create_aligned(len, custom_alignment);
 }
 
@@ -1306,8 +1337,16 @@ int KernelDevice::aio_read(
     ioc->pending_aios.push_back(aio_t(ioc, fd_directs[WRITE_LIFE_NOT_SET]));
     ++ioc->num_pending;
     aio_t& aio = ioc->pending_aios.back();
-    aio.bl.push_back(
-      ceph::buffer::ptr_node::create(create_custom_aligned(len, ioc)));
+    // only reads which are kept out of the cache anyway get a fixed
+    // buffer, or the cache would soon hold all of them
+    ceph::unique_leakable_ptr<buffer::raw> raw;
+    if (ioc->skip_cache()) {
+      raw = io_queue->create_fixed_buffer(len);
+    }
+    if (!raw) {
+      raw = create_custom_aligned(len, ioc);
+    }
+    aio.bl.push_back(ceph::buffer::ptr_node::create(std::move(raw)));
     aio.bl.prepare_iov(&aio.iov);
     aio.preadv(off, len);
     dout(30) << aio << dendl;
@@ -7,16 +7,66 @@
 
 #include "liburing.h"
 #include <sys/epoll.h>
+#include <sys/mman.h>
+
+#include <boost/lockfree/queue.hpp>
+
+#include "include/buffer_raw.h"
+#include "include/intarith.h"
 
 using std::list;
 using std::make_unique;
 
+/*
+ * One mapping split into equally sized buffers and registered with the
+ * ring as a single fixed buffer, so reads and writes from and to it can
+ * use IORING_OP_READ_FIXED/WRITE_FIXED.  The raws handed out share it,
+ * so the memory outlives the ring if they do.
+ */
+struct ioring_fixed_buffers {
+  char *base = nullptr;
+  size_t bytes = 0;
+  size_t buffer_size = 0;
+  boost::lockfree::queue<unsigned> free_q;
+
+  ioring_fixed_buffers(char *base, size_t bytes, size_t buffer_size)
+    : base(base), bytes(bytes), buffer_size(buffer_size),
+      free_q(bytes / buffer_size) {
+    for (unsigned i = 0; i < bytes / buffer_size; ++i) {
+      free_q.push(i);
+    }
+  }
+  ~ioring_fixed_buffers() {
+    ::munmap(base, bytes);
+  }
+
+  bool contains(const iovec &iov) const {
+    const char *p = static_cast<const char*>(iov.iov_base);
+    return p >= base && p + iov.iov_len <= base + bytes;
+  }
+};
+
+struct ioring_fixed_buffer_raw : public ceph::buffer::raw {
+  std::shared_ptr<ioring_fixed_buffers> buffers;
+  unsigned index;
+
+  ioring_fixed_buffer_raw(std::shared_ptr<ioring_fixed_buffers> b,
+			  unsigned index, unsigned len)
+    : raw(b->base + index * b->buffer_size, len),
+      buffers(std::move(b)), index(index) {}
+  ~ioring_fixed_buffer_raw() override {
+    // recycle the buffer; the mapping goes with the last reference
+    buffers->free_q.push(index);
+  }
+};
+
 struct ioring_data {
   struct io_uring io_uring;
   pthread_mutex_t cq_mutex;
   pthread_mutex_t sq_mutex;
   int epoll_fd = -1;
   std::map<int, int> fixed_fds_map;
+  std::shared_ptr<ioring_fixed_buffers> fixed_buffers;
 };
 
 static int ioring_get_cqe(struct ioring_data *d, unsigned int max,
@@ -50,6 +100,12 @@ static int find_fixed_fd(struct ioring_data *d, int real_fd)
   return it->second;
 }
 
+static bool is_fixed_buffer(struct ioring_data *d, struct aio_t *io)
+{
+  return d->fixed_buffers && io->iov.size() == 1 &&
+    d->fixed_buffers->contains(io->iov[0]);
+}
+
 static void init_sqe(struct ioring_data *d, struct io_uring_sqe *sqe,
 		     struct aio_t *io)
 {
@@ -57,14 +113,25 @@ static void init_sqe(struct ioring_data *d, struct io_uring_sqe *sqe,
 
   ceph_assert(fixed_fd != -1);
 
-  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV)
-    io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
-			 io->iov.size(), io->offset);
-  else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV)
-    io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
-			io->iov.size(), io->offset);
-  else
+  // the whole mapping is registered as buffer 0
+  bool fixed_buf = is_fixed_buffer(d, io);
+  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV) {
+    if (fixed_buf)
+      io_uring_prep_write_fixed(sqe, fixed_fd, io->iov[0].iov_base,
+				io->iov[0].iov_len, io->offset, 0);
+    else
+      io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
+			   io->iov.size(), io->offset);
+  } else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV) {
+    if (fixed_buf)
+      io_uring_prep_read_fixed(sqe, fixed_fd, io->iov[0].iov_base,
+			       io->iov[0].iov_len, io->offset, 0);
+    else
+      io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
+			  io->iov.size(), io->offset);
+  } else {
     ceph_assert(0);
+  }
 
   io_uring_sqe_set_data(sqe, io);
   io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
@@ -106,11 +173,51 @@ static void build_fixed_fds_map(struct ioring_data *d,
   }
 }
 
-ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_) :
+static std::shared_ptr<ioring_fixed_buffers> register_fixed_buffers(
+  struct io_uring *ring, uint64_t bytes, size_t buffer_size)
+{
+  static constexpr uint64_t HUGEPAGE_SIZE = 2ull << 20;
+
+  // a registered buffer can not be larger than 1G
+  bytes = std::min<uint64_t>(bytes, 1ull << 30);
+  buffer_size = p2roundup<size_t>(std::max<size_t>(buffer_size, 1),
+				  CEPH_PAGE_SIZE);
+  bytes -= bytes % buffer_size;
+  if (bytes == 0)
+    return nullptr;
+
+  void *base = MAP_FAILED;
+  if (bytes % HUGEPAGE_SIZE == 0)
+    base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB,
+		  -1, 0);
+  if (base == MAP_FAILED) {
+    // no hugepages reserved
+    base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (base == MAP_FAILED)
+      return nullptr;
+  }
+  auto buffers = std::make_shared<ioring_fixed_buffers>(
+    static_cast<char*>(base), bytes, buffer_size);
+
+  struct iovec iov = { base, bytes };
+  if (io_uring_register_buffers(ring, &iov, 1) < 0)
+    return nullptr;
+  return buffers;
+}
+
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_,
+			       unsigned sq_thread_idle_ms_,
+			       uint64_t fixed_buffers_bytes_,
+			       size_t fixed_buffer_size_) :
   d(make_unique<ioring_data>()),
   iodepth(iodepth_),
   hipri(hipri_),
-  sq_thread(sq_thread_)
+  sq_thread(sq_thread_),
+  sq_thread_idle_ms(sq_thread_idle_ms_),
+  fixed_buffers_bytes(fixed_buffers_bytes_),
+  fixed_buffer_size(fixed_buffer_size_)
 {
 }
 
@@ -120,17 +227,19 @@ ioring_queue_t::~ioring_queue_t()
 
 int ioring_queue_t::init(std::vector<int> &fds)
 {
-  unsigned flags = 0;
+  struct io_uring_params params = {};
 
   pthread_mutex_init(&d->cq_mutex, NULL);
   pthread_mutex_init(&d->sq_mutex, NULL);
 
   if (hipri)
-    flags |= IORING_SETUP_IOPOLL;
-  if (sq_thread)
-    flags |= IORING_SETUP_SQPOLL;
+    params.flags |= IORING_SETUP_IOPOLL;
+  if (sq_thread) {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = sq_thread_idle_ms;
+  }
 
-  int ret = io_uring_queue_init(iodepth, &d->io_uring, flags);
+  int ret = io_uring_queue_init_params(iodepth, &d->io_uring, &params);
   if (ret < 0)
     return ret;
 
@@ -143,6 +252,12 @@ int ioring_queue_t::init(std::vector<int> &fds)
 
   build_fixed_fds_map(d.get(), fds);
 
+  // not fatal: without them all I/O uses readv/writev
+  if (fixed_buffers_bytes)
+    d->fixed_buffers = register_fixed_buffers(&d->io_uring,
+					      fixed_buffers_bytes,
+					      fixed_buffer_size);
+
   d->epoll_fd = epoll_create1(0);
   if (d->epoll_fd < 0) {
     ret = -errno;
@@ -170,6 +285,7 @@ close_ring_fd:
 void ioring_queue_t::shutdown()
 {
   d->fixed_fds_map.clear();
+  d->fixed_buffers.reset();
   close(d->epoll_fd);
   d->epoll_fd = -1;
   io_uring_queue_exit(&d->io_uring);
@@ -209,6 +325,22 @@ get_cqe:
   return events;
 }
 
+size_t ioring_queue_t::get_fixed_buffer_size() const
+{
+  return d->fixed_buffers ? d->fixed_buffers->buffer_size : 0;
+}
+
+ceph::unique_leakable_ptr<ceph::buffer::raw>
+ioring_queue_t::create_fixed_buffer(unsigned len)
+{
+  auto& buffers = d->fixed_buffers;
+  unsigned index;
+  if (!buffers || len > buffers->buffer_size || !buffers->free_q.pop(index))
+    return nullptr;
+  return ceph::unique_leakable_ptr<ceph::buffer::raw>(
+    new ioring_fixed_buffer_raw(buffers, index, len));
+}
+
 bool ioring_queue_t::supported()
 {
   struct io_uring ring;
@@ -224,7 +356,10 @@ bool ioring_queue_t::supported()
 
 struct ioring_data {};
 
-ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_)
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_,
+			       unsigned sq_thread_idle_ms_,
+			       uint64_t fixed_buffers_bytes_,
+			       size_t fixed_buffer_size_)
 {
   ceph_assert(0);
 }
@@ -256,6 +391,17 @@ int ioring_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
   ceph_assert(0);
 }
 
+size_t ioring_queue_t::get_fixed_buffer_size() const
+{
+  ceph_assert(0);
+}
+
+ceph::unique_leakable_ptr<ceph::buffer::raw>
+ioring_queue_t::create_fixed_buffer(unsigned len)
+{
+  ceph_assert(0);
+}
+
 bool ioring_queue_t::supported()
 {
   return false;
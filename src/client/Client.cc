@@ -53,6 +53,7 @@
 #include "mon/MonClient.h"
 
 #include "messages/MClientCaps.h"
+#include "messages/MClientCapsBatch.h"
 #include "messages/MClientLease.h"
 #include "messages/MClientQuota.h"
 #include "messages/MClientReclaim.h"
@@ -394,6 +395,9 @@ Client::Client(Messenger *m, MonClient *mc, Objecter *objecter_)
 
   lru.lru_set_midpoint(cct->_conf->client_cache_mid);
 
+  for (unsigned i = 0; i < cct->_conf->client_readdir_prefetch; i++)
+    readdir_prefetchers.emplace_back(std::make_unique<Finisher>(cct));
+
   // file handles
   free_fd_set.insert(10, 1<<30);
 
@@ -588,6 +592,9 @@ void Client::_pre_init()
   objecter_finisher.start();
   filer.reset(new Filer(objecter, &objecter_finisher));
 
+  for (auto& f : readdir_prefetchers)
+    f->start();
+
   objectcacher->start();
 }
 
@@ -746,6 +753,11 @@ void Client::shutdown()
   objecter_finisher.wait_for_empty();
   objecter_finisher.stop();
 
+  for (auto& f : readdir_prefetchers) {
+    f->wait_for_empty();
+    f->stop();
+  }
+
   if (logger) {
     cct->get_perfcounters_collection()->remove(logger.get());
     logger.reset();
@@ -1385,7 +1397,7 @@ void Client::insert_readdir_results(MetaRequest *request, MetaSession *session,
 		   << ", last_hash " << last_hash
 		   << ", next_offset " << readdir_offset << dendl;
 
-    if (diri->snapid != CEPH_SNAPDIR &&
+    if (diri->snapid != CEPH_SNAPDIR && !dirp->fetch_ahead &&
 	fg.is_leftmost() && readdir_offset == 2 &&
 	!(hash_order && last_hash)) {
       dirp->release_count = diri->dir_release_count;
@@ -1449,26 +1461,9 @@ void Client::insert_readdir_results(MetaRequest *request, MetaSession *session,
 	dn->offset = dir_result_t::make_fpos(fg, readdir_offset++, false);
       }
       // add to readdir cache
-      if (!snapdiff_req &&
-          dirp->release_count == effective_diri->dir_release_count &&
-	  dirp->ordered_count == effective_diri->dir_ordered_count &&
-	  dirp->start_shared_gen == effective_diri->shared_gen) {
-	if (dirp->cache_index == effective_dir->readdir_cache.size()) {
-	  if (i == 0) {
-	    ceph_assert(!dirp->inode->is_complete_and_ordered());
-	    dir->readdir_cache.reserve(dirp->cache_index + numdn);
-	  }
-          effective_dir->readdir_cache.push_back(dn);
-	} else if (dirp->cache_index < effective_dir->readdir_cache.size()) {
-	  if (dirp->inode->is_complete_and_ordered())
-	    ceph_assert(effective_dir->readdir_cache[dirp->cache_index] == dn);
-	  else
-            effective_dir->readdir_cache[dirp->cache_index] = dn;
-	} else {
-	  ceph_abort_msg("unexpected readdir buffer idx");
-	}
-	dirp->cache_index++;
-      }
+      if (!snapdiff_req)
+	_readdir_add_to_cache(dirp, effective_diri, effective_dir, dn,
+			      i == 0 ? numdn : 0);
       // add to cached result list
       dirp->buffer.push_back(dir_result_t::dentry(dn->offset, dname, dn->alternate_name, in));
       ldout(cct, 15) << __func__ << "  " << hex << dn->offset << dec << ": '" << dname << "' -> " << in->ino << dendl;
@@ -2950,6 +2945,9 @@ bool Client::ms_dispatch2(const MessageRef &m)
   case CEPH_MSG_CLIENT_CAPS:
     handle_caps(ref_cast<MClientCaps>(m));
     break;
+  case CEPH_MSG_CLIENT_CAPS_BATCH:
+    handle_caps_batch(ref_cast<MClientCapsBatch>(m));
+    break;
   case CEPH_MSG_CLIENT_LEASE:
     handle_lease(ref_cast<MClientLease>(m));
     break;
@@ -5329,6 +5327,17 @@ void Client::handle_quota(const MConstRef<MClientQuota>& m)
   }
 }
 
+void Client::handle_caps_batch(const MConstRef<MClientCapsBatch>& m)
+{
+  ldout(cct, 10) << __func__ << " " << m->size() << " caps from mds."
+		 << m->get_source().num() << dendl;
+  // each one counts as a push from the mds, as if sent by itself
+  for (auto& c : m->caps) {
+    c->set_connection(m->get_connection());
+    handle_caps(c);
+  }
+}
+
 void Client::handle_caps(const MConstRef<MClientCaps>& m)
 {
   mds_rank_t mds = mds_rank_t(m->get_source().num());
@@ -9198,11 +9207,7 @@ int Client::_readdir_get_frag(int op, dir_result_t* dirp,
   ceph_assert(dirp->inode);
 
   // get the current frag.
-  frag_t fg;
-  if (dirp->hash_order())
-    fg = dirp->inode->dirfragtree[dirp->offset_high()];
-  else
-    fg = frag_t(dirp->offset_high());
+  frag_t fg = _readdir_cur_frag(dirp);
   
   ldout(cct, 10) << __func__ << " " << dirp << " on " << dirp->inode->ino << " fg " << fg
 		 << " offset " << hex << dirp->offset << dec << dendl;
@@ -9232,6 +9237,183 @@ int Client::_readdir_get_frag(int op, dir_result_t* dirp,
   return res;
 }
 
+frag_t Client::_readdir_cur_frag(dir_result_t *dirp)
+{
+  if (dirp->hash_order())
+    return dirp->inode->dirfragtree[dirp->offset_high()];
+  else
+    return frag_t(dirp->offset_high());
+}
+
+class C_Client_ReaddirPrefetch : public Context {
+private:
+  Client *client;
+  int op;
+  std::shared_ptr<dir_prefetch_t> pf;
+  Client::fill_readdir_args_cb_t fill_req_cb;
+public:
+  C_Client_ReaddirPrefetch(Client *c, int op,
+			   std::shared_ptr<dir_prefetch_t> pf,
+			   Client::fill_readdir_args_cb_t fill_req_cb)
+    : client(c), op(op), pf(std::move(pf)), fill_req_cb(std::move(fill_req_cb)) {}
+  void finish(int r) override {
+    ceph_assert(ceph_mutex_is_not_locked_by_me(client->client_lock));
+    client->_readdir_prefetch_frag(op, std::move(pf), fill_req_cb);
+  }
+};
+
+/*
+ * Request up to client_readdir_prefetch of the dirfrags that follow fg,
+ * each on its own prefetcher thread, so that they are on their way
+ * while the caller is busy with fg.  Only the first chunk of a dirfrag
+ * is read ahead; the rest is fetched as usual, from its last_name.
+ */
+void Client::_readdir_prefetch(int op, dir_result_t *dirp, frag_t fg,
+			       fill_readdir_args_cb_t fill_req_cb)
+{
+  ceph_assert(ceph_mutex_is_locked_by_me(client_lock));
+
+  if (readdir_prefetchers.empty() || op != CEPH_MDS_OP_READDIR)
+    return;
+
+  InodeRef& diri = dirp->inode;
+  for (auto& p : dirp->prefetched) {
+    if (ceph_frag_compare(p.first.value(), fg.value()) > 0)
+      fg = p.first;
+  }
+  while (dirp->prefetched.size() < readdir_prefetchers.size() &&
+	 !fg.is_rightmost()) {
+    frag_t next = diri->dirfragtree[fg.next().value()];
+    if (ceph_frag_compare(next.value(), fg.value()) <= 0) {
+      // our dirfragtree does not know what comes next
+      break;
+    }
+    fg = next;
+    ldout(cct, 10) << __func__ << " " << dirp << " on " << diri->ino
+		   << " fg " << fg << dendl;
+    auto pf = std::make_shared<dir_prefetch_t>(diri.get(), dirp->perms, fg);
+    dirp->prefetched[fg] = pf;
+    auto& f = readdir_prefetchers[next_readdir_prefetcher++ % readdir_prefetchers.size()];
+    f->queue(new C_Client_ReaddirPrefetch(this, op, std::move(pf), fill_req_cb));
+  }
+}
+
+void Client::_readdir_prefetch_frag(int op, std::shared_ptr<dir_prefetch_t> pf,
+				    fill_readdir_args_cb_t fill_req_cb)
+{
+  RWRef_t mref_reader(mount_state, CLIENT_MOUNTING);
+  std::scoped_lock lock(client_lock);
+
+  int r;
+  if (!mref_reader.is_state_satisfied()) {
+    r = -CEPHFS_ENOTCONN;
+  } else if (pf.use_count() == 1) {
+    // the reader closed, rewound or seeked away meanwhile
+    r = -CEPHFS_ECANCELED;
+  } else {
+    r = _readdir_get_frag(op, &pf->dirp, fill_req_cb);
+  }
+  ldout(cct, 10) << __func__ << " " << &pf->dirp << " fg " << pf->dirp.buffer_frag
+		 << " size " << pf->dirp.buffer.size() << " = " << r << dendl;
+  pf->result = r;
+  pf->done = true;
+  pf->cond.notify_all();
+  // may hold the last inode refs
+  pf.reset();
+}
+
+/*
+ * Fill dirp's buffer from a dirfrag read ahead, waiting for it if it is
+ * still in flight.  Returns false if there is none to use, in which case
+ * the caller fetches the dirfrag itself.
+ */
+bool Client::_readdir_take_prefetched(dir_result_t *dirp,
+				      std::unique_lock<ceph::mutex>& cl)
+{
+  if (dirp->prefetched.empty() || dirp->next_offset != 2)
+    return false;
+
+  frag_t fg = _readdir_cur_frag(dirp);
+  std::shared_ptr<dir_prefetch_t> pf;
+  for (auto p = dirp->prefetched.begin(); p != dirp->prefetched.end(); ) {
+    int c = ceph_frag_compare(p->first.value(), fg.value());
+    if (c < 0 || p->first == fg) {
+      // passed, or the one we want
+      if (p->first == fg)
+	pf = p->second;
+      p = dirp->prefetched.erase(p);
+    } else {
+      ++p;
+    }
+  }
+  if (!pf)
+    return false;
+
+  ldout(cct, 10) << __func__ << " " << dirp << " fg " << fg
+		 << (pf->done ? "" : ", waiting") << dendl;
+  pf->cond.wait(cl, [&pf] { return pf->done; });
+
+  auto& pdirp = pf->dirp;
+  if (pf->result < 0 || pdirp.buffer_frag != fg) {
+    ldout(cct, 10) << __func__ << " " << dirp << " prefetch of " << fg
+		   << " got " << pdirp.buffer_frag << " = " << pf->result
+		   << ", fetching again" << dendl;
+    return false;
+  }
+
+  // the entries went by the readdir cache; add them in order, unless
+  // some were trimmed meanwhile
+  InodeRef& diri = dirp->inode;
+  Dir *dir = diri->dir;
+  for (auto& entry : pdirp.buffer) {
+    Dentry *dn = nullptr;
+    if (dir) {
+      auto p = dir->dentries.find(entry.name);
+      if (p != dir->dentries.end() && p->second->inode == entry.inode &&
+	  p->second->offset == entry.offset)
+	dn = p->second;
+    }
+    if (!dn) {
+      dirp->release_count = 0;
+      break;
+    }
+    _readdir_add_to_cache(dirp, diri.get(), dir, dn, 0);
+  }
+
+  dirp->buffer_frag = pdirp.buffer_frag;
+  dirp->buffer = std::move(pdirp.buffer);
+  dirp->next_offset = pdirp.next_offset;
+  dirp->last_name = std::move(pdirp.last_name);
+  ldout(cct, 10) << __func__ << " " << dirp << " got frag " << dirp->buffer_frag
+		 << " size " << dirp->buffer.size() << dendl;
+  return true;
+}
+
+void Client::_readdir_add_to_cache(dir_result_t *dirp, Inode *diri, Dir *dir,
+				   Dentry *dn, unsigned reserve)
+{
+  if (dirp->release_count != diri->dir_release_count ||
+      dirp->ordered_count != diri->dir_ordered_count ||
+      dirp->start_shared_gen != diri->shared_gen)
+    return;
+
+  if (dirp->cache_index == dir->readdir_cache.size()) {
+    if (reserve) {
+      ceph_assert(!diri->is_complete_and_ordered());
+      dir->readdir_cache.reserve(dirp->cache_index + reserve);
+    }
+    dir->readdir_cache.push_back(dn);
+  } else if (dirp->cache_index < dir->readdir_cache.size()) {
+    if (diri->is_complete_and_ordered())
+      ceph_assert(dir->readdir_cache[dirp->cache_index] == dn);
+    else
+      dir->readdir_cache[dirp->cache_index] = dn;
+  } else {
+    ceph_abort_msg("unexpected readdir buffer idx");
+  }
+  dirp->cache_index++;
+}
+
 struct dentry_off_lt {
   bool operator()(const Dentry* dn, int64_t off) const {
     return dir_result_t::fpos_cmp(dn->offset, off) < 0;
@@ -9340,16 +9522,18 @@ int Client::readdir_r_cb(dir_result_t* d,
   unsigned flags,
   bool getref)
 {
-  auto fill_readdir_cb = [](dir_result_t* dirp,
-			    MetaRequest* req,
-			    InodeRef& diri,
-			    frag_t fg) {
+  bool dense = cct->_conf->client_readdir_dense;
+  auto fill_readdir_cb = [dense](dir_result_t* dirp,
+				 MetaRequest* req,
+				 InodeRef& diri,
+				 frag_t fg) {
     filepath path;
     diri->make_nosnap_relative_path(path);
     req->set_filepath(path);
     req->set_inode(diri.get());
     req->head.args.readdir.frag = fg;
-    req->head.args.readdir.flags = CEPH_READDIR_REPLY_BITFLAGS;
+    req->head.args.readdir.flags = CEPH_READDIR_REPLY_BITFLAGS |
+      (dense ? CEPH_READDIR_DENSE : 0);
     if (dirp->last_name.length()) {
       req->path2.set_path(dirp->last_name);
     } else if (dirp->hash_order()) {
@@ -9495,12 +9679,17 @@ int Client::_readdir_r_cb(int op,
 
     bool check_caps = true;
     if (!dirp->is_cached()) {
-      int r = _readdir_get_frag(op, dirp, fill_cb);
-      if (r)
-	return r;
+      if (!_readdir_take_prefetched(dirp, cl)) {
+	// have the next dirfrags on their way while we wait for this one
+	_readdir_prefetch(op, dirp, _readdir_cur_frag(dirp), fill_cb);
+	int r = _readdir_get_frag(op, dirp, fill_cb);
+	if (r)
+	  return r;
+      }
       // _readdir_get_frag () may updates dirp->offset if the replied dirfrag is
       // different than the requested one. (our dirfragtree was outdated)
       check_caps = false;
+      _readdir_prefetch(op, dirp, dirp->buffer_frag, fill_cb);
     }
     frag_t fg = dirp->buffer_frag;
 
@@ -139,6 +139,8 @@ class ceph_lock_state_t;
 // ========================================================
 // client interface
 
+struct dir_prefetch_t;
+
 struct dir_result_t {
   static const int SHIFT = 28;
   static const int64_t MASK = (1 << SHIFT) - 1;
@@ -216,6 +218,7 @@ struct dir_result_t {
     ordered_count = 0;
     cache_index = 0;
     buffer.clear();
+    prefetched.clear();
   }
 
   InodeRef inode;
@@ -238,6 +241,23 @@ struct dir_result_t {
 
   std::vector<dentry> buffer;
   struct dirent de;
+
+  // dirfrags requested ahead of the reader, by frag
+  std::map<frag_t, std::shared_ptr<dir_prefetch_t>> prefetched;
+  bool fetch_ahead = false;  // cursor of a prefetch; stays out of the readdir cache
+};
+
+struct dir_prefetch_t {
+  dir_prefetch_t(Inode *in, const UserPerm& perms, frag_t fg)
+    : dirp(in, perms) {
+    dirp.offset = dir_result_t::make_fpos(fg, 2, false);
+    dirp.fetch_ahead = true;
+  }
+
+  dir_result_t dirp;
+  bool done = false;
+  int result = 0;
+  ceph::condition_variable cond;
 };
 
 class Client : public Dispatcher, public md_config_obs_t {
@@ -250,6 +270,7 @@ public:
   friend class C_Client_RequestInterrupt;
   friend class C_Deleg_Timeout; // Asserts on client_lock, called when a delegation is unreturned
   friend class C_Client_CacheRelease; // Asserts on client_lock
+  friend class C_Client_ReaddirPrefetch; // calls _readdir_prefetch_frag()
   friend class SyntheticClient;
   friend void intrusive_ptr_release(Inode *in);
   template <typename T> friend struct RWRefState;
@@ -741,6 +762,7 @@ public:
   void handle_quota(const MConstRef<MClientQuota>& m);
   void handle_snap(const MConstRef<MClientSnap>& m);
   void handle_caps(const MConstRef<MClientCaps>& m);
+  void handle_caps_batch(const MConstRef<MClientCapsBatch>& m);
   void handle_cap_import(MetaSession *session, Inode *in, const MConstRef<MClientCaps>& m);
   void handle_cap_export(MetaSession *session, Inode *in, const MConstRef<MClientCaps>& m);
   void handle_cap_trunc(MetaSession *session, Inode *in, const MConstRef<MClientCaps>& m);
@@ -1565,6 +1587,15 @@ private:
   void _readdir_rechoose_frag(dir_result_t *dirp);
   int _readdir_get_frag(int op, dir_result_t *dirp,
     fill_readdir_args_cb_t fill_req_cb);
+  frag_t _readdir_cur_frag(dir_result_t *dirp);
+  void _readdir_prefetch(int op, dir_result_t *dirp, frag_t fg,
+    fill_readdir_args_cb_t fill_req_cb);
+  void _readdir_prefetch_frag(int op, std::shared_ptr<dir_prefetch_t> pf,
+    fill_readdir_args_cb_t fill_req_cb);
+  bool _readdir_take_prefetched(dir_result_t *dirp,
+    std::unique_lock<ceph::mutex>& cl);
+  void _readdir_add_to_cache(dir_result_t *dirp, Inode *diri, Dir *dir,
+    Dentry *dn, unsigned reserve);
   int _readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p, int caps, bool getref);
   int _readdir_r_cb(int op,
     dir_result_t* d,
@@ -1796,6 +1827,9 @@ private:
   Finisher remount_finisher;
   Finisher async_ino_releasor;
   Finisher objecter_finisher;
+  // one per dirfrag that may be read ahead (client_readdir_prefetch)
+  std::vector<std::unique_ptr<Finisher>> readdir_prefetchers;
+  unsigned next_readdir_prefetcher = 0;
 
   ceph::coarse_mono_time last_cap_renew;
 
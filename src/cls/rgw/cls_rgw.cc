@@ -534,6 +534,7 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
   bool done = false;   // whether we need to keep calling get_obj_vals
   bool more = true;    // output parameter of get_obj_vals
   bool has_delimiter = !op.delimiter.empty();
+  bool has_end_obj = !op.end_obj.empty();
 
   if (has_delimiter &&
       start_after_omap_key > op.filter_prefix &&
@@ -591,6 +592,21 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         continue;
       }
 
+      // stop at the caller's upper bound; when a delimiter is present
+      // the entry may instead roll up into a common prefix that sorts
+      // before the bound, which is checked below
+      if (has_end_obj && !(key < op.end_obj) &&
+	  (!has_delimiter ||
+	   key.name.find(op.delimiter, op.filter_prefix.size()) ==
+	   std::string::npos)) {
+	CLS_LOG(20, "%s: entry %s[%s] is at or past end key %s[%s]",
+		__func__, key.name.c_str(), key.instance.c_str(),
+		op.end_obj.name.c_str(), op.end_obj.instance.c_str());
+	more = false;
+	done = true;
+	break;
+      }
+
       if (!entry.is_valid()) {
         CLS_LOG(20, "%s: entry %s[%s] is not valid",
 		__func__, key.name.c_str(), key.instance.c_str());
@@ -613,6 +629,15 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
           string prefix_key =
 	    key.name.substr(0, delim_pos + op.delimiter.length());
 
+	  if (has_end_obj && !(cls_rgw_obj_key(prefix_key) < op.end_obj)) {
+	    CLS_LOG(20, "%s: common prefix %s is at or past end key %s[%s]",
+		    __func__, prefix_key.c_str(),
+		    op.end_obj.name.c_str(), op.end_obj.instance.c_str());
+	    more = false;
+	    done = true;
+	    break;
+	  }
+
 	  if (prefix_key == prev_prefix_omap_key) {
 	    continue; // we've already added this;
 	  } else {
@@ -313,7 +313,8 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const std::string& delimiter,
                             uint32_t num_entries,
                             bool list_versions,
-                            rgw_cls_list_ret* result)
+                            rgw_cls_list_ret* result,
+			    const cls_rgw_obj_key& end_obj)
 {
   bufferlist in;
   rgw_cls_list_op call;
@@ -322,6 +323,7 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
   call.delimiter = delimiter;
   call.num_entries = num_entries;
   call.list_versions = list_versions;
+  call.end_obj = end_obj;
   encode(call, in);
 
   op.exec(RGW_CLASS, RGW_BUCKET_LIST, in,
@@ -337,12 +339,13 @@ static bool issue_bucket_list_op(librados::IoCtx& io_ctx,
 				 uint32_t num_entries,
 				 bool list_versions,
 				 BucketIndexAioManager *manager,
-				 rgw_cls_list_ret *pdata)
+				 rgw_cls_list_ret *pdata,
+				 const cls_rgw_obj_key& end_obj = {})
 {
   librados::ObjectReadOperation op;
   cls_rgw_bucket_list_op(op,
 			 start_obj, filter_prefix, delimiter,
-                         num_entries, list_versions, pdata);
+                         num_entries, list_versions, pdata, end_obj);
   return manager->aio_operate(io_ctx, shard_id, oid, &op);
 }
 
@@ -354,17 +357,28 @@ int CLSRGWIssueBucketList::issue_op(const int shard_id, const string& oid)
   // to advance the search, otherwise use the marker passed in by the
   // caller
   cls_rgw_obj_key marker;
+  uint32_t shard_num_entries = num_entries;
+  const cls_rgw_bucket_list_cursor* cursor = nullptr;
+  if (cursors) {
+    auto c = cursors->find(shard_id);
+    if (c != cursors->end()) {
+      cursor = &c->second;
+      shard_num_entries = cursor->num_entries;
+    }
+  }
   auto iter = result.find(shard_id);
   if (iter != result.end()) {
     marker = iter->second.marker;
+  } else if (cursor) {
+    marker = cursor->start_obj;
   } else {
     marker = start_obj;
   }
 
   return issue_bucket_list_op(io_ctx, shard_id, oid,
 			      marker, filter_prefix, delimiter,
-			      num_entries, list_versions, &manager,
-			      &result[shard_id]);
+			      shard_num_entries, list_versions, &manager,
+			      &result[shard_id], end_obj);
 }
 
 
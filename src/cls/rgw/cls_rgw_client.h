@@ -414,10 +414,20 @@ int cls_rgw_usage_log_trim(librados::IoCtx& io_ctx, const std::string& oid, cons
  *                 amount of entries returned depends on the number of shardings).
  * list_results  - the std::list results keyed by bucket index object id.
  * max_aio       - the maximum number of AIO (for throttling).
+ * end_obj       - if not empty, each shard stops listing before this key.
+ * cursors       - if not null, per-shard start_obj and num_entries that
+ *                 override the ones above for the shards they cover.
  *
  * Return 0 on success, a failure code otherwise.
 */
 
+// where an ordered listing of one bucket index shard resumes, and how
+// many entries to ask that shard for
+struct cls_rgw_bucket_list_cursor {
+  cls_rgw_obj_key start_obj;
+  uint32_t num_entries = 0;
+};
+
 class CLSRGWIssueBucketList : public CLSRGWConcurrentIO {
   cls_rgw_obj_key start_obj;
   std::string filter_prefix;
@@ -425,6 +435,8 @@ class CLSRGWIssueBucketList : public CLSRGWConcurrentIO {
   uint32_t num_entries;
   bool list_versions;
   std::map<int, rgw_cls_list_ret>& result; // request_id -> return value
+  cls_rgw_obj_key end_obj;
+  const std::map<int, cls_rgw_bucket_list_cursor>* cursors;
 
 protected:
   int issue_op(int shard_id, const std::string& oid) override;
@@ -440,11 +452,13 @@ public:
                         std::map<int, std::string>& oids, // shard_id -> shard_oid
 			// shard_id -> return value
                         std::map<int, rgw_cls_list_ret>& list_results,
-                        uint32_t max_aio) :
+                        uint32_t max_aio,
+			const cls_rgw_obj_key& _end_obj = {},
+			const std::map<int, cls_rgw_bucket_list_cursor>* _cursors = nullptr) :
   CLSRGWConcurrentIO(io_ctx, oids, max_aio),
     start_obj(_start_obj), filter_prefix(_filter_prefix), delimiter(_delimiter),
     num_entries(_num_entries), list_versions(_list_versions),
-    result(list_results)
+    result(list_results), end_obj(_end_obj), cursors(_cursors)
   {}
 };
 
@@ -454,7 +468,8 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
 			    const std::string& delimiter,
                             uint32_t num_entries,
                             bool list_versions,
-                            rgw_cls_list_ret* result);
+                            rgw_cls_list_ret* result,
+			    const cls_rgw_obj_key& end_obj = {});
 
 void cls_rgw_bilog_list(librados::ObjectReadOperation& op,
                         const std::string& marker, uint32_t max,
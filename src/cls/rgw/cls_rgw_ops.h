@@ -387,19 +387,24 @@ struct rgw_cls_list_op
   bool list_versions;
   std::string delimiter;
 
+  // if not empty, listing stops before the first key that is not
+  // less than end_obj, and the result is not truncated
+  cls_rgw_obj_key end_obj;
+
   rgw_cls_list_op() : num_entries(0), list_versions(false) {}
 
   void encode(ceph::buffer::list &bl) const {
-    ENCODE_START(6, 4, bl);
+    ENCODE_START(7, 4, bl);
     encode(num_entries, bl);
     encode(filter_prefix, bl);
     encode(start_obj, bl);
     encode(list_versions, bl);
     encode(delimiter, bl);
+    encode(end_obj, bl);
     ENCODE_FINISH(bl);
   }
   void decode(ceph::buffer::list::const_iterator &bl) {
-    DECODE_START_LEGACY_COMPAT_LEN(6, 2, 2, bl);
+    DECODE_START_LEGACY_COMPAT_LEN(7, 2, 2, bl);
     if (struct_v < 4) {
       decode(start_obj.name, bl);
     }
@@ -416,6 +421,9 @@ struct rgw_cls_list_op
     if (struct_v >= 6) {
       decode(delimiter, bl);
     }
+    if (struct_v >= 7) {
+      decode(end_obj, bl);
+    }
     DECODE_FINISH(bl);
   }
   void dump(ceph::Formatter *f) const;
@@ -1,6 +1,10 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <algorithm>
+#include <functional>
+#include <thread>
+
 #include "Finisher.h"
 
 #define dout_subsys ceph_subsys_finisher
@@ -69,8 +73,10 @@ void *Finisher::finisher_thread_entry()
                      << dendl;
       in_progress_queue.clear();
       if (logger) {
+	utime_t lat = ceph_clock_now() - start;
 	logger->dec(l_finisher_queue_len, count);
-	logger->tinc(l_finisher_complete_lat, ceph_clock_now() - start);
+	logger->tinc(l_finisher_complete_lat, lat);
+	logger->hinc(l_finisher_queue_depth_hist, count, lat.to_nsec() / 1000);
       }
 
       ul.lock();
@@ -94,3 +100,222 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+
+PerfCounters *create_finisher_perf_counters(CephContext *cct,
+					    const std::string& name)
+{
+  PerfHistogramCommon::axis_config_d depth_axis{
+    "Queue depth",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,                               ///< Start at 0
+    1,                               ///< Quantization unit is 1
+    18,                              ///< up to 64k and more
+  };
+  PerfHistogramCommon::axis_config_d lat_axis{
+    "Completion latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,                               ///< Start at 0
+    1,                               ///< Quantization unit is 1 usec
+    24,                              ///< up to 8s and more
+  };
+
+  PerfCountersBuilder b(cct, std::string("finisher-") + name,
+			l_finisher_first, l_finisher_last);
+  b.add_u64(l_finisher_queue_len, "queue_len");
+  b.add_time_avg(l_finisher_complete_lat, "complete_latency");
+  b.add_u64_counter_histogram(
+    l_finisher_queue_depth_hist, "queue_depth_histogram",
+    depth_axis, lat_axis,
+    "Histogram of queue depth when the worker picks up a batch vs. time "
+    "to complete the batch");
+  PerfCounters *logger = b.create_perf_counters();
+  cct->get_perfcounters_collection()->add(logger);
+  logger->set(l_finisher_queue_len, 0);
+  logger->set(l_finisher_complete_lat, 0);
+  return logger;
+}
+
+// ShardedFinisher
+
+#undef dout_prefix
+#define dout_prefix *_dout << "sharded_finisher(" << this << ") "
+
+ShardedFinisher::node_t *ShardedFinisher::shard_t::pop()
+{
+  node_t *t = tail;
+  node_t *next = t->next.load(std::memory_order_acquire);
+  if (t == &stub) {
+    if (!next) {
+      return nullptr;
+    }
+    tail = next;
+    t = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail = next;
+    return t;
+  }
+  if (t != head.load(std::memory_order_acquire)) {
+    // a producer is between its exchange and its link
+    return nullptr;
+  }
+  // t is the last one; put the stub behind it so that it can be taken
+  push(&stub, &stub);
+  next = t->next.load(std::memory_order_acquire);
+  if (next) {
+    tail = next;
+    return t;
+  }
+  return nullptr;
+}
+
+ShardedFinisher::ShardedFinisher(CephContext *cct_, unsigned num_shards)
+  : cct(cct_),
+    shards(std::max(num_shards, 1u)),
+    finisher_lock(ceph::make_mutex("ShardedFinisher::finisher_lock")),
+    thread_name("fn_anonymous"),
+    finisher_thread(this)
+{}
+
+ShardedFinisher::ShardedFinisher(CephContext *cct_, std::string name,
+				 std::string tn, unsigned num_shards)
+  : cct(cct_),
+    shards(std::max(num_shards, 1u)),
+    finisher_lock(ceph::make_mutex("ShardedFinisher::" + name)),
+    thread_name(tn),
+    finisher_thread(this)
+{
+  logger = create_finisher_perf_counters(cct, name);
+}
+
+ShardedFinisher::~ShardedFinisher()
+{
+  if (logger && cct) {
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+  // like Finisher, contexts never completed are leaked; the nodes are not
+  for (auto& shard : shards) {
+    while (node_t *n = shard.pop()) {
+      delete n;
+    }
+  }
+}
+
+ShardedFinisher::shard_t& ShardedFinisher::my_shard()
+{
+  // the same thread always lands on the same shard, which is what keeps
+  // its contexts in order
+  static thread_local size_t tid_hash =
+    std::hash<std::thread::id>{}(std::this_thread::get_id());
+  return shards[tid_hash % shards.size()];
+}
+
+void ShardedFinisher::queued(size_t n)
+{
+  if (logger) {
+    logger->inc(l_finisher_queue_len, n);
+  }
+  // pairs with the worker setting sleeping and then checking pending
+  if (sleeping.load()) {
+    std::scoped_lock l(finisher_lock);
+    finisher_cond.notify_one();
+  }
+}
+
+void ShardedFinisher::start()
+{
+  ldout(cct, 10) << __func__ << " " << shards.size() << " shards" << dendl;
+  finisher_thread.create(thread_name.c_str());
+}
+
+void ShardedFinisher::stop()
+{
+  ldout(cct, 10) << __func__ << dendl;
+  {
+    std::scoped_lock l(finisher_lock);
+    finisher_stop = true;
+    finisher_cond.notify_all();
+  }
+  finisher_thread.join();
+  ldout(cct, 10) << __func__ << " finish" << dendl;
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  std::unique_lock ul(finisher_lock);
+  empty_waiters = true;
+  while (pending.load() > 0) {
+    ldout(cct, 10) << "wait_for_empty waiting" << dendl;
+    finisher_empty_cond.wait(ul);
+  }
+  ldout(cct, 10) << "wait_for_empty empty" << dendl;
+  empty_waiters = false;
+}
+
+void *ShardedFinisher::finisher_thread_entry()
+{
+  ldout(cct, 10) << "finisher_thread start" << dendl;
+
+  while (true) {
+    // take what is there, a shard at a time; each shard stays in order
+    int64_t depth = pending.load();
+    for (auto& shard : shards) {
+      while (node_t *n = shard.pop()) {
+	in_progress_queue.push_back(n);
+      }
+    }
+
+    if (!in_progress_queue.empty()) {
+      ldout(cct, 10) << "finisher_thread doing " << in_progress_queue.size()
+		     << dendl;
+      utime_t start;
+      if (logger) {
+	start = ceph_clock_now();
+      }
+      for (auto n : in_progress_queue) {
+	n->c->complete(n->r);
+	delete n;
+      }
+      size_t count = in_progress_queue.size();
+      in_progress_queue.clear();
+      if (logger) {
+	utime_t lat = ceph_clock_now() - start;
+	logger->dec(l_finisher_queue_len, count);
+	logger->tinc(l_finisher_complete_lat, lat);
+	logger->hinc(l_finisher_queue_depth_hist, depth, lat.to_nsec() / 1000);
+      }
+      if (pending.fetch_sub(count) == (int64_t)count && empty_waiters.load()) {
+	std::scoped_lock l(finisher_lock);
+	finisher_empty_cond.notify_all();
+      }
+      continue;
+    }
+
+    if (pending.load() > 0) {
+      // queued, but its producer has not linked it yet
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock ul(finisher_lock);
+    if (empty_waiters) {
+      finisher_empty_cond.notify_all();
+    }
+    if (finisher_stop) {
+      break;
+    }
+    sleeping = true;
+    ldout(cct, 10) << "finisher_thread sleeping" << dendl;
+    finisher_cond.wait(ul, [this] {
+      return pending.load() > 0 || finisher_stop;
+    });
+    sleeping = false;
+  }
+  finisher_empty_cond.notify_all();
+
+  ldout(cct, 10) << "finisher_thread stop" << dendl;
+  finisher_stop = false;
+  return 0;
+}
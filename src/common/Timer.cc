@@ -235,3 +235,215 @@ void CommonSafeTimer<Mutex>::dump(const char *caller) const
 
 template class CommonSafeTimer<ceph::mutex>;
 template class CommonSafeTimer<ceph::fair_mutex>;
+
+template <class Mutex>
+class CommonWheelTimerThread : public Thread {
+  CommonWheelTimer<Mutex> *parent;
+public:
+  explicit CommonWheelTimerThread(CommonWheelTimer<Mutex> *s) : parent(s) {}
+  void *entry() override {
+    parent->timer_thread();
+    return NULL;
+  }
+};
+
+template <class Mutex>
+CommonWheelTimer<Mutex>::CommonWheelTimer(CephContext *cct_, Mutex &l,
+					  bool safe_callbacks,
+					  ceph::timespan resolution)
+  : cct(cct_), lock(l),
+    safe_callbacks(safe_callbacks),
+    thread(NULL),
+    origin(clock_t::now()),
+    resolution(resolution),
+    sleeping_until(std::numeric_limits<tick_t>::max()),
+    stopping(false)
+{
+  ceph_assert(resolution > ceph::timespan::zero());
+}
+
+template <class Mutex>
+CommonWheelTimer<Mutex>::~CommonWheelTimer()
+{
+  ceph_assert(thread == NULL);
+}
+
+template <class Mutex>
+typename CommonWheelTimer<Mutex>::tick_t
+CommonWheelTimer<Mutex>::to_tick(clock_t::time_point t, bool round_up) const
+{
+  if (t <= origin) {
+    return 0;
+  }
+  auto d = t - origin;
+  if (round_up) {
+    d += resolution - clock_t::duration(1);
+  }
+  return d / resolution;
+}
+
+template <class Mutex>
+typename CommonWheelTimer<Mutex>::clock_t::time_point
+CommonWheelTimer<Mutex>::from_tick(tick_t t) const
+{
+  return origin + resolution * static_cast<ceph::timespan::rep>(t);
+}
+
+template <class Mutex>
+void CommonWheelTimer<Mutex>::init()
+{
+  ldout(cct,10) << "init" << dendl;
+  thread = new CommonWheelTimerThread<Mutex>(this);
+  thread->create("wheel_timer");
+}
+
+template <class Mutex>
+void CommonWheelTimer<Mutex>::shutdown()
+{
+  ldout(cct,10) << "shutdown" << dendl;
+  if (thread) {
+    ceph_assert(ceph_mutex_is_locked(lock));
+    cancel_all_events();
+    stopping = true;
+    cond.notify_all();
+    lock.unlock();
+    thread->join();
+    lock.lock();
+    delete thread;
+    thread = NULL;
+  }
+}
+
+template <class Mutex>
+void CommonWheelTimer<Mutex>::timer_thread()
+{
+  std::unique_lock l{lock};
+  ldout(cct,10) << "timer_thread starting" << dendl;
+  while (!stopping) {
+    // everything due by now, in one go; callbacks may add and cancel
+    // events (and drop the lock) as they please meanwhile
+    schedule.advance(to_tick(clock_t::now(), false),
+		     [&](ceph::timer_wheel::entry& e) {
+      Context *callback = static_cast<event_t&>(e).callback;
+      events.erase(callback);
+      ldout(cct,10) << "timer_thread executing " << callback << dendl;
+
+      if (!safe_callbacks) {
+	l.unlock();
+	callback->complete(0);
+	l.lock();
+      } else {
+	callback->complete(0);
+      }
+    });
+
+    // recheck stopping if we dropped the lock
+    if (!safe_callbacks && stopping)
+      break;
+
+    ldout(cct,20) << "timer_thread going to sleep" << dendl;
+    if (schedule.empty()) {
+      sleeping_until = std::numeric_limits<tick_t>::max();
+      cond.wait(l);
+    } else {
+      sleeping_until = schedule.next_tick();
+      cond.wait_until(l, from_tick(sleeping_until));
+    }
+    ldout(cct,20) << "timer_thread awake" << dendl;
+  }
+  ldout(cct,10) << "timer_thread exiting" << dendl;
+}
+
+template <class Mutex>
+Context* CommonWheelTimer<Mutex>::add_event_after(double seconds, Context *callback)
+{
+  return add_event_after(ceph::make_timespan(seconds), callback);
+}
+
+template <class Mutex>
+Context* CommonWheelTimer<Mutex>::add_event_after(ceph::timespan duration, Context *callback)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+
+  auto when = clock_t::now() + duration;
+  return add_event_at(when, callback);
+}
+
+template <class Mutex>
+Context* CommonWheelTimer<Mutex>::add_event_at(CommonWheelTimer<Mutex>::clock_t::time_point when, Context *callback)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+  ldout(cct,10) << __func__ << " " << when << " -> " << callback << dendl;
+  if (stopping) {
+    ldout(cct,5) << __func__ << " already shutdown, event not added" << dendl;
+    delete callback;
+    return nullptr;
+  }
+  auto [p, inserted] = events.try_emplace(callback);
+
+  /* If you hit this, you tried to insert the same Context* twice. */
+  ceph_assert(inserted);
+
+  auto t = to_tick(when, true);
+  p->second.callback = callback;
+  schedule.add(p->second, t);
+
+  /* Only wake the timer thread up if it would otherwise sleep through
+   * this one. */
+  if (t < sleeping_until) {
+    sleeping_until = t;
+    cond.notify_all();
+  }
+  return callback;
+}
+
+template <class Mutex>
+Context* CommonWheelTimer<Mutex>::add_event_at(ceph::real_clock::time_point when, Context *callback)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+  // convert from real_clock to mono_clock
+  auto mono_now = ceph::mono_clock::now();
+  auto real_now = ceph::real_clock::now();
+  const auto delta = when - real_now;
+  const auto mono_atime = (mono_now +
+			   std::chrono::ceil<clock_t::duration>(delta));
+  return add_event_at(mono_atime, callback);
+}
+
+template <class Mutex>
+bool CommonWheelTimer<Mutex>::cancel_event(Context *callback)
+{
+  ceph_assert(ceph_mutex_is_locked(lock));
+
+  auto p = events.find(callback);
+  if (p == events.end()) {
+    ldout(cct,10) << "cancel_event " << callback << " not found" << dendl;
+    return false;
+  }
+
+  ldout(cct,10) << "cancel_event " << from_tick(p->second.expires)
+		<< " -> " << callback << dendl;
+  delete p->first;
+
+  schedule.remove(p->second);
+  events.erase(p);
+  return true;
+}
+
+template <class Mutex>
+void CommonWheelTimer<Mutex>::cancel_all_events()
+{
+  ldout(cct,10) << "cancel_all_events" << dendl;
+  ceph_assert(ceph_mutex_is_locked(lock));
+
+  schedule.clear();
+  for (auto& [callback, e] : events) {
+    ldout(cct,10) << " cancelled " << from_tick(e.expires) << " -> "
+		  << callback << dendl;
+    delete callback;
+  }
+  events.clear();
+}
+
+template class CommonWheelTimer<ceph::mutex>;
+template class CommonWheelTimer<ceph::fair_mutex>;
@@ -16,15 +16,18 @@
 #define CEPH_TIMER_H
 
 #include <map>
+#include <unordered_map>
 #include "include/common_fwd.h"
 #include "ceph_time.h"
 #include "ceph_mutex.h"
 #include "fair_mutex.h"
+#include "timer_wheel.h"
 #include <condition_variable>
 
 class Context;
 
 template <class Mutex> class CommonSafeTimerThread;
+template <class Mutex> class CommonWheelTimerThread;
 
 template <class Mutex>
 class CommonSafeTimer
@@ -104,4 +107,69 @@ extern template class CommonSafeTimer<ceph::mutex>;
 extern template class CommonSafeTimer<ceph::fair_mutex>;
 using SafeTimer = class CommonSafeTimer<ceph::mutex>;
 
+/*
+ * A drop-in replacement for CommonSafeTimer that keeps its events in a
+ * hierarchical timing wheel instead of a multimap: adding and
+ * cancelling an event is O(1) no matter how many are pending, and the
+ * timer thread expires everything that is due in one pass.  Meant for
+ * users with lots of short-lived timeouts that mostly get cancelled.
+ *
+ * Events fire on tick boundaries, so up to one tick (1ms unless told
+ * otherwise) later than asked for; never earlier.
+ */
+template <class Mutex>
+class CommonWheelTimer
+{
+  CephContext *cct;
+  Mutex& lock;
+  std::condition_variable_any cond;
+  bool safe_callbacks;
+
+  friend class CommonWheelTimerThread<Mutex>;
+  class CommonWheelTimerThread<Mutex> *thread;
+
+  void timer_thread();
+
+  using clock_t = ceph::mono_clock;
+  using tick_t = ceph::timer_wheel::tick_t;
+  const clock_t::time_point origin;  // tick 0
+  const ceph::timespan resolution;
+
+  struct event_t : ceph::timer_wheel::entry {
+    Context *callback = nullptr;
+  };
+  using event_lookup_map_t = std::unordered_map<Context*, event_t>;
+  event_lookup_map_t events;
+  ceph::timer_wheel schedule;  // of events, which must outlive it
+  tick_t sleeping_until;       // what the timer thread waits for
+  bool stopping;
+
+  tick_t to_tick(clock_t::time_point t, bool round_up) const;
+  clock_t::time_point from_tick(tick_t t) const;
+
+public:
+  CommonWheelTimer(const CommonWheelTimer&) = delete;
+  CommonWheelTimer& operator=(const CommonWheelTimer&) = delete;
+
+  /* See CommonSafeTimer for safe_callbacks. */
+  CommonWheelTimer(CephContext *cct, Mutex &l, bool safe_callbacks=true,
+		   ceph::timespan resolution=std::chrono::milliseconds(1));
+  virtual ~CommonWheelTimer();
+
+  /* Same as CommonSafeTimer's, down to the locking rules. */
+  void init();
+  void shutdown();
+
+  Context* add_event_after(ceph::timespan duration, Context *callback);
+  Context* add_event_after(double seconds, Context *callback);
+  Context* add_event_at(clock_t::time_point when, Context *callback);
+  Context* add_event_at(ceph::real_clock::time_point when, Context *callback);
+  bool cancel_event(Context *callback);
+  void cancel_all_events();
+};
+
+extern template class CommonWheelTimer<ceph::mutex>;
+extern template class CommonWheelTimer<ceph::fair_mutex>;
+using WheelTimer = class CommonWheelTimer<ceph::mutex>;
+
 #endif
@@ -18,6 +18,11 @@
 #include <limits.h>
 
 #include <sys/uio.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include "include/ceph_assert.h"
 #include "include/types.h"
@@ -231,6 +236,170 @@ static ceph::spinlock debug_lock;
     ~raw_claim_buffer() override {}
   };
 
+  /*
+   * hugepage_pool hands out fixed size chunks carved from 2MB hugepage
+   * slabs.  Chunks are kept on per-NUMA-node free lists and recycled
+   * there when the owning raw goes away; nothing is ever handed back to
+   * the OS.  Slabs are populated by the thread that maps them, so the
+   * default first-touch policy places them on that thread's node.
+   */
+namespace {
+  class hugepage_pool {
+  public:
+    static constexpr size_t SLAB_SIZE = 2u << 20;
+    // every power of two from 4K to 4M, so a chunk is never more than
+    // twice what was asked for
+    static constexpr unsigned MIN_CLASS_SHIFT = 12;
+    static constexpr unsigned NUM_CLASSES = 11;
+    static constexpr unsigned MAX_NODES = 16;
+    static constexpr size_t class_size(unsigned c) {
+      return size_t(1) << (MIN_CLASS_SHIFT + c);
+    }
+
+    static hugepage_pool& get() {
+      // intentionally leaked: pooled raws may outlive static destructors
+      static hugepage_pool *pool = new hugepage_pool;
+      return *pool;
+    }
+
+    void set_max_bytes(uint64_t max) {
+      max_bytes = max;
+    }
+    uint64_t get_mapped_bytes() const {
+      return mapped_bytes;
+    }
+
+    /// smallest class that fits len at align, or -1
+    static int get_class(unsigned len, unsigned align) {
+      for (unsigned c = 0; c < NUM_CLASSES; ++c) {
+	if (len <= class_size(c) &&
+	    align <= std::min(class_size(c), SLAB_SIZE)) {
+	  return c;
+	}
+      }
+      return -1;
+    }
+
+    static unsigned get_node() {
+      unsigned node = 0;
+#if defined(__linux__) && defined(SYS_getcpu)
+      unsigned cpu;
+      if (::syscall(SYS_getcpu, &cpu, &node, nullptr) < 0) {
+	node = 0;
+      }
+#endif
+      return node % MAX_NODES;
+    }
+
+    char *alloc(unsigned c, unsigned node) {
+      auto& n = nodes[node];
+      {
+	std::lock_guard l(n.lock);
+	if (!n.free[c].empty()) {
+	  char *p = n.free[c].back();
+	  n.free[c].pop_back();
+	  return p;
+	}
+      }
+      const size_t map_len = std::max(SLAB_SIZE, class_size(c));
+      if (mapped_bytes.fetch_add(map_len) + map_len > max_bytes) {
+	mapped_bytes -= map_len;
+	return nullptr;
+      }
+      char *region = map_region(map_len);
+      if (!region) {
+	mapped_bytes -= map_len;
+	return nullptr;
+      }
+      std::lock_guard l(n.lock);
+      for (size_t off = class_size(c); off < map_len; off += class_size(c)) {
+	n.free[c].push_back(region + off);
+      }
+      return region;
+    }
+
+    void release(char *p, unsigned c, unsigned node) {
+      auto& n = nodes[node];
+      std::lock_guard l(n.lock);
+      n.free[c].push_back(p);
+    }
+
+  private:
+    struct node_t {
+      ceph::spinlock lock;
+      std::vector<char*> free[NUM_CLASSES];
+    };
+    node_t nodes[MAX_NODES];
+    std::atomic<uint64_t> max_bytes = {0};
+    std::atomic<uint64_t> mapped_bytes = {0};
+
+    /// map len bytes aligned to SLAB_SIZE, preferring explicit hugepages
+    static char *map_region(size_t len) {
+#ifdef _WIN32
+      return nullptr;
+#else
+      void *p;
+#ifdef MAP_HUGETLB
+      p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB,
+		       -1, 0);
+      if (p != MAP_FAILED) {
+	return static_cast<char*>(p);
+      }
+#endif
+      // no reserved hugepages; over-map so the slab can be aligned for THP
+      const size_t over_len = len + SLAB_SIZE;
+      p = ::mmap(nullptr, over_len, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+	return nullptr;
+      }
+      char *base = static_cast<char*>(p);
+      char *aligned = reinterpret_cast<char*>(
+	p2roundup(reinterpret_cast<uintptr_t>(base), uintptr_t(SLAB_SIZE)));
+      if (aligned > base) {
+	::munmap(base, aligned - base);
+      }
+      if (base + over_len > aligned + len) {
+	::munmap(aligned + len, base + over_len - (aligned + len));
+      }
+#ifdef MADV_HUGEPAGE
+      ::madvise(aligned, len, MADV_HUGEPAGE);
+#endif
+      // touch it now so first-touch places it on this node
+      memset(aligned, 0, len);
+      return aligned;
+#endif
+    }
+  };
+} // anonymous namespace
+
+  class buffer::raw_hugepage_pooled : public buffer::raw {
+    unsigned size_class;
+    unsigned node;
+  public:
+    MEMPOOL_CLASS_HELPERS();
+
+    raw_hugepage_pooled(char *d, unsigned l, unsigned c, unsigned n)
+      : raw(d, l, mempool::mempool_buffer_hugepage),
+	size_class(c), node(n) {
+      bdout << "raw_hugepage_pooled " << this << " alloc " << (void *)data
+	    << " l=" << l << ", class=" << c << ", node=" << n << bendl;
+    }
+    ~raw_hugepage_pooled() override {
+      hugepage_pool::get().release(data, size_class, node);
+      bdout << "raw_hugepage_pooled " << this << " free " << (void *)data
+	    << bendl;
+    }
+  };
+
+  void buffer::set_hugepage_pool_max_bytes(uint64_t max) {
+    hugepage_pool::get().set_max_bytes(max);
+  }
+  uint64_t buffer::get_hugepage_pool_mapped_bytes() {
+    return hugepage_pool::get().get_mapped_bytes();
+  }
+
   ceph::unique_leakable_ptr<buffer::raw> buffer::copy(const char *c, unsigned len) {
     auto r = buffer::create_aligned(len, sizeof(size_t));
     memcpy(r->get_data(), c, len);
@@ -309,6 +478,20 @@ static ceph::spinlock debug_lock;
       return create_aligned(len, CEPH_PAGE_SIZE);
     }
   }
+  ceph::unique_leakable_ptr<buffer::raw> buffer::create_hugepage_pooled(
+    unsigned len, unsigned align) {
+    // anything the pool cannot serve is allocated as usual
+    if (len > 0) {
+      if (int c = hugepage_pool::get_class(len, align); c >= 0) {
+	const unsigned node = hugepage_pool::get_node();
+	if (char *p = hugepage_pool::get().alloc(c, node); p) {
+	  return ceph::unique_leakable_ptr<buffer::raw>(
+	    new raw_hugepage_pooled(p, len, c, node));
+	}
+      }
+    }
+    return create_aligned(len, align);
+  }
 
   buffer::ptr::ptr(ceph::unique_leakable_ptr<raw> r)
     : _raw(r.release()),
@@ -2254,6 +2437,8 @@ MEMPOOL_DEFINE_OBJECT_FACTORY(buffer::raw_claimed_char, buffer_raw_claimed_char,
 			      buffer_meta);
 MEMPOOL_DEFINE_OBJECT_FACTORY(buffer::raw_static, buffer_raw_static,
 			      buffer_meta);
+MEMPOOL_DEFINE_OBJECT_FACTORY(buffer::raw_hugepage_pooled,
+			      buffer_raw_hugepage_pooled, buffer_meta);
 
 
 void ceph::buffer::list::page_aligned_appender::_refill(size_t len) {
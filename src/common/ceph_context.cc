@@ -167,6 +167,7 @@ public:
   const char** get_tracked_conf_keys() const override {
     static const char *KEYS[] = {
       "mempool_debug",
+      "buffer_hugepage_pool_max_bytes",
       NULL
     };
     return KEYS;
@@ -178,6 +179,10 @@ public:
     if (changed.count("mempool_debug")) {
       mempool::set_debug_mode(cct->_conf->mempool_debug);
     }
+    if (changed.count("buffer_hugepage_pool_max_bytes")) {
+      ceph::buffer::set_hugepage_pool_max_bytes(
+	cct->_conf->buffer_hugepage_pool_max_bytes);
+    }
   }
 
   // AdminSocketHook
@@ -19,9 +19,11 @@
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <boost/intrusive/set.hpp>
 
 #include "include/function2.hpp"
@@ -29,6 +31,7 @@
 
 #include "common/detail/construct_suspended.h"
 #include "common/Thread.h"
+#include "common/timer_wheel.h"
 
 namespace bi = boost::intrusive;
 namespace ceph {
@@ -320,6 +323,257 @@ public:
     }
   }
 }; // timer
+
+// The same as timer, but with its events in a hierarchical timing
+// wheel (see timer_wheel.h), so scheduling, adjusting and cancelling
+// are O(1) rather than O(log n) in the number of pending events and
+// the thread expires whatever is due in one go.  For when there are
+// lots of them, like op timeouts.
+//
+// Events are run on tick boundaries, so up to one tick (1ms by
+// default) late, and never early.  Those due in the same tick run in
+// the order they were scheduled.
+
+template<typename TC>
+class wheel_timer {
+  using tick_t = timer_wheel::tick_t;
+
+  struct event : timer_wheel::entry {
+    std::uint64_t id = 0;
+    fu2::unique_function<void()> f;
+
+    event(std::uint64_t id, fu2::unique_function<void()> f)
+      : id(id), f(std::move(f)) {}
+  };
+
+  const typename TC::time_point origin;  // tick 0
+  const typename TC::duration resolution;
+
+  timer_wheel schedule;
+  std::unordered_map<std::uint64_t, event*> events;
+
+  std::mutex lock;
+  std::condition_variable cond;
+
+  event* running = nullptr;
+  std::uint64_t next_id = 0;
+  // the tick the timer thread is waiting for
+  tick_t sleeping_until = std::numeric_limits<tick_t>::max();
+
+  bool suspended;
+  std::thread thread;
+
+  tick_t to_tick(typename TC::time_point t, bool round_up) const {
+    if (t <= origin) {
+      return 0;
+    }
+    auto d = t - origin;
+    if (round_up) {
+      d += resolution - typename TC::duration(1);
+    }
+    return d / resolution;
+  }
+  typename TC::time_point from_tick(tick_t t) const {
+    return origin + resolution * static_cast<typename TC::duration::rep>(t);
+  }
+
+  // Call with the lock held.
+  void schedule_event(event& e, tick_t t) {
+    schedule.add(e, t);
+    // wake the thread if it would sleep through this one
+    if (t < sleeping_until) {
+      sleeping_until = t;
+      cond.notify_one();
+    }
+  }
+
+  void timer_thread() {
+    std::unique_lock l(lock);
+    while (!suspended) {
+      schedule.advance(to_tick(TC::now(), false), [&](timer_wheel::entry& en) {
+	auto& e = static_cast<event&>(en);
+	events.erase(e.id);
+
+	// Since we have only one thread it is impossible to have more
+	// than one running event
+	running = &e;
+
+	l.unlock();
+	e.f();
+	l.lock();
+
+	if (running) {
+	  running = nullptr;
+	  delete &e;
+	} // Otherwise the event requeued itself
+      });
+
+      if (suspended)
+	break;
+      if (schedule.empty()) {
+	sleeping_until = std::numeric_limits<tick_t>::max();
+	cond.wait(l);
+      } else {
+	sleeping_until = schedule.next_tick();
+	cond.wait_until(l, from_tick(sleeping_until));
+      }
+    }
+  }
+
+  static typename TC::duration default_resolution() {
+    return std::chrono::duration_cast<typename TC::duration>(
+      std::chrono::milliseconds(1));
+  }
+
+public:
+  explicit wheel_timer(typename TC::duration resolution = default_resolution())
+    : origin(TC::now()), resolution(resolution), suspended(false) {
+    assert(resolution > TC::duration::zero());
+    thread = std::thread(&wheel_timer::timer_thread, this);
+    set_thread_name(thread, "ceph_timer");
+  }
+
+  // Create a suspended timer, jobs will be executed in order when
+  // it is resumed.
+  explicit wheel_timer(construct_suspended_t,
+		       typename TC::duration resolution = default_resolution())
+    : origin(TC::now()), resolution(resolution), suspended(true) {
+    assert(resolution > TC::duration::zero());
+  }
+
+  wheel_timer(const wheel_timer&) = delete;
+  wheel_timer& operator =(const wheel_timer&) = delete;
+
+  ~wheel_timer() {
+    suspend();
+    cancel_all_events();
+  }
+
+  // Suspend operation of the timer (and let its thread die).
+  void suspend() {
+    std::unique_lock l(lock);
+    if (suspended)
+      return;
+
+    suspended = true;
+    cond.notify_one();
+    l.unlock();
+    thread.join();
+  }
+
+  // Resume operation of the timer. (Must have been previously
+  // suspended.)
+  void resume() {
+    std::unique_lock l(lock);
+    if (!suspended)
+      return;
+
+    suspended = false;
+    assert(!thread.joinable());
+    thread = std::thread(&wheel_timer::timer_thread, this);
+  }
+
+  // Schedule an event in the relative future
+  template<typename Callable, typename... Args>
+  std::uint64_t add_event(typename TC::duration duration,
+			  Callable&& f, Args&&... args) {
+    return add_event(TC::now() + duration,
+		     std::forward<Callable>(f),
+		     std::forward<Args>(args)...);
+  }
+
+  // Schedule an event in the absolute future
+  template<typename Callable, typename... Args>
+  std::uint64_t add_event(typename TC::time_point when,
+			  Callable&& f, Args&&... args) {
+    std::lock_guard l(lock);
+    auto e = new event(++next_id, std::bind(std::forward<Callable>(f),
+					    std::forward<Args>(args)...));
+    events.emplace(e->id, e);
+    schedule_event(*e, to_tick(when, true));
+    return e->id;
+  }
+
+  // Adjust the timeout of a currently-scheduled event (relative)
+  bool adjust_event(std::uint64_t id, typename TC::duration duration) {
+    return adjust_event(id, TC::now() + duration);
+  }
+
+  // Adjust the timeout of a currently-scheduled event (absolute)
+  bool adjust_event(std::uint64_t id, typename TC::time_point when) {
+    std::lock_guard l(lock);
+
+    auto it = events.find(id);
+
+    if (it == events.end())
+      return false;
+
+    auto& e = *it->second;
+    schedule.remove(e);
+    schedule_event(e, to_tick(when, true));
+
+    return true;
+  }
+
+  // Cancel an event. If the event has already come and gone (or you
+  // never submitted it) you will receive false. Otherwise you will
+  // receive true and it is guaranteed the event will not execute.
+  bool cancel_event(const std::uint64_t id) {
+    std::lock_guard l(lock);
+    auto p = events.find(id);
+    if (p == events.end()) {
+      return false;
+    }
+
+    auto e = p->second;
+    events.erase(p);
+    schedule.remove(*e);
+    delete e;
+
+    return true;
+  }
+
+  // Reschedules a currently running event in the relative
+  // future. Must be called only from an event executed by this
+  // timer; see timer::reschedule_me.
+  //
+  // Returns an event id. If you had an event_id from the first
+  // scheduling, replace it with this return value.
+  std::uint64_t reschedule_me(typename TC::duration duration) {
+    return reschedule_me(TC::now() + duration);
+  }
+
+  // Reschedules a currently running event in the absolute
+  // future. Must be called only from an event executed by this
+  // timer; see timer::reschedule_me.
+  //
+  // Returns an event id. If you had an event_id from the first
+  // scheduling, replace it with this return value.
+  std::uint64_t reschedule_me(typename TC::time_point when) {
+    assert(std::this_thread::get_id() == thread.get_id());
+    std::lock_guard l(lock);
+    std::uint64_t id = ++next_id;
+    running->id = id;
+    events.emplace(id, running);
+    schedule_event(*running, to_tick(when, true));
+
+    // Hacky, but keeps us from being deleted
+    running = nullptr;
+
+    // Same function, but you get a new ID.
+    return id;
+  }
+
+  // Remove all events from the queue.
+  void cancel_all_events() {
+    std::lock_guard l(lock);
+    schedule.clear();
+    for (auto& [id, e] : events) {
+      delete e;
+    }
+    events.clear();
+  }
+}; // wheel_timer
 } // namespace ceph
 
 #endif
@@ -0,0 +1,291 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef COMMON_TIMER_WHEEL_H
+#define COMMON_TIMER_WHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <boost/intrusive/list.hpp>
+
+#include "include/ceph_assert.h"
+
+namespace ceph {
+
+// A hierarchical timing wheel, after Varghese & Lauck.
+//
+// Time is counted in ticks.  Level 0 has one slot per tick for the
+// next 256 ticks; each level above has 64 slots, each slot spanning
+// all of the level below it.  An entry is linked into the slot of the
+// lowest level its expiry fits in, and moved down a level when the
+// wheel turns into that slot ("cascading"), so that adding and
+// removing entries is O(1) no matter how many are pending, and
+// expiring them costs O(1) per entry plus at most one cascade per
+// level.  Entries further away than the top level covers (2^32 ticks)
+// are parked in its furthest slot and cascade back into it until they
+// come close enough.
+//
+// Entries expire at tick granularity, never early, and in the order
+// they were added among those expiring in the same tick, as they would
+// from a multimap keyed by expiry.  The wheel does no locking and no
+// allocation; the caller owns the entries, which must stay put while
+// linked.
+
+class timer_wheel {
+public:
+  using tick_t = std::uint64_t;
+
+  struct entry {
+    boost::intrusive::list_member_hook<> hook;
+    tick_t expires = 0;
+    std::uint64_t seq = 0;   // orders entries expiring in the same tick
+    std::uint16_t slot = 0;  // index into slots
+
+    entry() = default;
+    entry(const entry&) = delete;
+    entry& operator =(const entry&) = delete;
+
+    bool is_linked() const {
+      return hook.is_linked();
+    }
+  };
+
+private:
+  static constexpr unsigned LEVELS = 5;
+  static constexpr unsigned L0_BITS = 8;
+  static constexpr unsigned LN_BITS = 6;
+  static constexpr unsigned NUM_SLOTS =
+    (1u << L0_BITS) + (LEVELS - 1) * (1u << LN_BITS);
+  static constexpr tick_t MAX_DELTA =
+    (tick_t(1) << (L0_BITS + (LEVELS - 1) * LN_BITS)) - 1;
+
+  static constexpr unsigned shift(unsigned l) {
+    return l == 0 ? 0 : L0_BITS + (l - 1) * LN_BITS;
+  }
+  static constexpr unsigned num_slots(unsigned l) {
+    return l == 0 ? 1u << L0_BITS : 1u << LN_BITS;
+  }
+  static constexpr unsigned first_slot(unsigned l) {
+    return l == 0 ? 0 : (1u << L0_BITS) + (l - 1) * (1u << LN_BITS);
+  }
+
+  using list_t = boost::intrusive::list<
+    entry,
+    boost::intrusive::member_hook<entry, boost::intrusive::list_member_hook<>,
+				  &entry::hook>,
+    boost::intrusive::constant_time_size<false>>;
+
+  std::array<list_t, NUM_SLOTS> slots;
+  // one bit per non-empty slot, so finding the next one is cheap
+  std::array<std::uint64_t, NUM_SLOTS / 64> occupied = {};
+
+  tick_t cur;  // the next tick to expire
+  std::uint64_t next_seq = 0;
+  std::size_t num = 0;
+
+  void set_bit(unsigned slot) {
+    occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+  }
+  void clear_bit(unsigned slot) {
+    occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+  }
+
+  // distance from slot 'from' of level l to the next occupied one,
+  // going round; -1 if the level is empty
+  int next_occupied(unsigned l, unsigned from) const {
+    const unsigned n = num_slots(l);
+    const unsigned base = first_slot(l);
+    for (unsigned d = 0; d < n; ) {
+      unsigned i = (from + d) % n;
+      unsigned bit = (base + i) % 64;
+      std::uint64_t w = occupied[(base + i) / 64] >> bit;
+      // don't look past the end of the level within this word
+      unsigned avail = std::min(64 - bit, n - i);
+      if (avail < 64) {
+	w &= (std::uint64_t(1) << avail) - 1;
+      }
+      if (w) {
+	d += __builtin_ctzll(w);
+	return d < n ? (int)d : -1;
+      }
+      d += avail;
+    }
+    return -1;
+  }
+
+  void link(entry& e) {
+    tick_t delta = std::min(e.expires > cur ? e.expires - cur : 0, MAX_DELTA);
+    tick_t t = cur + delta;
+    unsigned l = 0;
+    while (l + 1 < LEVELS && delta >= (tick_t(1) << shift(l + 1))) {
+      ++l;
+    }
+    e.slot = first_slot(l) + ((t >> shift(l)) & (num_slots(l) - 1));
+    slots[e.slot].push_back(e);
+    set_bit(e.slot);
+  }
+
+  void unlink(entry& e) {
+    auto& s = slots[e.slot];
+    s.erase(s.iterator_to(e));
+    if (s.empty()) {
+      clear_bit(e.slot);
+    }
+  }
+
+  // move everything in the slot that comes due at cur to lower levels
+  void cascade(unsigned l) {
+    unsigned slot = first_slot(l) + ((cur >> shift(l)) & (num_slots(l) - 1));
+    list_t ls;
+    ls.swap(slots[slot]);
+    clear_bit(slot);
+    while (!ls.empty()) {
+      auto& e = ls.front();
+      ls.pop_front();
+      link(e);
+    }
+  }
+
+public:
+  explicit timer_wheel(tick_t now = 0) : cur(now) {}
+  timer_wheel(const timer_wheel&) = delete;
+  timer_wheel& operator =(const timer_wheel&) = delete;
+  ~timer_wheel() {
+    clear();
+  }
+
+  bool empty() const {
+    return num == 0;
+  }
+  std::size_t size() const {
+    return num;
+  }
+  // the next tick advance() will look at
+  tick_t current() const {
+    return cur;
+  }
+
+  // Add an unlinked entry that expires at tick 'expires'.  Anything at
+  // or before current() expires on the next advance().
+  void add(entry& e, tick_t expires) {
+    ceph_assert(!e.is_linked());
+    e.expires = expires;
+    e.seq = next_seq++;
+    link(e);
+    ++num;
+  }
+
+  void remove(entry& e) {
+    ceph_assert(e.is_linked());
+    unlink(e);
+    --num;
+  }
+
+  void update(entry& e, tick_t expires) {
+    remove(e);
+    add(e, expires);
+  }
+
+  // Unlink everything, without expiring it.
+  template<typename F>
+  void clear_and_dispose(F&& f) {
+    for (unsigned i = 0; i < NUM_SLOTS; ++i) {
+      while (!slots[i].empty()) {
+	auto& e = slots[i].front();
+	slots[i].pop_front();
+	--num;
+	f(e);
+      }
+    }
+    occupied.fill(0);
+  }
+  void clear() {
+    clear_and_dispose([](entry&) {});
+  }
+
+  // The first tick at which advance() has something to do: either an
+  // entry expires or a slot needs cascading.  The latter can come
+  // before the earliest expiry, but never after it.  Only meaningful
+  // if !empty().
+  tick_t next_tick() const {
+    tick_t next = std::numeric_limits<tick_t>::max();
+    for (unsigned l = 0; l < LEVELS; ++l) {
+      const unsigned n = num_slots(l);
+      const tick_t period = cur >> shift(l);
+      // the current slot is due now if cur is where it starts;
+      // otherwise it has been cascaded already and whatever is in it
+      // now is a lap ahead
+      const tick_t skip =
+	(l == 0 || (cur & ((tick_t(1) << shift(l)) - 1)) == 0) ? 0 : 1;
+      int d = next_occupied(l, (period + skip) & (n - 1));
+      if (d < 0) {
+	continue;
+      }
+      next = std::min(next, l == 0 ? cur + d : (period + skip + d) << shift(l));
+    }
+    return next;
+  }
+
+  // Expire everything up to and including tick 'now', calling f(entry&)
+  // on each after unlinking it.  f may add and remove entries
+  // (including the one it was passed, and the caller may drop locks in
+  // it); the wheel does not hold on to anything across the call.
+  template<typename F>
+  void advance(tick_t now, F&& f) {
+    while (cur <= now) {
+      if (num == 0) {
+	cur = now + 1;
+	break;
+      }
+      tick_t next = next_tick();
+      if (next > now) {
+	cur = now + 1;
+	break;
+      }
+      cur = std::max(cur, next);
+
+      // cascade the top levels first, so that whatever lands in the
+      // lower levels' current slots is cascaded along with them
+      unsigned top = 0;
+      while (top + 1 < LEVELS &&
+	     (cur & ((tick_t(1) << shift(top + 1)) - 1)) == 0) {
+	++top;
+      }
+      for (unsigned l = top; l > 0; --l) {
+	cascade(l);
+      }
+
+      // whatever was cascaded into this slot went in after what was
+      // added to it directly
+      auto& s = slots[cur & (num_slots(0) - 1)];
+      s.sort([](const entry& a, const entry& b) {
+	return a.expires == b.expires ? a.seq < b.seq : a.expires < b.expires;
+      });
+      while (!s.empty()) {
+	auto& e = s.front();
+	s.pop_front();
+	--num;
+	if (s.empty()) {
+	  clear_bit(e.slot);
+	}
+	f(e);
+      }
+      ++cur;
+    }
+  }
+};
+
+} // namespace ceph
+
+#endif
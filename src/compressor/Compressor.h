@@ -91,6 +91,11 @@ public:
     return alg;
   }
   virtual int compress(const ceph::bufferlist &in, ceph::bufferlist &out, std::optional<int32_t> &compressor_message) = 0;
+  // compress at the given level rather than the configured one; for
+  // algorithms without levels this is the same as compress()
+  virtual int compress_with_level(const ceph::bufferlist &in, ceph::bufferlist &out, std::optional<int32_t> &compressor_message, int level) {
+    return compress(in, out, compressor_message);
+  }
   virtual int decompress(const ceph::bufferlist &in, ceph::bufferlist &out, std::optional<int32_t> compressor_message) = 0;
   // this is a bit weird but we need non-const iterator to be in
   // alignment with decode methods
@@ -27,8 +27,13 @@ class ZstdCompressor : public Compressor {
   ZstdCompressor(CephContext *cct) : Compressor(COMP_ALG_ZSTD, "zstd"), cct(cct) {}
 
   int compress(const ceph::buffer::list &src, ceph::buffer::list &dst, std::optional<int32_t> &compressor_message) override {
+    return compress_with_level(src, dst, compressor_message,
+			       cct->_conf->compressor_zstd_level);
+  }
+
+  int compress_with_level(const ceph::buffer::list &src, ceph::buffer::list &dst, std::optional<int32_t> &compressor_message, int level) override {
     ZSTD_CStream *s = ZSTD_createCStream();
-    ZSTD_initCStream_srcSize(s, cct->_conf->compressor_zstd_level, src.length());
+    ZSTD_initCStream_srcSize(s, level, src.length());
     auto p = src.begin();
     size_t left = src.length();
 
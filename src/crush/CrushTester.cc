@@ -18,6 +18,7 @@
 #include "common/ceph_context.h"
 #include "include/ceph_features.h"
 #include "common/debug.h"
+#include "common/ceph_time.h"
 
 #define dout_subsys ceph_subsys_crush
 #undef dout_prefix
@@ -762,3 +763,80 @@ int CrushTester::compare(CrushWrapper& crush2)
   }
   return ret;
 }
+
+int CrushTester::bench()
+{
+  if (min_rule < 0 || max_rule < 0) {
+    min_rule = 0;
+    max_rule = crush.get_max_rules() - 1;
+  }
+  if (min_x < 0 || max_x < 0) {
+    min_x = 0;
+    max_x = 1023;
+  }
+
+  // initial osd weights
+  vector<__u32> weight;
+  for (int o = 0; o < crush.get_max_devices(); o++) {
+    if (device_weight.count(o)) {
+      weight.push_back(device_weight[o]);
+    } else if (crush.check_item_present(o)) {
+      weight.push_back(0x10000);
+    } else {
+      weight.push_back(0);
+    }
+  }
+  adjust_weights(weight);
+
+  vector<int> xs;
+  for (int x = min_x; x <= max_x; ++x) {
+    xs.push_back(x);
+  }
+
+  int ret = 0;
+  for (int r = min_rule; r < crush.get_max_rules() && r <= max_rule; r++) {
+    if (!crush.rule_exists(r)) {
+      if (output_statistics)
+        err << "rule " << r << " dne" << std::endl;
+      continue;
+    }
+    for (int nr = min_rep; nr <= max_rep; nr++) {
+      vector<vector<int>> scalar_out;
+      auto start = ceph::mono_clock::now();
+      crush.do_rule_batch(r, xs, scalar_out, nr, weight, 0, false);
+      double scalar_sec = std::chrono::duration<double>(
+	ceph::mono_clock::now() - start).count();
+
+      vector<vector<int>> batch_out;
+      start = ceph::mono_clock::now();
+      crush.do_rule_batch(r, xs, batch_out, nr, weight, 0);
+      double batch_sec = std::chrono::duration<double>(
+	ceph::mono_clock::now() - start).count();
+
+      int bad = 0;
+      for (size_t i = 0; i < xs.size(); ++i) {
+	if (scalar_out[i] != batch_out[i]) {
+	  ++bad;
+	}
+      }
+      if (bad) {
+	ret = -1;
+      }
+      double scalar_rate = xs.size() / std::max(scalar_sec, 1e-9);
+      double batch_rate = xs.size() / std::max(batch_sec, 1e-9);
+      cout << "rule " << r << " (" << crush.get_rule_name(r)
+	   << ") num_rep " << nr
+	   << " scalar " << (uint64_t)scalar_rate << " mappings/sec"
+	   << " batch " << (uint64_t)batch_rate << " mappings/sec"
+	   << " (" << batch_rate / scalar_rate << "x)";
+      if (bad) {
+	cout << " " << bad << "/" << xs.size() << " mismatched mappings";
+      }
+      cout << std::endl;
+    }
+  }
+  if (ret) {
+    cerr << "warning: batch mappings do NOT match" << std::endl;
+  }
+  return ret;
+}
@@ -352,6 +352,13 @@ public:
   int test_with_fork(CephContext* cct, int timeout);
 
   int compare(CrushWrapper& other);
+  /**
+   * time the scalar straw2 draws against the vectorized ones over the
+   * --test parameters, checking that both produce the same mappings
+   *
+   * @return 0 if the mappings are identical, -1 otherwise
+   */
+  int bench();
 };
 
 #endif
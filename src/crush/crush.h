@@ -534,6 +534,7 @@ struct crush_work_bucket {
 
 struct crush_work {
 	struct crush_work_bucket **work; /* Per-bucket working store */
+	int vectorized; /* batch the straw2 item hashes (default where SIMD) */
 };
 
 #endif
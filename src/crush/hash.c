@@ -140,6 +140,55 @@ __u32 crush_hash32_5(int type, __u32 a, __u32 b, __u32 c, __u32 d, __u32 e)
 	}
 }
 
+#if !defined(__KERNEL__) && defined(__GNUC__)
+/*
+ * rjenkins1_3 over several values of b at once.  The generic vector
+ * type lets the compiler use whatever SIMD unit the target has; the
+ * math is the same wrapping 32-bit arithmetic as the scalar version,
+ * so the results are identical.
+ */
+#define CRUSH_HASH_LANES 8
+typedef __u32 crush_hash_vec_t
+	__attribute__((vector_size(CRUSH_HASH_LANES * sizeof(__u32))));
+
+static void crush_hash32_rjenkins1_3_vec(__u32 sa, const __u32 *sb,
+					 __u32 sc, __u32 *out)
+{
+	crush_hash_vec_t a, b, c, x, y, hash;
+	int i;
+
+	for (i = 0; i < CRUSH_HASH_LANES; i++) {
+		a[i] = sa;
+		c[i] = sc;
+		x[i] = 231232;
+		y[i] = 1232;
+	}
+	memcpy(&b, sb, sizeof(b));
+	hash = (crush_hash_seed ^ a) ^ b ^ c;
+	crush_hashmix(a, b, hash);
+	crush_hashmix(c, x, hash);
+	crush_hashmix(y, a, hash);
+	crush_hashmix(b, x, hash);
+	crush_hashmix(y, c, hash);
+	memcpy(out, &hash, sizeof(hash));
+}
+#endif
+
+void crush_hash32_3_batch(int type, __u32 a, const __u32 *b, __u32 c,
+			  __u32 *out, unsigned int n)
+{
+	unsigned int i = 0;
+
+#if !defined(__KERNEL__) && defined(__GNUC__)
+	if (type == CRUSH_HASH_RJENKINS1) {
+		for (; i + CRUSH_HASH_LANES <= n; i += CRUSH_HASH_LANES)
+			crush_hash32_rjenkins1_3_vec(a, b + i, c, out + i);
+	}
+#endif
+	for (; i < n; i++)
+		out[i] = crush_hash32_3(type, a, b[i], c);
+}
+
 const char *crush_hash_name(int type)
 {
 	switch (type) {
@@ -309,10 +309,8 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
-                                                      int weight)
+static inline __s64 exponential_from_hash(unsigned int u, int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -336,6 +334,12 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
+                                                      int weight)
+{
+	return exponential_from_hash(crush_hash32_3(type, x, y, z), weight);
+}
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
@@ -361,12 +365,69 @@ static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 	return bucket->h.items[high];
 }
 
+/*
+ * Same draws as bucket_straw2_choose(), but the item hashes are
+ * computed a block at a time with crush_hash32_3_batch() so they can
+ * use SIMD.  The result is identical.
+ */
+#define CRUSH_STRAW2_HASH_BLOCK 64
+
+/*
+ * Below this many items the batch hash has no full SIMD block to work
+ * on, so it would only add overhead.
+ */
+#define CRUSH_STRAW2_VEC_MIN_SIZE 8
+
+/*
+ * The vectorized draws give the same results, so use them wherever the
+ * batch hash is vectorized.
+ */
+#if !defined(__KERNEL__) && defined(__GNUC__)
+# define CRUSH_VECTORIZED_DEFAULT 1
+#else
+# define CRUSH_VECTORIZED_DEFAULT 0
+#endif
+
+static int bucket_straw2_choose_vec(const struct crush_bucket_straw2 *bucket,
+				    int x, int r,
+				    const struct crush_choose_arg *arg,
+				    int position)
+{
+	unsigned int i, j, n, high = 0;
+	__s64 draw, high_draw = 0;
+	__u32 u[CRUSH_STRAW2_HASH_BLOCK];
+	__u32 *weights = get_choose_arg_weights(bucket, arg, position);
+	__s32 *ids = get_choose_arg_ids(bucket, arg);
+
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_STRAW2_HASH_BLOCK)
+			n = CRUSH_STRAW2_HASH_BLOCK;
+		crush_hash32_3_batch(bucket->h.hash, x, (const __u32 *)ids + i,
+				     r, u, n);
+		for (j = 0; j < n; j++) {
+			if (weights[i + j])
+				draw = exponential_from_hash(u[j],
+							     weights[i + j]);
+			else
+				draw = S64_MIN;
+
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
+		}
+	}
+
+	return bucket->h.items[high];
+}
+
 
 static int crush_bucket_choose(const struct crush_bucket *in,
 			       struct crush_work_bucket *work,
 			       int x, int r,
                                const struct crush_choose_arg *arg,
-                               int position)
+                               int position, int vectorized)
 {
 	dprintk(" crush_bucket_choose %d x=%d r=%d\n", in->id, x, r);
 	BUG_ON(in->size == 0);
@@ -386,6 +447,10 @@ static int crush_bucket_choose(const struct crush_bucket *in,
 			(const struct crush_bucket_straw *)in,
 			x, r);
 	case CRUSH_BUCKET_STRAW2:
+		if (vectorized && in->size >= CRUSH_STRAW2_VEC_MIN_SIZE)
+			return bucket_straw2_choose_vec(
+				(const struct crush_bucket_straw2 *)in,
+				x, r, arg, position);
 		return bucket_straw2_choose(
 			(const struct crush_bucket_straw2 *)in,
 			x, r, arg, position);
@@ -505,7 +570,7 @@ parent_r %d stable %d\n",
 						in, work->work[-1-in->id],
 						x, r,
                                                 (choose_args ? &choose_args[-1-in->id] : 0),
-                                                outpos);
+                                                outpos, work->vectorized);
 				if (item >= map->max_devices) {
 					dprintk("   bad item %d\n", item);
 					skip_rep = 1;
@@ -715,7 +780,7 @@ static void crush_choose_indep(const struct crush_map *map,
 					in, work->work[-1-in->id],
 					x, r,
                                         (choose_args ? &choose_args[-1-in->id] : 0),
-                                        outpos);
+                                        outpos, work->vectorized);
 				if (item >= map->max_devices) {
 					dprintk("   bad item %d\n", item);
 					out[rep] = CRUSH_ITEM_NONE;
@@ -844,6 +909,7 @@ void crush_init_workspace(const struct crush_map *m, void *v) {
 	char *point = (char *)v;
 	__s32 b;
 	point += sizeof(struct crush_work);
+	w->vectorized = CRUSH_VECTORIZED_DEFAULT;
 	w->work = (struct crush_work_bucket **)point;
 	point += m->max_buckets * sizeof(struct crush_work_bucket *);
 	for (b = 0; b < m->max_buckets; ++b) {
@@ -1081,3 +1147,37 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+/**
+ * crush_do_rule_batch - calculate mappings for several inputs
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @xs: hash inputs
+ * @nx: number of hash inputs
+ * @results: nx * result_max result vectors, one per input
+ * @result_lens: nx result sizes
+ * @result_max: maximum result size
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @cwin: Pointer to at least map->working_size bytes of memory or NULL.
+ * @vectorized: whether to batch the straw2 item hashes
+ */
+void crush_do_rule_batch(const struct crush_map *map,
+			 int ruleno, const int *xs, int nx,
+			 int *results, int *result_lens, int result_max,
+			 const __u32 *weight, int weight_max,
+			 void *cwin, const struct crush_choose_arg *choose_args,
+			 int vectorized)
+{
+	struct crush_work *cw = cwin;
+	int was_vectorized = cw->vectorized;
+	int i;
+
+	cw->vectorized = vectorized;
+	for (i = 0; i < nx; i++)
+		result_lens[i] = crush_do_rule(map, ruleno, xs[i],
+					       results + i * result_max,
+					       result_max, weight, weight_max,
+					       cwin, choose_args);
+	cw->vectorized = was_vectorized;
+}
@@ -77,6 +77,26 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/** @ingroup API
+ *
+ * Map each of the __nx__ inputs in __xs__ as crush_do_rule() would,
+ * storing the items for __xs[i]__ in __results[i * result_max]__ and
+ * their count in __result_lens[i]__. If __vectorized__ is set, straw2
+ * draws hash the bucket items in blocks so they can use SIMD, as
+ * crush_do_rule() does by default where that is available; the
+ * mappings are identical either way.
+ *
+ * The __cwin__ argument is initialized once, as for crush_do_rule(),
+ * and reused for every input.
+ */
+extern void crush_do_rule_batch(const struct crush_map *map,
+				int ruleno, const int *xs, int nx,
+				int *results, int *result_lens, int result_max,
+				const __u32 *weights, int weight_max,
+				void *cwin,
+				const struct crush_choose_arg *choose_args,
+				int vectorized);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cstring>
 
 #include "ErasureCode.h"
 
@@ -37,6 +38,7 @@ using std::string;
 using std::vector;
 
 using ceph::bufferlist;
+using ceph::bufferptr;
 
 namespace ceph {
 const unsigned ErasureCode::SIMD_ALIGN = 32;
@@ -328,6 +330,15 @@ int ErasureCode::to_string(const std::string &name,
   return 0;
 }
 
+int ErasureCode::chunk_position(int chunk) const
+{
+  if (chunk_mapping.empty())
+    return chunk;
+  auto p = std::find(chunk_mapping.begin(), chunk_mapping.end(), chunk);
+  ceph_assert(p != chunk_mapping.end());
+  return p - chunk_mapping.begin();
+}
+
 int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
 			       bufferlist *decoded)
 {
@@ -345,4 +356,35 @@ int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
   }
   return r;
 }
+
+void ErasureCode::encode_delta(const bufferptr &old_data,
+			       const bufferptr &new_data,
+			       bufferptr *delta)
+{
+  // subtraction is an exclusive or in the Galois fields used by
+  // the linear codes
+  ceph_assert(old_data.length() == new_data.length());
+  ceph_assert(delta->length() == old_data.length());
+  const char *o = old_data.c_str();
+  const char *n = new_data.c_str();
+  char *d = delta->c_str();
+  unsigned len = old_data.length();
+  unsigned i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t a, b;
+    memcpy(&a, o + i, sizeof(a));
+    memcpy(&b, n + i, sizeof(b));
+    a ^= b;
+    memcpy(d + i, &a, sizeof(a));
+  }
+  for (; i < len; i++) {
+    d[i] = o[i] ^ n[i];
+  }
+}
+
+void ErasureCode::apply_delta(const map<int, bufferptr> &in,
+			      map<int, bufferptr> &out)
+{
+  ceph_abort_msg("parity delta is not supported by this erasure code");
+}
 }
@@ -459,6 +459,46 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Return true if the coding chunks are a linear function of the
+     * data chunks, in which case a partial overwrite can update
+     * them with **encode_delta** and **apply_delta** instead of
+     * encoding all data chunks again.
+     *
+     * @return **true** if **apply_delta** is implemented
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute in **delta** the difference between the **old_data**
+     * and the **new_data** content of a data chunk. All three
+     * buffers have the same length and **delta** may be the same
+     * buffer as **old_data** or **new_data**.
+     *
+     * @param [in] old_data current content of the data chunk
+     * @param [in] new_data content about to be written
+     * @param [out] delta difference to be given to **apply_delta**
+     */
+    virtual void encode_delta(const bufferptr &old_data,
+			      const bufferptr &new_data,
+			      bufferptr *delta) = 0;
+
+    /**
+     * Update the coding chunks in **out** in place so that they
+     * reflect the data chunk changes described by **in**. The keys
+     * of **in** are data chunk indexes mapped to the deltas computed
+     * by **encode_delta**, the keys of **out** are coding chunk
+     * indexes mapped to their current content. All buffers have the
+     * same length.
+     *
+     * Must only be called if **supports_parity_delta** is true.
+     *
+     * @param [in] in map data chunk indexes to data chunk deltas
+     * @param [in,out] out map coding chunk indexes to coding chunks
+     */
+    virtual void apply_delta(const std::map<int, bufferptr> &in,
+			     std::map<int, bufferptr> &out) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
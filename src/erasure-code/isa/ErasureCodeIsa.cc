@@ -132,6 +132,53 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+void
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferptr> &in,
+                                   map<int, bufferptr> &out)
+{
+  if (m == 1) {
+    // single parity stripe, see isa_encode
+    for (auto &&[data_chunk, delta] : in) {
+      for (auto &&[coding_chunk, coding] : out) {
+        encode_delta(coding, delta, &coding);
+      }
+    }
+    return;
+  }
+
+  // ec_encode_data_update expects all m coding buffers, use scratch
+  // space for those the caller does not care about
+  unsigned blocksize = in.begin()->second.length();
+  std::vector<bufferptr> scratch;
+  unsigned char *coding[m];
+  for (int j = 0; j < m; j++) {
+    coding[j] = nullptr;
+  }
+  for (auto &&[coding_chunk, ptr] : out) {
+    int j = chunk_position(coding_chunk) - k;
+    ceph_assert(j >= 0 && j < m);
+    ceph_assert(ptr.length() == blocksize);
+    coding[j] = (unsigned char*) ptr.c_str();
+  }
+  for (int j = 0; j < m; j++) {
+    if (!coding[j]) {
+      scratch.emplace_back(buffer::create_aligned(blocksize, EC_ISA_ADDRESS_ALIGNMENT));
+      scratch.back().zero();
+      coding[j] = (unsigned char*) scratch.back().c_str();
+    }
+  }
+
+  for (auto &&[data_chunk, delta] : in) {
+    int i = chunk_position(data_chunk);
+    ceph_assert(i < k);
+    ceph_assert(delta.length() == blocksize);
+    ec_encode_data_update(blocksize, k, m, i, encode_tbls,
+                          (unsigned char*) delta.c_str(), coding);
+  }
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -145,6 +145,14 @@ public:
 
   void prepare() override;
 
+  bool supports_parity_delta() const override
+  {
+    return true;
+  }
+
+  void apply_delta(const std::map<int, ceph::bufferptr> &in,
+                   std::map<int, ceph::bufferptr> &out) override;
+
  private:
   int parse(ceph::ErasureCodeProfile &profile,
             std::ostream *ss) override;
@@ -39,6 +39,7 @@ using std::map;
 using std::set;
 
 using ceph::bufferlist;
+using ceph::bufferptr;
 using ceph::ErasureCodeProfile;
 
 static ostream& _prefix(std::ostream* _dout)
@@ -137,6 +138,45 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+void ErasureCodeJerasure::matrix_apply_delta(const int *matrix,
+					     const map<int, bufferptr> &in,
+					     map<int, bufferptr> &out)
+{
+  // coding chunk j is the sum of matrix[j * k + i] * data chunk i,
+  // the change of a data chunk is added to it the same way
+  for (auto &&[data_chunk, delta] : in) {
+    int i = chunk_position(data_chunk);
+    ceph_assert(i < k);
+    for (auto &&[coding_chunk, coding] : out) {
+      int j = chunk_position(coding_chunk) - k;
+      ceph_assert(j >= 0 && j < m);
+      ceph_assert(coding.length() == delta.length());
+      char *src = const_cast<char*>(delta.c_str());
+      int coefficient = matrix[j * k + i];
+      if (coefficient == 1) {
+	galois_region_xor(src, coding.c_str(), delta.length());
+	continue;
+      }
+      switch (w) {
+      case 8:
+	galois_w08_region_multiply(src, coefficient, delta.length(),
+				   coding.c_str(), 1);
+	break;
+      case 16:
+	galois_w16_region_multiply(src, coefficient, delta.length(),
+				   coding.c_str(), 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(src, coefficient, delta.length(),
+				   coding.c_str(), 1);
+	break;
+      default:
+	ceph_abort_msg("unsupported word size");
+      }
+    }
+  }
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
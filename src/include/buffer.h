@@ -118,6 +118,10 @@ struct error_code;
   int get_missed_crc();
   /// enable/disable tracking of cached crcs
   void track_cached_crc(bool b);
+  /// cap on memory mapped by the hugepage buffer pool (0 disables it)
+  void set_hugepage_pool_max_bytes(uint64_t max);
+  /// bytes currently mapped by the hugepage buffer pool
+  uint64_t get_hugepage_pool_mapped_bytes();
 
   /*
    * an abstract raw buffer.  with a reference count.
@@ -131,6 +135,7 @@ struct error_code;
   class raw_unshareable; // diagnostic, unshareable char buffer
   class raw_combined;
   class raw_claim_buffer;
+  class raw_hugepage_pooled;
 
 
   /*
@@ -148,6 +153,7 @@ struct error_code;
   ceph::unique_leakable_ptr<raw> create_aligned_in_mempool(unsigned len, unsigned align, int mempool);
   ceph::unique_leakable_ptr<raw> create_page_aligned(unsigned len);
   ceph::unique_leakable_ptr<raw> create_small_page_aligned(unsigned len);
+  ceph::unique_leakable_ptr<raw> create_hugepage_pooled(unsigned len, unsigned align);
   ceph::unique_leakable_ptr<raw> claim_buffer(unsigned len, char *buf, deleter del);
 
 #ifdef HAVE_SEASTAR
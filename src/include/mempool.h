@@ -175,7 +175,8 @@ namespace mempool {
   f(pgmap)			      \
   f(mds_co)			      \
   f(unittest_1)			      \
-  f(unittest_2)
+  f(unittest_2)			      \
+  f(buffer_hugepage)
 
 
 // give them integer ids
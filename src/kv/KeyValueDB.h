@@ -7,6 +7,7 @@
 #include <ostream>
 #include <set>
 #include <map>
+#include <functional>
 #include <optional>
 #include <string>
 #include <boost/scoped_ptr.hpp>
@@ -343,6 +344,44 @@ public:
       get_wholespace_iterator(opts));
   }
 
+  /**
+   * get_range -- read a run of consecutive keys in one go
+   *
+   * Calls f(key, value) on the keys of prefix from 'from' (or after it,
+   * if !inclusive) up to, but not including, 'end', in order, until f
+   * returns false.  The key and value are only valid during the call.
+   * Unlike stepping an Iterator, this lets the backend read the range
+   * in a single pass, reading ahead 'readahead' bytes (0 leaves it to
+   * the backend).
+   *
+   * @returns 0 on success, negative error code on failure
+   */
+  virtual int get_range(
+    const std::string &prefix,
+    const std::string &from,
+    bool inclusive,
+    const std::string &end,
+    size_t readahead,
+    const std::function<bool(std::string_view, std::string_view)>& f) {
+    auto it = get_iterator(prefix, 0, IteratorBounds{from, end});
+    if (inclusive) {
+      it->lower_bound(from);
+    } else {
+      it->upper_bound(from);
+    }
+    for (; it->valid(); it->next()) {
+      std::string k = it->key();
+      if (k >= end) {
+	break;
+      }
+      ceph::buffer::list v = it->value();
+      if (!f(k, std::string_view(v.c_str(), v.length()))) {
+	break;
+      }
+    }
+    return it->status();
+  }
+
   virtual uint64_t get_estimated_size(std::map<std::string,uint64_t> &extra) = 0;
   virtual int get_statfs(struct store_statfs_t *buf) {
     return -EOPNOTSUPP;
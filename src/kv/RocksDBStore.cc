@@ -1858,36 +1858,41 @@ int RocksDBStore::get(
     const std::set<string> &keys,
     std::map<string, bufferlist> *out)
 {
-  rocksdb::PinnableSlice value;
   utime_t start = ceph_clock_now();
-  if (cf_handles.count(prefix) > 0) {
-    for (auto& key : keys) {
-      auto cf_handle = get_cf_handle(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    cf_handle,
-			    rocksdb::Slice(key),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+  // look the keys up in one batch, so that rocksdb can read the blocks
+  // they share once and fetch the rest in parallel
+  const size_t n = keys.size();
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs(n);
+  std::vector<rocksdb::Slice> slices(n);
+  std::vector<string> combined;
+  bool sharded = cf_handles.count(prefix) > 0;
+  if (!sharded) {
+    combined.reserve(n);
+  }
+  size_t i = 0;
+  for (auto& key : keys) {
+    if (sharded) {
+      cfs[i] = get_cf_handle(prefix, key);
+      slices[i] = rocksdb::Slice(key);
+    } else {
+      cfs[i] = default_cf;
+      combined.push_back(combine_strings(prefix, key));
+      slices[i] = rocksdb::Slice(combined.back());
     }
-  } else {
-    for (auto& key : keys) {
-      string k = combine_strings(prefix, key);
-      auto status = db->Get(rocksdb::ReadOptions(),
-			    default_cf,
-			    rocksdb::Slice(k),
-			    &value);
-      if (status.ok()) {
-	(*out)[key].append(value.data(), value.size());
-      } else if (status.IsIOError()) {
-	ceph_abort_msg(status.getState());
-      }
-      value.Reset();
+    ++i;
+  }
+  std::vector<rocksdb::PinnableSlice> values(n);
+  std::vector<rocksdb::Status> statuses(n);
+  db->MultiGet(rocksdb::ReadOptions(), n, cfs.data(), slices.data(),
+	       values.data(), statuses.data());
+  i = 0;
+  for (auto& key : keys) {
+    if (statuses[i].ok()) {
+      (*out)[key].append(values[i].data(), values[i].size());
+    } else if (statuses[i].IsIOError()) {
+      ceph_abort_msg(statuses[i].getState());
     }
+    ++i;
   }
   utime_t lat = ceph_clock_now() - start;
   logger->tinc(l_rocksdb_get_latency, lat);
@@ -3039,6 +3044,67 @@ KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix, Itera
   }
 }
 
+int RocksDBStore::get_range(
+  const std::string &prefix,
+  const std::string &from,
+  bool inclusive,
+  const std::string &end,
+  size_t readahead,
+  const std::function<bool(std::string_view, std::string_view)>& f)
+{
+  rocksdb::ColumnFamilyHandle* cf = nullptr;
+  std::string lower, upper;
+  size_t skip = 0;
+  auto cf_it = cf_handles.find(prefix);
+  if (cf_it != cf_handles.end()) {
+    if (cf_it->second.handles.size() == 1) {
+      cf = cf_it->second.handles[0];
+    } else if (cct->_conf->osd_rocksdb_iterator_bounds_enabled) {
+      cf = check_cf_handle_bounds(cf_it, IteratorBounds{from, end});
+    }
+    if (!cf) {
+      // the range spans shards; merge them the slow way
+      return KeyValueDB::get_range(prefix, from, inclusive, end, readahead, f);
+    }
+    lower = from;
+    upper = end;
+  } else {
+    cf = default_cf;
+    lower = combine_strings(prefix, from);
+    upper = combine_strings(prefix, end);
+    skip = prefix.size() + 1;
+  }
+
+  utime_t start = ceph_clock_now();
+  // with the bounds set rocksdb can stop at the end of the range rather
+  // than at the next live key, and with readahead_size it reads the
+  // range from the files in a few large reads instead of block by block
+  rocksdb::Slice lower_slice(lower);
+  rocksdb::Slice upper_slice(upper);
+  rocksdb::ReadOptions options;
+  options.iterate_lower_bound = &lower_slice;
+  options.iterate_upper_bound = &upper_slice;
+  if (readahead) {
+    options.readahead_size = readahead;
+  }
+  std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(options, cf));
+  it->Seek(lower_slice);
+  if (!inclusive && it->Valid() && it->key() == lower_slice) {
+    it->Next();
+  }
+  for (; it->Valid(); it->Next()) {
+    rocksdb::Slice k = it->key();
+    rocksdb::Slice v = it->value();
+    if (!f(std::string_view(k.data() + skip, k.size() - skip),
+	   std::string_view(v.data(), v.size()))) {
+      break;
+    }
+  }
+  int r = it->status().ok() ? 0 : -EIO;
+  logger->tinc(l_rocksdb_get_latency, ceph_clock_now() - start);
+  return r;
+}
+
 RocksDBStore::WholeSpaceIterator RocksDBStore::new_shard_iterator(rocksdb::ColumnFamilyHandle* cf)
 {
   return std::make_shared<RocksDBWholeSpaceIteratorImpl>(
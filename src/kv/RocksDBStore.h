@@ -388,6 +388,13 @@ public:
   };
 
   Iterator get_iterator(const std::string& prefix, IteratorOpts opts = 0, IteratorBounds = IteratorBounds()) override;
+  int get_range(
+    const std::string &prefix,
+    const std::string &from,
+    bool inclusive,
+    const std::string &end,
+    size_t readahead,
+    const std::function<bool(std::string_view, std::string_view)>& f) override;
 private:
   /// this iterator spans single cf
   WholeSpaceIterator new_shard_iterator(rocksdb::ColumnFamilyHandle* cf);
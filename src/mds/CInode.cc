@@ -3706,7 +3706,8 @@ int CInode::encode_inodestat(bufferlist& bl, Session *session,
 			     SnapRealm *dir_realm,
 			     snapid_t snapid,
 			     unsigned max_bytes,
-			     int getattr_caps)
+			     int getattr_caps,
+			     bool dense)
 {
   client_t client = session->get_client();
   ceph_assert(snapid);
@@ -3862,6 +3863,23 @@ int CInode::encode_inodestat(bufferlist& bl, Session *session,
   } else {
     xattr_version = 0;
   }
+
+  // a dense readdir leaves these to the caps or to a getattr.  if the
+  // client's xattrs are not current it must not get Xs with this reply
+  // or it would trust them; if it already holds Xs it gets them anyway
+  bool dense_strip_xs = false;
+  if (dense) {
+    if (inline_version != CEPH_INLINE_NONE) {
+      inline_version = 0;
+      inline_data.clear();
+    }
+    if (cap && cap->client_xattr_version == xattr_i->xattr_version) {
+      xattr_version = 0;
+    } else if (!cap || !(cap->pending() & CEPH_CAP_XATTR_SHARED)) {
+      dense_strip_xs = true;
+      xattr_version = 0;
+    }
+  }
   
   // do we have room?
   if (max_bytes) {
@@ -3915,6 +3933,8 @@ int CInode::encode_inodestat(bufferlist& bl, Session *session,
     ecap.caps = valid ? get_caps_allowed_by_type(CAP_ANY) : CEPH_STAT_CAP_INODE;
     if (last == CEPH_NOSNAP || is_any_caps())
       ecap.caps = ecap.caps & get_caps_allowed_for_client(session, nullptr, file_i);
+    if (dense_strip_xs)
+      ecap.caps = ecap.caps & ~CEPH_CAP_XATTR_SHARED;
     ecap.seq = 0;
     ecap.mseq = 0;
     ecap.realm = 0;
@@ -3931,6 +3951,8 @@ int CInode::encode_inodestat(bufferlist& bl, Session *session,
       int likes = get_caps_liked();
       int allowed = get_caps_allowed_for_client(session, cap, file_i);
       issue = (cap->wanted() | likes) & allowed;
+      if (dense_strip_xs)
+	issue &= ~CEPH_CAP_XATTR_SHARED;
       cap->issue_norevoke(issue, true);
       issue = cap->pending();
       dout(10) << "encode_inodestat issuing " << ccap_string(issue)
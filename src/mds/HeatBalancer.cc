@@ -0,0 +1,216 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "HeatBalancer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "common/config.h"
+#include "common/debug.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_mds_balancer
+#undef dout_prefix
+#define dout_prefix *_dout << "mds.heatbal " << __func__ << " "
+
+using std::map;
+
+const HeatBalancer::plan_t& HeatBalancer::rebalance(
+  int epoch,
+  const map<mds_rank_t, rank_heat_t>& heat)
+{
+  const auto window_size = cct->_conf.get_val<uint64_t>("mds_bal_heat_window");
+  const double high = cct->_conf.get_val<double>("mds_bal_heat_high_watermark");
+  const double low = cct->_conf.get_val<double>("mds_bal_heat_low_watermark");
+  const double dominance =
+    cct->_conf.get_val<double>("mds_bal_heat_client_dominance");
+
+  plan.clear();
+
+  // loads taken before ranks came or went are not comparable
+  if (!window.empty()) {
+    const auto& last = window.back();
+    if (!std::equal(last.begin(), last.end(), heat.begin(), heat.end(),
+		    [](const auto& a, const auto& b) {
+		      return a.first == b.first &&
+			a.second.in_mask == b.second.in_mask;
+		    })) {
+      ldout(cct, 7) << "ranks changed, restarting the window" << dendl;
+      reset();
+    }
+  }
+  window.push_back(heat);
+  while (window.size() > window_size) {
+    window.pop_front();
+  }
+
+  // per-epoch targets, and per-rank averages over the window
+  std::vector<double> epoch_target;
+  map<mds_rank_t, double> avg_load;
+  map<mds_rank_t, double> avg_share;
+  for (const auto& sample : window) {
+    double total = 0.0;
+    unsigned n = 0;
+    for (const auto& [rank, h] : sample) {
+      avg_load[rank] += h.load / window.size();
+      if (h.client_heat > 0) {
+	avg_share[rank] += h.top_client_heat / h.client_heat / window.size();
+      }
+      if (h.in_mask) {
+	total += h.load;
+	++n;
+      }
+    }
+    epoch_target.push_back(n ? total / n : 0.0);
+  }
+
+  double total = 0.0;
+  unsigned n = 0;
+  for (const auto& [rank, h] : heat) {
+    if (h.in_mask) {
+      total += avg_load[rank];
+      ++n;
+    }
+  }
+  target_load = n ? total / n : 0.0;
+  ldout(cct, 7) << "epoch " << epoch << " window " << window.size()
+		<< "/" << window_size << " target " << target_load
+		<< " loads " << avg_load << dendl;
+
+  if (window.size() < window_size || target_load <= 0.0) {
+    return plan;
+  }
+
+  auto overloaded_throughout = [&](mds_rank_t rank) {
+    for (size_t i = 0; i < window.size(); ++i) {
+      if (window[i].at(rank).load <= epoch_target[i] * (1.0 + high)) {
+	return false;
+      }
+    }
+    return true;
+  };
+
+  std::multimap<double, mds_rank_t> exporters;
+  std::multimap<double, mds_rank_t> importers;
+  for (const auto& [rank, h] : heat) {
+    double load = avg_load[rank];
+    if (!h.in_mask) {
+      // not supposed to hold anything; no hysteresis for those
+      if (load > 0.0) {
+	exporters.emplace(load, rank);
+      }
+      continue;
+    }
+
+    if (exporting.count(rank)) {
+      if (load <= target_load * (1.0 + low)) {
+	ldout(cct, 5) << "mds." << rank << " back under the low watermark ("
+		      << load << "), stops exporting" << dendl;
+	exporting.erase(rank);
+      }
+    } else if (overloaded_throughout(rank)) {
+      auto p = last_import_epoch.find(rank);
+      if (p != last_import_epoch.end() &&
+	  epoch - p->second < (int)window_size) {
+	ldout(cct, 7) << "mds." << rank << " is overloaded but imported at epoch "
+		      << p->second << ", holding off" << dendl;
+      } else {
+	ldout(cct, 5) << "mds." << rank << " overloaded for " << window.size()
+		      << " epochs (" << load << "), starts exporting" << dendl;
+	exporting.insert(rank);
+      }
+    }
+
+    if (exporting.count(rank)) {
+      double excess = load - target_load;
+      double share = avg_share[rank];
+      if (dominance < 1.0 && share > dominance) {
+	// scale down to nothing as one client approaches all of the load
+	excess *= (1.0 - share) / (1.0 - dominance);
+	ldout(cct, 10) << "mds." << rank << " top client share " << share
+		       << ", movable excess " << excess << dendl;
+      }
+      if (excess > 0.0) {
+	exporters.emplace(excess, rank);
+      }
+    } else if (load < target_load * (1.0 - low)) {
+      importers.emplace(target_load - load, rank);
+    }
+  }
+
+  // big exporters to big importers
+  auto ex = exporters.rbegin();
+  auto im = importers.rbegin();
+  double ex_left = ex != exporters.rend() ? ex->first : 0.0;
+  double im_left = im != importers.rend() ? im->first : 0.0;
+  while (ex != exporters.rend() && im != importers.rend()) {
+    double amount = std::min(ex_left, im_left);
+    plan[ex->second][im->second] += amount;
+    last_import_epoch[im->second] = epoch;
+    ex_left -= amount;
+    im_left -= amount;
+    if (ex_left <= .001 && ++ex != exporters.rend()) {
+      ex_left = ex->first;
+    }
+    if (im_left <= .001 && ++im != importers.rend()) {
+      im_left = im->first;
+    }
+  }
+  ldout(cct, 7) << "plan " << plan << dendl;
+  return plan;
+}
+
+double HeatBalancer::migration_cost(uint64_t inodes, uint64_t caps) const
+{
+  return inodes * cct->_conf.get_val<double>("mds_bal_heat_inode_cost") +
+    caps * cct->_conf.get_val<double>("mds_bal_heat_cap_cost");
+}
+
+void HeatBalancer::reset()
+{
+  window.clear();
+  exporting.clear();
+  last_import_epoch.clear();
+  target_load = 0.0;
+  plan.clear();
+}
+
+void HeatBalancer::dump(ceph::Formatter *f) const
+{
+  f->dump_unsigned("window_epochs", window.size());
+  f->dump_float("target_load", target_load);
+  f->open_array_section("exporting");
+  for (auto rank : exporting) {
+    f->dump_int("rank", rank);
+  }
+  f->close_section();
+  f->open_array_section("last_import_epoch");
+  for (const auto& [rank, epoch] : last_import_epoch) {
+    f->open_object_section("import");
+    f->dump_int("rank", rank);
+    f->dump_int("epoch", epoch);
+    f->close_section();
+  }
+  f->close_section();
+  f->open_array_section("plan");
+  for (const auto& [from, targets] : plan) {
+    for (const auto& [to, amount] : targets) {
+      f->open_object_section("export");
+      f->dump_int("from", from);
+      f->dump_int("to", to);
+      f->dump_float("amount", amount);
+      f->close_section();
+    }
+  }
+  f->close_section();
+}
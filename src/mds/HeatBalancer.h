@@ -0,0 +1,97 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MDS_HEATBALANCER_H
+#define CEPH_MDS_HEATBALANCER_H
+
+#include <deque>
+#include <map>
+#include <set>
+
+#include "include/common_fwd.h"
+#include "common/Formatter.h"
+#include "mdstypes.h"
+
+/*
+ * Policy behind mds_bal_policy=heat.
+ *
+ * The classic balancer compares the loads of a single heartbeat epoch,
+ * so a burst on one rank is enough to start an export and the next
+ * burst elsewhere sends the subtree back.  This policy keeps the loads
+ * of the last mds_bal_heat_window epochs and decides on their average:
+ *
+ *  - a rank starts exporting only after it was above the high watermark
+ *    in every epoch of the window, and keeps exporting until its
+ *    average drops under the low watermark;
+ *  - a rank that just imported does not export again for a window;
+ *  - the part of a rank's excess that comes from one dominant client is
+ *    not offered, since that load follows the client's subtree around;
+ *  - a subtree is only worth migrating if its popularity pays for the
+ *    inodes and caps that have to move with it.
+ *
+ * Every rank sees the same heartbeat loads and runs the same
+ * computation, so each one can derive the full plan (and therefore who
+ * is cooling down after an import) without extra messages.
+ *
+ * The class knows nothing about MDSRank so that recorded heat traces
+ * can be replayed through it offline.
+ */
+class HeatBalancer {
+public:
+  struct rank_heat_t {
+    double load = 0.0;             // mds_load() of the rank
+    double client_heat = 0.0;      // sum of per-client request rates
+    double top_client_heat = 0.0;  // request rate of the busiest client
+    bool in_mask = true;           // outside mds_bal_rank_mask: drain it
+  };
+  // exporter -> importer -> amount of load, in mds_load() units
+  using plan_t = std::map<mds_rank_t, std::map<mds_rank_t, double>>;
+
+  explicit HeatBalancer(CephContext *cct) : cct(cct) {}
+
+  /**
+   * Add one epoch of rank loads to the window and work out who should
+   * export how much to whom.
+   *
+   * @param epoch heartbeat epoch the loads belong to
+   * @param heat loads of every in rank
+   * @returns the migrations to perform; empty while the window fills
+   */
+  const plan_t& rebalance(int epoch,
+			  const std::map<mds_rank_t, rank_heat_t>& heat);
+
+  /// average load of the ranks in the mask over the current window
+  double get_target_load() const {
+    return target_load;
+  }
+
+  double migration_cost(uint64_t inodes, uint64_t caps) const;
+  /// whether moving a subtree with this popularity, inode and cap
+  /// count is expected to pay off
+  bool worth_migrating(double pop, uint64_t inodes, uint64_t caps) const {
+    return pop > migration_cost(inodes, caps);
+  }
+
+  void reset();
+  void dump(ceph::Formatter *f) const;
+
+private:
+  CephContext *cct;
+
+  std::deque<std::map<mds_rank_t, rank_heat_t>> window;
+  std::set<mds_rank_t> exporting;
+  std::map<mds_rank_t, int> last_import_epoch;
+  double target_load = 0.0;
+  plan_t plan;
+};
+
+#endif
@@ -72,7 +72,21 @@ public:
 };
 
 Locker::Locker(MDSRank *m, MDCache *c) :
-  need_snapflush_inodes(member_offset(CInode, item_caps)), mds(m), mdcache(c) {}
+  need_snapflush_inodes(member_offset(CInode, item_caps)), mds(m), mdcache(c)
+{
+  cap_batch_max = g_conf().get_val<uint64_t>("mds_cap_batch_max");
+  cap_batch_delay = g_conf().get_val<double>("mds_cap_batch_delay");
+}
+
+void Locker::handle_conf_change(const std::set<std::string>& changed)
+{
+  if (changed.count("mds_cap_batch_max"))
+    cap_batch_max = g_conf().get_val<uint64_t>("mds_cap_batch_max");
+  if (changed.count("mds_cap_batch_delay"))
+    cap_batch_delay = g_conf().get_val<double>("mds_cap_batch_delay");
+  if (!cap_batch_max)
+    flush_cap_batches();
+}
 
 
 void Locker::dispatch(const cref_t<Message> &m)
@@ -2369,7 +2383,7 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
 					   mds->get_osd_epoch_barrier());
 	in->encode_cap_message(m, cap);
 
-	mds->send_message_client_counted(m, cap->get_session());
+	send_caps_message(m, cap->get_session());
       }
     }
 
@@ -2417,7 +2431,7 @@ int Locker::issue_caps(CInode *in, Capability *only_cap)
 					 mds->get_osd_epoch_barrier());
       in->encode_cap_message(m, cap);
 
-      mds->send_message_client_counted(m, cap->get_session());
+      send_caps_message(m, cap->get_session());
     }
 
     if (only_cap)
@@ -2451,6 +2465,85 @@ void Locker::issue_truncate(CInode *in)
 }
 
 
+/*
+ * Grants and revokes for a client that understands MClientCapsBatch are
+ * queued instead of sent.  A lock transition on a shared directory can
+ * touch thousands of inodes per client; queueing lets them go out as a
+ * few messages.  Queued caps are flushed:
+ *  - when the MDS is done with the message or contexts that caused them
+ *    (MDSRank::_advance_queues);
+ *  - before anything else is sent to the same client, which keeps the
+ *    order the client sees unchanged;
+ *  - when a batch reaches mds_cap_batch_max;
+ *  - after mds_cap_batch_delay for work done outside dispatch, such as
+ *    timers and journal completions.
+ */
+void Locker::send_caps_message(const ref_t<MClientCaps>& m, Session *session)
+{
+  if (!cap_batch_max ||
+      !session->info.has_feature(CEPHFS_FEATURE_BATCH_CAPS)) {
+    mds->send_message_client_counted(m, session);
+    return;
+  }
+
+  auto& batch = cap_batches[session->get_client()];
+  if (!batch)
+    batch = make_message<MClientCapsBatch>();
+  version_t seq = session->inc_push_seq();
+  dout(10) << __func__ << " " << session->info.inst.name << " seq " << seq
+	   << " " << *m << dendl;
+  batch->add(m);
+
+  if (batch->size() >= cap_batch_max) {
+    flush_cap_batch(session);
+  } else if (!cap_batch_timer) {
+    cap_batch_timer = new LambdaContext([this](int) {
+      cap_batch_timer = nullptr;
+      flush_cap_batches();
+    });
+    mds->timer.add_event_after(cap_batch_delay, cap_batch_timer);
+  }
+}
+
+void Locker::flush_cap_batch(Session *session)
+{
+  auto p = cap_batches.find(session->get_client());
+  if (p == cap_batches.end())
+    return;
+  auto batch = std::move(p->second);
+  cap_batches.erase(p);
+
+  if (mds->logger) {
+    mds->logger->inc(l_mdss_ceph_cap_batch);
+    mds->logger->inc(l_mdss_ceph_cap_batched, batch->size());
+  }
+  // already counted when queued
+  if (batch->size() == 1)
+    mds->send_message_client(batch->caps.front(), session);
+  else
+    mds->send_message_client(batch, session);
+}
+
+void Locker::flush_cap_batches()
+{
+  if (cap_batch_timer) {
+    mds->timer.cancel_event(cap_batch_timer);
+    cap_batch_timer = nullptr;
+  }
+  while (!cap_batches.empty()) {
+    client_t client = cap_batches.begin()->first;
+    Session *session = mds->get_session(client);
+    if (!session) {
+      dout(10) << __func__ << " no session for client." << client
+	       << ", dropping " << cap_batches.begin()->second->size()
+	       << " caps" << dendl;
+      cap_batches.erase(cap_batches.begin());
+      continue;
+    }
+    flush_cap_batch(session);
+  }
+}
+
 void Locker::revoke_stale_cap(CInode *in, client_t client)
 {
   dout(7) << __func__ << " client." << client << " on " << *in << dendl;
@@ -2929,7 +3022,7 @@ void Locker::share_inode_max_size(CInode *in, Capability *only_cap)
                                          cap->get_mseq(),
                                          mds->get_osd_epoch_barrier());
       in->encode_cap_message(m, cap);
-      mds->send_message_client_counted(m, client);
+      send_caps_message(m, cap->get_session());
     }
     if (only_cap)
       break;
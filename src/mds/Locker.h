@@ -18,6 +18,7 @@
 #include "include/types.h"
 
 #include "messages/MClientCaps.h"
+#include "messages/MClientCapsBatch.h"
 #include "messages/MClientCapRelease.h"
 #include "messages/MClientLease.h"
 #include "messages/MLock.h"
@@ -42,6 +43,8 @@ class Locker {
 public:
   Locker(MDSRank *m, MDCache *c);
 
+  void handle_conf_change(const std::set<std::string>& changed);
+
   SimpleLock *get_lock(int lock_type, const MDSCacheObjectInfo &info);
   
   void dispatch(const cref_t<Message> &m);
@@ -175,6 +178,11 @@ public:
 
   void request_inode_file_caps(CInode *in);
 
+  // -- batched caps --
+  void send_caps_message(const ref_t<MClientCaps>& m, Session *session);
+  void flush_cap_batch(Session *session);
+  void flush_cap_batches();
+
   bool check_client_ranges(CInode *in, uint64_t size);
   bool calc_new_client_ranges(CInode *in, uint64_t size,
 			      bool *max_increased=nullptr);
@@ -269,5 +277,13 @@ private:
   MDSRank *mds;
   MDCache *mdcache;
   xlist<ScatterLock*> updated_filelocks;
+
+  // grants and revokes not sent yet, one batch per client; their push
+  // seqs are already taken, so they must go out before anything else
+  // sent to that client
+  std::map<client_t, ref_t<MClientCapsBatch>> cap_batches;
+  Context *cap_batch_timer = nullptr;
+  uint64_t cap_batch_max;
+  double cap_batch_delay;
 };
 #endif
@@ -79,7 +79,7 @@ int MDBalancer::proc_message(const cref_t<Message> &m)
 }
 
 MDBalancer::MDBalancer(MDSRank *m, Messenger *msgr, MonClient *monc) :
-    mds(m), messenger(msgr), mon_client(monc)
+    mds(m), messenger(msgr), mon_client(monc), heat_balancer(g_ceph_context)
 {
   bal_fragment_dirs = g_conf().get_val<bool>("mds_bal_fragment_dirs");
   bal_fragment_interval = g_conf().get_val<int64_t>("mds_bal_fragment_interval");
@@ -335,6 +335,14 @@ mds_load_t MDBalancer::get_load()
 
   load.queue_len = messenger->get_dispatch_queue_len();
 
+  for (const auto& [name, session] : mds->sessionmap.get_sessions()) {
+    if (!name.is_client())
+      continue;
+    double heat = session->get_load_avg();
+    load.client_heat += heat;
+    load.top_client_heat = std::max(load.top_client_heat, heat);
+  }
+
   bool update_last = true;
   if (last_get_load != clock::zero() &&
       now > last_get_load) {
@@ -537,6 +545,11 @@ void MDBalancer::handle_heartbeat(const cref_t<MHeartbeat> &m)
                           << "balancer=" << mds->mdsmap->get_balancer()
                           << " : " << cpp_strerror(r);
       }
+      if (!g_conf()->mds_thrash_exports &&
+          g_conf().get_val<std::string>("mds_bal_policy") == "heat") {
+        heat_prep_rebalance();
+        return;
+      }
       prep_rebalance(m->get_beat());
     }
   }
@@ -710,17 +723,7 @@ void MDBalancer::prep_rebalance(int beat)
     mds->mdcache->migrator->clear_export_queue();
 
     // rescale!  turn my mds_load back into meta_load units
-    double load_fac = 1.0;
-    map<mds_rank_t, mds_load_t>::iterator m = mds_load.find(whoami);
-    if ((m != mds_load.end()) && (m->second.mds_load() > 0)) {
-      double metald = m->second.auth.meta_load();
-      double mdsld = m->second.mds_load();
-      load_fac = metald / mdsld;
-      dout(7) << " load_fac is " << load_fac
-	      << " <- " << m->second.auth << " " << metald
-	      << " / " << mdsld
-	      << dendl;
-    }
+    double load_fac = get_load_fac(whoami);
 
     mds_meta_load.clear();
 
@@ -861,6 +864,67 @@ void MDBalancer::prep_rebalance(int beat)
   try_rebalance(state);
 }
 
+double MDBalancer::get_load_fac(mds_rank_t whoami)
+{
+  double load_fac = 1.0;
+  map<mds_rank_t, mds_load_t>::iterator m = mds_load.find(whoami);
+  if ((m != mds_load.end()) && (m->second.mds_load() > 0)) {
+    double metald = m->second.auth.meta_load();
+    double mdsld = m->second.mds_load();
+    load_fac = metald / mdsld;
+    dout(7) << " load_fac is " << load_fac
+	    << " <- " << m->second.auth << " " << metald
+	    << " / " << mdsld
+	    << dendl;
+  }
+  return load_fac;
+}
+
+void MDBalancer::heat_prep_rebalance()
+{
+  balance_state_t state;
+
+  int cluster_size = mds->get_mds_map()->get_num_in_mds();
+  mds_rank_t whoami = mds->get_nodeid();
+  rebalance_time = clock::now();
+  mds->mdcache->migrator->clear_export_queue();
+
+  double load_fac = get_load_fac(whoami);
+
+  mds_meta_load.clear();
+  map<mds_rank_t, HeatBalancer::rank_heat_t> heat;
+  for (mds_rank_t i=mds_rank_t(0); i < mds_rank_t(cluster_size); i++) {
+    const mds_load_t& load = mds_load.at(i);
+    auto& h = heat[i];
+    h.load = load.mds_load();
+    h.client_heat = load.client_heat;
+    h.top_client_heat = load.top_client_heat;
+    h.in_mask = test_rank_mask(i);
+    mds_meta_load[i] = h.load * load_fac;
+  }
+  my_load = mds_meta_load[whoami];
+
+  const auto& plan = heat_balancer.rebalance(beat_epoch, heat);
+  target_load = heat_balancer.get_target_load() * load_fac;
+  dout(7) << "my load " << my_load
+	  << "   target " << target_load
+	  << dendl;
+
+  auto p = plan.find(whoami);
+  if (p == plan.end()) {
+    dout(7) << "  heat balancer has nothing for me to export" << dendl;
+    return;
+  }
+  for (const auto& [target, amount] : p->second) {
+    state.targets[target] = amount * load_fac;
+  }
+  dout(7) << " heat balancer decided that new targets=" << state.targets << dendl;
+
+  use_migration_cost = true;
+  try_rebalance(state);
+  use_migration_cost = false;
+}
+
 int MDBalancer::mantle_prep_rebalance()
 {
   balance_state_t state;
@@ -1142,6 +1206,16 @@ void MDBalancer::find_exports(CDir *dir,
 	continue;
       }
 
+      if (use_migration_cost && !worth_migrating(subdir, pop)) {
+	// too expensive to move as a whole; maybe a piece of it is not
+	dout(15) << "   not worth migrating whole " << *subdir << dendl;
+	if (subdir->is_rep())
+	  bigger_rep.push_back(subdir);
+	else
+	  bigger_unrep.push_back(subdir);
+	continue;
+      }
+
       // lucky find?
       if (pop > needmin && pop < needmax) {
 	exports->push_back(subdir);
@@ -1211,6 +1285,20 @@ void MDBalancer::find_exports(CDir *dir,
   }
 }
 
+bool MDBalancer::worth_migrating(CDir *dir, double pop)
+{
+  const auto& rstat = dir->get_fnode()->rstat;
+  uint64_t inodes = rstat.rfiles + rstat.rsubdirs;
+  // only what is cached here holds caps that must be exported
+  uint64_t caps = dir->get_inode()->get_client_caps().size();
+  for (const auto& p : *dir) {
+    CInode *in = p.second->get_linkage()->get_inode();
+    if (in)
+      caps += in->get_client_caps().size();
+  }
+  return heat_balancer.worth_migrating(pop, inodes, caps);
+}
+
 void MDBalancer::hit_inode(CInode *in, int type)
 {
   // hit inode
@@ -1407,6 +1495,7 @@ void MDBalancer::handle_mds_failure(mds_rank_t who)
   if (0 == who) {
     mds_last_epoch_under_map.clear();
   }
+  heat_balancer.reset();
 }
 
 int MDBalancer::dump_loads(Formatter *f, int64_t depth) const
@@ -1464,6 +1553,8 @@ int MDBalancer::dump_loads(Formatter *f, int64_t depth) const
       f->dump_float("cache_hit_rate", load.cache_hit_rate);
       f->dump_float("queue_length", load.queue_len);
       f->dump_float("cpu_load", load.cpu_load_avg);
+      f->dump_float("client_heat", load.client_heat);
+      f->dump_float("top_client_heat", load.top_client_heat);
       f->dump_float("mds_load", load.mds_load());
 
       f->open_object_section("auth_dirfrags");
@@ -1510,6 +1601,10 @@ int MDBalancer::dump_loads(Formatter *f, int64_t depth) const
   }
   f->close_section(); // mds_import_map
 
+  f->open_object_section("heat_balancer");
+  heat_balancer.dump(f);
+  f->close_section(); // heat_balancer
+
   f->close_section(); // loads
   return 0;
 }
@@ -22,6 +22,7 @@
 #include "messages/MHeartbeat.h"
 
 #include "MDSMap.h"
+#include "HeatBalancer.h"
 
 class MDSRank;
 class MHeartbeat;
@@ -87,6 +88,8 @@ private:
   //MDSMap is up to date
   void prep_rebalance(int beat);
   int mantle_prep_rebalance();
+  void heat_prep_rebalance();
+  double get_load_fac(mds_rank_t whoami);
 
   mds_load_t get_load();
   int localize_balancer();
@@ -97,6 +100,7 @@ private:
                     std::vector<CDir*>* exports,
                     double& have,
                     std::set<CDir*>& already_exporting);
+  bool worth_migrating(CDir *dir, double pop);
 
   double try_match(balance_state_t &state,
                    mds_rank_t ex, double& maxex,
@@ -131,6 +135,10 @@ private:
   std::string bal_code;
   std::string bal_version;
 
+  HeatBalancer heat_balancer;
+  // charge subtrees their migration cost in find_exports()
+  bool use_migration_cost = false;
+
   time last_heartbeat = clock::zero();
   time last_sample = clock::zero();
   time rebalance_time = clock::zero(); //ensure a consistent view of load for rebalance
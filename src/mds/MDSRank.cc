@@ -1330,6 +1330,10 @@ void MDSRank::_advance_queues()
 
     heartbeat_reset();
   }
+
+  // whatever caps the work above changed go out now, one message per
+  // client
+  locker->flush_cap_batches();
 }
 
 /**
@@ -1526,6 +1530,8 @@ void MDSRank::send_message_client_counted(const ref_t<Message>& m, const Connect
 
 void MDSRank::send_message_client_counted(const ref_t<Message>& m, Session* session)
 {
+  // batched caps were counted when queued and must go out first
+  locker->flush_cap_batch(session);
   version_t seq = session->inc_push_seq();
   dout(10) << "send_message_client_counted " << session->info.inst.name << " seq "
 	   << seq << " " << *m << dendl;
@@ -1538,6 +1544,7 @@ void MDSRank::send_message_client_counted(const ref_t<Message>& m, Session* sess
 
 void MDSRank::send_message_client(const ref_t<Message>& m, Session* session)
 {
+  locker->flush_cap_batch(session);
   dout(10) << "send_message_client " << session->info.inst << " " << *m << dendl;
   if (session->get_connection()) {
     session->get_connection()->send_message2(m);
@@ -3462,6 +3469,10 @@ void MDSRank::create_logger()
                            "caps truncate notify", "cfsa", PerfCountersBuilder::PRIO_INTERESTING);
     mds_plb.add_u64_counter(l_mdss_ceph_cap_op_flush_ack, "ceph_cap_op_flush_ack",
                            "caps truncate notify", "cfa", PerfCountersBuilder::PRIO_INTERESTING);
+    mds_plb.add_u64_counter(l_mdss_ceph_cap_batch, "ceph_cap_batch",
+                           "Batched caps msgs", "cbat", PerfCountersBuilder::PRIO_INTERESTING);
+    mds_plb.add_u64_counter(l_mdss_ceph_cap_batched, "ceph_cap_batched",
+                           "Caps msgs sent in batches", "cbtd", PerfCountersBuilder::PRIO_INTERESTING);
     mds_plb.add_u64_counter(l_mdss_handle_inode_file_caps, "handle_inode_file_caps",
                            "Inter mds caps msg", "hifc", PerfCountersBuilder::PRIO_INTERESTING);
 
@@ -3823,6 +3834,8 @@ const char** MDSRankDispatcher::get_tracked_conf_keys() const
     "mds_cache_reservation",
     "mds_cache_trim_decay_rate",
     "mds_cap_acquisition_throttle_retry_request_time",
+    "mds_cap_batch_delay",
+    "mds_cap_batch_max",
     "mds_cap_revoke_eviction_timeout",
     "mds_debug_subtrees",
     "mds_dir_max_entries",
@@ -3949,6 +3962,7 @@ void MDSRankDispatcher::handle_conf_change(const ConfigProxy& conf, const std::s
     mdcache->handle_conf_change(changed, *mdsmap);
     mdlog->handle_conf_change(changed, *mdsmap);
     purge_queue.handle_conf_change(changed, *mdsmap);
+    locker->handle_conf_change(changed);
   }));
 }
 
@@ -102,6 +102,8 @@ enum {
   l_mdss_ceph_cap_op_trunc,
   l_mdss_ceph_cap_op_flushsnap_ack,
   l_mdss_ceph_cap_op_flush_ack,
+  l_mdss_ceph_cap_batch,
+  l_mdss_ceph_cap_batched,
   l_mdss_handle_client_caps,
   l_mdss_handle_client_caps_dirty,
   l_mdss_handle_client_cap_release,
@@ -30,6 +30,7 @@ static const std::array feature_names
   "32bits_retry_fwd",
   "new_snaprealm_info",
   "has_owner_uidgid",
+  "batch_caps",
 };
 static_assert(feature_names.size() == CEPHFS_FEATURE_MAX + 1);
 
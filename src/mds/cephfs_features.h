@@ -48,7 +48,8 @@ namespace ceph {
 #define CEPHFS_FEATURE_32BITS_RETRY_FWD     18
 #define CEPHFS_FEATURE_NEW_SNAPREALM_INFO   19
 #define CEPHFS_FEATURE_HAS_OWNER_UIDGID     20
-#define CEPHFS_FEATURE_MAX                  20
+#define CEPHFS_FEATURE_BATCH_CAPS           21
+#define CEPHFS_FEATURE_MAX                  21
 
 #define CEPHFS_FEATURES_ALL {		\
   0, 1, 2, 3, 4,			\
@@ -70,6 +71,7 @@ namespace ceph {
   CEPHFS_FEATURE_32BITS_RETRY_FWD,      \
   CEPHFS_FEATURE_NEW_SNAPREALM_INFO,    \
   CEPHFS_FEATURE_HAS_OWNER_UIDGID,      \
+  CEPHFS_FEATURE_BATCH_CAPS,            \
 }
 
 #define CEPHFS_METRIC_FEATURES_ALL {		\
@@ -957,6 +957,10 @@ struct mds_load_t {
 
   double cpu_load_avg = 0.0;
 
+  // decayed request counts of this rank's client sessions
+  double client_heat = 0.0;
+  double top_client_heat = 0.0;
+
   double mds_load() const;  // defiend in MDBalancer.cc
   void encode(ceph::buffer::list& bl) const;
   void decode(ceph::buffer::list::const_iterator& bl);
@@ -977,6 +981,8 @@ inline std::ostream& operator<<(std::ostream& out, const mds_load_t& load)
              << ", hr " << load.cache_hit_rate
              << ", qlen " << load.queue_len
 	     << ", cpu " << load.cpu_load_avg
+	     << ", clients " << load.client_heat
+	     << " top " << load.top_client_heat
              << ">";
 }
 
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MCLIENTCAPSBATCH_H
+#define CEPH_MCLIENTCAPSBATCH_H
+
+#include "msg/Message.h"
+#include "messages/MClientCaps.h"
+
+/*
+ * Several MClientCaps for one session in a single message.
+ *
+ * Each MClientCaps is carried with its own header version, payload and
+ * middle, exactly as it would be on the wire by itself, so the receiver
+ * rebuilds and handles them one by one, in order.  The rebuilt messages
+ * share the batch's header (source, etc.) but not its connection.  Only
+ * sent to clients with CEPHFS_FEATURE_BATCH_CAPS.
+ */
+class MClientCapsBatch final : public SafeMessage {
+private:
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+public:
+  std::vector<ref_t<MClientCaps>> caps;
+
+  void add(ref_t<MClientCaps> m) {
+    caps.push_back(std::move(m));
+  }
+  size_t size() const {
+    return caps.size();
+  }
+
+protected:
+  MClientCapsBatch()
+    : SafeMessage{CEPH_MSG_CLIENT_CAPS_BATCH, HEAD_VERSION, COMPAT_VERSION} {}
+  ~MClientCapsBatch() final {}
+
+public:
+  std::string_view get_type_name() const override { return "Cfcaps"; }
+  void print(std::ostream& out) const override {
+    out << "client_caps_batch(" << caps.size() << " caps)";
+  }
+
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    encode((uint32_t)caps.size(), payload);
+    for (auto& m : caps) {
+      m->clear_payload();
+      m->encode_payload(features);
+      encode((__u16)m->get_header().version, payload);
+      encode(m->get_payload(), payload);
+      encode(m->get_middle(), payload);
+    }
+  }
+  void decode_payload() override {
+    using ceph::decode;
+    auto p = payload.cbegin();
+    uint32_t n;
+    decode(n, p);
+    caps.clear();
+    caps.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      __u16 version;
+      ceph::buffer::list front, middle;
+      decode(version, p);
+      decode(front, p);
+      decode(middle, p);
+      auto m = ceph::make_message<MClientCaps>();
+      ceph_msg_header h = get_header();
+      h.type = CEPH_MSG_CLIENT_CAPS;
+      h.version = version;
+      m->set_header(h);
+      m->set_payload(front);
+      m->set_middle(middle);
+      m->decode_payload();
+      caps.push_back(std::move(m));
+    }
+  }
+private:
+  template<class T, typename... Args>
+  friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
+  template<class T, typename... Args>
+  friend MURef<T> crimson::make_message(Args&&... args);
+};
+
+#endif
@@ -21,6 +21,12 @@
 #include <errno.h>
 
 #include <algorithm>
+#include <deque>
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define POSIX_STACK_ZEROCOPY
+#endif
 
 #include "PosixStack.h"
 
@@ -37,16 +43,151 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+/**
+ * MSG_ZEROCOPY sends of a socket that the kernel has not completed yet
+ *
+ * The kernel keeps reading the pages of such a send until it reports its
+ * completion id on the socket error queue, which can be well after the
+ * socket was closed by us.  The buffers are held here until then; see
+ * PosixWorker::linger().
+ */
+class PosixZeroCopySends {
+  CephContext *cct;
+  PerfCounters *logger;
+  int fd;
+
+  /// an in-flight MSG_ZEROCOPY sendmsg(2), identified by the completion id
+  /// the kernel assigned to it
+  struct send_t {
+    uint32_t id;
+    bool done = false;
+    ceph::buffer::list bl; ///< keeps the transmitted buffers alive
+    explicit send_t(uint32_t id) : id(id) {}
+  };
+
+  uint32_t next_id = 0;  ///< id the kernel assigns to the next send
+  /// in-flight sends in id order; buffers are released in that order only
+  std::deque<send_t> inflight;
+
+  void complete(uint32_t lo, uint32_t hi) {
+    if (inflight.empty()) {
+      return;
+    }
+    uint32_t base = inflight.front().id;
+    for (uint32_t id = lo; ; ++id) {
+      uint32_t i = id - base;
+      if (i < inflight.size()) {
+	inflight[i].done = true;
+      }
+      if (id == hi) {
+	break;
+      }
+    }
+    while (!inflight.empty() && inflight.front().done) {
+      inflight.pop_front();
+    }
+  }
+
+ public:
+  /// a run of bytes of the outgoing bufferlist sent with MSG_ZEROCOPY
+  struct run_t {
+    size_t off;
+    size_t len;
+    unsigned calls; ///< successful sendmsg(2) calls it took
+  };
+
+  bool enabled = false;  ///< socket accepts MSG_ZEROCOPY sends
+
+  PosixZeroCopySends(CephContext *cct, PerfCounters *logger, int fd)
+    : cct(cct), logger(logger), fd(fd) {}
+
+  int get_fd() const {
+    return fd;
+  }
+  bool empty() const {
+    return inflight.empty();
+  }
+  size_t size() const {
+    return inflight.size();
+  }
+
+  /// hold the runs of 'sent' handed to the kernel until they complete
+  void pin(const ceph::buffer::list &sent, const std::vector<run_t> &runs) {
+    for (auto &run : runs) {
+      // completions may arrive out of order, but a run is only released
+      // once all the ids up to its last one are done
+      for (unsigned i = 0; i < run.calls; ++i) {
+	inflight.emplace_back(next_id++);
+      }
+      inflight.back().bl.substr_of(sent, run.off, run.len);
+    }
+  }
+
+  /// release the buffers of the sends the kernel reported done
+  void reap() {
+#ifdef POSIX_STACK_ZEROCOPY
+    while (!inflight.empty()) {
+      struct msghdr msg;
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) +
+		   CMSG_SPACE(sizeof(struct sockaddr_in6))];
+      // FIPS zeroization audit 20191115: this memset is not security related.
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+	// EAGAIN: nothing (more) to reap
+	break;
+      }
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+	   cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+	  continue;
+	}
+	auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+	  continue;
+	}
+	if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+	  // the kernel had to copy anyway (e.g. loopback or a device
+	  // without scatter-gather); stop paying for the page pinning
+	  logger->inc(l_msgr_send_zerocopy_copied);
+	  if (enabled) {
+	    ldout(cct, 10) << __func__ << " fd " << fd << " kernel copied"
+			   << " zero-copy send, disabling zero-copy" << dendl;
+	    enabled = false;
+	  }
+	}
+	complete(serr->ee_info, serr->ee_data);
+      }
+    }
+#endif
+  }
+};
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
+  CephContext *cct;
+  PerfCounters *logger;
+  PosixWorker *worker;
   ceph::NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
+  /// null once closed
+  std::unique_ptr<PosixZeroCopySends> zerocopy;
 
  public:
   explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
-				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+				    int f, bool connected, PosixWorker *w)
+      : cct(w->cct), logger(w->get_perf_counter()), worker(w),
+	handler(h), _fd(f), sa(sa), connected(connected),
+	zerocopy(std::make_unique<PosixZeroCopySends>(cct, logger, f)) {
+#ifdef POSIX_STACK_ZEROCOPY
+    if (cct->_conf->ms_async_zerocopy) {
+      zerocopy->enabled = (handler.set_zerocopy(_fd) == 0);
+    }
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -77,13 +218,20 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   // return the sent length
   // < 0 means error occurred
   #ifndef _WIN32
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  /// what a do_sendmsg() call got through to the kernel, even if it failed
+  struct sendmsg_progress_t {
+    size_t sent = 0;     ///< bytes
+    unsigned calls = 0;  ///< successful sendmsg(2) calls
+  };
+
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    int flags, sendmsg_progress_t *progress)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | flags | (more ? MSG_MORE : 0));
       if (r < 0) {
         int err = ceph_sock_errno();
         if (err == EINTR) {
@@ -94,6 +242,8 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         return -err;
       }
 
+      ++progress->calls;
+      progress->sent += r;
       sent += r;
       if (len == sent) break;
 
@@ -117,10 +267,33 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
+    std::vector<PosixZeroCopySends::run_t> zerocopy_runs;
+    size_t zerocopy_min_size = 0;
+    zerocopy->reap();
+    if (zerocopy->enabled) {
+      zerocopy_min_size = cct->_conf->ms_async_zerocopy_min_size;
+    }
     while (left_pbrs) {
       struct msghdr msg;
       struct iovec msgvec[IOV_MAX];
       uint64_t size = std::min<uint64_t>(left_pbrs, IOV_MAX);
+      int flags = 0;
+#ifdef POSIX_STACK_ZEROCOPY
+      if (zerocopy->enabled) {
+	// large buffers go out without copying, small ones (e.g. frame
+	// preambles and headers) are copied as usual; never mix both in
+	// a single call
+	bool large = pb->length() >= zerocopy_min_size;
+	uint64_t n = 1;
+	for (auto p = std::next(pb);
+	     n < size && (p->length() >= zerocopy_min_size) == large;
+	     ++p) {
+	  ++n;
+	}
+	size = n;
+	flags = large ? MSG_ZEROCOPY : 0;
+      }
+#endif
       left_pbrs -= size;
       // FIPS zeroization audit 20191115: this memset is not security related.
       memset(&msg, 0, sizeof(msg));
@@ -133,9 +306,23 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
-      if (r < 0)
+      sendmsg_progress_t progress;
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, flags,
+			     &progress);
+#ifdef POSIX_STACK_ZEROCOPY
+      if ((flags & MSG_ZEROCOPY) && progress.calls) {
+	zerocopy_runs.push_back({sent_bytes, progress.sent, progress.calls});
+      }
+      logger->inc((flags & MSG_ZEROCOPY) ? l_msgr_send_zerocopy_bytes :
+		  l_msgr_send_copy_bytes, progress.sent);
+#else
+      logger->inc(l_msgr_send_copy_bytes, progress.sent);
+#endif
+      if (r < 0) {
+	// the kernel may be reading from what the earlier calls sent
+	zerocopy->pin(bl, zerocopy_runs);
         return r;
+      }
 
       // "r" is the remaining length
       sent_bytes += r;
@@ -148,14 +335,20 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
       ceph::buffer::list swapped;
       if (sent_bytes < bl.length()) {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
-        bl.swap(swapped);
-      } else {
-        bl.clear();
       }
+      // bl now holds exactly the sent bytes
+      zerocopy->pin(bl, zerocopy_runs);
+      bl.swap(swapped);
     }
 
     return static_cast<ssize_t>(sent_bytes);
   }
+
+  void reap_send_completions() override {
+    if (zerocopy) {
+      zerocopy->reap();
+    }
+  }
   #else
   ssize_t send(bufferlist &bl, bool more) override
   {
@@ -204,7 +397,15 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     ::shutdown(_fd, SHUT_RDWR);
   }
   void close() override {
-    compat_closesocket(_fd);
+    if (zerocopy->empty()) {
+      compat_closesocket(_fd);
+    } else {
+      // the kernel may still be reading from our buffers; the worker
+      // keeps them, and the fd to learn when it is done, until then
+      ::shutdown(_fd, SHUT_RDWR);
+      worker->linger(std::move(zerocopy));
+    }
+    zerocopy.reset();
   }
   void set_priority(int sd, int prio, int domain) override {
     handler.set_priority(sd, prio, domain);
@@ -262,15 +463,98 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true, static_cast<PosixWorker*>(w)));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
 
+class PosixWorker::C_reap_lingering : public EventCallback {
+ public:
+  PosixWorker *worker;
+  explicit C_reap_lingering(PosixWorker *w) : worker(w) {}
+  void do_request(uint64_t id) override {
+    if (!worker) {
+      // run by ~EventCenter after our worker is gone
+      delete this;
+      return;
+    }
+    worker->reap_lingering();
+  }
+};
+
+PosixWorker::PosixWorker(CephContext *c, unsigned i)
+  : Worker(c, i), net(c), linger_reaper(new C_reap_lingering(this))
+{
+}
+
+PosixWorker::~PosixWorker()
+{
+  std::lock_guard l{linger_lock};
+  for (auto &sends : lingering) {
+    sends->reap();
+    compat_closesocket(sends->get_fd());
+    if (!sends->empty()) {
+      // we can't tell when the kernel is done with these any more, so
+      // rather leak them than have it read freed memory
+      ldout(cct, 1) << __func__ << " leaking " << sends->size()
+		    << " unfinished zero-copy sends of fd " << sends->get_fd()
+		    << dendl;
+      (void)sends.release();
+    }
+  }
+  lingering.clear();
+  if (linger_kick_pending) {
+    // still queued in center, which runs it when destroyed
+    linger_reaper->worker = nullptr;
+  } else {
+    delete linger_reaper;
+  }
+}
+
 void PosixWorker::initialize()
 {
 }
 
+void PosixWorker::linger(std::unique_ptr<PosixZeroCopySends> sends)
+{
+  ldout(cct, 10) << __func__ << " fd " << sends->get_fd() << " has "
+		 << sends->size() << " unfinished zero-copy sends" << dendl;
+  {
+    std::lock_guard l{linger_lock};
+    lingering.push_back(std::move(sends));
+    if (linger_reap_scheduled) {
+      return;
+    }
+    linger_reap_scheduled = true;
+    linger_kick_pending = true;
+  }
+  // we may be called from outside the worker thread
+  center.dispatch_event_external(linger_reaper);
+}
+
+void PosixWorker::reap_lingering()
+{
+  std::lock_guard l{linger_lock};
+  // either the kick from linger() or our own timer got us here
+  linger_kick_pending = false;
+  for (auto p = lingering.begin(); p != lingering.end(); ) {
+    (*p)->reap();
+    if ((*p)->empty()) {
+      ldout(cct, 10) << __func__ << " fd " << (*p)->get_fd()
+		     << " zero-copy sends done, closing" << dendl;
+      compat_closesocket((*p)->get_fd());
+      p = lingering.erase(p);
+    } else {
+      ++p;
+    }
+  }
+  if (lingering.empty()) {
+    linger_reap_scheduled = false;
+  } else {
+    center.create_time_event(LINGER_REAP_INTERVAL_US, linger_reaper);
+  }
+}
+
 int PosixWorker::listen(entity_addr_t &sa,
 			unsigned addr_slot,
 			const SocketOptions &opt,
@@ -331,7 +615,7 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock, this)));
   return 0;
 }
 
@@ -17,19 +17,38 @@
 #ifndef CEPH_MSG_ASYNC_POSIXSTACK_H
 #define CEPH_MSG_ASYNC_POSIXSTACK_H
 
+#include <list>
+#include <memory>
 #include <thread>
 
+#include "common/ceph_mutex.h"
 #include "msg/msg_types.h"
 #include "msg/async/net_handler.h"
 
 #include "Stack.h"
 
+class PosixZeroCopySends;
+
 class PosixWorker : public Worker {
   ceph::NetHandler net;
+
+  static constexpr uint64_t LINGER_REAP_INTERVAL_US = 100000;
+  class C_reap_lingering;
+  /// closed sockets with zero-copy sends the kernel may still be reading
+  /// from; the fds are closed once it reports them all done
+  ceph::mutex linger_lock = ceph::make_mutex("PosixWorker::linger_lock");
+  std::list<std::unique_ptr<PosixZeroCopySends>> lingering;
+  C_reap_lingering *linger_reaper;
+  bool linger_reap_scheduled = false;  ///< kicked or timer armed
+  bool linger_kick_pending = false;    ///< queued in center as external event
+
   void initialize() override;
+  void reap_lingering();
  public:
-  PosixWorker(CephContext *c, unsigned i)
-      : Worker(c, i), net(c) {}
+  PosixWorker(CephContext *c, unsigned i);
+  ~PosixWorker() override;
+  /// take over the unfinished zero-copy sends of a closed socket
+  void linger(std::unique_ptr<PosixZeroCopySends> sends);
   int listen(entity_addr_t &sa,
 	     unsigned addr_slot,
 	     const SocketOptions &opt,
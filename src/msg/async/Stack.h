@@ -35,6 +35,8 @@ class ConnectedSocketImpl {
   virtual void close() = 0;
   virtual int fd() const = 0;
   virtual void set_priority(int sd, int prio, int domain) = 0;
+  /// release buffers of completed zero-copy sends, if any
+  virtual void reap_send_completions() {}
 };
 
 class ConnectedSocket;
@@ -130,6 +132,15 @@ class ConnectedSocket {
     _csi->set_priority(sd, prio, domain);
   }
 
+  /// Process transmit completions.
+  ///
+  /// Buffers handed to the kernel without copying are referenced until
+  /// the kernel reports that it is done with them.  This must be called
+  /// whenever the socket signals an error condition.
+  void reap_send_completions() {
+    _csi->reap_send_completions();
+  }
+
   explicit operator bool() const {
     return _csi.get();
   }
@@ -213,6 +224,10 @@ enum {
   l_msgr_recv_encrypted_bytes,
   l_msgr_send_encrypted_bytes,
 
+  l_msgr_send_zerocopy_bytes,
+  l_msgr_send_copy_bytes,
+  l_msgr_send_zerocopy_copied,
+
   l_msgr_last,
 };
 
@@ -271,6 +286,10 @@ class Worker {
     plb.add_u64_counter(l_msgr_recv_encrypted_bytes, "msgr_recv_encrypted_bytes", "Network received encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_encrypted_bytes, "msgr_send_encrypted_bytes", "Network sent encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
 
+    plb.add_u64_counter(l_msgr_send_zerocopy_bytes, "msgr_send_zerocopy_bytes", "Network bytes sent with MSG_ZEROCOPY", NULL, 0, unit_t(UNIT_BYTES));
+    plb.add_u64_counter(l_msgr_send_copy_bytes, "msgr_send_copy_bytes", "Network bytes sent by copying into the kernel", NULL, 0, unit_t(UNIT_BYTES));
+    plb.add_u64_counter(l_msgr_send_zerocopy_copied, "msgr_send_zerocopy_copied", "Zero-copy sends the kernel completed by copying");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
 
@@ -168,6 +168,23 @@ void NetHandler::set_priority(int sd, int prio, int domain)
 #endif	// SO_PRIORITY
 }
 
+int NetHandler::set_zerocopy(int sd)
+{
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  int flag = 1;
+  int r = ::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, (SOCKOPT_VAL_TYPE)&flag, sizeof(flag));
+  if (r < 0) {
+    r = ceph_sock_errno();
+    ldout(cct, 1) << __func__ << " couldn't set SO_ZEROCOPY: "
+		  << cpp_strerror(r) << dendl;
+    return -r;
+  }
+  return 0;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
 int NetHandler::generic_connect(const entity_addr_t& addr, const entity_addr_t &bind_addr, bool nonblock)
 {
   int ret;
@@ -29,6 +29,8 @@
 
 #include <errno.h>
 #include <sys/stat.h>
+#include <array>
+#include <functional>
 #include <map>
 #include <memory>
 #include <vector>
@@ -353,6 +355,34 @@ public:
   virtual int pool_statfs(uint64_t pool_id, struct store_statfs_t *buf,
 			  bool *per_pool_omap) = 0;
 
+  /**
+   * io_service_stats_t
+   *
+   * How long the store waited on its device for reads and for writes,
+   * bucketed by the average size of a device IO: < 4K, 4K, 8K, ... 4M and
+   * up.  The sums only ever grow; callers diff two samples.
+   */
+  struct io_service_stats_t {
+    static constexpr unsigned NUM_BUCKETS = 12;
+    struct bucket_t {
+      uint64_t ops = 0;    ///< requests waited for
+      uint64_t ios = 0;    ///< device IOs they were made of
+      uint64_t bytes = 0;
+      uint64_t nsec = 0;   ///< time spent waiting
+    };
+    using buckets_t = std::array<bucket_t, NUM_BUCKETS>;
+    buckets_t read, write;
+
+    static unsigned get_bucket(uint64_t ios, uint64_t bytes) {
+      return std::min<unsigned>(cbits(bytes / std::max<uint64_t>(ios, 1) >> 12),
+				NUM_BUCKETS - 1);
+    }
+  };
+  /// fill in io_service_stats_t; false if the store doesn't keep them
+  virtual bool get_io_service_stats(io_service_stats_t *stats) {
+    return false;
+  }
+
   virtual void collect_metadata(std::map<std::string,std::string> *pm) { }
 
   /**
@@ -478,6 +508,38 @@ public:
      ceph::buffer::list& bl,
      uint32_t op_flags = 0) = 0;
 
+  /**
+   * read_crc32c -- read a byte range and crc32c it
+   *
+   * Like read(), but also folds the data read into *crc, as
+   * bl.crc32c(*crc) would.  A store that keeps crc32c checksums of the
+   * data and verifies them on read may combine those instead of hashing
+   * the buffer a second time.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   * @param bl output ceph::buffer::list
+   * @param crc crc32c seed on input, crc32c of the data read on output
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @returns number of bytes read on success, or negative error code on failure.
+   */
+   virtual int read_crc32c(
+     CollectionHandle &c,
+     const ghobject_t& oid,
+     uint64_t offset,
+     size_t len,
+     ceph::buffer::list& bl,
+     uint32_t *crc,
+     uint32_t op_flags = 0) {
+     int r = read(c, oid, offset, len, bl, op_flags);
+     if (r >= 0) {
+       *crc = bl.crc32c(*crc);
+     }
+     return r;
+   }
+
   /**
    * fiemap -- get extent std::map of data of an object
    *
@@ -569,6 +631,24 @@ public:
     return -ENOTSUP;
   }
 
+  /**
+   * recompress -- rewrite an object's data compressed harder, if it is
+   * cold and that saves space.  The content of the object does not
+   * change, so this is not part of a Transaction and is not replicated.
+   *
+   * @param c collection for object
+   * @param oid oid of object
+   * @param bytes_read set to the amount of data read to decide
+   * @returns 0 on success (whether or not anything was rewritten),
+   *          -EOPNOTSUPP if the store does not do this
+   */
+  virtual int recompress(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t *bytes_read) {
+    return -EOPNOTSUPP;
+  }
+
   /**
    * getattr -- get an xattr of an object
    *
@@ -754,6 +834,45 @@ public:
     const ghobject_t &oid  ///< [in] object
     ) = 0;
 
+  /**
+   * omap_get_values_range -- read omap entries in key order
+   *
+   * Calls f(key, value) on the omap entries of oid from key 'from' on
+   * (or after it, if !inclusive), until f returns false or there are
+   * no more.  The key
+   * and value are only valid during the call.  Stores that can should
+   * read the range in one pass, reading ahead about readahead bytes;
+   * the default just steps an omap iterator.
+   *
+   * @return 0 on success, or negative error
+   */
+  virtual int omap_get_values_range(
+    CollectionHandle &c,                 ///< [in] collection
+    const ghobject_t &oid,               ///< [in] object
+    const std::string &from,             ///< [in] first key to list
+    bool inclusive,                      ///< [in] include 'from' itself
+    size_t readahead,                    ///< [in] bytes likely to be read
+    const std::function<bool(std::string_view, std::string_view)>& f
+    ) {
+    auto it = get_omap_iterator(c, oid);
+    if (!it) {
+      return -ENOENT;
+    }
+    if (inclusive) {
+      it->lower_bound(from);
+    } else {
+      it->upper_bound(from);
+    }
+    for (; it->valid(); it->next()) {
+      std::string k = it->key();
+      ceph::buffer::list v = it->value();
+      if (!f(k, std::string_view(v.c_str(), v.length()))) {
+	break;
+      }
+    }
+    return it->status();
+  }
+
   virtual int flush_journal() { return -EOPNOTSUPP; }
 
   virtual int dump_journal(std::ostream& out) { return -EOPNOTSUPP; }
@@ -389,6 +389,12 @@ void BlueFS::_init_logger()
                     "Average lock duration while compacting bluefs log",
                     "c_lt",
                     PerfCountersBuilder::PRIO_INTERESTING);
+ b.add_time_avg     (l_bluefs_compaction_snapshot_lat, "compact_snapshot_lat",
+                    "Average time the log is locked to capture metadata "
+                    "for async compaction");
+ b.add_time_avg     (l_bluefs_compaction_switch_lat, "compact_switch_lat",
+                    "Average time the log is locked to switch over to "
+                    "the compacted log");
   b.add_u64_counter(l_bluefs_alloc_shared_dev_fallbacks, "alloc_slow_fallback",
 		    "Amount of allocations that required fallback to "
                     " slow/shared device",
@@ -2454,6 +2460,61 @@ void BlueFS::_compact_log_dump_metadata_NF(uint64_t start_seq,
   }
 }
 
+void BlueFS::_compact_log_snapshot_metadata_NF(metadata_snapshot_t *snap,
+					       uint64_t capture_before_seq)
+{
+  dout(20) << __func__ << dendl;
+  std::lock_guard nl(nodes.lock);
+
+  snap->files.reserve(nodes.file_map.size());
+  for (auto& [ino, file_ref] : nodes.file_map) {
+    if (ino == 1)
+      continue;
+    ceph_assert(ino > 1);
+    std::lock_guard fl(file_ref->lock);
+    if (capture_before_seq == 0 || file_ref->dirty_seq < capture_before_seq) {
+      dout(20) << __func__ << " op_file_update " << file_ref->fnode << dendl;
+    } else {
+      dout(20) << __func__ << " op_file_update just modified, dirty_seq="
+               << file_ref->dirty_seq << " " << file_ref->fnode << dendl;
+    }
+    // later op_file_update_inc must apply on top of what we capture, as
+    // if it had been encoded now
+    file_ref->fnode.reset_delta();
+    snap->files.push_back(file_ref->fnode);
+  }
+  snap->dirs.reserve(nodes.dir_map.size());
+  for (auto& [path, dir_ref] : nodes.dir_map) {
+    auto& links = snap->dirs.emplace_back(path, 0).second;
+    links.reserve(dir_ref->file_map.size());
+    for (auto& [fname, file_ref] : dir_ref->file_map) {
+      links.emplace_back(fname, file_ref->fnode.ino);
+    }
+  }
+}
+
+void BlueFS::_compact_log_encode_snapshot(uint64_t start_seq,
+					  metadata_snapshot_t &snap,
+					  bluefs_transaction_t *t)
+{
+  dout(20) << __func__ << " " << snap.files.size() << " files "
+	   << snap.dirs.size() << " dirs" << dendl;
+  t->seq = start_seq;
+  t->uuid = super.uuid;
+  for (auto& fnode : snap.files) {
+    t->op_file_update(fnode);
+  }
+  for (auto& [path, links] : snap.dirs) {
+    dout(20) << __func__ << " op_dir_create " << path << dendl;
+    t->op_dir_create(path);
+    for (auto& [fname, ino] : links) {
+      dout(20) << __func__ << " op_dir_link " << path << "/" << fname
+	       << " to " << ino << dendl;
+      t->op_dir_link(path, fname, ino);
+    }
+  }
+}
+
 void BlueFS::_compact_log_sync_LNF_LD()
 {
   dout(10) << __func__ << dendl;
@@ -2817,8 +2878,9 @@ void BlueFS::_compact_log_async_LD_LNF_D() //also locks FW for new_writer
   // Part 2.
   // Build new log starter and compacted metadata body
   // 2.1.  Build full compacted meta transaction.
-  //       While still holding the lock, encode a bluefs transaction
-  //       that dumps all of the in-memory fnodes and names.
+  //       While still holding the lock, copy all of the in-memory fnodes
+  //       and names. After releasing it, encode them into a bluefs
+  //       transaction.
   //       This might be pretty large and its allocation map can exceed
   //       superblock size. Hence instead we'll need log starter part which
   //       goes to superblock and refers that new meta through op_update_inc.
@@ -2842,15 +2904,22 @@ void BlueFS::_compact_log_async_LD_LNF_D() //also locks FW for new_writer
   //
 
   // 2.1 Build full compacted meta transaction
-  bluefs_transaction_t compacted_meta_t;
-  _compact_log_dump_metadata_NF(starter_seq + 1, &compacted_meta_t, 0, seq_now);
+  //     Only copy the metadata while the log is locked, encoding it
+  //     can wait until the lock is released.
+  metadata_snapshot_t snapshot;
+  _compact_log_snapshot_metadata_NF(&snapshot, seq_now);
 
-  // now state is captured to compacted_meta_t,
+  // now state is captured to snapshot,
   // current log can be used to write to,
   //ops in log will be continuation of captured state
-  logger->tinc(l_bluefs_compaction_lock_lat, mono_clock::now() - t0);
+  auto snapshot_lat = mono_clock::now() - t0;
+  logger->tinc(l_bluefs_compaction_snapshot_lat, snapshot_lat);
   log.lock.unlock();
 
+  bluefs_transaction_t compacted_meta_t;
+  _compact_log_encode_snapshot(starter_seq + 1, snapshot, &compacted_meta_t);
+  snapshot = metadata_snapshot_t();
+
   // 2.2 Allocate the space required for the compacted meta transaction
   uint64_t compacted_meta_need = _estimate_transaction_size(&compacted_meta_t);
   dout(20) << __func__ << " compacted_meta_need " << compacted_meta_need
@@ -2948,6 +3017,7 @@ void BlueFS::_compact_log_async_LD_LNF_D() //also locks FW for new_writer
 
   // we need to acquire log's lock back at this point
   log.lock.lock();
+  auto t1 = mono_clock::now();
   // Reconstruct actual log object from the new one.
   vselector->sub_usage(log_file->vselector_hint, log_file->fnode);
   log_file->fnode.size =
@@ -2958,7 +3028,10 @@ void BlueFS::_compact_log_async_LD_LNF_D() //also locks FW for new_writer
   log.writer->pos = log.writer->file->fnode.size;
   vselector->add_usage(log_file->vselector_hint, log_file->fnode);
   // and unlock
+  auto switch_lat = mono_clock::now() - t1;
   log.lock.unlock();
+  logger->tinc(l_bluefs_compaction_switch_lat, switch_lat);
+  logger->tinc(l_bluefs_compaction_lock_lat, snapshot_lat + switch_lat);
 
   // we're mostly done
   dout(10) << __func__ << " log extents " << log_file->fnode.extents << dendl;
@@ -69,6 +69,8 @@ enum {
   l_bluefs_write_bytes,
   l_bluefs_compaction_lat,
   l_bluefs_compaction_lock_lat,
+  l_bluefs_compaction_snapshot_lat,
+  l_bluefs_compaction_switch_lat,
   l_bluefs_alloc_shared_dev_fallbacks,
   l_bluefs_alloc_shared_size_fallbacks,
   l_bluefs_read_zeros_candidate,
@@ -482,6 +484,19 @@ private:
 				     int flags,
 				     uint64_t capture_before_seq);
 
+  // in-memory metadata captured by async compaction while log.lock is
+  // held, and encoded into the new log after it is released
+  struct metadata_snapshot_t {
+    std::vector<bluefs_fnode_t> files;
+    std::vector<std::pair<std::string,
+			  std::vector<std::pair<std::string, uint64_t>>>> dirs;
+  };
+  void _compact_log_snapshot_metadata_NF(metadata_snapshot_t *snap,
+					 uint64_t capture_before_seq);
+  void _compact_log_encode_snapshot(uint64_t start_seq,
+				    metadata_snapshot_t &snap,
+				    bluefs_transaction_t *t);
+
   void _compact_log_sync_LNF_LD();
   void _compact_log_async_LD_LNF_D();
 
@@ -1106,17 +1106,82 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
       boost::intrusive::list_member_hook<>,
       &BlueStore::Onode::lru_item> > list_t;
 
-  list_t lru;
+  list_t lru;     ///< warm tier, age binned
+  list_t hot_lru; ///< hot tier, trimmed only when lru is exhausted
 
   explicit LruOnodeCacheShard(CephContext *cct) : BlueStore::OnodeCacheShard(cct) {}
 
+  uint64_t _get_hot_max() const {
+    return max * cct->_conf->bluestore_onode_cache_hot_ratio;
+  }
+
+  // link an unpinned onode into the tier it belongs to
+  void _link(BlueStore::Onode* o, int level) {
+    if (o->hot) {
+      (level > 0) ? hot_lru.push_front(*o) : hot_lru.push_back(*o);
+    } else {
+      (level > 0) ? lru.push_front(*o) : lru.push_back(*o);
+      o->cache_age_bin = age_bins.front();
+      *(o->cache_age_bin) += 1;
+    }
+  }
+  void _unlink(BlueStore::Onode* o) {
+    if (o->hot) {
+      hot_lru.erase(hot_lru.iterator_to(*o));
+    } else {
+      *(o->cache_age_bin) -= 1;
+      lru.erase(lru.iterator_to(*o));
+    }
+  }
+  void _clear_hot(BlueStore::Onode* o) {
+    if (o->hot) {
+      ceph_assert(num_hot);
+      --num_hot;
+      o->hot = false;
+    }
+    o->cache_hits = 0;
+  }
+
+  // move a warm onode which collected enough hits to the hot tier
+  void _maybe_promote(BlueStore::Onode* o) {
+    if (o->hot ||
+        o->cache_hits < cct->_conf->bluestore_onode_cache_hot_promote_hits) {
+      return;
+    }
+    uint64_t hot_max = _get_hot_max();
+    if (hot_max == 0) {
+      return;
+    }
+    _unlink(o);
+    o->hot = true;
+    ++num_hot;
+    _link(o, 1);
+    logger->inc(l_bluestore_onode_hot_promotes);
+    dout(20) << __func__ << " " << this << " " << o->oid << " promoted, hot="
+             << num_hot << dendl;
+    _trim_hot(hot_max);
+  }
+  // demote least recently used hot onodes back to the warm tier
+  void _trim_hot(uint64_t hot_max) {
+    while (num_hot > hot_max && hot_lru.size() > 0) {
+      BlueStore::Onode *o = &hot_lru.back();
+      hot_lru.pop_back();
+      _clear_hot(o);
+      _link(o, 1);
+      logger->inc(l_bluestore_onode_hot_demotes);
+      dout(20) << __func__ << " " << this << " " << o->oid << " demoted, hot="
+               << num_hot << dendl;
+    }
+  }
+
   void _add(BlueStore::Onode* o, int level) override
   {
     o->set_cached();
+    if (o->hot) {
+      ++num_hot;
+    }
     if (o->pin_nref == 1) {
-      (level > 0) ? lru.push_front(*o) : lru.push_back(*o);
-      o->cache_age_bin = age_bins.front();
-      *(o->cache_age_bin) += 1;
+      _link(o, level);
     }
     ++num; // we count both pinned and unpinned entries
     dout(20) << __func__ << " " << this << " " << o->oid << " added, num="
@@ -1126,8 +1191,11 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
   {
     o->clear_cached();
     if (o->lru_item.is_linked()) {
-      *(o->cache_age_bin) -= 1;
-      lru.erase(lru.iterator_to(*o));
+      _unlink(o);
+    }
+    if (o->hot) {
+      ceph_assert(num_hot);
+      --num_hot;
     }
     ceph_assert(num);
     --num;
@@ -1147,14 +1215,13 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
     if (o->is_cached() && o->pin_nref == 1) {
       if(!o->lru_item.is_linked()) {
         if (o->exists) {
-	  lru.push_front(*o);
-	  o->cache_age_bin = age_bins.front();
-	  *(o->cache_age_bin) += 1;
+	  _link(o, 1);
 	  dout(20) << __func__ << " " << this << " " << o->oid << " unpinned"
                    << dendl;
         } else {
 	  ceph_assert(num);
 	  --num;
+	  _clear_hot(o);
 	  o->clear_cached();
 	  dout(20) << __func__ << " " << this << " " << o->oid << " removed"
                    << dendl;
@@ -1162,43 +1229,63 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
           o->c->onode_space._remove(o->oid);
         }
       } else if (o->exists) {
-        // move onode within LRU
-        lru.erase(lru.iterator_to(*o));
-        lru.push_front(*o);
-        if (o->cache_age_bin != age_bins.front()) {
-          *(o->cache_age_bin) -= 1;
-          o->cache_age_bin = age_bins.front();
-          *(o->cache_age_bin) += 1;
+        // move onode within its tier
+        if (o->hot) {
+          hot_lru.erase(hot_lru.iterator_to(*o));
+          hot_lru.push_front(*o);
+        } else {
+          lru.erase(lru.iterator_to(*o));
+          lru.push_front(*o);
+          if (o->cache_age_bin != age_bins.front()) {
+            *(o->cache_age_bin) -= 1;
+            o->cache_age_bin = age_bins.front();
+            *(o->cache_age_bin) += 1;
+          }
         }
         dout(20) << __func__ << " " << this << " " << o->oid << " touched"
                  << dendl;
       }
+      if (o->lru_item.is_linked()) {
+        _maybe_promote(o);
+      }
     }
     ocs->lock.unlock();
   }
 
   void _trim_to(uint64_t new_size) override
   {
-    if (new_size >= lru.size()) {
+    // keep the hot tier within its share of the shard first, this
+    // also shrinks it when the shard itself is downsized
+    _trim_hot(_get_hot_max());
+    if (new_size >= lru.size() + hot_lru.size()) {
       return; // don't even try
     } 
     uint64_t n = num - new_size; // note: we might get empty LRU
                                  // before n == 0 due to pinned
                                  // entries. And hence being unable
                                  // to reach new_size target.
-    while (n-- > 0 && lru.size() > 0) {
-      BlueStore::Onode *o = &lru.back();
-      lru.pop_back();
+    // warm onodes go first, hot ones only when nothing else is left
+    while (n > 0 && (lru.size() > 0 || hot_lru.size() > 0)) {
+      --n;
+      BlueStore::Onode *o;
+      if (lru.size() > 0) {
+        o = &lru.back();
+        lru.pop_back();
+        *(o->cache_age_bin) -= 1;
+      } else {
+        o = &hot_lru.back();
+        hot_lru.pop_back();
+      }
 
       dout(20) << __func__ << "  rm " << o->oid << " "
-               << o->nref << " " << o->cached << dendl;
+               << o->nref << " " << o->cached << " " << o->hot << dendl;
 
-      *(o->cache_age_bin) -= 1;
       if (o->pin_nref > 1) {
         dout(20) << __func__ << " " << this << " " << " " << " " << o->oid << dendl;
       } else {
 	ceph_assert(num);
         --num;
+        _clear_hot(o);
         o->clear_cached();
         o->c->onode_space._remove(o->oid);
       }
@@ -1213,11 +1300,13 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
     ceph_assert(o->nref > 1);
     to->_add(o, 0);
   }
-  void add_stats(uint64_t *onodes, uint64_t *pinned_onodes) override
+  void add_stats(uint64_t *onodes, uint64_t *pinned_onodes,
+                 uint64_t *hot_onodes) override
   {
     std::lock_guard l(lock);
     *onodes += num;
-    *pinned_onodes += num - lru.size();
+    *pinned_onodes += num - lru.size() - hot_lru.size();
+    *hot_onodes += num_hot;
   }
 };
 
@@ -1983,12 +2072,24 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
       o = p->second;
 
       cache->logger->inc(l_bluestore_onode_hits);
+      if (o->hot) {
+        cache->logger->inc(l_bluestore_onode_hot_hits);
+      } else if (o->cache_hits < std::numeric_limits<uint16_t>::max()) {
+        // counted towards promotion to the hot tier once unpinned
+        ++o->cache_hits;
+      }
     }
   }
 
   return o;
 }
 
+bool BlueStore::OnodeSpace::contains(const ghobject_t& oid)
+{
+  std::lock_guard l(cache->lock);
+  return onode_map.count(oid);
+}
+
 void BlueStore::OnodeSpace::clear()
 {
   std::lock_guard l(cache->lock);
@@ -4722,6 +4823,9 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_compression_max_blob_size_ssd",
     "bluestore_compression_max_blob_size_hdd",
     "bluestore_compression_required_ratio",
+    "bluestore_compression_adaptive",
+    "bluestore_compression_adaptive_sample_size",
+    "bluestore_recompression_algorithm",
     "bluestore_max_alloc_size",
     "bluestore_prefer_deferred_size",
     "bluestore_prefer_deferred_size_hdd",
@@ -4775,7 +4879,10 @@ void BlueStore::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("bluestore_compression_mode") ||
       changed.count("bluestore_compression_algorithm") ||
       changed.count("bluestore_compression_min_blob_size") ||
-      changed.count("bluestore_compression_max_blob_size")) {
+      changed.count("bluestore_compression_max_blob_size") ||
+      changed.count("bluestore_compression_adaptive") ||
+      changed.count("bluestore_compression_adaptive_sample_size") ||
+      changed.count("bluestore_recompression_algorithm")) {
     if (bdev) {
       _set_compression();
     }
@@ -4866,6 +4973,10 @@ void BlueStore::_set_compression()
     }
   }
 
+  comp_adaptive = cct->_conf.get_val<bool>("bluestore_compression_adaptive");
+  comp_sample_size =
+    cct->_conf.get_val<Option::size_t>("bluestore_compression_adaptive_sample_size");
+
   auto& alg_name = cct->_conf->bluestore_compression_algorithm;
   if (!alg_name.empty()) {
     compressor = Compressor::create(cct, alg_name);
@@ -4875,11 +4986,26 @@ void BlueStore::_set_compression()
       _set_compression_alert(false, alg_name.c_str());
     }
   }
- 
+
+  recompressor = nullptr;
+  auto recomp_name =
+    cct->_conf.get_val<std::string>("bluestore_recompression_algorithm");
+  if (!recomp_name.empty()) {
+    recompressor = Compressor::create(cct, recomp_name);
+    if (!recompressor) {
+      derr << __func__ << " unable to initialize " << recomp_name
+	   << " compressor for recompression" << dendl;
+      _set_compression_alert(false, recomp_name.c_str());
+    }
+  }
+
   dout(10) << __func__ << " mode " << Compressor::get_comp_mode_name(comp_mode)
 	   << " alg " << (compressor ? compressor->get_type_name() : "(none)")
 	   << " min_blob " << comp_min_blob_size
 	   << " max_blob " << comp_max_blob_size
+	   << " adaptive " << comp_adaptive
+	   << " recompress "
+	   << (recompressor ? recompressor->get_type_name() : "(none)")
 	   << dendl;
 }
 
@@ -5267,6 +5393,31 @@ void BlueStore::_init_logger()
 	    "Sum for beneficial compress ops");
   b.add_u64_counter(l_bluestore_compress_rejected_count, "compress_rejected_count",
 	    "Sum for compress ops rejected due to low net gain of space");
+  b.add_u64_counter(l_bluestore_compress_skipped_count, "compress_skipped_count",
+	    "Sum for blobs not compressed as they were expected to be rejected");
+  b.add_u64_counter(l_bluestore_compress_skipped_bytes, "compress_skipped_bytes",
+		    "Bytes not compressed as they were expected to be rejected",
+		    NULL,
+		    PerfCountersBuilder::PRIO_DEBUGONLY,
+		    unit_t(UNIT_BYTES));
+  b.add_time(l_bluestore_compress_skipped_time, "compress_skipped_time",
+	    "Estimated time saved by not compressing skipped blobs");
+  b.add_time_avg(l_bluestore_compress_probe_lat, "compress_probe_lat",
+	    "Average latency of estimating a blob's entropy");
+  b.add_u64_counter(l_bluestore_recompress_objects, "recompress_objects",
+	    "Objects rewritten by background recompression");
+  b.add_u64_counter(l_bluestore_recompress_read_bytes, "recompress_read_bytes",
+		    "Bytes read back to be considered for recompression",
+		    NULL,
+		    PerfCountersBuilder::PRIO_DEBUGONLY,
+		    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_recompress_write_bytes, "recompress_write_bytes",
+		    "Bytes rewritten by background recompression, before compression",
+		    NULL,
+		    PerfCountersBuilder::PRIO_DEBUGONLY,
+		    unit_t(UNIT_BYTES));
+  b.add_time_avg(l_bluestore_recompress_lat, "recompress_lat",
+	    "Average latency of considering an object for recompression");
   //****************************************
 
   // onode cache stats
@@ -5275,12 +5426,20 @@ void BlueStore::_init_logger()
 	    "Number of onodes in cache");
   b.add_u64(l_bluestore_pinned_onodes, "onodes_pinned",
             "Number of pinned onodes in cache");
+  b.add_u64(l_bluestore_hot_onodes, "onodes_hot",
+            "Number of onodes in the hot tier of the cache");
   b.add_u64_counter(l_bluestore_onode_hits, "onode_hits",
 		    "Count of onode cache lookup hits",
 		    "o_ht", PerfCountersBuilder::PRIO_USEFUL);
   b.add_u64_counter(l_bluestore_onode_misses, "onode_misses",
 		    "Count of onode cache lookup misses",
 		    "o_ms", PerfCountersBuilder::PRIO_USEFUL);
+  b.add_u64_counter(l_bluestore_onode_hot_hits, "onode_hot_hits",
+		    "Count of onode cache lookup hits in the hot tier");
+  b.add_u64_counter(l_bluestore_onode_hot_promotes, "onode_hot_promotes",
+		    "Count of onodes promoted to the hot tier");
+  b.add_u64_counter(l_bluestore_onode_hot_demotes, "onode_hot_demotes",
+		    "Count of onodes demoted from the hot tier");
   b.add_u64_counter(l_bluestore_onode_shard_hits, "onode_shard_hits",
 		    "Count of onode shard cache lookups hits");
   b.add_u64_counter(l_bluestore_onode_shard_misses,
@@ -10606,6 +10765,37 @@ int BlueStore::pool_statfs(uint64_t pool_id, struct store_statfs_t *buf,
   return 0;
 }
 
+bool BlueStore::get_io_service_stats(io_service_stats_t *stats)
+{
+  auto fill = [](auto& from, io_service_stats_t::buckets_t& to) {
+    for (unsigned i = 0; i < to.size(); ++i) {
+      to[i].ops = from[i].ops.load(std::memory_order_relaxed);
+      to[i].ios = from[i].ios.load(std::memory_order_relaxed);
+      to[i].bytes = from[i].bytes.load(std::memory_order_relaxed);
+      to[i].nsec = from[i].nsec.load(std::memory_order_relaxed);
+    }
+  };
+  fill(io_service_read, stats->read);
+  fill(io_service_write, stats->write);
+  return true;
+}
+
+void BlueStore::_note_io_service(bool write, uint64_t ios, uint64_t bytes,
+				 mono_clock::duration lat)
+{
+  if (!ios) {
+    return;
+  }
+  auto& b = (write ? io_service_write : io_service_read)[
+    io_service_stats_t::get_bucket(ios, bytes)];
+  b.ops.fetch_add(1, std::memory_order_relaxed);
+  b.ios.fetch_add(ios, std::memory_order_relaxed);
+  b.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  b.nsec.fetch_add(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(lat).count(),
+    std::memory_order_relaxed);
+}
+
 void BlueStore::_check_legacy_statfs_alert()
 {
   string s;
@@ -10718,12 +10908,13 @@ void BlueStore::_update_logger()
 {
   uint64_t num_onodes = 0;
   uint64_t num_pinned_onodes = 0;
+  uint64_t num_hot_onodes = 0;
   uint64_t num_extents = 0;
   uint64_t num_blobs = 0;
   uint64_t num_buffers = 0;
   uint64_t num_buffer_bytes = 0;
   for (auto c : onode_cache_shards) {
-    c->add_stats(&num_onodes, &num_pinned_onodes);
+    c->add_stats(&num_onodes, &num_pinned_onodes, &num_hot_onodes);
   }
   for (auto c : buffer_cache_shards) {
     c->add_stats(&num_extents, &num_blobs,
@@ -10731,6 +10922,7 @@ void BlueStore::_update_logger()
   }
   logger->set(l_bluestore_onodes, num_onodes);
   logger->set(l_bluestore_pinned_onodes, num_pinned_onodes);
+  logger->set(l_bluestore_hot_onodes, num_hot_onodes);
   logger->set(l_bluestore_extents, num_extents);
   logger->set(l_bluestore_blobs, num_blobs);
   logger->set(l_bluestore_buffers, num_buffers);
@@ -10842,6 +11034,31 @@ int BlueStore::read(
   size_t length,
   bufferlist& bl,
   uint32_t op_flags)
+{
+  return _read(c_, oid, offset, length, bl, nullptr, op_flags);
+}
+
+int BlueStore::read_crc32c(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  bufferlist& bl,
+  uint32_t *crc,
+  uint32_t op_flags)
+{
+  ceph_assert(crc);
+  return _read(c_, oid, offset, length, bl, crc, op_flags);
+}
+
+int BlueStore::_read(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  bufferlist& bl,
+  uint32_t *crc,
+  uint32_t op_flags)
 {
   auto start = mono_clock::now();
   Collection *c = static_cast<Collection *>(c_.get());
@@ -10870,7 +11087,7 @@ int BlueStore::read(
     if (offset == length && offset == 0)
       length = o->onode.size;
 
-    r = _do_read(c, o, offset, length, bl, op_flags);
+    r = _do_read(c, o, offset, length, bl, op_flags, 0, crc);
     if (r == -EIO) {
       logger->inc(l_bluestore_read_eio);
     }
@@ -11072,7 +11289,8 @@ int BlueStore::_generate_read_result_bl(
   blobs2read_t& blobs2read,
   bool buffered,
   bool* csum_error,
-  bufferlist& bl)
+  bufferlist& bl,
+  map<uint64_t, pair<uint32_t, uint32_t>>* chunk_crcs)
 {
  // enumerate and decompress desired blobs
   auto p = compressed_blob_bls.begin();
@@ -11120,6 +11338,9 @@ int BlueStore::_generate_read_result_bl(
         for (const auto& r : req.regs) {
           ready_regions[r.logical_offset].substr_of(req.bl, r.front, r.length);
         }
+        if (chunk_crcs) {
+          _note_chunk_crcs(bptr->get_blob(), req.regs, chunk_crcs);
+        }
       }
     }
     ++b2r_it;
@@ -11146,6 +11367,9 @@ int BlueStore::_generate_read_result_bl(
       dout(30) << __func__ << " assemble 0x" << std::hex << pos
                << ": zeros for 0x" << (pos + offset) << "~" << l
                << std::dec << dendl;
+      if (chunk_crcs) {
+        (*chunk_crcs)[pos + offset] = {(uint32_t)l, ceph_crc32c(-1, nullptr, l)};
+      }
       bl.append_zero(l);
       pos += l;
     }
@@ -11163,7 +11387,8 @@ int BlueStore::_do_read(
   size_t length,
   bufferlist& bl,
   uint32_t op_flags,
-  uint64_t retry_count)
+  uint64_t retry_count,
+  uint32_t *crc)
 {
   FUNCTRACE(cct);
   int r = 0;
@@ -11222,6 +11447,10 @@ int BlueStore::_do_read(
                              // The error isn't that much...
   vector<bufferlist> compressed_blob_bls;
   IOContext ioc(cct, NULL, !cct->_conf->bluestore_fail_eio);
+  if (!buffered) {
+    // lets the device read into buffers it does not want cached
+    ioc.flags |= IOContext::FLAG_DONT_CACHE;
+  }
   r = _prepare_read_ioc(blobs2read, &compressed_blob_bls, &ioc);
   // we always issue aio for reading, so errors other than EIO are not allowed
   if (r < 0)
@@ -11230,6 +11459,9 @@ int BlueStore::_do_read(
   int64_t num_ios = blobs2read.size();
   if (ioc.has_pending_aios()) {
     num_ios = ioc.get_num_ios();
+    // what goes to the device: no cache hits or holes, compressed and
+    // csum-aligned lengths
+    uint64_t io_bytes = ioc.get_pending_bytes();
     bdev->aio_submit(&ioc);
     dout(20) << __func__ << " waiting for aio" << dendl;
     ioc.aio_wait();
@@ -11238,6 +11470,7 @@ int BlueStore::_do_read(
       ceph_assert(r == -EIO); // no other errors allowed
       return -EIO;
     }
+    _note_io_service(false, num_ios, io_bytes, mono_clock::now() - start);
   }
   log_latency_fn(__func__,
     l_bluestore_read_wait_aio_lat,
@@ -11247,10 +11480,12 @@ int BlueStore::_do_read(
   );
 
   bool csum_error = false;
+  map<uint64_t, pair<uint32_t, uint32_t>> chunk_crcs;
   r = _generate_read_result_bl(o, offset, length, ready_regions,
                               compressed_blob_bls, blobs2read,
                               buffered && !ioc.skip_cache(),
-                              &csum_error, bl);
+                              &csum_error, bl,
+                              crc ? &chunk_crcs : nullptr);
   if (csum_error) {
     // Handles spurious read errors caused by a kernel bug.
     // We sometimes get all-zero pages as a result of the read under
@@ -11260,7 +11495,10 @@ int BlueStore::_do_read(
     if (retry_count >= cct->_conf->bluestore_retry_disk_reads) {
       return -EIO;
     }
-    return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1);
+    return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1, crc);
+  }
+  if (crc) {
+    *crc = _crc32c_with_chunks(*crc, offset, bl, chunk_crcs);
   }
   r = bl.length();
   if (retry_count) {
@@ -11274,6 +11512,65 @@ int BlueStore::_do_read(
   return r;
 }
 
+void BlueStore::_note_chunk_crcs(
+  const bluestore_blob_t& blob,
+  const list<region_t>& regs,
+  map<uint64_t, pair<uint32_t, uint32_t>>* chunk_crcs) const
+{
+  // only what _verify_csum() has just checked against the device data
+  // is worth anything here
+  if (blob.csum_type != Checksummer::CSUM_CRC32C ||
+      cct->_conf->bluestore_ignore_data_csum) {
+    return;
+  }
+  const uint64_t cs = blob.get_csum_chunk_size();
+  for (const auto& r : regs) {
+    uint64_t x = p2roundup(r.blob_xoffset, cs);
+    const uint64_t end = p2align(r.blob_xoffset + r.length, cs);
+    for (; x < end; x += cs) {
+      (*chunk_crcs)[r.logical_offset + x - r.blob_xoffset] =
+	{(uint32_t)cs, (uint32_t)blob.get_csum_item(x / cs)};
+    }
+  }
+}
+
+uint32_t BlueStore::_crc32c_with_chunks(
+  uint32_t crc,
+  uint64_t offset,
+  const bufferlist& bl,
+  const map<uint64_t, pair<uint32_t, uint32_t>>& chunk_crcs)
+{
+  // The blob checksums are seeded with -1; for a chunk with crc32c c
+  // under seed -1, crc32c(seed, chunk) == c ^ crc32c(seed ^ -1, zeros).
+  // The latter takes O(log len), so a verified chunk is folded in
+  // without looking at its data again.
+  auto p = bl.cbegin();
+  uint64_t pos = offset;
+  const uint64_t end = offset + bl.length();
+  auto c = chunk_crcs.lower_bound(offset);
+  while (pos < end) {
+    while (c != chunk_crcs.end() && c->first < pos) {
+      ++c;
+    }
+    if (c != chunk_crcs.end() && c->first == pos &&
+	pos + c->second.first <= end) {
+      auto [len, chunk_crc] = c->second;
+      crc = chunk_crc ^ ceph_crc32c(crc ^ 0xffffffff, nullptr, len);
+      p += len;
+      pos += len;
+      ++c;
+    } else {
+      uint64_t l = end - pos;
+      if (c != chunk_crcs.end() && c->first > pos && c->first < end) {
+	l = c->first - pos;
+      }
+      crc = p.crc32c(l, crc);
+      pos += l;
+    }
+  }
+  return crc;
+}
+
 int BlueStore::_verify_csum(OnodeRef& o,
 			    const bluestore_blob_t* blob, uint64_t blob_xoffset,
 			    const bufferlist& bl,
@@ -11569,6 +11866,9 @@ int BlueStore::_do_readv(
   _dump_onode<30>(cct, *o);
 
   IOContext ioc(cct, NULL, !cct->_conf->bluestore_fail_eio);
+  if (!buffered) {
+    ioc.flags |= IOContext::FLAG_DONT_CACHE;
+  }
   vector<std::tuple<ready_regions_t, vector<bufferlist>, blobs2read_t>> raw_results;
   raw_results.reserve(m.num_intervals());
   int i = 0;
@@ -11585,6 +11885,7 @@ int BlueStore::_do_readv(
   auto num_ios = m.size();
   if (ioc.has_pending_aios()) {
     num_ios = ioc.get_num_ios();
+    uint64_t io_bytes = ioc.get_pending_bytes();
     bdev->aio_submit(&ioc);
     dout(20) << __func__ << " waiting for aio" << dendl;
     ioc.aio_wait();
@@ -11593,6 +11894,7 @@ int BlueStore::_do_readv(
       ceph_assert(r == -EIO); // no other errors allowed
       return -EIO;
     }
+    _note_io_service(false, num_ios, io_bytes, mono_clock::now() - start);
   }
   log_latency_fn(__func__,
     l_bluestore_read_wait_aio_lat,
@@ -12150,15 +12452,19 @@ int BlueStore::omap_get_values(
     const string& prefix = o->get_omap_prefix();
     o->get_omap_key(string(), &final_key);
     size_t base_key_len = final_key.size();
+    // fetch them all in one batch rather than a lookup per key
+    set<string> final_keys;
     for (set<string>::const_iterator p = keys.begin(); p != keys.end(); ++p) {
       final_key.resize(base_key_len); // keep prefix
       final_key += *p;
-      bufferlist val;
-      if (db->get(prefix, final_key, &val) >= 0) {
-	dout(30) << __func__ << "  got " << pretty_binary_string(final_key)
-		 << " -> " << *p << dendl;
-	out->insert(make_pair(*p, val));
-      }
+      final_keys.insert(final_keys.end(), final_key);
+    }
+    map<string, bufferlist> vals;
+    db->get(prefix, final_keys, &vals);
+    for (auto& [k, val] : vals) {
+      dout(30) << __func__ << "  got " << pretty_binary_string(k)
+	       << " -> " << k.substr(base_key_len) << dendl;
+      out->insert(out->end(), make_pair(k.substr(base_key_len), std::move(val)));
     }
   }
  out:
@@ -12173,6 +12479,58 @@ int BlueStore::omap_get_values(
   return r;
 }
 
+int BlueStore::omap_get_values_range(
+  CollectionHandle &c_,            ///< [in] Collection containing oid
+  const ghobject_t &oid,           ///< [in] Object containing omap
+  const string &from,              ///< [in] First key to list
+  bool inclusive,                  ///< [in] Include from itself
+  size_t readahead,                ///< [in] Bytes likely to be read
+  const std::function<bool(std::string_view, std::string_view)>& f)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " oid " << oid
+	   << " from " << pretty_binary_string(from)
+	   << (inclusive ? " inclusive" : "")
+	   << " readahead " << readahead << dendl;
+  if (!c->exists)
+    return -ENOENT;
+  std::shared_lock l(c->lock);
+  auto start1 = mono_clock::now();
+  int r = 0;
+  OnodeRef o = c->get_onode(oid, false);
+  if (!o || !o->exists) {
+    r = -ENOENT;
+    goto out;
+  }
+  if (!o->onode.has_omap()) {
+    goto out;
+  }
+  o->flush();
+  {
+    string first, tail;
+    o->get_omap_key(from, &first);
+    o->get_omap_tail(&tail);
+    size_t base_key_len = first.size() - from.size();
+    r = db->get_range(
+      o->get_omap_prefix(), first, inclusive, tail, readahead,
+      [&](std::string_view k, std::string_view v) {
+	dout(30) << __func__ << "  got " << pretty_binary_string(string(k))
+		 << dendl;
+	return f(k.substr(base_key_len), v);
+      });
+  }
+ out:
+  c->store->log_latency(
+    __func__,
+    l_bluestore_omap_get_values_lat,
+    mono_clock::now() - start1,
+    c->store->cct->_conf->bluestore_log_omap_iterator_age);
+
+  dout(10) << __func__ << " " << c->get_cid() << " oid " << oid << " = " << r
+	   << dendl;
+  return r;
+}
+
 #ifdef WITH_SEASTAR
 int BlueStore::omap_get_values(
   CollectionHandle &c_,        ///< [in] Collection containing oid
@@ -12649,6 +13007,8 @@ void BlueStore::_txc_state_proc(TransContext *txc)
         }
 #endif
 	txc->had_ios = true;
+	txc->aio_ios = txc->ioc.get_num_ios();
+	txc->aio_bytes = txc->ioc.get_pending_bytes();
 	_txc_aio_submit(txc);
 	return;
       }
@@ -12658,6 +13018,12 @@ void BlueStore::_txc_state_proc(TransContext *txc)
       {
 	mono_clock::duration lat = throttle.log_state_latency(
 	  *txc, logger, l_bluestore_state_aio_wait_lat);
+	// sample what went to the device rather than what the txc was
+	// charged for, which not every txc sets and which counts the
+	// logical bytes (and deferred writes) rather than the aios
+	if (txc->aio_bytes) {
+	  _note_io_service(true, txc->aio_ios, txc->aio_bytes, lat);
+	}
 	if (ceph::to_seconds<double>(lat) >= cct->_conf->bluestore_log_op_age) {
 	  dout(0) << __func__ << " slow aio_wait, txc = " << txc
 		  << ", latency = " << lat
@@ -14185,6 +14551,43 @@ bool BlueStore::_eliminate_outdated_deferred(bluestore_deferred_transaction_t* d
 // ---------------------------
 // transactions
 
+void BlueStore::_txc_journal_deferred(TransContext *txc)
+{
+  if (txc->deferred_txn) {
+    txc->deferred_txn->seq = ++deferred_seq;
+    bufferlist bl;
+    encode(*txc->deferred_txn, bl);
+    string key;
+    get_deferred_key(txc->deferred_txn->seq, &key);
+    txc->t->set(PREFIX_DEFERRED, key, bl);
+  }
+}
+
+void BlueStore::_txc_start_throttle(TransContext *txc,
+				    mono_clock::time_point tstart)
+{
+  if (!throttle.try_start_transaction(
+	*db,
+	*txc,
+	tstart)) {
+    // ensure we do not block here because of deferred writes
+    dout(10) << __func__ << " failed get throttle_deferred_bytes, aggressive"
+	     << dendl;
+    ++deferred_aggressive;
+    deferred_try_submit();
+    {
+      // wake up any previously finished deferred events
+      std::lock_guard l(kv_lock);
+      if (!kv_sync_in_progress) {
+	kv_sync_in_progress = true;
+	kv_cond.notify_one();
+      }
+    }
+    throttle.finish_start_transaction(*db, *txc, tstart);
+    --deferred_aggressive;
+  }
+}
+
 int BlueStore::queue_transactions(
   CollectionHandle& ch,
   vector<Transaction>& tls,
@@ -14223,17 +14626,7 @@ int BlueStore::queue_transactions(
   _txc_calc_cost(txc);
 
   _txc_write_nodes(txc, txc->t);
-
-  // journal deferred items
-  if (txc->deferred_txn) {
-    txc->deferred_txn->seq = ++deferred_seq;
-    bufferlist bl;
-    encode(*txc->deferred_txn, bl);
-    string key;
-    get_deferred_key(txc->deferred_txn->seq, &key);
-    txc->t->set(PREFIX_DEFERRED, key, bl);
-  }
-
+  _txc_journal_deferred(txc);
   _txc_finalize_kv(txc, txc->t);
 
 #ifdef WITH_BLKIN
@@ -14246,27 +14639,7 @@ int BlueStore::queue_transactions(
     handle->suspend_tp_timeout();
 
   auto tstart = mono_clock::now();
-
-  if (!throttle.try_start_transaction(
-	*db,
-	*txc,
-	tstart)) {
-    // ensure we do not block here because of deferred writes
-    dout(10) << __func__ << " failed get throttle_deferred_bytes, aggressive"
-	     << dendl;
-    ++deferred_aggressive;
-    deferred_try_submit();
-    {
-      // wake up any previously finished deferred events
-      std::lock_guard l(kv_lock);
-      if (!kv_sync_in_progress) {
-	kv_sync_in_progress = true;
-	kv_cond.notify_one();
-      }
-    }
-    throttle.finish_start_transaction(*db, *txc, tstart);
-    --deferred_aggressive;
-  }
+  _txc_start_throttle(txc, tstart);
   auto tend = mono_clock::now();
 
   if (handle)
@@ -15535,7 +15908,10 @@ int BlueStore::_do_alloc_write(
 
   CompressorRef c;
   double crr = 0;
-  if (wctx->compress) {
+  if (wctx->compressor) {
+    c = wctx->compressor;
+    crr = wctx->required_ratio;
+  } else if (wctx->compress) {
     c = select_option(
       "compression_algorithm",
       compressor,
@@ -15599,8 +15975,37 @@ int BlueStore::_do_alloc_write(
   // We assume that allocator does its best to provide contiguous space,
   // and the condition is : (data_size < deferred).
 
+  // with adaptive compression, data that compressed poorly before is
+  // likely to again; the hint says otherwise, so trust that.  a
+  // compressor the caller brought (recompress()) has tried the data
+  // already, and is not the one the model learns about
+  bool adaptive = c && comp_adaptive && !wctx->compressor &&
+    !(o->onode.alloc_hint_flags & CEPH_OSD_ALLOC_HINT_FLAG_COMPRESSIBLE);
+  uint64_t sample_size = comp_sample_size;
   auto max_bsize = std::max(wctx->target_blob_size, min_alloc_size);
   for (auto& wi : wctx->writes) {
+    double entropy = 0;
+    if (adaptive && wi.blob_length > min_alloc_size) {
+      auto start = mono_clock::now();
+      entropy = bluestore_compressibility_t::estimate_entropy(wi.bl,
+							      sample_size);
+      bool skip = coll->compressibility.should_skip(entropy, crr);
+      logger->tinc(l_bluestore_compress_probe_lat, mono_clock::now() - start);
+      if (skip) {
+	dout(20) << __func__ << std::hex << "  0x" << wi.blob_length
+		 << std::dec << " bytes with entropy " << entropy
+		 << " expected to compress to "
+		 << coll->compressibility.get_ratio(entropy)
+		 << ", leaving uncompressed" << dendl;
+	logger->inc(l_bluestore_compress_skipped_count);
+	logger->inc(l_bluestore_compress_skipped_bytes, wi.blob_length);
+	logger->tinc(l_bluestore_compress_skipped_time,
+		     coll->compressibility.estimate_cost(wi.blob_length));
+	need += wi.blob_length;
+	data_size += wi.bl.length();
+	continue;
+      }
+    }
     if (c && wi.blob_length > min_alloc_size) {
       auto start = mono_clock::now();
 
@@ -15611,7 +16016,10 @@ int BlueStore::_do_alloc_write(
       // FIXME: memory alignment here is bad
       bufferlist t;
       std::optional<int32_t> compressor_message;
-      int r = c->compress(wi.bl, t, compressor_message);
+      int r = wctx->compress_level ?
+	c->compress_with_level(wi.bl, t, compressor_message,
+			       wctx->compress_level) :
+	c->compress(wi.bl, t, compressor_message);
       uint64_t want_len_raw = wi.blob_length * crr;
       uint64_t want_len = p2roundup(want_len_raw, min_alloc_size);
       bool rejected = false;
@@ -15675,9 +16083,15 @@ int BlueStore::_do_alloc_write(
 	need += wi.blob_length;
 	data_size += wi.bl.length();
       }
+      auto elapsed = mono_clock::now() - start;
+      if (adaptive) {
+	coll->compressibility.learn(entropy, wi.blob_length,
+				    r == 0 ? compressed_len : wi.blob_length,
+				    elapsed);
+      }
       log_latency("compress@_do_alloc_write",
 	l_bluestore_compress_lat,
-        mono_clock::now() - start,
+        elapsed,
 	cct->_conf->bluestore_log_op_age );
     } else {
       need += wi.blob_length;
@@ -16178,6 +16592,195 @@ int BlueStore::_do_gc(
   return 0;
 }
 
+int BlueStore::recompress(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t *bytes_read)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  CollectionRef cref(c);
+  dout(15) << __func__ << " " << c->cid << " " << oid << dendl;
+  *bytes_read = 0;
+  CompressorRef cp = recompressor;
+  if (!cp) {
+    return -EOPNOTSUPP;
+  }
+  if (!c->exists) {
+    return -ENOENT;
+  }
+
+  auto start = mono_clock::now();
+  OnodeRef o;
+  uint16_t write_seq;
+  WriteContext wctx;
+  std::map<uint64_t, bufferlist> to_rewrite;
+  uint64_t rewrite_bytes = 0;
+  {
+    // reading and compressing take a while, so only hold writers off
+    // for the rewrite itself
+    std::shared_lock l(c->lock);
+    // an onode still in the cache has been used lately, so let it be
+    if (c->onode_space.contains(oid)) {
+      dout(20) << __func__ << " " << oid << " is not cold" << dendl;
+      return 0;
+    }
+    o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      return -ENOENT;
+    }
+    write_seq = o->write_seq;
+    if (o->onode.has_flag(bluestore_onode_t::FLAG_RECOMPRESSED) ||
+	(o->onode.alloc_hint_flags & CEPH_OSD_ALLOC_HINT_FLAG_INCOMPRESSIBLE)) {
+      return 0;
+    }
+    auto cm = select_option(
+      "compression_mode",
+      comp_mode.load(),
+      [&]() {
+	string val;
+	if (c->pool_opts.get(pool_opts_t::COMPRESSION_MODE, &val)) {
+	  return std::optional<Compressor::CompressionMode>(
+	    Compressor::get_comp_mode_type(val));
+	}
+	return std::optional<Compressor::CompressionMode>();
+      }
+    );
+    if (cm == Compressor::COMP_NONE) {
+      return 0;
+    }
+
+    _choose_write_options(cref, o, 0, &wctx);
+    wctx.compress = true;
+    wctx.compressor = cp;
+    wctx.compress_level =
+      cct->_conf.get_val<int64_t>("bluestore_recompression_level");
+    wctx.required_ratio =
+      cct->_conf.get_val<double>("bluestore_recompression_required_ratio");
+    // nobody is waiting on cold data, so favour large blobs
+    wctx.target_blob_size = std::max(
+      std::min(comp_max_blob_size.load(), max_blob_size.load()),
+      min_alloc_size * 2);
+
+    // data shared with clones would be duplicated by the rewrite, and
+    // extents no bigger than an allocation unit can't get any smaller
+    o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
+    struct candidate_t {
+      uint64_t offset;
+      uint64_t length;
+      uint64_t allocated;  ///< space it takes now
+    };
+    std::vector<candidate_t> candidates;
+    for (auto& e : o->extent_map.extent_map) {
+      auto& b = e.blob->get_blob();
+      if (b.is_shared() || e.length <= min_alloc_size) {
+	continue;
+      }
+      uint64_t allocated = b.is_compressed() ?
+	(uint64_t)b.get_ondisk_length() * e.length / b.get_logical_length() :
+	p2roundup<uint64_t>(e.length, min_alloc_size);
+      candidates.push_back({e.logical_offset, e.length, allocated});
+    }
+    // nothing to try, and cheap to find out again, so don't spend a
+    // write on flagging it
+    if (candidates.empty()) {
+      return 0;
+    }
+
+    // try each before rewriting, so that data that doesn't compress any
+    // better costs a read rather than a write too; the rewrite compresses
+    // it again, which is fine for a background task
+    for (auto& cd : candidates) {
+      bufferlist bl;
+      int r = _do_read(c, o, cd.offset, cd.length, bl, 0);
+      if (r < 0) {
+	derr << __func__ << " " << oid << " failed to read 0x" << std::hex
+	     << cd.offset << "~" << cd.length << std::dec << ": "
+	     << cpp_strerror(r) << dendl;
+	return r;
+      }
+      *bytes_read += bl.length();
+      bufferlist t;
+      std::optional<int32_t> compressor_message;
+      r = wctx.compress_level ?
+	cp->compress_with_level(bl, t, compressor_message,
+				wctx.compress_level) :
+	cp->compress(bl, t, compressor_message);
+      uint64_t want_len = p2roundup<uint64_t>(
+	cd.length * wctx.required_ratio, min_alloc_size);
+      uint64_t result_len = p2roundup<uint64_t>(t.length(), min_alloc_size);
+      dout(20) << __func__ << " " << oid << std::hex << " 0x" << cd.offset
+	       << "~" << cd.length << " takes 0x" << cd.allocated
+	       << ", would take 0x" << result_len << std::dec << dendl;
+      if (r == 0 && result_len <= want_len && result_len < cd.allocated) {
+	rewrite_bytes += bl.length();
+	to_rewrite.emplace(cd.offset, std::move(bl));
+      }
+    }
+    // leave headroom, as the old extents are only released once the
+    // new ones are written
+    if (rewrite_bytes && rewrite_bytes * 2 > alloc->get_free()) {
+      dout(10) << __func__ << " " << oid << " not enough free space to rewrite 0x"
+	       << std::hex << rewrite_bytes << std::dec << dendl;
+      logger->inc(l_bluestore_recompress_read_bytes, *bytes_read);
+      return 0;
+    }
+  }
+
+  TransContext *txc = nullptr;
+  {
+    std::unique_lock l(c->lock);
+    // only rewrite what we read: if it was written, removed or dropped
+    // from the cache meanwhile, leave it to the next pass
+    if (!c->exists || c->get_onode(oid, false) != o || !o->exists ||
+	o->write_seq != write_seq) {
+      dout(20) << __func__ << " " << oid << " changed, skipping" << dendl;
+      logger->inc(l_bluestore_recompress_read_bytes, *bytes_read);
+      return 0;
+    }
+    txc = _txc_create(c, c->osr.get(), nullptr);
+    spg_t pgid;
+    if (c->cid.is_pg(&pgid)) {
+      txc->osd_pool_id = pgid.pool();
+    }
+    if (!to_rewrite.empty()) {
+      // shards may have been trimmed while we didn't hold the lock
+      o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
+      uint64_t dirty_start = to_rewrite.begin()->first;
+      uint64_t dirty_end = to_rewrite.rbegin()->first +
+	to_rewrite.rbegin()->second.length();
+      for (auto& [offset, bl] : to_rewrite) {
+	_do_write_data(txc, cref, o, offset, bl.length(), bl, &wctx);
+      }
+      int r = _do_alloc_write(txc, cref, o, &wctx);
+      if (r < 0) {
+	derr << __func__ << " _do_alloc_write failed with " << cpp_strerror(r)
+	     << dendl;
+	ceph_abort_msg("unexpected error");
+      }
+      _wctx_finish(txc, cref, o, &wctx);
+      o->extent_map.compress_extent_map(dirty_start, dirty_end - dirty_start);
+      o->extent_map.dirty_range(dirty_start, dirty_end - dirty_start);
+      logger->inc(l_bluestore_recompress_objects);
+      logger->inc(l_bluestore_recompress_write_bytes, rewrite_bytes);
+    }
+    // don't look at it again until it is written to
+    o->onode.set_flag(bluestore_onode_t::FLAG_RECOMPRESSED);
+    txc->write_onode(o);
+
+    _txc_calc_cost(txc);
+    _txc_write_nodes(txc, txc->t);
+    _txc_journal_deferred(txc);
+    _txc_finalize_kv(txc, txc->t);
+  }
+
+  _txc_start_throttle(txc, mono_clock::now());
+  _txc_state_proc(txc);
+
+  logger->inc(l_bluestore_recompress_read_bytes, *bytes_read);
+  logger->tinc(l_bluestore_recompress_lat, mono_clock::now() - start);
+  return 0;
+}
+
 int BlueStore::_do_write(
   TransContext *txc,
   CollectionRef& c,
@@ -16208,6 +16811,7 @@ int BlueStore::_do_write(
   }
 
   uint64_t end = offset + length;
+  o->onode.clear_flag(bluestore_onode_t::FLAG_RECOMPRESSED);
 
   GarbageCollector gc(c->store->cct);
   int64_t benefit = 0;
@@ -16893,7 +17497,7 @@ int BlueStore::_clone(TransContext *txc,
     }
     // check if prefix for omap key is exactly the same size for both objects
     // otherwise rewrite_omap_key will corrupt data
-    ceph_assert(oldo->onode.flags == newo->onode.flags);
+    ceph_assert(oldo->onode.get_omap_flags() == newo->onode.get_omap_flags());
     const string& prefix = newo->get_omap_prefix();
     string head, tail;
     oldo->get_omap_header(&head);
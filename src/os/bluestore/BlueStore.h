@@ -159,14 +159,26 @@ enum {
   l_bluestore_decompress_lat,
   l_bluestore_compress_success_count,
   l_bluestore_compress_rejected_count,
+  l_bluestore_compress_skipped_count,
+  l_bluestore_compress_skipped_bytes,
+  l_bluestore_compress_skipped_time,
+  l_bluestore_compress_probe_lat,
+  l_bluestore_recompress_objects,
+  l_bluestore_recompress_read_bytes,
+  l_bluestore_recompress_write_bytes,
+  l_bluestore_recompress_lat,
   //****************************************
 
   // onode cache stats
   //****************************************
   l_bluestore_onodes,
   l_bluestore_pinned_onodes,
+  l_bluestore_hot_onodes,
   l_bluestore_onode_hits,
   l_bluestore_onode_misses,
+  l_bluestore_onode_hot_hits,
+  l_bluestore_onode_hot_promotes,
+  l_bluestore_onode_hot_demotes,
   l_bluestore_onode_shard_hits,
   l_bluestore_onode_shard_misses,
   l_bluestore_extents,
@@ -1196,6 +1208,12 @@ public:
     bool cached;              ///< Onode is logically in the cache
                               /// (it can be pinned and hence physically out
                               /// of it at the moment though)
+    bool hot = false;         ///< Onode belongs to the hot tier of its
+                              /// cache shard (protected by cache lock)
+    uint16_t cache_hits = 0;  ///< lookup hits since last (re)insertion into
+                              /// the warm tier (protected by cache lock)
+    uint16_t write_seq = 0;   ///< bumped by each txc that writes it
+                              /// (protected by collection lock)
     ExtentMap extent_map;
 
     // track txc's that have not been committed to kv store (and whose
@@ -1400,6 +1418,7 @@ private:
   /// A Generic onode Cache Shard
   struct OnodeCacheShard : public CacheShard {
     std::array<std::pair<ghobject_t, ceph::mono_clock::time_point>, 64> dumped_onodes;
+    std::atomic<uint64_t> num_hot = {0}; ///< onodes in the hot tier
 
   public:
     OnodeCacheShard(CephContext* cct) : CacheShard(cct) {}
@@ -1413,10 +1432,14 @@ private:
     virtual void _move_pinned(OnodeCacheShard *to, Onode *o) = 0;
 
     virtual void maybe_unpin(Onode* o) = 0;
-    virtual void add_stats(uint64_t *onodes, uint64_t *pinned_onodes) = 0;
+    virtual void add_stats(uint64_t *onodes, uint64_t *pinned_onodes,
+                           uint64_t *hot_onodes) = 0;
     bool empty() {
       return _get_num() == 0;
     }
+    uint64_t get_num_hot() const {
+      return num_hot;
+    }
   };
 
   /// A Generic buffer Cache Shard
@@ -1483,6 +1506,8 @@ private:
 
     OnodeRef add_onode(const ghobject_t& oid, OnodeRef& o);
     OnodeRef lookup(const ghobject_t& o);
+    /// whether o is cached, without counting it as a hit
+    bool contains(const ghobject_t& o);
     void rename(OnodeRef& o, const ghobject_t& old_oid,
 		const ghobject_t& new_oid,
 		const mempool::bluestore_cache_meta::string& new_okey);
@@ -1519,6 +1544,9 @@ private:
     pool_opts_t pool_opts;
     ContextQueue *commit_queue;
 
+    /// how well what is written here compresses; under lock
+    bluestore_compressibility_t compressibility;
+
     OnodeCacheShard* get_onode_cache() const {
       return onode_space.cache;
     }
@@ -1795,6 +1823,7 @@ private:
 
     IOContext ioc;
     bool had_ios = false;  ///< true if we submitted IOs before our kv txn
+    uint64_t aio_ios = 0, aio_bytes = 0;  ///< what those IOs were
 
     uint64_t seq = 0;
     ceph::mono_clock::time_point start;
@@ -1832,6 +1861,7 @@ private:
     }
 
     void write_onode(OnodeRef& o) {
+      ++o->write_seq;
       onodes.insert(o);
     }
     void write_shared_blob(SharedBlobRef &sb) {
@@ -2332,9 +2362,24 @@ private:
   CompressorRef compressor;
   std::atomic<uint64_t> comp_min_blob_size = {0};
   std::atomic<uint64_t> comp_max_blob_size = {0};
+  CompressorRef recompressor; ///< for recompress()
+  std::atomic<bool> comp_adaptive = {false};
+  std::atomic<uint64_t> comp_sample_size = {0};
 
   std::atomic<uint64_t> max_blob_size = {0};  ///< maximum blob size
 
+  /// device waits reported by get_io_service_stats()
+  struct io_service_bucket_t {
+    std::atomic<uint64_t> ops = {0};
+    std::atomic<uint64_t> ios = {0};
+    std::atomic<uint64_t> bytes = {0};
+    std::atomic<uint64_t> nsec = {0};
+  };
+  std::array<io_service_bucket_t, io_service_stats_t::NUM_BUCKETS>
+    io_service_read, io_service_write;
+  void _note_io_service(bool write, uint64_t ios, uint64_t bytes,
+			mono_clock::duration lat);
+
   uint64_t kv_ios = 0;
   uint64_t kv_throttle_costs = 0;
 
@@ -2389,6 +2434,11 @@ private:
 
       virtual uint64_t _get_used_bytes() const = 0;
       virtual uint64_t _sum_bins(uint32_t start, uint32_t end) const = 0;
+      // bytes held by entries that are not age binned and should be
+      // requested ahead of everything else
+      virtual uint64_t _get_hot_bytes() const {
+        return 0;
+      }
 
       virtual int64_t request_cache_bytes(
           PriorityCache::Priority pri, uint64_t total_cache) const {
@@ -2397,13 +2447,15 @@ private:
         switch (pri) {
         case PriorityCache::Priority::PRI0:
 	  {
-            // BlueStore caches currently don't put anything in PRI0
-	    break;
+            // Only the hot onode tier (if enabled) lives in PRI0
+	    int64_t request = _get_hot_bytes();
+            return(request > assigned) ? request - assigned : 0;
 	  }
         case PriorityCache::Priority::LAST:
           {
             uint32_t max = get_bin_count();
-	    int64_t request = _get_used_bytes() - _sum_bins(0, max);
+	    int64_t request = _get_used_bytes() - _sum_bins(0, max) -
+	      _get_hot_bytes();
             return(request > assigned) ? request - assigned : 0;
           }
         default:
@@ -2525,6 +2577,13 @@ private:
 	}
 	return onodes*get_bytes_per_onode();
       }
+      virtual uint64_t _get_hot_bytes() const {
+        uint64_t onodes = 0;
+	for (auto i : store->onode_cache_shards) {
+	  onodes += i->get_num_hot();
+	}
+	return onodes*get_bytes_per_onode();
+      }
       virtual std::string get_cache_name() const {
         return "BlueStore Meta Cache";
       }
@@ -2726,6 +2785,9 @@ public:
   }
 private:
   void _txc_finish_io(TransContext *txc);
+  void _txc_journal_deferred(TransContext *txc);
+  void _txc_start_throttle(TransContext *txc,
+			   ceph::mono_clock::time_point tstart);
   void _txc_finalize_kv(TransContext *txc, KeyValueDB::Transaction t);
   void _txc_apply_kv(TransContext *txc, bool sync_submit_transaction);
   void _txc_committed_kv(TransContext *txc);
@@ -2989,6 +3051,7 @@ public:
              osd_alert_list_t* alerts = nullptr) override;
   int pool_statfs(uint64_t pool_id, struct store_statfs_t *buf,
 		  bool *per_pool_omap) override;
+  bool get_io_service_stats(io_service_stats_t *stats) override;
 
   void collect_metadata(std::map<std::string,std::string> *pm) override;
 
@@ -3008,8 +3071,24 @@ public:
     size_t len,
     ceph::buffer::list& bl,
     uint32_t op_flags = 0) override;
+  int read_crc32c(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    ceph::buffer::list& bl,
+    uint32_t *crc,
+    uint32_t op_flags = 0) override;
 
 private:
+  int _read(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    ceph::buffer::list& bl,
+    uint32_t *crc,
+    uint32_t op_flags);
 
   // --------------------------------------------------------
   // intermediate data structures used while reading
@@ -3081,7 +3160,21 @@ private:
     blobs2read_t& blobs2read,
     bool buffered,
     bool* csum_error,
-    ceph::buffer::list& bl);
+    ceph::buffer::list& bl,
+    std::map<uint64_t, std::pair<uint32_t, uint32_t>>* chunk_crcs = nullptr);
+
+  // remember the crc32c of the whole csum chunks of regs, just read
+  // and verified, by logical offset, as (length, crc32c seeded with -1)
+  void _note_chunk_crcs(
+    const bluestore_blob_t& blob,
+    const std::list<region_t>& regs,
+    std::map<uint64_t, std::pair<uint32_t, uint32_t>>* chunk_crcs) const;
+  // crc32c bl, read from offset, reusing chunk_crcs where they apply
+  static uint32_t _crc32c_with_chunks(
+    uint32_t crc,
+    uint64_t offset,
+    const ceph::buffer::list& bl,
+    const std::map<uint64_t, std::pair<uint32_t, uint32_t>>& chunk_crcs);
 
   int _do_read(
     Collection *c,
@@ -3090,7 +3183,8 @@ private:
     size_t len,
     ceph::buffer::list& bl,
     uint32_t op_flags = 0,
-    uint64_t retry_count = 0);
+    uint64_t retry_count = 0,
+    uint32_t *crc = nullptr);
 
   int _do_readv(
     Collection *c,
@@ -3118,6 +3212,9 @@ public:
   int dump_onode(CollectionHandle &c, const ghobject_t& oid,
     const std::string& section_name, ceph::Formatter *f) override;
 
+  int recompress(CollectionHandle &c, const ghobject_t& oid,
+		 uint64_t *bytes_read) override;
+
   int getattr(CollectionHandle &c, const ghobject_t& oid, const char *name,
 	      ceph::buffer::ptr& value) override;
 
@@ -3190,6 +3287,15 @@ public:
     std::map<std::string, ceph::buffer::list> *out ///< [out] Returned keys and values
     ) override;
 
+  int omap_get_values_range(
+    CollectionHandle &c,             ///< [in] Collection containing oid
+    const ghobject_t &oid,           ///< [in] Object containing omap
+    const std::string &from,         ///< [in] First key to list
+    bool inclusive,                  ///< [in] Include from itself
+    size_t readahead,                ///< [in] Bytes likely to be read
+    const std::function<bool(std::string_view, std::string_view)>& f
+    ) override;
+
 #ifdef WITH_SEASTAR
   int omap_get_values(
     CollectionHandle &c,         ///< [in] Collection containing oid
@@ -3396,6 +3502,10 @@ private:
     old_extent_map_t old_extents;   ///< must deref these blobs
     interval_set<uint64_t> extents_to_gc; ///< extents for garbage collection
 
+    CompressorRef compressor;       ///< instead of the pool's, if set
+    int compress_level = 0;         ///< for compressor, 0 for its default
+    double required_ratio = 0;      ///< for compressor
+
     struct write_item {
       uint64_t logical_offset;      ///< write logical offset
       BlobRef b;
@@ -3441,6 +3551,9 @@ private:
       compress = other.compress;
       target_blob_size = other.target_blob_size;
       csum_order = other.csum_order;
+      compressor = other.compressor;
+      compress_level = other.compress_level;
+      required_ratio = other.required_ratio;
     }
     void write(
       uint64_t loffs,
@@ -0,0 +1,228 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "ShardedAllocator.h"
+
+#include <algorithm>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+#include "HybridAllocator.h"
+#include "common/config_proxy.h"
+#include "common/debug.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef  dout_prefix
+#define dout_prefix *_dout << "ShardedAllocator "
+
+ShardedAllocator::ShardedAllocator(CephContext* cct,
+				   std::string_view type,
+				   int64_t device_size,
+				   int64_t block_size,
+				   unsigned n,
+				   std::string_view name)
+  : Allocator(name, device_size, block_size),
+    cct(cct),
+    num_cpus(std::max(1u, std::thread::hardware_concurrency()))
+{
+  n = std::clamp<uint64_t>(device_size / MIN_REGION_SIZE, 1, std::max(n, 1u));
+  // a power of two no alloc unit exceeds, so that offsets aligned within
+  // a region are aligned on the device too
+  region_size = p2roundup<uint64_t>(device_size / n, MIN_REGION_SIZE);
+  num_shards = std::max<uint64_t>(1, (device_size + region_size - 1) / region_size);
+  shards.reset(new shard_t[num_shards]);
+
+  uint64_t mem_cap =
+    cct->_conf.get_val<uint64_t>("bluestore_hybrid_alloc_mem_cap") / num_shards;
+  for (unsigned i = 0; i < num_shards; ++i) {
+    auto& s = shards[i];
+    s.start = i * region_size;
+    s.length = std::min<uint64_t>(region_size, device_size - s.start);
+    std::string shard_name;
+    if (!name.empty()) {
+      shard_name = std::string(name) + "." + std::to_string(i);
+    }
+    if (type == "hybrid") {
+      // share the memory cap out rather than allow it per shard
+      s.alloc.reset(new HybridAllocator(cct, s.length, block_size, mem_cap,
+					shard_name));
+    } else {
+      s.alloc.reset(Allocator::create(cct, type, s.length, block_size, 0, 0,
+				      shard_name));
+    }
+    ceph_assert(s.alloc);
+  }
+  ldout(cct, 10) << __func__ << " " << num_shards << " x " << type
+		 << " regions of 0x" << std::hex << region_size << std::dec
+		 << dendl;
+}
+
+unsigned ShardedAllocator::home_shard() const
+{
+  int cpu = sched_getcpu();
+  if (cpu < 0) {
+    return std::hash<std::thread::id>{}(std::this_thread::get_id()) %
+      num_shards;
+  }
+  // contiguous runs of cpus, so that a NUMA node's end up together
+  return (uint64_t)cpu * num_shards / num_cpus % num_shards;
+}
+
+int64_t ShardedAllocator::allocate(
+  uint64_t want,
+  uint64_t unit,
+  uint64_t max_alloc_size,
+  int64_t  hint,
+  PExtentVector *extents)
+{
+  ldout(cct, 10) << __func__ << std::hex
+		 << " want 0x" << want
+		 << " unit 0x" << unit
+		 << " max_alloc_size 0x" << max_alloc_size
+		 << " hint 0x" << hint
+		 << std::dec << dendl;
+  unsigned home = home_shard();
+  uint64_t got = 0;
+  // our own region first, then steal what is missing from the others
+  for (unsigned i = 0; i < num_shards && got < want; ++i) {
+    auto& s = shards[(home + i) % num_shards];
+    if (s.free.load(std::memory_order_relaxed) < unit) {
+      continue;
+    }
+    int64_t h = 0;
+    if (hint > 0 && (uint64_t)hint >= s.start &&
+	(uint64_t)hint < s.start + s.length) {
+      h = hint - s.start;
+    }
+    size_t first = extents->size();
+    int64_t r = s.alloc->allocate(want - got, unit, max_alloc_size, h,
+				  extents);
+    if (r <= 0) {
+      continue;
+    }
+    for (size_t j = first; j < extents->size(); ++j) {
+      (*extents)[j].offset += s.start;
+    }
+    s.free -= r;
+    got += r;
+    if (i > 0) {
+      ldout(cct, 20) << __func__ << " stole 0x" << std::hex << r << std::dec
+		     << " from shard " << (home + i) % num_shards
+		     << " for shard " << home << dendl;
+    }
+  }
+  return got ? (int64_t)got : -ENOSPC;
+}
+
+void ShardedAllocator::release(const interval_set<uint64_t>& release_set)
+{
+  // an extent never spans regions but adjacent ones may have been merged
+  // in release_set, so split them up again
+  std::vector<interval_set<uint64_t>> per_shard(num_shards);
+  for (auto p = release_set.begin(); p != release_set.end(); ++p) {
+    split(p.get_start(), p.get_len(),
+      [&](shard_t& s, uint64_t offset, uint64_t length) {
+	per_shard[&s - shards.get()].insert(offset, length);
+      });
+  }
+  for (unsigned i = 0; i < num_shards; ++i) {
+    if (!per_shard[i].empty()) {
+      shards[i].free += per_shard[i].size();
+      shards[i].alloc->release(per_shard[i]);
+    }
+  }
+}
+
+uint64_t ShardedAllocator::get_free()
+{
+  uint64_t free = 0;
+  for (unsigned i = 0; i < num_shards; ++i) {
+    free += shards[i].free.load(std::memory_order_relaxed);
+  }
+  return free;
+}
+
+double ShardedAllocator::get_fragmentation()
+{
+  double frag = 0;
+  uint64_t total = 0;
+  for (unsigned i = 0; i < num_shards; ++i) {
+    auto& s = shards[i];
+    uint64_t free = s.free.load(std::memory_order_relaxed);
+    if (free) {
+      frag += s.alloc->get_fragmentation() * free;
+      total += free;
+    }
+  }
+  return total ? frag / total : 0.0;
+}
+
+void ShardedAllocator::dump()
+{
+  for (unsigned i = 0; i < num_shards; ++i) {
+    auto& s = shards[i];
+    ldout(cct, 0) << __func__ << " shard " << i << " at 0x" << std::hex
+		  << s.start << "~" << s.length << std::dec
+		  << " free " << s.free.load() << dendl;
+    s.alloc->dump();
+  }
+}
+
+void ShardedAllocator::foreach(
+  std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  // join up what is free on both sides of a region boundary, so that
+  // the fragmentation score doesn't depend on the number of shards
+  uint64_t pending_offset = 0, pending_length = 0;
+  for (unsigned i = 0; i < num_shards; ++i) {
+    auto& s = shards[i];
+    s.alloc->foreach([&](uint64_t offset, uint64_t length) {
+      offset += s.start;
+      if (pending_length && pending_offset + pending_length == offset) {
+	pending_length += length;
+	return;
+      }
+      if (pending_length) {
+	notify(pending_offset, pending_length);
+      }
+      pending_offset = offset;
+      pending_length = length;
+    });
+  }
+  if (pending_length) {
+    notify(pending_offset, pending_length);
+  }
+}
+
+void ShardedAllocator::init_add_free(uint64_t offset, uint64_t length)
+{
+  ldout(cct, 10) << __func__ << std::hex
+		 << " offset 0x" << offset
+		 << " length 0x" << length
+		 << std::dec << dendl;
+  split(offset, length, [](shard_t& s, uint64_t offset, uint64_t length) {
+    s.alloc->init_add_free(offset, length);
+    s.free += length;
+  });
+}
+
+void ShardedAllocator::init_rm_free(uint64_t offset, uint64_t length)
+{
+  ldout(cct, 10) << __func__ << std::hex
+		 << " offset 0x" << offset
+		 << " length 0x" << length
+		 << std::dec << dendl;
+  split(offset, length, [](shard_t& s, uint64_t offset, uint64_t length) {
+    s.alloc->init_rm_free(offset, length);
+    s.free -= length;
+  });
+}
+
+void ShardedAllocator::shutdown()
+{
+  for (unsigned i = 0; i < num_shards; ++i) {
+    shards[i].alloc->shutdown();
+  }
+}
@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "Allocator.h"
+
+/*
+ * Splits the device into a few contiguous regions, each with an
+ * allocator of its own, so that threads allocating at the same time
+ * mostly take different locks.  A thread allocates from the region its
+ * CPU maps to (neighbouring CPUs, and so usually those of a NUMA node,
+ * share one) and steals from the others once that runs short.  Space
+ * is always released to the region it lies in.
+ */
+class ShardedAllocator : public Allocator {
+  struct alignas(64) shard_t {
+    std::unique_ptr<Allocator> alloc;
+    uint64_t start = 0;   ///< device offset the region starts at
+    uint64_t length = 0;
+    std::atomic<uint64_t> free = {0};
+  };
+
+  CephContext* cct;
+  std::unique_ptr<shard_t[]> shards;
+  unsigned num_shards = 0;
+  uint64_t region_size = 0;
+  unsigned num_cpus = 1;
+
+  unsigned shard_of(uint64_t offset) const {
+    return std::min<uint64_t>(offset / region_size, num_shards - 1);
+  }
+  unsigned home_shard() const;
+
+  // call f(shard, offset within it, length) on the pieces of a device
+  // range, one per region it spans
+  template <typename F>
+  void split(uint64_t offset, uint64_t length, F&& f) {
+    while (length) {
+      auto& s = shards[shard_of(offset)];
+      ceph_assert(offset < s.start + s.length);
+      uint64_t l = std::min(length, s.start + s.length - offset);
+      f(s, offset - s.start, l);
+      offset += l;
+      length -= l;
+    }
+  }
+
+public:
+  // regions are never cut smaller than this, and are a multiple of it
+  static constexpr uint64_t MIN_REGION_SIZE = 1ull << 30;
+
+  ShardedAllocator(CephContext* cct, std::string_view type,
+		   int64_t device_size, int64_t block_size,
+		   unsigned shards, std::string_view name);
+
+  const char* get_type() const override
+  {
+    return "sharded";
+  }
+  unsigned get_num_shards() const {
+    return num_shards;
+  }
+  int64_t allocate(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    int64_t  hint,
+    PExtentVector *extents) override;
+  void release(const interval_set<uint64_t>& release_set) override;
+  uint64_t get_free() override;
+  double get_fragmentation() override;
+
+  void dump() override;
+  void foreach(
+    std::function<void(uint64_t offset, uint64_t length)> notify) override;
+  void init_add_free(uint64_t offset, uint64_t length) override;
+  void init_rm_free(uint64_t offset, uint64_t length) override;
+  void shutdown() override;
+};
@@ -12,6 +12,8 @@
  *
  */
 
+#include <cmath>
+
 #include "bluestore_types.h"
 #include "common/Formatter.h"
 #include "common/Checksummer.h"
@@ -1193,6 +1195,85 @@ void bluestore_compression_header_t::generate_test_instances(
   o.back()->length = 1234;
 }
 
+// bluestore_compressibility_t
+
+double bluestore_compressibility_t::estimate_entropy(
+  const bufferlist& bl,
+  size_t sample_bytes)
+{
+  // a few spots rather than the head alone, which for media files is
+  // often an uncompressed header
+  constexpr unsigned SPOTS = 16;
+  unsigned len = bl.length();
+  if (len == 0) {
+    return 0;
+  }
+  unsigned spots = len > sample_bytes ? SPOTS : 1;
+  unsigned per_spot = std::max<unsigned>(
+    std::min<uint64_t>(sample_bytes, len) / spots, 1);
+  unsigned stride = len / spots;
+  std::array<uint32_t, 256> hist = {};
+  uint64_t total = 0;
+  auto p = bl.cbegin();
+  for (unsigned i = 0; i < spots; ++i) {
+    p.seek(i * stride);
+    unsigned left = std::min(per_spot, len - i * stride);
+    while (left) {
+      const char *data;
+      unsigned l = p.get_ptr_and_advance(left, &data);
+      for (unsigned j = 0; j < l; ++j) {
+	++hist[(unsigned char)data[j]];
+      }
+      left -= l;
+      total += l;
+    }
+  }
+  double entropy = 0;
+  for (auto n : hist) {
+    if (n) {
+      double f = (double)n / total;
+      entropy -= f * std::log2(f);
+    }
+  }
+  return entropy;
+}
+
+bool bluestore_compressibility_t::should_skip(
+  double entropy,
+  double required_ratio)
+{
+  auto& b = bands[band_of(entropy)];
+  if (b.samples < MIN_SAMPLES || b.ratio <= required_ratio) {
+    return false;
+  }
+  return ++b.skipped % EXPLORE_EVERY != 0;
+}
+
+void bluestore_compressibility_t::learn(
+  double entropy,
+  uint64_t len,
+  uint64_t compressed_len,
+  ceph::timespan elapsed)
+{
+  if (len == 0) {
+    return;
+  }
+  constexpr double alpha = 1.0 / MIN_SAMPLES;
+  auto& b = bands[band_of(entropy)];
+  double ratio = std::min((double)compressed_len / len, 1.0);
+  b.ratio = b.samples ? b.ratio + alpha * (ratio - b.ratio) : ratio;
+  if (b.samples < MIN_SAMPLES) {
+    ++b.samples;
+  }
+  double ns = (double)elapsed.count() / len;
+  ns_per_byte = ns_per_byte ? ns_per_byte + alpha * (ns - ns_per_byte) : ns;
+}
+
+ceph::timespan bluestore_compressibility_t::estimate_cost(uint64_t len) const
+{
+  return ceph::timespan((uint64_t)(ns_per_byte * len));
+}
+
 // adds more salt to build a hash func input
 shared_blob_2hash_tracker_t::hash_input_t
   shared_blob_2hash_tracker_t::build_hash_input(
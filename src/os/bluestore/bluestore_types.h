@@ -24,6 +24,7 @@
 #include "include/types.h"
 #include "include/interval_set.h"
 #include "include/utime.h"
+#include "common/ceph_time.h"
 #include "common/hobject.h"
 #include "compressor/Compressor.h"
 #include "common/Checksummer.h"
@@ -970,6 +971,7 @@ struct bluestore_onode_t {
     FLAG_PGMETA_OMAP = 2,  ///< omap data is in meta omap prefix
     FLAG_PERPOOL_OMAP = 4, ///< omap data is in per-pool prefix; per-pool keys
     FLAG_PERPG_OMAP = 8,   ///< omap data is in per-pg prefix; per-pg keys
+    FLAG_RECOMPRESSED = 16, ///< data not written since BlueStore::recompress
   };
 
   std::string get_flags_string() const {
@@ -986,6 +988,9 @@ struct bluestore_onode_t {
     if (flags & FLAG_PERPG_OMAP) {
       s += "+per_pg_omap";
     }
+    if (flags & FLAG_RECOMPRESSED) {
+      s += "+recompressed";
+    }
     return s;
   }
 
@@ -1031,6 +1036,12 @@ struct bluestore_onode_t {
     set_flag(FLAG_OMAP | FLAG_PGMETA_OMAP);
   }
 
+  uint8_t get_omap_flags() const {
+    return flags & (FLAG_OMAP |
+		    FLAG_PGMETA_OMAP |
+		    FLAG_PERPOOL_OMAP |
+		    FLAG_PERPG_OMAP);
+  }
   void clear_omap_flag() {
     clear_flag(FLAG_OMAP |
 	       FLAG_PGMETA_OMAP |
@@ -1127,6 +1138,47 @@ struct bluestore_compression_header_t {
 };
 WRITE_CLASS_DENC(bluestore_compression_header_t)
 
+/// Learns how well data written to a collection compresses, by the
+/// entropy of a sample of it, so that data that is not going to meet
+/// the required ratio can skip the compressor.
+class bluestore_compressibility_t {
+public:
+  static constexpr unsigned NUM_BANDS = 16;     ///< 0.5 bits/byte each
+  static constexpr unsigned MIN_SAMPLES = 8;    ///< before trusting a band
+  static constexpr unsigned EXPLORE_EVERY = 16; ///< compress 1 in N skips
+
+  /// Shannon entropy, in bits per byte, of up to sample_bytes of bl
+  /// picked from evenly spaced spots
+  static double estimate_entropy(const ceph::buffer::list& bl,
+				 size_t sample_bytes);
+
+  /// whether data of this entropy should skip compression; now and
+  /// then returns false anyway to learn if that still holds
+  bool should_skip(double entropy, double required_ratio);
+  /// record the outcome of compressing len bytes of data
+  void learn(double entropy, uint64_t len, uint64_t compressed_len,
+	     ceph::timespan elapsed);
+  /// estimated time compressing len bytes would take
+  ceph::timespan estimate_cost(uint64_t len) const;
+
+  double get_ratio(double entropy) const {
+    return bands[band_of(entropy)].ratio;
+  }
+
+private:
+  struct band_t {
+    double ratio = 1.0;    ///< average compressed/original
+    uint32_t samples = 0;
+    uint32_t skipped = 0;
+  };
+  std::array<band_t, NUM_BANDS> bands;
+  double ns_per_byte = 0;
+
+  static unsigned band_of(double entropy) {
+    return std::min<unsigned>(entropy * NUM_BANDS / 8, NUM_BANDS - 1);
+  }
+};
+
 template <template <typename> typename V, class COUNTER_TYPE = int32_t>
 class ref_counter_2hash_tracker_t {
   size_t num_non_zero = 0;
@@ -176,6 +176,7 @@ ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
       << " plan.will_write=" << rhs.plan.will_write
+      << " parity_delta=" << rhs.parity_delta
       << ")";
   return lhs;
 }
@@ -209,6 +210,17 @@ void ECBackend::RecoveryOp::dump(Formatter *f) const
   f->dump_stream("extent_requested") << extent_requested;
 }
 
+static void log_ec_stats(
+  PerfCounters *logger,
+  int lat, int lat_hist,
+  utime_t start, uint64_t bytes)
+{
+  utime_t latency = ceph_clock_now();
+  latency -= start;
+  logger->tinc(lat, latency);
+  logger->hinc(lat_hist, latency.to_nsec(), bytes);
+}
+
 ECBackend::ECBackend(
   PGBackend::Listener *pg,
   const coll_t &coll,
@@ -461,8 +473,17 @@ void ECBackend::handle_recovery_read_complete(
   }
   dout(10) << __func__ << ": " << from << dendl;
   int r;
-  r = ECUtil::decode(sinfo, ec_impl, from, target);
+  utime_t decode_start = ceph_clock_now();
+  r = ECUtil::decode(sinfo, ec_impl, from, target,
+		     get_parent()->get_ec_stripe_batch_pool());
   ceph_assert(r == 0);
+  uint64_t decoded = 0;
+  for (auto &&i : target) {
+    decoded += i.second->length();
+  }
+  log_ec_stats(get_parent()->get_logger(),
+	       l_osd_ec_decode_lat, l_osd_ec_decode_lat_outb_hist,
+	       decode_start, decoded);
   if (attrs) {
     op.xattrs.swap(*attrs);
 
@@ -1486,6 +1507,7 @@ void ECBackend::on_change()
   waiting_reads.clear();
   waiting_state.clear();
   waiting_commit.clear();
+  parity_delta_objects.clear();
   for (auto &&op: tid_to_op_map) {
     cache.release_write_pin(op.second.pin);
   }
@@ -1921,12 +1943,167 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
   check_ops();
 }
 
+struct ECBackend::ParityDeltaRead :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ceph_tid_t tid;
+  hobject_t hoid;
+  set<int> shards;
+  ParityDeltaRead(
+    ECBackend *ec,
+    ceph_tid_t tid,
+    const hobject_t &hoid,
+    const set<int> &shards)
+    : ec(ec), tid(tid), hoid(hoid), shards(shards) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ec->handle_parity_delta_read(tid, hoid, shards, in.second);
+  }
+};
+
+/*
+ * An overwrite confined to a single stripe (plan.parity_delta) only
+ * needs the data chunks it modifies and the coding chunks, as long as
+ * no write which has not committed yet is going to change them and the
+ * cache holds no copy of the stripe that this write would make stale.
+ * The caller has already checked that the cache is valid.
+ * Later reads of the object wait until this write is sent, see
+ * parity_delta_objects.
+ */
+bool ECBackend::try_parity_delta(Op *op)
+{
+  if (!cct->_conf->osd_ec_parity_delta_writes ||
+      !ec_impl->supports_parity_delta() ||
+      op->plan.to_read.size() != 1 ||
+      op->plan.parity_delta.size() != 1) {
+    return false;
+  }
+  const hobject_t &hoid = op->plan.parity_delta.begin()->first;
+  if (!op->plan.to_read.count(hoid) ||
+      op->invalidates_cache() ||
+      cache.contains_object(hoid)) {
+    return false;
+  }
+  for (auto &&i: waiting_reads) {
+    if (i.plan.will_write.count(hoid)) {
+      return false;
+    }
+  }
+  for (auto &&i: waiting_commit) {
+    if (i.plan.will_write.count(hoid)) {
+      return false;
+    }
+  }
+
+  set<int> shards = ECTransaction::get_parity_delta_shards(
+    sinfo, ec_impl, op->plan.parity_delta.begin()->second);
+  if (shards.size() >= ec_impl->get_chunk_count()) {
+    // all data chunks are modified, reading them is no better
+    return false;
+  }
+
+  set<int> have;
+  map<shard_id_t, pg_shard_t> avail;
+  get_all_avail_shards(hoid, set<pg_shard_t>(), have, avail, false);
+  map<pg_shard_t, vector<pair<int, int>>> need;
+  vector<pair<int, int>> subchunks;
+  subchunks.push_back(make_pair(0, ec_impl->get_sub_chunk_count()));
+  for (int shard : shards) {
+    auto iter = avail.find(shard_id_t(shard));
+    if (iter == avail.end()) {
+      return false;
+    }
+    need[iter->second] = subchunks;
+  }
+
+  waiting_state.pop_front();
+  waiting_reads.push_back(*op);
+  op->using_cache = false;
+  op->parity_delta = true;
+  parity_delta_objects.insert(hoid);
+  dout(10) << __func__ << ": reading shards " << shards
+	   << " for " << *op << dendl;
+
+  const extent_set &stripe = op->plan.to_read.begin()->second;
+  list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+  to_read.push_back(boost::make_tuple(stripe.range_start(), stripe.size(), 0));
+  map<hobject_t, read_request_t> for_read_op;
+  for_read_op.insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	to_read,
+	need,
+	false,
+	new ParityDeltaRead(this, op->tid, hoid, shards))));
+  map<hobject_t, set<int>> want_to_read;
+  want_to_read[hoid] = shards;
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    want_to_read,
+    for_read_op,
+    OpRequestRef(),
+    false, false);
+  return true;
+}
+
+void ECBackend::handle_parity_delta_read(
+  ceph_tid_t tid,
+  const hobject_t &hoid,
+  const set<int> &shards,
+  read_result_t &res)
+{
+  auto iter = tid_to_op_map.find(tid);
+  ceph_assert(iter != tid_to_op_map.end());
+  Op *op = &(iter->second);
+  ceph_assert(op->parity_delta);
+  ceph_assert(!op->parity_delta_read_done);
+  op->parity_delta_read_done = true;
+
+  map<int, bufferlist> chunks;
+  if (res.r == 0 && res.returned.size() == 1) {
+    for (auto &&[shard, bl] : res.returned.front().get<2>()) {
+      if (shards.count(shard.shard) &&
+	  bl.length() == sinfo.get_chunk_size()) {
+	chunks[shard.shard] = std::move(bl);
+      }
+    }
+  }
+  if (chunks.size() == shards.size()) {
+    get_parent()->get_logger()->inc(l_osd_ec_parity_delta);
+    op->parity_delta_chunks[hoid] = std::move(chunks);
+  } else {
+    dout(10) << __func__ << ": " << hoid << " r=" << res.r
+	     << " errors=" << res.errors
+	     << ", reading the whole stripe instead" << dendl;
+    get_parent()->get_logger()->inc(l_osd_ec_parity_delta_fallback);
+    op->remote_read = op->plan.to_read;
+    objects_read_async_no_cache(
+      op->remote_read,
+      [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+	for (auto &&i: results) {
+	  op->remote_read_result.emplace(i.first, i.second.second);
+	}
+	check_ops();
+      });
+  }
+  check_ops();
+}
+
 bool ECBackend::try_state_to_reads()
 {
   if (waiting_state.empty())
     return false;
 
   Op *op = &(waiting_state.front());
+  for (auto &&hpair: op->plan.to_read) {
+    if (parity_delta_objects.count(hpair.first)) {
+      dout(20) << __func__ << ": blocking " << *op
+	       << " because a parity delta write to " << hpair.first
+	       << " has not been sent yet" << dendl;
+      return false;
+    }
+  }
+
   if (op->requires_rmw() && pipeline_state.cache_invalid()) {
     ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
     dout(20) << __func__ << ": blocking " << *op
@@ -1936,6 +2113,9 @@ bool ECBackend::try_state_to_reads()
     return false;
   }
 
+  if (op->requires_rmw() && try_parity_delta(op))
+    return true;
+
   if (!pipeline_state.caching_enabled()) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
@@ -2037,19 +2217,31 @@ bool ECBackend::try_reads_to_commit()
 
   map<hobject_t,extent_map> written;
   if (op->plan.t) {
+    utime_t encode_start = ceph_clock_now();
     ECTransaction::generate_transactions(
       op->plan,
       ec_impl,
       get_parent()->get_info().pgid.pgid,
       sinfo,
       op->remote_read_result,
+      op->parity_delta_chunks,
       op->log_entries,
       &written,
       &trans,
       &(op->temp_added),
       &(op->temp_cleared),
       get_parent()->get_dpp(),
-      get_osdmap()->require_osd_release);
+      get_osdmap()->require_osd_release,
+      get_parent()->get_ec_stripe_batch_pool());
+    uint64_t encoded = 0;
+    for (auto &&[hoid, extents] : written) {
+      for (auto &&extent : extents) {
+	encoded += extent.get_len();
+      }
+    }
+    log_ec_stats(get_parent()->get_logger(),
+		 l_osd_ec_encode_lat, l_osd_ec_encode_lat_inb_hist,
+		 encode_start, encoded);
   }
 
   dout(20) << __func__ << ": " << cache << dendl;
@@ -2071,7 +2263,9 @@ bool ECBackend::try_reads_to_commit()
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  ceph_assert(written_set == op->plan.will_write);
+  // a parity delta only writes the modified part of the stripe
+  ceph_assert(!op->parity_delta_chunks.empty() ||
+	      written_set == op->plan.will_write);
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
@@ -2081,6 +2275,12 @@ bool ECBackend::try_reads_to_commit()
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  if (op->parity_delta) {
+    for (auto &&hpair: op->plan.parity_delta) {
+      parity_delta_objects.erase(hpair.first);
+    }
+    op->parity_delta_chunks.clear();
+  }
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -2377,15 +2577,20 @@ struct CallClientContexts :
 	   ++j) {
 	to_decode[j->first.shard] = std::move(j->second);
       }
+      utime_t decode_start = ceph_clock_now();
       int r = ECUtil::decode(
 	ec->sinfo,
 	ec->ec_impl,
 	to_decode,
-	&bl);
+	&bl,
+	ec->get_parent()->get_ec_stripe_batch_pool());
       if (r < 0) {
         res.r = r;
         goto out;
       }
+      log_ec_stats(ec->get_parent()->get_logger(),
+		   l_osd_ec_decode_lat, l_osd_ec_decode_lat_outb_hist,
+		   decode_start, bl.length());
       bufferlist trimmed;
       trimmed.substr_of(
 	bl,
@@ -2558,31 +2763,37 @@ int ECBackend::be_deep_scrub(
   if (stride % sinfo.get_chunk_size())
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
-  bufferlist bl;
-  r = store->read(
-    ch,
-    ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-    pos.data_pos,
-    stride, bl,
-    fadvise_flags);
-  if (r < 0) {
-    dout(20) << __func__ << "  " << poid << " got "
-	     << r << " on read, read_error" << dendl;
-    o.read_error = true;
-    return 0;
-  }
-  if (bl.length() % sinfo.get_chunk_size()) {
-    dout(20) << __func__ << "  " << poid << " got "
-	     << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
-	     << dendl;
-    o.read_error = true;
-    return 0;
-  }
-  if (r > 0) {
-    pos.data_hash << bl;
-  }
-  pos.data_pos += r;
+  // keep reading while the slice allows, rather than requeueing after
+  // every stride
+  do {
+    bufferlist bl;
+    uint32_t crc = pos.data_hash.digest();
+    r = store->read_crc32c(
+      ch,
+      ghobject_t(
+	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      pos.data_pos,
+      stride, bl, &crc,
+      fadvise_flags);
+    if (r < 0) {
+      dout(20) << __func__ << "  " << poid << " got "
+	       << r << " on read, read_error" << dendl;
+      o.read_error = true;
+      return 0;
+    }
+    if (bl.length() % sinfo.get_chunk_size()) {
+      dout(20) << __func__ << "  " << poid << " got "
+	       << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
+	       << dendl;
+      o.read_error = true;
+      return 0;
+    }
+    if (r > 0) {
+      pos.data_hash = bufferhash(crc);
+    }
+    pos.data_pos += r;
+    pos.slice_bytes += r;
+  } while (r == (int)stride && pos.slice_has_room());
   if (r == (int)stride) {
     return -EINPROGRESS;
   }
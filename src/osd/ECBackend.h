@@ -474,14 +474,24 @@ public:
     bool requires_rmw() const { return !plan.to_read.empty(); }
     bool invalidates_cache() const { return plan.invalidates_cache; }
 
-    // must be true if requires_rmw(), must be false if invalidates_cache()
+    // must be true if requires_rmw() unless parity_delta, must be false
+    // if invalidates_cache()
     bool using_cache = true;
 
     /// In progress read state;
     std::map<hobject_t,extent_set> pending_read; // subset already being read
     std::map<hobject_t,extent_set> remote_read;  // subset we must read
     std::map<hobject_t,extent_map> remote_read_result;
+
+    /// plan.parity_delta is being applied, see try_parity_delta
+    bool parity_delta = false;
+    bool parity_delta_read_done = false;
+    /// shard reads for plan.parity_delta, empty if they failed
+    std::map<hobject_t,std::map<int, ceph::buffer::list>> parity_delta_chunks;
+
     bool read_in_progress() const {
+      if (parity_delta && !parity_delta_read_done)
+	return true;
       return !remote_read.empty() && remote_read_result.empty();
     }
 
@@ -560,7 +570,16 @@ public:
   op_list waiting_commit;       /// writes waiting on initial commit
   eversion_t completed_to;
   eversion_t committed_to;
+  /// objects read by a parity delta write which has not been sent yet
+  std::set<hobject_t> parity_delta_objects;
   void start_rmw(Op *op, PGTransactionUPtr &&t);
+  struct ParityDeltaRead;
+  bool try_parity_delta(Op *op);
+  void handle_parity_delta_read(
+    ceph_tid_t tid,
+    const hobject_t &hoid,
+    const std::set<int> &shards,
+    read_result_t &res);
   bool try_state_to_reads();
   bool try_reads_to_commit();
   bool try_finish_rmw();
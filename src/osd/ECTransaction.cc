@@ -20,6 +20,7 @@
 #include "ECUtil.h"
 #include "os/ObjectStore.h"
 #include "common/inline_variant.h"
+#include "erasure-code/ErasureCode.h"
 
 using std::less;
 using std::make_pair;
@@ -30,8 +31,10 @@ using std::string;
 using std::vector;
 
 using ceph::bufferlist;
+using ceph::bufferptr;
 using ceph::decode;
 using ceph::encode;
+using ceph::ErasureCode;
 using ceph::ErasureCodeInterfaceRef;
 
 void encode_and_write(
@@ -46,7 +49,8 @@ void encode_and_write(
   ECUtil::HashInfoRef hinfo,
   extent_map &written,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
-  DoutPrefixProvider *dpp) {
+  DoutPrefixProvider *dpp,
+  ECUtil::StripeBatchPool *pool) {
   const uint64_t before_size = hinfo->get_total_logical_size(sinfo);
   ceph_assert(sinfo.logical_offset_is_stripe_aligned(offset));
   ceph_assert(sinfo.logical_offset_is_stripe_aligned(bl.length()));
@@ -54,7 +58,7 @@ void encode_and_write(
 
   map<int, bufferlist> buffers;
   int r = ECUtil::encode(
-    sinfo, ecimpl, bl, want, &buffers);
+    sinfo, ecimpl, bl, want, &buffers, pool);
   ceph_assert(r == 0);
 
   written.insert(offset, bl.length(), bl);
@@ -93,19 +97,143 @@ void encode_and_write(
   }
 }
 
+set<int> ECTransaction::get_parity_delta_shards(
+  const ECUtil::stripe_info_t &sinfo,
+  const ErasureCodeInterfaceRef &ecimpl,
+  const extent_set &to_write)
+{
+  ceph_assert(!to_write.empty());
+  const vector<int> &mapping = ecimpl->get_chunk_mapping();
+  auto shard = [&mapping](unsigned i) {
+    return mapping.size() > i ? mapping[i] : (int)i;
+  };
+  const uint64_t stripe_off =
+    sinfo.logical_to_prev_stripe_offset(to_write.range_start());
+  set<int> shards;
+  for (auto &&extent : to_write) {
+    uint64_t first = (extent.first - stripe_off) / sinfo.get_chunk_size();
+    uint64_t last = (extent.first + extent.second - 1 - stripe_off) /
+      sinfo.get_chunk_size();
+    ceph_assert(last < ecimpl->get_data_chunk_count());
+    for (uint64_t i = first; i <= last; i++) {
+      shards.insert(shard(i));
+    }
+  }
+  for (unsigned i = ecimpl->get_data_chunk_count();
+       i < ecimpl->get_chunk_count();
+       i++) {
+    shards.insert(shard(i));
+  }
+  return shards;
+}
+
+/*
+ * Apply writes confined to the stripe at stripe_off using the current
+ * content of the modified data chunks and of the coding chunks:
+ * only those shards are written, the coding chunks being updated with
+ * the delta of the data chunks.
+ */
+void encode_delta_and_write(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  uint64_t stripe_off,
+  const extent_map &to_overwrite,
+  const map<int, bufferlist> &old_chunks,
+  uint32_t flags,
+  extent_map &written,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const vector<int> &mapping = ecimpl->get_chunk_mapping();
+  auto shard = [&mapping](unsigned i) {
+    return mapping.size() > i ? mapping[i] : (int)i;
+  };
+  auto get_chunk = [&](int s) {
+    auto iter = old_chunks.find(s);
+    ceph_assert(iter != old_chunks.end());
+    ceph_assert(iter->second.length() == chunk_size);
+    bufferptr ptr(ceph::buffer::create_aligned(chunk_size,
+					       ErasureCode::SIMD_ALIGN));
+    iter->second.begin().copy(chunk_size, ptr.c_str());
+    return ptr;
+  };
+
+  map<int, bufferptr> data;
+  for (auto &&extent : to_overwrite) {
+    ceph_assert(extent.get_off() >= stripe_off);
+    ceph_assert(extent.get_off() + extent.get_len() <=
+		stripe_off + sinfo.get_stripe_width());
+    uint64_t off = extent.get_off() - stripe_off;
+    auto bp = extent.get_val().begin();
+    for (uint64_t pos = 0; pos < extent.get_len(); ) {
+      uint64_t in_chunk = (off + pos) % chunk_size;
+      uint64_t len = std::min(chunk_size - in_chunk, extent.get_len() - pos);
+      int s = shard((off + pos) / chunk_size);
+      auto iter = data.find(s);
+      if (iter == data.end()) {
+	iter = data.emplace(s, get_chunk(s)).first;
+      }
+      bp.copy(len, iter->second.c_str() + in_chunk);
+      pos += len;
+    }
+    written.insert(extent.get_off(), extent.get_len(), extent.get_val());
+  }
+
+  map<int, bufferptr> deltas;
+  for (auto &&[s, ptr] : data) {
+    bufferptr delta(ceph::buffer::create_aligned(chunk_size,
+						 ErasureCode::SIMD_ALIGN));
+    ecimpl->encode_delta(get_chunk(s), ptr, &delta);
+    deltas.emplace(s, std::move(delta));
+  }
+  map<int, bufferptr> coding;
+  for (unsigned i = ecimpl->get_data_chunk_count();
+       i < ecimpl->get_chunk_count();
+       i++) {
+    coding.emplace(shard(i), get_chunk(shard(i)));
+  }
+  ecimpl->apply_delta(deltas, coding);
+  data.merge(coding);
+
+  const uint64_t chunk_off =
+    sinfo.aligned_logical_offset_to_chunk_offset(stripe_off);
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " writing shards " << data.size()
+		     << " at " << chunk_off << "~" << chunk_size
+		     << dendl;
+  for (auto &&[s, ptr] : data) {
+    auto iter = transactions->find(shard_id_t(s));
+    if (iter == transactions->end())
+      continue;
+    bufferlist bl;
+    bl.append(ptr);
+    iter->second.write(
+      coll_t(spg_t(pgid, iter->first)),
+      ghobject_t(oid, ghobject_t::NO_GEN, iter->first),
+      chunk_off,
+      bl.length(),
+      bl,
+      flags);
+  }
+}
+
 void ECTransaction::generate_transactions(
   WritePlan &plan,
   ErasureCodeInterfaceRef &ecimpl,
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,map<int, bufferlist>> &parity_delta_chunks,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
   set<hobject_t> *temp_added,
   set<hobject_t> *temp_removed,
   DoutPrefixProvider *dpp,
-  const ceph_release_t require_osd_release)
+  const ceph_release_t require_osd_release,
+  ECUtil::StripeBatchPool *pool)
 {
   ceph_assert(written_map);
   ceph_assert(transactions);
@@ -546,49 +674,76 @@ void ECTransaction::generate_transactions(
       ldpp_dout(dpp, 20) << "generate_transactions: to_overwrite: "
 			 << to_overwrite
 			 << dendl;
-      for (auto &&extent: to_overwrite) {
-	ceph_assert(extent.get_off() + extent.get_len() <= append_after);
-	ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_off()));
-	ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_len()));
-	if (entry) {
-	  uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
-	    extent.get_off());
-	  uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
-	    extent.get_len());
-	  ldpp_dout(dpp, 20) << "generate_transactions: overwriting "
-			     << restore_from << "~" << restore_len
-			     << dendl;
-	  if (rollback_extents.empty()) {
-	    for (auto &&st : *transactions) {
-	      st.second.touch(
-		coll_t(spg_t(pgid, st.first)),
-		ghobject_t(oid, entry->version.version, st.first));
-	    }
-	  }
-	  rollback_extents.emplace_back(make_pair(restore_from, restore_len));
+      auto save_rollback_extent = [&](uint64_t off, uint64_t len) {
+	if (!entry)
+	  return;
+	uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
+	  off);
+	uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
+	  len);
+	ldpp_dout(dpp, 20) << "generate_transactions: overwriting "
+			   << restore_from << "~" << restore_len
+			   << dendl;
+	if (rollback_extents.empty()) {
 	  for (auto &&st : *transactions) {
-	    st.second.clone_range(
+	    st.second.touch(
 	      coll_t(spg_t(pgid, st.first)),
-	      ghobject_t(oid, ghobject_t::NO_GEN, st.first),
-	      ghobject_t(oid, entry->version.version, st.first),
-	      restore_from,
-	      restore_len,
-	      restore_from);
+	      ghobject_t(oid, entry->version.version, st.first));
 	  }
 	}
-	encode_and_write(
+	rollback_extents.emplace_back(make_pair(restore_from, restore_len));
+	for (auto &&st : *transactions) {
+	  st.second.clone_range(
+	    coll_t(spg_t(pgid, st.first)),
+	    ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	    ghobject_t(oid, entry->version.version, st.first),
+	    restore_from,
+	    restore_len,
+	    restore_from);
+	}
+      };
+      auto dciter = parity_delta_chunks.find(oid);
+      if (dciter != parity_delta_chunks.end()) {
+	ceph_assert(!to_overwrite.empty());
+	uint64_t stripe_off = sinfo.logical_to_prev_stripe_offset(
+	  to_overwrite.begin().get_off());
+	ldpp_dout(dpp, 20) << "generate_transactions: parity delta at "
+			   << stripe_off
+			   << dendl;
+	save_rollback_extent(stripe_off, sinfo.get_stripe_width());
+	encode_delta_and_write(
 	  pgid,
 	  oid,
 	  sinfo,
 	  ecimpl,
-	  want,
-	  extent.get_off(),
-	  extent.get_val(),
+	  stripe_off,
+	  to_overwrite,
+	  dciter->second,
 	  fadvise_flags,
-	  hinfo,
 	  written,
 	  transactions,
 	  dpp);
+      } else {
+	for (auto &&extent: to_overwrite) {
+	  ceph_assert(extent.get_off() + extent.get_len() <= append_after);
+	  ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_off()));
+	  ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_len()));
+	  save_rollback_extent(extent.get_off(), extent.get_len());
+	  encode_and_write(
+	    pgid,
+	    oid,
+	    sinfo,
+	    ecimpl,
+	    want,
+	    extent.get_off(),
+	    extent.get_val(),
+	    fadvise_flags,
+	    hinfo,
+	    written,
+	    transactions,
+	    dpp,
+	    pool);
+	}
       }
 
       auto to_append = to_write.intersect(
@@ -615,7 +770,8 @@ void ECTransaction::generate_transactions(
 	  hinfo,
 	  written,
 	  transactions,
-	  dpp);
+	  dpp,
+	  pool);
       }
 
       ldpp_dout(dpp, 20) << "generate_transactions: " << oid
@@ -29,9 +29,19 @@ namespace ECTransaction {
     std::map<hobject_t,extent_set> to_read;
     std::map<hobject_t,extent_set> will_write; // superset of to_read
 
+    /// writes confined to the single stripe in to_read, which may be
+    /// applied as a parity delta instead of reading the whole stripe
+    std::map<hobject_t,extent_set> parity_delta;
+
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
   };
 
+  /// shards to read and rewrite to apply a parity delta for to_write
+  std::set<int> get_parity_delta_shards(
+    const ECUtil::stripe_info_t &sinfo,
+    const ceph::ErasureCodeInterfaceRef &ecimpl,
+    const extent_set &to_write);
+
   template <typename F>
   WritePlan get_write_plan(
     const ECUtil::stripe_info_t &sinfo,
@@ -158,6 +168,22 @@ namespace ECTransaction {
 	  projected_size = truncating_to;
 	}
 
+	auto to_read_iter = plan.to_read.find(i.first);
+	if (to_read_iter != plan.to_read.end() &&
+	    !raw_write_set.empty() &&
+	    !i.first.is_temp() &&
+	    !i.second.has_source() &&
+	    !i.second.is_fresh_object() &&
+	    !i.second.deletes_first() &&
+	    !i.second.truncate &&
+	    to_read_iter->second.num_intervals() == 1 &&
+	    to_read_iter->second.size() == sinfo.get_stripe_width() &&
+	    will_write == to_read_iter->second) {
+	  ldpp_dout(dpp, 20) << __func__ << ": parity delta candidate "
+			     << raw_write_set << dendl;
+	  plan.parity_delta[i.first] = raw_write_set;
+	}
+
 	ldpp_dout(dpp, 20) << __func__ << ": " << i.first
 			   << " projected size "
 			   << projected_size
@@ -184,13 +210,15 @@ namespace ECTransaction {
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const std::map<hobject_t,extent_map> &partial_extents,
+    const std::map<hobject_t,std::map<int, ceph::buffer::list>> &parity_delta_chunks,
     std::vector<pg_log_entry_t> &entries,
     std::map<hobject_t,extent_map> *written,
     std::map<shard_id_t, ObjectStore::Transaction> *transactions,
     std::set<hobject_t> *temp_added,
     std::set<hobject_t> *temp_removed,
     DoutPrefixProvider *dpp,
-    const ceph_release_t require_osd_release = ceph_release_t::unknown);
+    const ceph_release_t require_osd_release = ceph_release_t::unknown,
+    ECUtil::StripeBatchPool *pool = nullptr);
 };
 
 #endif
@@ -2,6 +2,8 @@
 
 #include <errno.h>
 #include "include/encoding.h"
+#include "common/ceph_context.h"
+#include "common/Thread.h"
 #include "ECUtil.h"
 
 using namespace std;
@@ -9,11 +11,221 @@ using ceph::bufferlist;
 using ceph::ErasureCodeInterfaceRef;
 using ceph::Formatter;
 
+ECUtil::StripeBatchPool::StripeBatchPool(CephContext *cct,
+					 unsigned num_threads)
+  : cct(cct), num_threads(num_threads)
+{
+}
+
+ECUtil::StripeBatchPool::~StripeBatchPool()
+{
+  ceph_assert(threads.empty());
+}
+
+void ECUtil::StripeBatchPool::start()
+{
+  ceph_assert(threads.empty());
+  stopping = false;
+  for (unsigned i = 0; i < num_threads; ++i) {
+    threads.push_back(make_named_thread("ec_batch",
+					&StripeBatchPool::worker, this));
+  }
+}
+
+void ECUtil::StripeBatchPool::stop()
+{
+  {
+    std::lock_guard l(lock);
+    stopping = true;
+  }
+  work_cond.notify_all();
+  for (auto &t : threads) {
+    t.join();
+  }
+  threads.clear();
+}
+
+unsigned ECUtil::StripeBatchPool::get_num_batches(
+  ErasureCodeInterfaceRef &ec_impl, uint64_t len) const
+{
+  // plugins with sub-chunks (clay) keep per-instance scratch buffers
+  // and cannot encode or decode concurrently
+  if (threads.empty() || ec_impl->get_sub_chunk_count() != 1) {
+    return 1;
+  }
+  const uint64_t min_bytes = cct->_conf->osd_ec_stripe_batch_min_bytes;
+  if (min_bytes == 0 || len < 2 * min_bytes) {
+    return 1;
+  }
+  return std::min<uint64_t>(len / min_bytes, num_threads + 1);
+}
+
+void ECUtil::StripeBatchPool::run(unsigned n,
+				  const std::function<void(unsigned)> &fn)
+{
+  if (n <= 1 || threads.empty()) {
+    for (unsigned b = 0; b < n; ++b) {
+      fn(b);
+    }
+    return;
+  }
+  job_t job(fn, n);
+  {
+    std::lock_guard l(lock);
+    jobs.push_back(&job);
+  }
+  work_cond.notify_all();
+  unsigned ran = work_on(&job);
+
+  std::unique_lock l(lock);
+  job.done += ran;
+  done_cond.wait(l, [&job] {
+    return job.done == job.n && job.refs == 0;
+  });
+  if (auto p = std::find(jobs.begin(), jobs.end(), &job); p != jobs.end()) {
+    jobs.erase(p);
+  }
+}
+
+unsigned ECUtil::StripeBatchPool::work_on(job_t *job)
+{
+  unsigned ran = 0;
+  for (unsigned b = job->next++; b < job->n; b = job->next++) {
+    job->fn(b);
+    ++ran;
+  }
+  return ran;
+}
+
+void ECUtil::StripeBatchPool::worker()
+{
+  std::unique_lock l(lock);
+  while (!stopping) {
+    if (jobs.empty()) {
+      work_cond.wait(l);
+      continue;
+    }
+    job_t *job = jobs.front();
+    if (job->next >= job->n) {
+      // every batch is claimed; the owner waits for the stragglers
+      jobs.pop_front();
+      continue;
+    }
+    ++job->refs;
+    l.unlock();
+    unsigned ran = work_on(job);
+    l.lock();
+    job->done += ran;
+    --job->refs;
+    if (job->done == job->n && job->refs == 0) {
+      done_cond.notify_all();
+    }
+  }
+}
+
+namespace {
+
+/// first unit of batch @b when @count units are split into @batches
+uint64_t batch_start(uint64_t count, unsigned batches, unsigned b)
+{
+  return count * b / batches;
+}
+
+unsigned get_num_batches(
+  ECUtil::StripeBatchPool *pool,
+  ErasureCodeInterfaceRef &ec_impl,
+  uint64_t len,
+  uint64_t units)
+{
+  if (!pool) {
+    return 1;
+  }
+  return std::min<uint64_t>(pool->get_num_batches(ec_impl, len), units);
+}
+
+void decode_concat_range(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const map<int, bufferlist> &to_decode,
+  uint64_t begin,
+  uint64_t end,
+  bufferlist *out)
+{
+  for (uint64_t i = begin; i < end; i += sinfo.get_chunk_size()) {
+    map<int, bufferlist> chunks;
+    for (auto j = to_decode.begin(); j != to_decode.end(); ++j) {
+      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
+    }
+    bufferlist bl;
+    int r = ec_impl->decode_concat(chunks, &bl);
+    ceph_assert(r == 0);
+    ceph_assert(bl.length() == sinfo.get_stripe_width());
+    out->claim_append(bl);
+  }
+}
+
+void decode_range(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const set<int> &need,
+  const map<int, bufferlist> &to_decode,
+  int repair_data_per_chunk,
+  int begin,
+  int end,
+  map<int, bufferlist> *out)
+{
+  for (int i = begin; i < end; i++) {
+    map<int, bufferlist> chunks;
+    for (auto j = to_decode.begin();
+	 j != to_decode.end();
+	 ++j) {
+      chunks[j->first].substr_of(j->second, 
+                                 i*repair_data_per_chunk, 
+                                 repair_data_per_chunk);
+    }
+    map<int, bufferlist> out_bls;
+    int r = ec_impl->decode(need, chunks, &out_bls, sinfo.get_chunk_size());
+    ceph_assert(r == 0);
+    for (auto &&j : need) {
+      ceph_assert(out_bls.count(j));
+      ceph_assert(out_bls[j].length() == sinfo.get_chunk_size());
+      (*out)[j].claim_append(out_bls[j]);
+    }
+  }
+}
+
+void encode_range(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const bufferlist &in,
+  const set<int> &want,
+  uint64_t begin,
+  uint64_t end,
+  map<int, bufferlist> *out)
+{
+  for (uint64_t i = begin; i < end; i += sinfo.get_stripe_width()) {
+    map<int, bufferlist> encoded;
+    bufferlist buf;
+    buf.substr_of(in, i, sinfo.get_stripe_width());
+    int r = ec_impl->encode(want, buf, &encoded);
+    ceph_assert(r == 0);
+    for (map<int, bufferlist>::iterator i = encoded.begin();
+	 i != encoded.end();
+	 ++i) {
+      ceph_assert(i->second.length() == sinfo.get_chunk_size());
+      (*out)[i->first].claim_append(i->second);
+    }
+  }
+}
+
+} // anonymous namespace
+
 int ECUtil::decode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
   map<int, bufferlist> &to_decode,
-  bufferlist *out) {
+  bufferlist *out,
+  StripeBatchPool *pool) {
   ceph_assert(to_decode.size());
 
   uint64_t total_data_size = to_decode.begin()->second.length();
@@ -31,17 +243,22 @@ int ECUtil::decode(
   if (total_data_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
-    }
-    bufferlist bl;
-    int r = ec_impl->decode_concat(chunks, &bl);
-    ceph_assert(r == 0);
-    ceph_assert(bl.length() == sinfo.get_stripe_width());
+  const uint64_t stripes = total_data_size / sinfo.get_chunk_size();
+  const unsigned batches = get_num_batches(
+    pool, ec_impl, stripes * sinfo.get_stripe_width(), stripes);
+  if (batches <= 1) {
+    decode_concat_range(sinfo, ec_impl, to_decode, 0, total_data_size, out);
+    return 0;
+  }
+  vector<bufferlist> batch_out(batches);
+  pool->run(batches, [&](unsigned b) {
+    decode_concat_range(
+      sinfo, ec_impl, to_decode,
+      batch_start(stripes, batches, b) * sinfo.get_chunk_size(),
+      batch_start(stripes, batches, b + 1) * sinfo.get_chunk_size(),
+      &batch_out[b]);
+  });
+  for (auto &bl : batch_out) {
     out->claim_append(bl);
   }
   return 0;
@@ -51,7 +268,8 @@ int ECUtil::decode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
   map<int, bufferlist> &to_decode,
-  map<int, bufferlist*> &out) {
+  map<int, bufferlist*> &out,
+  StripeBatchPool *pool) {
 
   ceph_assert(to_decode.size());
 
@@ -96,22 +314,24 @@ int ECUtil::decode(
     }
   }
 
-  for (int i = 0; i < chunks_count; i++) {
-    map<int, bufferlist> chunks;
-    for (auto j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, 
-                                 i*repair_data_per_chunk, 
-                                 repair_data_per_chunk);
-    }
-    map<int, bufferlist> out_bls;
-    r = ec_impl->decode(need, chunks, &out_bls, sinfo.get_chunk_size());
-    ceph_assert(r == 0);
+  const unsigned batches = get_num_batches(
+    pool, ec_impl, (uint64_t)chunks_count * sinfo.get_stripe_width(),
+    chunks_count);
+  vector<map<int, bufferlist>> batch_out(std::max(batches, 1u));
+  if (batches <= 1) {
+    decode_range(sinfo, ec_impl, need, to_decode, repair_data_per_chunk,
+		 0, chunks_count, &batch_out[0]);
+  } else {
+    pool->run(batches, [&](unsigned b) {
+      decode_range(sinfo, ec_impl, need, to_decode, repair_data_per_chunk,
+		   batch_start(chunks_count, batches, b),
+		   batch_start(chunks_count, batches, b + 1),
+		   &batch_out[b]);
+    });
+  }
+  for (auto &bo : batch_out) {
     for (auto j = out.begin(); j != out.end(); ++j) {
-      ceph_assert(out_bls.count(j->first));
-      ceph_assert(out_bls[j->first].length() == sinfo.get_chunk_size());
-      j->second->claim_append(out_bls[j->first]);
+      j->second->claim_append(bo[j->first]);
     }
   }
   for (auto &&i : out) {
@@ -125,7 +345,8 @@ int ECUtil::encode(
   ErasureCodeInterfaceRef &ec_impl,
   bufferlist &in,
   const set<int> &want,
-  map<int, bufferlist> *out) {
+  map<int, bufferlist> *out,
+  StripeBatchPool *pool) {
 
   uint64_t logical_size = in.length();
 
@@ -136,17 +357,24 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    ceph_assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      ceph_assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
+  const uint64_t stripes = logical_size / sinfo.get_stripe_width();
+  const unsigned batches = get_num_batches(pool, ec_impl, logical_size,
+					   stripes);
+  if (batches <= 1) {
+    encode_range(sinfo, ec_impl, in, want, 0, logical_size, out);
+  } else {
+    vector<map<int, bufferlist>> batch_out(batches);
+    pool->run(batches, [&](unsigned b) {
+      encode_range(
+	sinfo, ec_impl, in, want,
+	batch_start(stripes, batches, b) * sinfo.get_stripe_width(),
+	batch_start(stripes, batches, b + 1) * sinfo.get_stripe_width(),
+	&batch_out[b]);
+    });
+    for (auto &bo : batch_out) {
+      for (auto &&[shard, bl] : bo) {
+	(*out)[shard].claim_append(bl);
+      }
     }
   }
 
@@ -15,11 +15,17 @@
 #ifndef ECUTIL_H
 #define ECUTIL_H
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <ostream>
+#include <thread>
 #include "erasure-code/ErasureCodeInterface.h"
 #include "include/buffer_fwd.h"
 #include "include/ceph_assert.h"
+#include "include/common_fwd.h"
 #include "include/encoding.h"
+#include "common/ceph_mutex.h"
 #include "common/Formatter.h"
 
 namespace ECUtil {
@@ -79,24 +85,73 @@ public:
   }
 };
 
+/**
+ * A few threads shared by the OSD to encode and decode large requests
+ * a batch of stripes at a time.  run() returns once every batch is
+ * done; the calling thread takes batches as well, so a request never
+ * waits on a busy pool to make progress.
+ */
+class StripeBatchPool {
+public:
+  StripeBatchPool(CephContext *cct, unsigned num_threads);
+  ~StripeBatchPool();
+
+  void start();
+  void stop();
+
+  /// number of batches to split @len bytes of stripes into; 1 runs inline
+  unsigned get_num_batches(
+    ceph::ErasureCodeInterfaceRef &ec_impl, uint64_t len) const;
+  /// run fn(0) ... fn(n - 1), possibly concurrently
+  void run(unsigned n, const std::function<void(unsigned)> &fn);
+
+private:
+  struct job_t {
+    const std::function<void(unsigned)> &fn;
+    const unsigned n;
+    std::atomic<unsigned> next = {0};
+    unsigned done = 0;  ///< batches finished, under lock
+    unsigned refs = 0;  ///< workers holding the job, under lock
+
+    job_t(const std::function<void(unsigned)> &fn, unsigned n)
+      : fn(fn), n(n) {}
+  };
+
+  CephContext *cct;
+  const unsigned num_threads;
+  ceph::mutex lock = ceph::make_mutex("ECUtil::StripeBatchPool::lock");
+  ceph::condition_variable work_cond;
+  ceph::condition_variable done_cond;
+  std::deque<job_t*> jobs;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+
+  void worker();
+  /// claim and run batches of @job until there are none left
+  unsigned work_on(job_t *job);
+};
+
 int decode(
   const stripe_info_t &sinfo,
   ceph::ErasureCodeInterfaceRef &ec_impl,
   std::map<int, ceph::buffer::list> &to_decode,
-  ceph::buffer::list *out);
+  ceph::buffer::list *out,
+  StripeBatchPool *pool = nullptr);
 
 int decode(
   const stripe_info_t &sinfo,
   ceph::ErasureCodeInterfaceRef &ec_impl,
   std::map<int, ceph::buffer::list> &to_decode,
-  std::map<int, ceph::buffer::list*> &out);
+  std::map<int, ceph::buffer::list*> &out,
+  StripeBatchPool *pool = nullptr);
 
 int encode(
   const stripe_info_t &sinfo,
   ceph::ErasureCodeInterfaceRef &ec_impl,
   ceph::buffer::list &in,
   const std::set<int> &want,
-  std::map<int, ceph::buffer::list> *out);
+  std::map<int, ceph::buffer::list> *out,
+  StripeBatchPool *pool = nullptr);
 
 class HashInfo {
   uint64_t total_chunk_size = 0;
@@ -406,6 +406,11 @@ public:
     pin.open(next_write_tid++);
   }
 
+  /// true if some extents of oid are pinned by a write in progress
+  bool contains_object(const hobject_t &oid) const {
+    return per_object_caches.find(oid, Cmp()) != per_object_caches.end();
+  }
+
   /**
    * Reserves extents required for rmw, and learn
    * which need to be read
@@ -125,6 +125,7 @@
 
 #include "common/perf_counters.h"
 #include "common/Timer.h"
+#include "common/Thread.h"
 #include "common/LogClient.h"
 #include "common/AsyncReserver.h"
 #include "common/HeartbeatMap.h"
@@ -275,6 +276,7 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
 				 osd->objecter_messenger,
 				 osd->monc, poolctx)),
   m_objecter_finishers(cct->_conf->osd_objecter_finishers),
+  ec_stripe_batch_pool(cct, cct->_conf->osd_ec_stripe_batch_threads),
   watch_timer(osd->client_messenger->cct, watch_lock),
   next_notif_id(0),
   recovery_request_timer(cct, recovery_request_lock, false),
@@ -522,6 +524,7 @@ void OSDService::shutdown()
     f->wait_for_empty();
     f->stop();
   }
+  ec_stripe_batch_pool.stop();
 
   publish_map(OSDMapRef());
   next_osdmap = OSDMapRef();
@@ -533,6 +536,7 @@ void OSDService::init()
   for (auto& f : objecter_finishers) {
     f->start();
   }
+  ec_stripe_batch_pool.start();
   objecter->set_client_incarnation(0);
 
   // deprioritize objecter in daemonperf output
@@ -1909,6 +1913,20 @@ void OSDService::queue_for_pg_delete(spg_t pgid, epoch_t e)
       e));
 }
 
+void OSDService::queue_for_pg_recompress(spg_t pgid, epoch_t e)
+{
+  dout(10) << __func__ << " on " << pgid << " e " << e  << dendl;
+  enqueue_back(
+    OpSchedulerItem(
+      unique_ptr<OpSchedulerItem::OpQueueable>(
+	new PGRecompress(pgid, e)),
+      cct->_conf.get_val<Option::size_t>("osd_recompress_cost"),
+      cct->_conf.get_val<uint64_t>("osd_recompress_priority"),
+      ceph_clock_now(),
+      0,
+      e));
+}
+
 bool OSDService::try_finish_pg_delete(PG *pg, unsigned old_pg_num)
 {
   return osd->try_finish_pg_delete(pg, old_pg_num);
@@ -2412,6 +2430,9 @@ OSD::OSD(CephContext *cct_,
       this);
     shards.push_back(one_shard);
   }
+  mclock_calibrator =
+    std::make_unique<ceph::osd::scheduler::mClockCalibrator>(
+      cct, store_is_rotational);
 }
 
 OSD::~OSD()
@@ -2792,6 +2813,11 @@ will start to track new ops received afterwards.";
     f->open_object_section("pq");
     op_shardedwq.dump(f);
     f->close_section();
+  } else if (prefix == "dump_mclock_calibration") {
+    f->open_object_section("mclock_calibration");
+    f->dump_bool("enabled", mclock_calibrating);
+    mclock_calibrator->dump(f);
+    f->close_section();
   } else if (prefix == "dump_blocklist") {
     list<pair<entity_addr_t,utime_t> > bl;
     list<pair<entity_addr_t,utime_t> > rbl;
@@ -3608,6 +3634,7 @@ int OSD::init()
   std::lock_guard lock(osd_lock);
   if (is_stopping())
     return 0;
+  auto init_start = ceph::mono_clock::now();
   tracing::osd::tracer.init("osd");
   tick_timer.init();
   tick_timer_without_osd_lock.init();
@@ -3635,11 +3662,14 @@ int OSD::init()
  auto rotating_auth_timeout =
    g_conf().get_val<int64_t>("rotating_keys_bootstrap_timeout");
 
+  auto mount_start = ceph::mono_clock::now();
   int r = store->mount();
   if (r < 0) {
     derr << "OSD:init: unable to mount object store" << dendl;
     return r;
   }
+  logger->tset(l_osd_boot_mount_lat,
+	       utime_t(ceph::mono_clock::now() - mount_start));
   journal_is_rotational = store->is_journal_rotational();
   dout(2) << "journal looks like " << (journal_is_rotational ? "hdd" : "ssd")
           << dendl;
@@ -4002,6 +4032,9 @@ int OSD::init()
 
   monc->renew_subs();
 
+  logger->tset(l_osd_boot_init_lat,
+	       utime_t(ceph::mono_clock::now() - init_start));
+  boot_stamp = ceph::mono_clock::now();
   start_boot();
 
   // Override a few options if mclock scheduler is enabled.
@@ -4069,6 +4102,11 @@ void OSD::final_init()
 				     asok_hook,
 				     "dump op queue state");
   ceph_assert(r == 0);
+  r = admin_socket->register_command("dump_mclock_calibration",
+				     asok_hook,
+				     "dump the mclock cost model measured from "
+				     "the object store");
+  ceph_assert(r == 0);
   r = admin_socket->register_command("dump_blocklist",
 				     asok_hook,
 				     "dump blocklisted clients and times");
@@ -5132,6 +5170,7 @@ void OSD::load_pgs()
 {
   ceph_assert(ceph_mutex_is_locked(osd_lock));
   dout(0) << "load_pgs" << dendl;
+  auto start = ceph::mono_clock::now();
 
   {
     auto pghist = make_pg_num_history_oid();
@@ -5150,7 +5189,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  int num = 0;
+  vector<PGRef> pgs;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -5203,35 +5242,76 @@ void OSD::load_pgs()
       recursive_remove_collection(cct, store.get(), pgid, *it);
       continue;
     }
+    pgs.push_back(std::move(pg));
+  }
+
+  // reading a PG's info and log only touches that PG, so spread them over
+  // a few threads; each one is registered as soon as it has been read
+  std::atomic<size_t> next = 0;
+  std::atomic<int> num = 0;
+  ceph::mutex dne_lock = ceph::make_mutex("OSD::load_pgs::dne_lock");
+  vector<PGRef> dne;
+  auto load = [&] {
+    for (size_t i = next++; i < pgs.size(); i = next++) {
+      if (_load_pg(pgs[i])) {
+	++num;
+      } else {
+	std::lock_guard l(dne_lock);
+	dne.push_back(pgs[i]);
+      }
+    }
+  };
+  size_t num_threads = std::min<size_t>(
+    cct->_conf.get_val<uint64_t>("osd_load_pgs_threads"), pgs.size());
+  vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.push_back(make_named_thread("osd_load_pgs", load));
+  }
+  load();
+  for (auto& t : threads) {
+    t.join();
+  }
 
-    // there can be no waiters here, so we don't call _wake_pg_slot
+  for (auto& pg : dne) {
+    dout(10) << "load_pgs " << pg->coll << " deleting dne" << dendl;
+    recursive_remove_collection(cct, store.get(), pg->pg_id, pg->coll);
+  }
+  auto lat = ceph::mono_clock::now() - start;
+  logger->tset(l_osd_boot_load_pgs_lat, utime_t(lat));
+  dout(0) << __func__ << " opened " << num << " pgs in " << lat
+	  << " with " << std::max<size_t>(num_threads, 1) << " threads"
+	  << dendl;
+}
 
-    pg->lock();
-    pg->ch = store->open_collection(pg->coll);
+bool OSD::_load_pg(PGRef pg)
+{
+  auto start = ceph::mono_clock::now();
 
-    // read pg state, log
-    pg->read_state(store.get());
+  // there can be no waiters here, so we don't call _wake_pg_slot
 
-    if (pg->dne())  {
-      dout(10) << "load_pgs " << *it << " deleting dne" << dendl;
-      pg->ch = nullptr;
-      pg->unlock();
-      recursive_remove_collection(cct, store.get(), pgid, *it);
-      continue;
-    }
-    {
-      uint32_t shard_index = pgid.hash_to_shard(shards.size());
-      assert(NULL != shards[shard_index]);
-      store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
-    }
+  pg->lock();
+  pg->ch = store->open_collection(pg->coll);
 
-    dout(10) << __func__ << " loaded " << *pg << dendl;
-    pg->unlock();
+  // read pg state, log
+  pg->read_state(store.get());
 
-    register_pg(pg);
-    ++num;
+  if (pg->dne())  {
+    pg->ch = nullptr;
+    pg->unlock();
+    return false;
+  }
+  {
+    uint32_t shard_index = pg->pg_id.hash_to_shard(shards.size());
+    assert(NULL != shards[shard_index]);
+    store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
   }
-  dout(0) << __func__ << " opened " << num << " pgs" << dendl;
+
+  dout(10) << __func__ << " loaded " << *pg << dendl;
+  pg->unlock();
+
+  register_pg(pg);
+  logger->tinc(l_osd_boot_pg_load_lat, ceph::mono_clock::now() - start);
+  return true;
 }
 
 
@@ -6299,6 +6379,8 @@ void OSD::tick_without_osd_lock()
       sched_scrub();
     }
     service.promote_throttle_recalibrate();
+    sched_recompress();
+    calibrate_mclock();
     resume_creating_pg();
     bool need_send_beacon = false;
     const auto now = ceph::coarse_mono_clock::now();
@@ -7623,6 +7705,86 @@ bool OSD::scrub_random_backoff()
 }
 
 
+void OSD::sched_recompress()
+{
+  auto interval = cct->_conf.get_val<double>("osd_recompress_interval");
+  if (interval <= 0) {
+    return;
+  }
+  auto now = ceph::coarse_mono_clock::now();
+  if (now - last_recompress_sched < ceph::make_timespan(interval)) {
+    return;
+  }
+  last_recompress_sched = now;
+  dout(10) << __func__ << dendl;
+  vector<PGRef> pgs;
+  _get_pgs(&pgs);
+  for (auto& pg : pgs) {
+    std::scoped_lock l{*pg};
+    pg->queue_recompress();
+  }
+}
+
+void OSD::calibrate_mclock()
+{
+  auto interval =
+    cct->_conf.get_val<double>("osd_mclock_calibration_interval");
+  if (interval <= 0) {
+    if (mclock_calibrating) {
+      // go back to what config says
+      dout(1) << __func__ << " calibration off, using configured model"
+	      << dendl;
+      mclock_calibrating = false;
+      mclock_calibrator->reset();
+      auto model = mclock_calibrator->get_model();
+      for (auto shard : shards) {
+	shard->scheduler->set_capacity_model(model.cost_per_io,
+					     model.bandwidth);
+      }
+    }
+    return;
+  }
+  auto now = ceph::coarse_mono_clock::now();
+  if (mclock_calibrating &&
+      now - last_mclock_calibration < ceph::make_timespan(interval)) {
+    return;
+  }
+  ObjectStore::io_service_stats_t stats;
+  if (!store->get_io_service_stats(&stats)) {
+    return;
+  }
+  last_mclock_calibration = now;
+  mclock_calibrating = true;
+  if (!mclock_calibrator->update(stats)) {
+    return;
+  }
+
+  auto model = mclock_calibrator->get_model();
+  dout(10) << __func__ << " cost_per_io " << model.cost_per_io
+	   << " bandwidth " << model.bandwidth << dendl;
+  for (auto shard : shards) {
+    shard->scheduler->set_capacity_model(model.cost_per_io, model.bandwidth);
+  }
+  logger->inc(l_osd_mclock_calibrations);
+  logger->set(l_osd_mclock_cost_per_io,
+	      static_cast<uint64_t>(model.cost_per_io));
+  logger->set(l_osd_mclock_bandwidth,
+	      static_cast<uint64_t>(model.bandwidth));
+  for (bool write : {false, true}) {
+    auto fit = mclock_calibrator->get_fit(write);
+    if (!fit.valid()) {
+      continue;
+    }
+    utime_t io_time;
+    io_time.set_from_double(fit.io_time);
+    logger->tset(write ? l_osd_mclock_write_io_time : l_osd_mclock_read_io_time,
+		 io_time);
+    logger->set(write ? l_osd_mclock_write_bandwidth :
+		l_osd_mclock_read_bandwidth,
+		static_cast<uint64_t>(1.0 / fit.byte_time));
+  }
+}
+
 void OSD::sched_scrub()
 {
   auto& scrub_scheduler = service.get_scrub_services();
@@ -7714,6 +7876,15 @@ Scrub::schedule_result_t OSDService::initiate_a_scrub(spg_t pgid,
   return scrub_attempt;
 }
 
+uint64_t OSDService::get_queued_client_ops() const
+{
+  uint64_t queued = 0;
+  for (const auto shard : osd->shards) {
+    queued += shard->scheduler->get_queued_client_ops();
+  }
+  return queued;
+}
+
 void OSD::resched_all_scrubs()
 {
   dout(10) << __func__ << ": start" << dendl;
@@ -8445,6 +8616,11 @@ void OSD::_committed_osd_maps(epoch_t first, epoch_t last, MOSDMap *m)
       dout(1) << "state: booting -> active" << dendl;
       set_state(STATE_ACTIVE);
       do_restart = false;
+      if (boot_stamp != ceph::mono_time()) {
+	logger->tset(l_osd_boot_up_lat,
+		     utime_t(ceph::mono_clock::now() - boot_stamp));
+	boot_stamp = ceph::mono_time();
+      }
 
       // set incarnation so that osd_reqid_t's we generate for our
       // objecter requests are unique across restarts.
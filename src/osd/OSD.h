@@ -39,6 +39,7 @@
 #include "Session.h"
 
 #include "osd/scheduler/OpScheduler.h"
+#include "osd/scheduler/mClockCalibrator.h"
 
 #include <atomic>
 #include <map>
@@ -52,6 +53,7 @@
 #include "messages/MOSDOp.h"
 #include "common/EventTrace.h"
 #include "osd/osd_perf_counters.h"
+#include "osd/ECUtil.h"
 #include "common/Finisher.h"
 #include "scrubber/osd_scrub_sched.h"
 
@@ -263,6 +265,8 @@ public:
     spg_t pgid,
     bool allow_requested_repair_only) final;
 
+  uint64_t get_queued_client_ops() const final;
+
 
  private:
   // -- agent shared state --
@@ -427,6 +431,9 @@ public:
   int m_objecter_finishers;
   std::vector<std::unique_ptr<Finisher>> objecter_finishers;
 
+  // -- EC, for splitting large encodes/decodes into stripe batches --
+  ECUtil::StripeBatchPool ec_stripe_batch_pool;
+
   // -- Watch --
   ceph::mutex watch_lock = ceph::make_mutex("OSDService::watch_lock");
   SafeTimer watch_timer;
@@ -576,6 +583,7 @@ public:
 				   Scrub::act_token_t act_token);
 
   void queue_for_pg_delete(spg_t pgid, epoch_t e);
+  void queue_for_pg_recompress(spg_t pgid, epoch_t e);
   bool try_finish_pg_delete(PG *pg, unsigned old_pg_num);
 
 private:
@@ -1438,6 +1446,7 @@ private:
   utime_t last_heartbeat_resample;   ///< last time we chose random peers in waiting-for-healthy state
   double daily_loadavg;
   ceph::mono_time startup_time;
+  ceph::mono_time boot_stamp;  ///< when init() first asked to boot, until up
 
   // Track ping repsonse times using vector as a circular buffer
   // MUST BE A POWER OF 2
@@ -1763,6 +1772,7 @@ protected:
   void resume_creating_pg();
 
   void load_pgs();
+  bool _load_pg(PGRef pg);
 
   epoch_t last_pg_create_epoch;
 
@@ -1871,6 +1881,16 @@ protected:
   void resched_all_scrubs();
   bool scrub_random_backoff();
 
+  // -- background recompression --
+  ceph::coarse_mono_clock::time_point last_recompress_sched;
+  void sched_recompress();
+
+  // -- mclock cost model --
+  std::unique_ptr<ceph::osd::scheduler::mClockCalibrator> mclock_calibrator;
+  ceph::coarse_mono_clock::time_point last_mclock_calibration;
+  std::atomic<bool> mclock_calibrating = false;
+  void calibrate_mclock();
+
   // -- status reporting --
   MPGStats *collect_pg_stats();
   std::vector<DaemonHealthMetric> get_health_metrics();
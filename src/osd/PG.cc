@@ -2619,6 +2619,71 @@ void PG::C_DeleteMore::complete(int r) {
   delete this;
 }
 
+void PG::queue_recompress()
+{
+  if (recompress_queued || is_deleting() || !is_active()) {
+    return;
+  }
+  dout(20) << __func__ << " from " << recompress_cursor << dendl;
+  recompress_queued = true;
+  osd->queue_for_pg_recompress(get_pgid(), get_osdmap_epoch());
+}
+
+void PG::recompress_some(epoch_t queued, ThreadPool::TPHandle &handle)
+{
+  recompress_queued = false;
+  if (pg_has_reset_since(queued) || is_deleting() || !is_active()) {
+    // the next pass carries on from recompress_cursor
+    return;
+  }
+
+  // each work item reads about osd_recompress_cost bytes, which is what
+  // the op scheduler charged it
+  uint64_t budget = cct->_conf.get_val<Option::size_t>("osd_recompress_cost");
+  int max = std::min(osd->store->get_ideal_list_max(),
+		     (int)cct->_conf->osd_target_transaction_size);
+  vector<ghobject_t> olist;
+  ghobject_t next;
+  osd->store->collection_list(
+    ch,
+    recompress_cursor,
+    ghobject_t::get_max(),
+    max,
+    &olist,
+    &next);
+
+  uint64_t done = 0;
+  auto p = olist.begin();
+  for (; p != olist.end() && done < budget; ++p) {
+    if (p->is_pgmeta()) {
+      continue;
+    }
+    uint64_t bytes = 0;
+    int r = osd->store->recompress(ch, *p, &bytes);
+    if (r == -EOPNOTSUPP) {
+      dout(10) << __func__ << " not supported by the object store" << dendl;
+      recompress_cursor = ghobject_t();
+      return;
+    }
+    if (r < 0 && r != -ENOENT) {
+      dout(5) << __func__ << " " << *p << " failed: " << cpp_strerror(r)
+	      << dendl;
+    }
+    done += bytes;
+    handle.reset_tp_timeout();
+  }
+  recompress_cursor = p == olist.end() ? next : *p;
+  dout(20) << __func__ << " read " << done << " bytes, next "
+	   << recompress_cursor << dendl;
+  if (recompress_cursor.is_max()) {
+    dout(10) << __func__ << " pass complete" << dendl;
+    recompress_cursor = ghobject_t();
+    return;
+  }
+  recompress_queued = true;
+  osd->queue_for_pg_recompress(get_pgid(), get_osdmap_epoch());
+}
+
 std::pair<ghobject_t, bool> PG::do_delete_work(
   ObjectStore::Transaction &t,
   ghobject_t _next)
@@ -300,8 +300,21 @@ public:
       });
   }
 
+  static void add_bytes_scrubbed(int64_t bytes, pg_stat_t &stats) {
+    stats.bytes_scrubbed += bytes;
+  }
+
+  void add_bytes_scrubbed(int64_t bytes) {
+    recovery_state.update_stats(
+      [bytes](auto &history, auto &stats) {
+	add_bytes_scrubbed(bytes, stats);
+	return true;
+      });
+  }
+
   static void reset_objects_scrubbed(pg_stat_t &stats) {
     stats.objects_scrubbed = 0;
+    stats.bytes_scrubbed = 0;
   }
 
   void reset_objects_scrubbed()
@@ -658,6 +671,10 @@ public:
   std::pair<ghobject_t, bool> do_delete_work(ObjectStore::Transaction &t,
     ghobject_t _next) override;
 
+  /// queue a pass of background recompression, unless one is under way
+  void queue_recompress();
+  void recompress_some(epoch_t queued, ThreadPool::TPHandle &handle);
+
   void clear_ready_to_merge() override;
   void set_not_ready_to_merge_target(pg_t pgid, pg_t src) override;
   void set_not_ready_to_merge_source(pg_t pgid) override;
@@ -1293,6 +1310,9 @@ public:
 protected:
   bool delete_needs_sleep = false;
 
+  bool recompress_queued = false;
+  ghobject_t recompress_cursor;   ///< where the current pass is up to
+
 protected:
   bool state_test(uint64_t m) const { return recovery_state.state_test(m); }
   void state_set(uint64_t m) { recovery_state.state_set(m); }
@@ -35,6 +35,9 @@ struct inconsistent_obj_wrapper;
 
 //forward declaration
 class OSDMap;
+namespace ECUtil {
+  class StripeBatchPool;
+}
 class PGLog;
 typedef std::shared_ptr<const OSDMap> OSDMapRef;
 
@@ -290,6 +293,7 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
      virtual entity_name_t get_cluster_msgr_name() = 0;
 
      virtual PerfCounters *get_logger() = 0;
+     virtual ECUtil::StripeBatchPool *get_ec_stripe_batch_pool() = 0;
 
      virtual ceph_tid_t get_tid() = 0;
 
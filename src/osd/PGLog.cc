@@ -56,8 +56,8 @@ void PGLog::IndexedLog::split_out_child(
 void PGLog::IndexedLog::trim(
   CephContext* cct,
   eversion_t s,
-  set<eversion_t> *trimmed,
-  set<string>* trimmed_dups,
+  TrimmedRange *trimmed,
+  TrimmedRange *trimmed_dups,
   eversion_t *write_from_dups)
 {
   lgeneric_subdout(cct, osd, 10) << "IndexedLog::trim s=" << s << dendl;
@@ -77,7 +77,7 @@ void PGLog::IndexedLog::trim(
       break;
     lgeneric_subdout(cct, osd, 20) << "trim " << e << dendl;
     if (trimmed)
-      trimmed->emplace(e.version);
+      trimmed->insert(e.version);
 
     unindex(e);         // remove from index,
 
@@ -146,7 +146,7 @@ void PGLog::IndexedLog::trim(
     const auto& e = *dups.begin();
     lgeneric_subdout(cct, osd, 20) << "trim dup " << e << dendl;
     if (trimmed_dups)
-      trimmed_dups->insert(e.get_key_name());
+      trimmed_dups->insert(e.version);
     unindex(e);
     dups.pop_front();
   }
@@ -651,8 +651,8 @@ void PGLog::write_log_and_missing(
       dirty_to,
       dirty_from,
       writeout_from,
-      std::move(trimmed),
-      std::move(trimmed_dups),
+      trimmed,
+      trimmed_dups,
       missing,
       !touched_log,
       require_rollback,
@@ -704,8 +704,8 @@ void PGLog::write_log_and_missing(
     eversion_t::max(),
     eversion_t(),
     eversion_t(),
-    set<eversion_t>(),
-    set<string>(),
+    TrimmedRange(),
+    TrimmedRange(),
     missing,
     true, require_rollback, false,
     eversion_t::max(),
@@ -854,8 +854,8 @@ void PGLog::_write_log_and_missing(
   eversion_t dirty_to,
   eversion_t dirty_from,
   eversion_t writeout_from,
-  set<eversion_t> &&trimmed,
-  set<string> &&trimmed_dups,
+  const TrimmedRange &trimmed,
+  const TrimmedRange &trimmed_dups,
   const pg_missing_tracker_t &missing,
   bool touch_log,
   bool require_rollback,
@@ -871,22 +871,35 @@ void PGLog::_write_log_and_missing(
 		     << " dirty_to_dups=" << dirty_to_dups
 		     << " dirty_from_dups=" << dirty_from_dups
 		     << " write_from_dups=" << write_from_dups
-		     << " trimmed_dups.size()=" << trimmed_dups.size() << dendl;
+		     << " trimmed=" << trimmed
+		     << " trimmed_dups=" << trimmed_dups << dendl;
   set<string> to_remove;
-  to_remove.swap(trimmed_dups);
-  for (auto& t : trimmed) {
-    string key = t.get_key_name();
-    if (log_keys_debug) {
-      auto it = log_keys_debug->find(key);
-      ceph_assert(it != log_keys_debug->end());
-      log_keys_debug->erase(it);
-    }
-    to_remove.emplace(std::move(key));
-  }
-  trimmed.clear();
 
   if (touch_log)
     t.touch(coll, log_oid);
+  // trimmed keys are a contiguous run (see TrimmedRange), so clear each
+  // of them with one range delete; removing them one by one leaves a
+  // tombstone per key for later iterators to step over
+  if (!trimmed.empty()) {
+    string first = trimmed.first.get_key_name();
+    string end = trimmed.end().get_key_name();
+    t.omap_rmkeyrange(coll, log_oid, first, end);
+    if (log_keys_debug) {
+      size_t n = 0;
+      for (auto i = log_keys_debug->lower_bound(first);
+	   i != log_keys_debug->end() && *i < end;
+	   log_keys_debug->erase(i++), ++n);
+      ceph_assert(n == trimmed.size());
+    }
+  }
+  if (!trimmed_dups.empty()) {
+    pg_log_dup_t first, end;
+    first.version = trimmed_dups.first;
+    end.version = trimmed_dups.end();
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      first.get_key_name(), end.get_key_name());
+  }
   if (dirty_to != eversion_t()) {
     t.omap_rmkeyrange(
       coll, log_oid,
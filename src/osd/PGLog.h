@@ -124,6 +124,46 @@ struct PGLog : DoutPrefixProvider {
   }
 
   ////////////////////////////// sub classes //////////////////////////////
+  /**
+   * TrimmedRange
+   *
+   * The versions trimmed since the log was last written out.  A trim
+   * always eats from the front of the log (or of the dups), so these are
+   * one contiguous run of keys and can be cleared with a single range
+   * delete instead of a remove per key.
+   */
+  struct TrimmedRange {
+    eversion_t first = eversion_t::max();
+    eversion_t last;
+    size_t count = 0;
+
+    void insert(eversion_t v) {
+      if (v < first)
+	first = v;
+      if (v > last)
+	last = v;
+      ++count;
+    }
+    bool empty() const {
+      return count == 0;
+    }
+    size_t size() const {
+      return count;
+    }
+    void clear() {
+      *this = TrimmedRange();
+    }
+    /// the version just past the range; no live key sorts before it
+    eversion_t end() const {
+      return eversion_t(last.epoch, last.version + 1);
+    }
+    friend std::ostream& operator<<(std::ostream& out, const TrimmedRange& r) {
+      if (r.empty())
+	return out << "[]";
+      return out << "[" << r.first << "," << r.last << "]x" << r.count;
+    }
+  };
+
   struct LogEntryHandler {
     virtual void rollback(
       const pg_log_entry_t &entry) = 0;
@@ -633,8 +673,8 @@ public:
     void trim(
       CephContext* cct,
       eversion_t s,
-      std::set<eversion_t> *trimmed,
-      std::set<std::string>* trimmed_dups,
+      TrimmedRange *trimmed,
+      TrimmedRange *trimmed_dups,
       eversion_t *write_from_dups);
 
     std::ostream& print(std::ostream& out) const;
@@ -650,11 +690,11 @@ protected:
   eversion_t dirty_to;         ///< must clear/writeout all keys <= dirty_to
   eversion_t dirty_from;       ///< must clear/writeout all keys >= dirty_from
   eversion_t writeout_from;    ///< must writout keys >= writeout_from
-  std::set<eversion_t> trimmed;     ///< must clear keys in trimmed
+  TrimmedRange trimmed;        ///< must clear keys in trimmed
   eversion_t dirty_to_dups;    ///< must clear/writeout all dups <= dirty_to_dups
   eversion_t dirty_from_dups;  ///< must clear/writeout all dups >= dirty_from_dups
   eversion_t write_from_dups;  ///< must write keys >= write_from_dups
-  std::set<std::string> trimmed_dups;    ///< must clear keys in trimmed_dups
+  TrimmedRange trimmed_dups;   ///< must clear dups in trimmed_dups
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
@@ -1382,8 +1422,8 @@ public:
     eversion_t dirty_to,
     eversion_t dirty_from,
     eversion_t writeout_from,
-    std::set<eversion_t> &&trimmed,
-    std::set<std::string> &&trimmed_dups,
+    const TrimmedRange &trimmed,
+    const TrimmedRange &trimmed_dups,
     const pg_missing_tracker_t &missing,
     bool touch_log,
     bool require_rollback,
@@ -1444,35 +1484,38 @@ public:
     // will get overridden below if it had been recorded
     eversion_t on_disk_can_rollback_to = info.last_update;
     eversion_t on_disk_rollback_info_trimmed_to = eversion_t();
-    ObjectMap::ObjectMapIterator p = store->get_omap_iterator(ch,
-							      pgmeta_oid);
     std::map<eversion_t, hobject_t> divergent_priors;
     bool must_rebuild = false;
     missing.may_include_deletes = false;
     std::list<pg_log_entry_t> entries;
     std::list<pg_log_dup_t> dups;
     const auto NUM_DUPS_WARN_THRESHOLD = 2*cct->_conf->osd_pg_log_dups_tracked;
-    if (p) {
-      using ceph::decode;
-      for (p->seek_to_first(); p->valid() ; p->next()) {
+    // the log, dups and missing set are all read in one pass over the
+    // omap, reading ahead as far as we are allowed to
+    r = store->omap_get_values_range(
+      ch, pgmeta_oid, std::string(), true,
+      cct->_conf.get_val<Option::size_t>("osd_omap_readahead_max"),
+      [&](std::string_view key, std::string_view value) {
+	using ceph::decode;
 	// non-log pgmeta_oid keys are prefixed with _; skip those
-	if (p->key()[0] == '_')
-	  continue;
-	auto bl = p->value();//Copy ceph::buffer::list before creating iterator
+	if (key[0] == '_')
+	  return true;
+	ceph::buffer::list bl;
+	bl.append(value.data(), value.size());
 	auto bp = bl.cbegin();
-	if (p->key() == "divergent_priors") {
+	if (key == "divergent_priors") {
 	  decode(divergent_priors, bp);
 	  ldpp_dout(dpp, 20) << "read_log_and_missing " << divergent_priors.size()
 			     << " divergent_priors" << dendl;
 	  must_rebuild = true;
 	  debug_verify_stored_missing = false;
-	} else if (p->key() == "can_rollback_to") {
+	} else if (key == "can_rollback_to") {
 	  decode(on_disk_can_rollback_to, bp);
-	} else if (p->key() == "rollback_info_trimmed_to") {
+	} else if (key == "rollback_info_trimmed_to") {
 	  decode(on_disk_rollback_info_trimmed_to, bp);
-	} else if (p->key() == "may_include_deletes_in_missing") {
+	} else if (key == "may_include_deletes_in_missing") {
 	  missing.may_include_deletes = true;
-	} else if (p->key().substr(0, 7) == std::string("missing")) {
+	} else if (key.substr(0, 7) == "missing") {
 	  hobject_t oid;
 	  pg_missing_item item;
 	  decode(oid, bp);
@@ -1482,7 +1525,7 @@ public:
 	    ceph_assert(missing.may_include_deletes);
 	  }
 	  missing.add(oid, std::move(item));
-	} else if (p->key().substr(0, 4) == std::string("dup_")) {
+	} else if (key.substr(0, 4) == "dup_") {
 	  ++total_dups;
 	  pg_log_dup_t dup;
 	  decode(dup, bp);
@@ -1497,22 +1540,23 @@ public:
 			      << " Consider ceph-objectstore-tool --op trim-pg-log-dups"
 			      << dendl;
 	  }
-	  dups.push_back(dup);
+	  dups.push_back(std::move(dup));
 	} else {
 	  pg_log_entry_t e;
 	  e.decode_with_checksum(bp);
 	  ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
 	  if (!entries.empty()) {
-	    pg_log_entry_t last_e(entries.back());
+	    const pg_log_entry_t &last_e = entries.back();
 	    ceph_assert(last_e.version.version < e.version.version);
 	    ceph_assert(last_e.version.epoch <= e.version.epoch);
 	  }
-	  entries.push_back(e);
 	  if (log_keys_debug)
 	    log_keys_debug->insert(e.get_key_name());
+	  entries.push_back(std::move(e));
 	}
-      }
-    }
+	return true;
+      });
+    ceph_assert(r == 0);
     if (info.pgid.is_no_shard()) {
       // replicated pool pg does not persist this key
       assert(on_disk_rollback_info_trimmed_to == eversion_t());
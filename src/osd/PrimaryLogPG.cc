@@ -587,6 +587,11 @@ PerfCounters *PrimaryLogPG::get_logger()
   return osd->logger;
 }
 
+ECUtil::StripeBatchPool *PrimaryLogPG::get_ec_stripe_batch_pool()
+{
+  return &osd->ec_stripe_batch_pool;
+}
+
 
 // ====================
 // missing objects
@@ -7726,27 +7731,34 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	bool truncated = false;
 	bufferlist bl;
 	if (oi.is_omap()) {
-	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
-	    );
-          if (!iter) {
-            result = -ENOENT;
-            goto fail;
-          }
-	  iter->upper_bound(start_after);
-	  if (filter_prefix > start_after) iter->lower_bound(filter_prefix);
-	  for (num = 0;
-	       iter->valid() &&
-		 iter->key().substr(0, filter_prefix.size()) == filter_prefix;
-	       ++num, iter->next()) {
-	    dout(20) << "Found key " << iter->key() << dendl;
-	    if (num >= max_return ||
-		bl.length() >= cct->_conf->osd_max_omap_bytes_per_request) {
-	      truncated = true;
-	      break;
-	    }
-	    encode(iter->key(), bl);
-	    encode(iter->value(), bl);
+	  const uint64_t max_bytes = cct->_conf->osd_max_omap_bytes_per_request;
+	  // read the page in one pass, reading ahead roughly what it is
+	  // going to take (we don't know the entry size, so guess 256
+	  // bytes)
+	  uint64_t readahead = std::min<uint64_t>(
+	    {max_return * 256, max_bytes,
+	     cct->_conf.get_val<Option::size_t>("osd_omap_readahead_max")});
+	  bool filtered = filter_prefix > start_after;
+	  int r = osd->store->omap_get_values_range(
+	    ch, ghobject_t(soid),
+	    filtered ? filter_prefix : start_after, filtered, readahead,
+	    [&](std::string_view key, std::string_view value) {
+	      if (key.substr(0, filter_prefix.size()) != filter_prefix) {
+		return false;
+	      }
+	      dout(20) << "Found key " << key << dendl;
+	      if (num >= max_return || bl.length() >= max_bytes) {
+		truncated = true;
+		return false;
+	      }
+	      encode(key, bl);
+	      encode(value, bl);
+	      ++num;
+	      return true;
+	    });
+	  if (r < 0) {
+	    result = r;
+	    goto fail;
 	  }
 	} // else return empty out_set
 	encode(num, osd_op.outdata);
@@ -583,6 +583,7 @@ public:
   }
 
   PerfCounters *get_logger() override;
+  ECUtil::StripeBatchPool *get_ec_stripe_batch_pool() override;
 
   ceph_tid_t get_tid() override { return osd->get_tid(); }
 
@@ -657,24 +657,30 @@ int ReplicatedBackend::be_deep_scrub(
 
     const uint64_t stride = cct->_conf->osd_deep_scrub_stride;
 
-    bufferlist bl;
-    r = store->read(
-      ch,
-      ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-      pos.data_pos,
-      stride, bl,
-      fadvise_flags);
-    if (r < 0) {
-      dout(20) << __func__ << "  " << poid << " got "
-	       << r << " on read, read_error" << dendl;
-      o.read_error = true;
-      return 0;
-    }
-    if (r > 0) {
-      pos.data_hash << bl;
-    }
-    pos.data_pos += r;
+    // keep reading while the slice allows, rather than requeueing
+    // after every stride
+    do {
+      bufferlist bl;
+      uint32_t crc = pos.data_hash.digest();
+      r = store->read_crc32c(
+	ch,
+	ghobject_t(
+	  poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+	pos.data_pos,
+	stride, bl, &crc,
+	fadvise_flags);
+      if (r < 0) {
+	dout(20) << __func__ << "  " << poid << " got "
+		 << r << " on read, read_error" << dendl;
+	o.read_error = true;
+	return 0;
+      }
+      if (r > 0) {
+	pos.data_hash = bufferhash(crc);
+      }
+      pos.data_pos += r;
+      pos.slice_bytes += r;
+    } while (static_cast<uint64_t>(r) == stride && pos.slice_has_room());
     if (static_cast<uint64_t>(r) == stride) {
       dout(20) << __func__ << "  " << poid << " more data, digest so far 0x"
 	       << std::hex << pos.data_hash.digest() << std::dec << dendl;
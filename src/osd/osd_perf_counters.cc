@@ -133,6 +133,27 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_time_avg(l_osd_op_before_dequeue_op_lat, "op_before_dequeue_op_lat",
     "Latency of IO before calling dequeue_op(already dequeued and get PG lock)"); // client io before dequeue_op latency
 
+  osd_plb.add_time_avg(
+    l_osd_ec_encode_lat, "ec_encode_latency",
+    "Latency of encoding erasure coded writes");
+  osd_plb.add_u64_counter_histogram(
+    l_osd_ec_encode_lat_inb_hist, "ec_encode_latency_in_bytes_histogram",
+    op_hist_x_axis_config, op_hist_y_axis_config,
+    "Histogram of erasure coded write encode latency + data encoded");
+  osd_plb.add_time_avg(
+    l_osd_ec_decode_lat, "ec_decode_latency",
+    "Latency of decoding erasure coded reads and recovery");
+  osd_plb.add_u64_counter_histogram(
+    l_osd_ec_decode_lat_outb_hist, "ec_decode_latency_out_bytes_histogram",
+    op_hist_x_axis_config, op_hist_y_axis_config,
+    "Histogram of erasure coded read and recovery decode latency + data decoded");
+  osd_plb.add_u64_counter(
+    l_osd_ec_parity_delta, "ec_parity_delta",
+    "Erasure coded overwrites applied as a parity delta");
+  osd_plb.add_u64_counter(
+    l_osd_ec_parity_delta_fallback, "ec_parity_delta_fallback",
+    "Erasure coded parity delta overwrites falling back to a stripe read");
+
   osd_plb.add_u64_counter(
     l_osd_sop, "subop", "Suboperations");
   osd_plb.add_u64_counter(
@@ -319,6 +340,47 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_time(
+    l_osd_boot_mount_lat, "boot_mount_lat",
+    "Time to mount the object store at start");
+  osd_plb.add_time(
+    l_osd_boot_load_pgs_lat, "boot_load_pgs_lat",
+    "Time to load all PGs at start");
+  osd_plb.add_time_avg(
+    l_osd_boot_pg_load_lat, "boot_pg_load_lat",
+    "Time to read one PG's info and log at start");
+  osd_plb.add_time(
+    l_osd_boot_init_lat, "boot_init_lat",
+    "Time from start until the OSD asked to boot");
+  osd_plb.add_time(
+    l_osd_boot_up_lat, "boot_up_lat",
+    "Time from asking to boot until the OSD was up and active");
+
+  osd_plb.add_u64_counter(
+    l_osd_mclock_calibrations, "mclock_calibrations",
+    "Updates of the mclock cost model from measured service times");
+  osd_plb.add_u64(
+    l_osd_mclock_cost_per_io, "mclock_cost_per_io",
+    "Cost of an io charged by mclock, in bytes", NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64(
+    l_osd_mclock_bandwidth, "mclock_bandwidth",
+    "Capacity mclock schedules against, in bytes/second",
+    NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_time(
+    l_osd_mclock_read_io_time, "mclock_read_io_time",
+    "Measured device time per read io");
+  osd_plb.add_time(
+    l_osd_mclock_write_io_time, "mclock_write_io_time",
+    "Measured device time per write io");
+  osd_plb.add_u64(
+    l_osd_mclock_read_bandwidth, "mclock_read_bandwidth",
+    "Measured device read bandwidth, in bytes/second",
+    NULL, 0, unit_t(UNIT_BYTES));
+  osd_plb.add_u64(
+    l_osd_mclock_write_bandwidth, "mclock_write_bandwidth",
+    "Measured device write bandwidth, in bytes/second",
+    NULL, 0, unit_t(UNIT_BYTES));
+
   return osd_plb.create_perf_counters();
 }
  
@@ -42,6 +42,13 @@ enum {
   l_osd_op_before_queue_op_lat,
   l_osd_op_before_dequeue_op_lat,
 
+  l_osd_ec_encode_lat,
+  l_osd_ec_encode_lat_inb_hist,
+  l_osd_ec_decode_lat,
+  l_osd_ec_decode_lat_outb_hist,
+  l_osd_ec_parity_delta,
+  l_osd_ec_parity_delta_fallback,
+
   l_osd_sop,
   l_osd_sop_inb,
   l_osd_sop_lat,
@@ -131,6 +138,20 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_boot_mount_lat,
+  l_osd_boot_load_pgs_lat,
+  l_osd_boot_pg_load_lat,
+  l_osd_boot_init_lat,
+  l_osd_boot_up_lat,
+
+  l_osd_mclock_calibrations,
+  l_osd_mclock_cost_per_io,
+  l_osd_mclock_bandwidth,
+  l_osd_mclock_read_io_time,
+  l_osd_mclock_write_io_time,
+  l_osd_mclock_read_bandwidth,
+  l_osd_mclock_write_bandwidth,
+
   l_osd_last,
 };
 
@@ -2862,6 +2862,7 @@ void pg_stat_t::dump(Formatter *f) const
   f->dump_stream("last_deep_scrub_stamp") << last_deep_scrub_stamp;
   f->dump_stream("last_clean_scrub_stamp") << last_clean_scrub_stamp;
   f->dump_int("objects_scrubbed", objects_scrubbed);
+  f->dump_int("bytes_scrubbed", bytes_scrubbed);
   f->dump_int("log_size", log_size);
   f->dump_int("log_dups_size", log_dups_size);
   f->dump_int("ondisk_log_size", ondisk_log_size);
@@ -2980,7 +2981,7 @@ bool operator==(const pg_scrubbing_status_t& l, const pg_scrubbing_status_t& r)
 
 void pg_stat_t::encode(ceph::buffer::list &bl) const
 {
-  ENCODE_START(29, 22, bl);
+  ENCODE_START(30, 22, bl);
   encode(version, bl);
   encode(reported_seq, bl);
   encode(reported_epoch, bl);
@@ -3040,6 +3041,7 @@ void pg_stat_t::encode(ceph::buffer::list &bl) const
   encode(objects_trimmed, bl);
   encode(snaptrim_duration, bl);
   encode(log_dups_size, bl);
+  encode(bytes_scrubbed, bl);
 
   ENCODE_FINISH(bl);
 }
@@ -3048,7 +3050,7 @@ void pg_stat_t::decode(ceph::buffer::list::const_iterator &bl)
 {
   bool tmp;
   uint32_t old_state;
-  DECODE_START(29, bl);
+  DECODE_START(30, bl);
   decode(version, bl);
   decode(reported_seq, bl);
   decode(reported_epoch, bl);
@@ -3138,6 +3140,9 @@ void pg_stat_t::decode(ceph::buffer::list::const_iterator &bl)
     if (struct_v >= 29) {
       decode(log_dups_size, bl);
     }
+    if (struct_v >= 30) {
+      decode(bytes_scrubbed, bl);
+    }
   }
   DECODE_FINISH(bl);
 }
@@ -3174,6 +3179,7 @@ void pg_stat_t::generate_test_instances(list<pg_stat_t*>& o)
   a.scrub_duration = 0.003;
   a.snaptrimq_len = 1048576;
   a.objects_scrubbed = 0;
+  a.bytes_scrubbed = 0;
   a.objects_trimmed = 0;
   a.snaptrim_duration = 0.123;
   list<object_stat_collection_t*> l;
@@ -3253,6 +3259,7 @@ bool operator==(const pg_stat_t& l, const pg_stat_t& r)
     l.last_scrub_duration == r.last_scrub_duration &&
     l.scrub_sched_status == r.scrub_sched_status &&
     l.objects_scrubbed == r.objects_scrubbed &&
+    l.bytes_scrubbed == r.bytes_scrubbed &&
     l.scrub_duration == r.scrub_duration &&
     l.objects_trimmed == r.objects_trimmed &&
     l.snaptrim_duration == r.snaptrim_duration;
@@ -2216,6 +2216,7 @@ struct pg_stat_t {
   int64_t log_dups_size;
   int64_t ondisk_log_size;    // >= active_log_size
   int64_t objects_scrubbed;
+  int64_t bytes_scrubbed;     // object data read by the current deep scrub
   double scrub_duration;
 
   std::vector<int32_t> up, acting;
@@ -2261,6 +2262,7 @@ struct pg_stat_t {
       log_size(0), log_dups_size(0),
       ondisk_log_size(0),
       objects_scrubbed(0),
+      bytes_scrubbed(0),
       scrub_duration(0),
       mapping_epoch(0),
       up_primary(-1),
@@ -6195,6 +6197,8 @@ struct ScrubMapBuilder {
   ceph::buffer::hash data_hash, omap_hash;  ///< accumulatinng hash value
   uint64_t omap_keys = 0;
   uint64_t omap_bytes = 0;
+  uint64_t slice_budget = 0;  ///< object data a deep scrub may read before yielding
+  uint64_t slice_bytes = 0;   ///< object data read since the last yield
 
   bool empty() {
     return ls.empty();
@@ -6210,6 +6214,18 @@ struct ScrubMapBuilder {
     return data_pos < 0;
   }
 
+  /// start a new slice of work, in which up to 'budget' bytes of object
+  /// data may be read back to back
+  void start_slice(uint64_t budget) {
+    slice_budget = budget;
+    slice_bytes = 0;
+  }
+
+  /// may another stride of the current object be read without yielding?
+  bool slice_has_room() const {
+    return slice_bytes < slice_budget;
+  }
+
   void next_object() {
     ++pos;
     data_pos = 0;
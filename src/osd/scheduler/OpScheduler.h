@@ -54,6 +54,14 @@ public:
   // Apply config changes to the scheduler (if any)
   virtual void update_configuration() = 0;
 
+  // Number of client ops waiting to be scheduled, for background work
+  // to gauge client load by; may be called without the shard lock held
+  virtual uint64_t get_queued_client_ops() const { return 0; }
+
+  // Replace the cost model derived from config with a measured one, see
+  // mClockCalibrator; may be called without the shard lock held
+  virtual void set_capacity_model(double cost_per_io, double bandwidth) {}
+
   // Destructor
   virtual ~OpScheduler() {};
 };
@@ -244,6 +244,16 @@ void PGDelete::run(
   osd->dequeue_delete(sdata, pg.get(), epoch_queued, handle);
 }
 
+void PGRecompress::run(
+  OSD *osd,
+  OSDShard *sdata,
+  PGRef& pg,
+  ThreadPool::TPHandle &handle)
+{
+  pg->recompress_some(epoch_queued, handle);
+  pg->unlock();
+}
+
 void PGRecoveryMsg::run(
   OSD *osd,
   OSDShard *sdata,
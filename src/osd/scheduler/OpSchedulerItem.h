@@ -606,6 +606,30 @@ public:
   }
 };
 
+class PGRecompress : public PGOpQueueable {
+  epoch_t epoch_queued;
+public:
+  PGRecompress(
+    spg_t pg,
+    epoch_t epoch_queued)
+    : PGOpQueueable(pg),
+      epoch_queued(epoch_queued) {}
+  std::ostream &print(std::ostream &rhs) const final {
+    return rhs << "PGRecompress(" << get_pgid()
+	       << " e" << epoch_queued
+	       << ")";
+  }
+  std::string print() const final {
+    return fmt::format(
+	"PGRecompress(pgid={} epoch_queued={})", get_pgid(), epoch_queued);
+  }
+  void run(
+    OSD *osd, OSDShard *sdata, PGRef& pg, ThreadPool::TPHandle &handle) final;
+  op_scheduler_class get_scheduler_class() const final {
+    return op_scheduler_class::background_best_effort;
+  }
+};
+
 class PGRecoveryMsg : public PGOpQueueable {
   utime_t time_queued;
   OpRequestRef op;
@@ -0,0 +1,238 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+
+#include "osd/scheduler/mClockCalibrator.h"
+#include "common/dout.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_mclock
+#undef dout_prefix
+#define dout_prefix *_dout << "mClockCalibrator: "
+
+
+namespace ceph::osd::scheduler {
+
+mClockCalibrator::model_t mClockCalibrator::get_configured_model(
+  CephContext *cct, bool is_rotational)
+{
+  uint64_t bandwidth;
+  double iops;
+  if (is_rotational) {
+    bandwidth = cct->_conf.get_val<Option::size_t>(
+      "osd_mclock_max_sequential_bandwidth_hdd");
+    iops = cct->_conf.get_val<double>("osd_mclock_max_capacity_iops_hdd");
+  } else {
+    bandwidth = cct->_conf.get_val<Option::size_t>(
+      "osd_mclock_max_sequential_bandwidth_ssd");
+    iops = cct->_conf.get_val<double>("osd_mclock_max_capacity_iops_ssd");
+  }
+  bandwidth = std::max<uint64_t>(1, bandwidth);
+  iops = std::max<double>(1.0, iops);
+  return model_t{static_cast<double>(bandwidth) / iops,
+		 static_cast<double>(bandwidth)};
+}
+
+mClockCalibrator::fit_t mClockCalibrator::fit(
+  const io_service_stats_t::buckets_t &buckets,
+  double held_byte_time)
+{
+  // weighted least squares over the buckets' mean op
+  double s11 = 0, s12 = 0, s22 = 0, s1y = 0, s2y = 0;
+  fit_t r;
+  for (auto &b : buckets) {
+    if (!b.ops) {
+      continue;
+    }
+    double n = b.ops;
+    double x1 = b.ios / n;
+    double x2 = b.bytes / n;
+    double y = b.nsec / 1e9 / n;
+    s11 += n * x1 * x1;
+    s12 += n * x1 * x2;
+    s22 += n * x2 * x2;
+    s1y += n * x1 * y;
+    s2y += n * x2 * y;
+    r.ops += b.ops;
+  }
+  if (s11 <= 0) {
+    return r;
+  }
+  double det = s11 * s22 - s12 * s12;
+  if (det > 1e-6 * s11 * s22) {
+    r.io_time = (s1y * s22 - s2y * s12) / det;
+    r.byte_time = (s2y * s11 - s1y * s12) / det;
+  }
+  if (!r.valid() && held_byte_time > 0) {
+    r.byte_time = held_byte_time;
+    r.io_time = (s1y - held_byte_time * s12) / s11;
+  }
+  if (!r.valid()) {
+    r.io_time = r.byte_time = 0;
+  }
+  return r;
+}
+
+bool mClockCalibrator::update(const io_service_stats_t &stats)
+{
+  std::lock_guard l(lock);
+  model_t cfg = get_configured_model(cct, is_rotational);
+  if (cfg.cost_per_io != configured.cost_per_io ||
+      cfg.bandwidth != configured.bandwidth) {
+    // re-benchmarked or set by hand; start over from there
+    dout(1) << __func__ << " configured model changed, restarting" << dendl;
+    configured = current = cfg;
+    read_fit = write_fit = fit_t();
+    base_byte_time = 0;
+  }
+  if (!have_last) {
+    last = stats;
+    have_last = true;
+    return false;
+  }
+
+  auto diff = [](const io_service_stats_t::buckets_t &now,
+		 const io_service_stats_t::buckets_t &then) {
+    io_service_stats_t::buckets_t d;
+    for (unsigned i = 0; i < d.size(); ++i) {
+      d[i].ops = now[i].ops - then[i].ops;
+      d[i].ios = now[i].ios - then[i].ios;
+      d[i].bytes = now[i].bytes - then[i].bytes;
+      d[i].nsec = now[i].nsec - then[i].nsec;
+    }
+    return d;
+  };
+  auto read = diff(stats.read, last.read);
+  auto write = diff(stats.write, last.write);
+  last = stats;
+
+  const uint64_t min_ops =
+    cct->_conf.get_val<uint64_t>("osd_mclock_calibration_min_ops");
+  auto refit = [&](fit_t &f, const io_service_stats_t::buckets_t &d) {
+    // until we know better, assume a byte takes as long as the
+    // configured bandwidth says
+    fit_t n = fit(d, f.valid() ? f.byte_time : 1.0 / configured.bandwidth);
+    f.ops = n.ops;
+    if (n.ops < min_ops || !n.valid()) {
+      return false;
+    }
+    if (!f.valid()) {
+      f.io_time = n.io_time;
+      f.byte_time = n.byte_time;
+    } else {
+      f.io_time += (n.io_time - f.io_time) / 4;
+      f.byte_time += (n.byte_time - f.byte_time) / 4;
+    }
+    return true;
+  };
+  bool r = refit(read_fit, read);
+  bool w = refit(write_fit, write);
+  if (!r && !w) {
+    dout(20) << __func__ << " too few ops to fit, read " << read_fit.ops
+	     << " write " << write_fit.ops << dendl;
+    return false;
+  }
+
+  // mclock has one cost per io for both, so weigh them by their share
+  double rw = read_fit.valid() ? std::max<uint64_t>(read_fit.ops, 1) : 0;
+  double ww = write_fit.valid() ? std::max<uint64_t>(write_fit.ops, 1) : 0;
+  double cost_per_io = 0, byte_time = 0;
+  if (rw) {
+    cost_per_io += rw * read_fit.io_time / read_fit.byte_time;
+    byte_time += rw * read_fit.byte_time;
+  }
+  if (ww) {
+    cost_per_io += ww * write_fit.io_time / write_fit.byte_time;
+    byte_time += ww * write_fit.byte_time;
+  }
+  cost_per_io /= rw + ww;
+  byte_time /= rw + ww;
+  if (base_byte_time == 0) {
+    base_byte_time = byte_time;
+  }
+  model_t target{cost_per_io,
+		 configured.bandwidth * base_byte_time / byte_time};
+
+  const double step =
+    1.0 + cct->_conf.get_val<double>("osd_mclock_calibration_max_step");
+  const double adjust =
+    cct->_conf.get_val<double>("osd_mclock_calibration_max_adjust");
+  auto approach = [&](double cur, double want, double conf) {
+    double next = std::clamp(want, cur / step, cur * step);
+    return std::clamp(next, conf / adjust, conf * adjust);
+  };
+  current.cost_per_io =
+    approach(current.cost_per_io, target.cost_per_io, configured.cost_per_io);
+  current.bandwidth =
+    approach(current.bandwidth, target.bandwidth, configured.bandwidth);
+  ++num_updates;
+  dout(10) << __func__ << " target cost_per_io " << target.cost_per_io
+	   << " bandwidth " << target.bandwidth
+	   << ", now cost_per_io " << current.cost_per_io
+	   << " bandwidth " << current.bandwidth << dendl;
+  return true;
+}
+
+void mClockCalibrator::reset()
+{
+  std::lock_guard l(lock);
+  have_last = false;
+  configured = current = get_configured_model(cct, is_rotational);
+  read_fit = write_fit = fit_t();
+  base_byte_time = 0;
+  num_updates = 0;
+}
+
+mClockCalibrator::model_t mClockCalibrator::get_model() const
+{
+  std::lock_guard l(lock);
+  return current;
+}
+
+mClockCalibrator::fit_t mClockCalibrator::get_fit(bool write) const
+{
+  std::lock_guard l(lock);
+  return write ? write_fit : read_fit;
+}
+
+bool mClockCalibrator::is_calibrated() const
+{
+  std::lock_guard l(lock);
+  return num_updates > 0;
+}
+
+void mClockCalibrator::dump(ceph::Formatter *f) const
+{
+  std::lock_guard l(lock);
+  f->dump_unsigned("updates", num_updates);
+  f->open_object_section("configured");
+  f->dump_float("cost_per_io", configured.cost_per_io);
+  f->dump_float("bandwidth", configured.bandwidth);
+  f->close_section();
+  f->open_object_section("current");
+  f->dump_float("cost_per_io", current.cost_per_io);
+  f->dump_float("bandwidth", current.bandwidth);
+  f->close_section();
+  auto dump_fit = [f](const char *name, const fit_t &fit) {
+    f->open_object_section(name);
+    f->dump_bool("valid", fit.valid());
+    f->dump_float("io_time", fit.io_time);
+    f->dump_float("byte_time", fit.byte_time);
+    f->dump_unsigned("ops", fit.ops);
+    f->close_section();
+  };
+  dump_fit("read", read_fit);
+  dump_fit("write", write_fit);
+}
+
+}
@@ -0,0 +1,104 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
+#include "common/Formatter.h"
+#include "os/ObjectStore.h"
+
+namespace ceph::osd::scheduler {
+
+/**
+ * mClockCalibrator
+ *
+ * mClockScheduler charges each item its size plus a cost per io, against
+ * a capacity in bytes/second.  Both come from config (the capacity in
+ * iops from the benchmark run when the OSD was first started) and go
+ * stale as the device ages or the workload changes.
+ *
+ * The calibrator keeps them up to date from the time the store spends
+ * waiting on its device.  For reads and for writes it fits
+ *
+ *   wait = io_time * ios + byte_time * bytes
+ *
+ * over the store's io_service_stats_t buckets.  io_time / byte_time is
+ * the cost of an io in bytes, and the bandwidth is the configured one
+ * scaled by how far byte_time has moved since the first fit.  The model
+ * in use moves towards the fit by at most osd_mclock_calibration_max_step
+ * per update, and stays within osd_mclock_calibration_max_adjust of the
+ * configured values.
+ */
+class mClockCalibrator {
+public:
+  using io_service_stats_t = ObjectStore::io_service_stats_t;
+
+  struct fit_t {
+    double io_time = 0;    ///< seconds per device io
+    double byte_time = 0;  ///< seconds per byte
+    uint64_t ops = 0;      ///< ops seen by the last update
+
+    bool valid() const {
+      return io_time > 0 && byte_time > 0;
+    }
+  };
+
+  struct model_t {
+    double cost_per_io = 0;  ///< bytes
+    double bandwidth = 0;    ///< bytes/second
+  };
+
+  mClockCalibrator(CephContext *cct, bool is_rotational)
+    : cct(cct), is_rotational(is_rotational) {
+    reset();
+  }
+
+  /// the model osd_mclock_max_* describe
+  static model_t get_configured_model(CephContext *cct, bool is_rotational);
+
+  /**
+   * fit io_time and byte_time to the difference of two samples
+   *
+   * If the buckets can't tell the two apart (e.g. all ios were the same
+   * size), byte_time is held at held_byte_time and only io_time is fit.
+   */
+  static fit_t fit(const io_service_stats_t::buckets_t &buckets,
+		   double held_byte_time);
+
+  /// fold in a new sample of the store's stats; true if the model moved
+  bool update(const io_service_stats_t &stats);
+
+  /// forget what was learnt and go back to the configured model
+  void reset();
+
+  model_t get_model() const;
+  fit_t get_fit(bool write) const;
+  bool is_calibrated() const;
+
+  void dump(ceph::Formatter *f) const;
+
+private:
+  CephContext *cct;
+  const bool is_rotational;
+
+  mutable ceph::mutex lock = ceph::make_mutex("mClockCalibrator::lock");
+  bool have_last = false;
+  io_service_stats_t last;
+  model_t configured;
+  model_t current;
+  fit_t read_fit, write_fit;
+  double base_byte_time = 0;  ///< byte_time of the first fit
+  uint64_t num_updates = 0;
+};
+
+}
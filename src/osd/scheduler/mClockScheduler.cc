@@ -17,6 +17,7 @@
 #include <functional>
 
 #include "osd/scheduler/mClockScheduler.h"
+#include "osd/scheduler/mClockCalibrator.h"
 #include "common/dout.h"
 
 namespace dmc = crimson::dmclock;
@@ -157,29 +158,10 @@ const dmc::ClientInfo *mClockScheduler::ClientRegistry::get_info(
 
 void mClockScheduler::set_osd_capacity_params_from_config()
 {
-  uint64_t osd_bandwidth_capacity;
-  double osd_iop_capacity;
-
-  std::tie(osd_bandwidth_capacity, osd_iop_capacity) = [&, this] {
-    if (is_rotational) {
-      return std::make_tuple(
-        cct->_conf.get_val<Option::size_t>(
-          "osd_mclock_max_sequential_bandwidth_hdd"),
-        cct->_conf.get_val<double>("osd_mclock_max_capacity_iops_hdd"));
-    } else {
-      return std::make_tuple(
-        cct->_conf.get_val<Option::size_t>(
-          "osd_mclock_max_sequential_bandwidth_ssd"),
-        cct->_conf.get_val<double>("osd_mclock_max_capacity_iops_ssd"));
-    }
-  }();
-
-  osd_bandwidth_capacity = std::max<uint64_t>(1, osd_bandwidth_capacity);
-  osd_iop_capacity = std::max<double>(1.0, osd_iop_capacity);
+  auto model = mClockCalibrator::get_configured_model(cct, is_rotational);
 
-  osd_bandwidth_cost_per_io =
-    static_cast<double>(osd_bandwidth_capacity) / osd_iop_capacity;
-  osd_bandwidth_capacity_per_shard = static_cast<double>(osd_bandwidth_capacity)
+  osd_bandwidth_cost_per_io = model.cost_per_io;
+  osd_bandwidth_capacity_per_shard = model.bandwidth
     / static_cast<double>(num_shards);
 
   dout(1) << __func__ << ": osd_bandwidth_cost_per_io: "
@@ -190,6 +172,39 @@ void mClockScheduler::set_osd_capacity_params_from_config()
           << dendl;
 }
 
+void mClockScheduler::set_capacity_model(double cost_per_io, double bandwidth)
+{
+  std::lock_guard l(pending_lock);
+  pending_capacity_model = std::make_pair(cost_per_io, bandwidth);
+  have_pending_capacity_model = true;
+}
+
+void mClockScheduler::apply_pending_capacity_model()
+{
+  std::pair<double, double> model;
+  {
+    std::lock_guard l(pending_lock);
+    have_pending_capacity_model = false;
+    if (!pending_capacity_model) {
+      return;
+    }
+    model = *pending_capacity_model;
+    pending_capacity_model.reset();
+  }
+  osd_bandwidth_cost_per_io = std::max(1.0, model.first);
+  osd_bandwidth_capacity_per_shard = std::max(1.0, model.second)
+    / static_cast<double>(num_shards);
+  client_registry.update_from_config(
+    cct->_conf, osd_bandwidth_capacity_per_shard);
+
+  dout(10) << __func__ << ": osd_bandwidth_cost_per_io: "
+           << std::fixed << std::setprecision(2)
+           << osd_bandwidth_cost_per_io << " bytes/io"
+           << ", osd_bandwidth_capacity_per_shard "
+           << osd_bandwidth_capacity_per_shard << " bytes/second"
+           << dendl;
+}
+
 /**
  * profile_t
  *
@@ -380,10 +395,19 @@ void mClockScheduler::dump(ceph::Formatter &f) const
     f.dump_int("queue_size", it->second.size());
   }
   f.close_section();
+
+  f.open_object_section("capacity");
+  f.dump_float("cost_per_io", osd_bandwidth_cost_per_io);
+  f.dump_float("capacity_per_shard", osd_bandwidth_capacity_per_shard);
+  f.close_section();
 }
 
 void mClockScheduler::enqueue(OpSchedulerItem&& item)
 {
+  if (have_pending_capacity_model) {
+    apply_pending_capacity_model();
+  }
+
   auto id = get_scheduler_id(item);
   unsigned priority = item.get_priority();
   
@@ -400,6 +424,9 @@ void mClockScheduler::enqueue(OpSchedulerItem&& item)
              << " scaled_cost: " << cost
              << dendl;
 
+    if (op_scheduler_class::client == id.class_id) {
+      ++queued_client_ops;
+    }
     // Add item to scheduler queue
     scheduler.add_request(
       std::move(item),
@@ -473,6 +500,9 @@ WorkItem mClockScheduler::dequeue()
       ceph_assert(result.is_retn());
 
       auto &retn = result.get_retn();
+      if (op_scheduler_class::client == retn.request->get_scheduler_class()) {
+	--queued_client_ops;
+      }
       return std::move(*retn.request);
     }
   }
@@ -15,9 +15,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <ostream>
 #include <map>
+#include <optional>
 #include <vector>
 
 #include "boost/variant.hpp"
@@ -27,6 +29,7 @@
 #include "osd/scheduler/OpScheduler.h"
 #include "common/config.h"
 #include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
 #include "common/mClockPriorityQueue.h"
 #include "osd/scheduler/OpSchedulerItem.h"
 
@@ -142,6 +145,19 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
    */
   double osd_bandwidth_capacity_per_shard;
 
+  /**
+   * pending_capacity_model
+   *
+   * Set by set_capacity_model() from outside the shard lock and applied
+   * by the next enqueue().  Replaced again by the values derived from
+   * config when those change.
+   */
+  ceph::mutex pending_lock = ceph::make_mutex("mClockScheduler::pending_lock");
+  std::optional<std::pair<double, double>> pending_capacity_model;
+  std::atomic<bool> have_pending_capacity_model = false;
+
+  void apply_pending_capacity_model();
+
   class ClientRegistry {
     std::array<
       crimson::dmclock::ClientInfo,
@@ -190,6 +206,8 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
    * Invariant: entries are never empty
    */
   SubQueue high_priority;
+  /// client ops in 'scheduler'; read by other threads
+  std::atomic<uint64_t> queued_client_ops = 0;
   priority_t immediate_class_priority = std::numeric_limits<priority_t>::max();
 
   static scheduler_id_t get_scheduler_id(const OpSchedulerItem &item) {
@@ -263,6 +281,12 @@ public:
     ostream << "mClockScheduler";
   }
 
+  uint64_t get_queued_client_ops() const final {
+    return queued_client_ops;
+  }
+
+  void set_capacity_model(double cost_per_io, double bandwidth) final;
+
   // Update data associated with the modified mclock config key(s)
   void update_configuration() final;
 
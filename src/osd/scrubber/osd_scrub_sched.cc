@@ -576,6 +576,43 @@ std::chrono::milliseconds ScrubQueue::scrub_sleep_time(bool must_scrub) const
   return std::max(extended_sleep, regular_sleep_period);
 }
 
+double ScrubQueue::deep_scrub_load_factor() const
+{
+  const auto load_ops =
+    conf().get_val<uint64_t>("osd_deep_scrub_client_load_ops");
+  if (load_ops == 0) {
+    return 1.0;
+  }
+  const auto queued = osd_service.get_queued_client_ops();
+  return 1.0 - std::min(1.0, double(queued) / load_ops);
+}
+
+std::chrono::milliseconds ScrubQueue::deep_scrub_throttle(uint64_t bytes)
+{
+  const double bw_max =
+    conf().get_val<Option::size_t>("osd_deep_scrub_bandwidth_max");
+  if (bw_max == 0 || bytes == 0) {
+    return 0ms;
+  }
+  const double bw_min = std::min(
+    bw_max, double(conf().get_val<Option::size_t>("osd_deep_scrub_bandwidth_min")));
+  const double factor = deep_scrub_load_factor();
+  const double bw = bw_min + (bw_max - bw_min) * factor;
+
+  const auto now = ceph::mono_clock::now();
+  std::lock_guard l{deep_throttle_lock};
+  // no credit for time spent idle: a scrub starting up after a pause
+  // does not get to burst
+  deep_scrub_paid_until = std::max(deep_scrub_paid_until, now) +
+    std::chrono::duration_cast<ceph::timespan>(
+      std::chrono::duration<double>(bytes / bw));
+  auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+    deep_scrub_paid_until - now);
+  dout(20) << __func__ << " " << bytes << " bytes at " << bw
+	   << " B/s (load factor " << factor << "): wait " << delay << dendl;
+  return delay;
+}
+
 bool ScrubQueue::scrub_load_below_threshold() const
 {
   double loadavgs[3];
@@ -158,6 +158,9 @@ class ScrubSchedListener {
     spg_t pgid,
     bool allow_requested_repair_only) = 0;
 
+  /// the number of client ops queued in the OSD's op scheduler
+  virtual uint64_t get_queued_client_ops() const = 0;
+
   virtual ~ScrubSchedListener() {}
 };
 
@@ -406,6 +409,26 @@ class ScrubQueue {
    */
   std::chrono::milliseconds scrub_sleep_time(bool must_scrub) const;
 
+  /**
+   * deep_scrub_load_factor
+   *
+   * The share of their full rate deep scrubs should run at, given the
+   * client ops queued in the op scheduler: from 1.0 with none queued,
+   * down to 0.0 at osd_deep_scrub_client_load_ops.
+   */
+  double deep_scrub_load_factor() const;
+
+  /**
+   * deep_scrub_throttle
+   *
+   * Charges 'bytes' of object data, just read by a deep scrub, against
+   * the OSD-wide deep scrub bandwidth, and returns how long that scrub
+   * should wait before reading more. The bandwidth ranges from
+   * osd_deep_scrub_bandwidth_max down to osd_deep_scrub_bandwidth_min
+   * with the load factor.
+   */
+  std::chrono::milliseconds deep_scrub_throttle(uint64_t bytes);
+
   /**
    *  called every heartbeat to update the "daily" load average
    *
@@ -493,6 +516,14 @@ class ScrubQueue {
 
   std::atomic_bool a_pg_is_reserving{false};
 
+  /// guards deep_scrub_paid_until
+  ceph::mutex deep_throttle_lock =
+    ceph::make_mutex("ScrubQueue::deep_throttle_lock");
+
+  /// when the deep scrub reads charged so far are paid for, at the
+  /// current bandwidth
+  ceph::mono_time deep_scrub_paid_until{};
+
   [[nodiscard]] bool scrub_load_below_threshold() const;
   [[nodiscard]] bool scrub_time_permit(utime_t now) const;
 
@@ -1002,6 +1002,8 @@ void PgScrubber::on_init()
   // going upwards from 'inactive'
   ceph_assert(!is_scrub_active());
   m_pg->reset_objects_scrubbed();
+  m_deep_scrub_bytes = 0;
+  m_deep_scrub_throttled = 0ms;
   preemption_data.reset();
   m_interval_start = m_pg->get_history().same_interval_since;
   dout(10) << __func__ << " start same_interval:" << m_interval_start << dendl;
@@ -1062,9 +1064,26 @@ int PgScrubber::build_primary_map_chunk()
 				   m_end,
 				   m_is_deep);
 
+  if (m_primary_scrubmap_pos.slice_bytes) {
+    m_deep_scrub_bytes += m_primary_scrubmap_pos.slice_bytes;
+    m_pg->add_bytes_scrubbed(m_primary_scrubmap_pos.slice_bytes);
+  }
+  auto delay = deep_scrub_throttle(m_primary_scrubmap_pos);
+  m_deep_scrub_throttled += delay;
+
   if (ret == -EINPROGRESS) {
     // reschedule another round of asking the backend to collect the scrub data
-    m_osds->queue_for_scrub_resched(m_pg, Scrub::scrub_prio_t::low_priority);
+    if (delay > 0ms) {
+      schedule_callback_after(delay, [this, session = m_sessions_counter] {
+	// the scrub may have been aborted meanwhile
+	if (session == m_sessions_counter) {
+	  m_osds->queue_for_scrub_resched(m_pg,
+					  Scrub::scrub_prio_t::low_priority);
+	}
+      });
+    } else {
+      m_osds->queue_for_scrub_resched(m_pg, Scrub::scrub_prio_t::low_priority);
+    }
   }
   return ret;
 }
@@ -1083,6 +1102,7 @@ int PgScrubber::build_replica_map_chunk()
 				   m_start,
 				   m_end,
 				   m_is_deep);
+  auto delay = deep_scrub_throttle(replica_scrubmap_pos);
 
   switch (ret) {
 
@@ -1090,10 +1110,20 @@ int PgScrubber::build_replica_map_chunk()
       // must wait for the backend to finish. No external event source.
       // (note: previous version used low priority here. Now switched to using
       // the priority of the original message)
-      m_osds->queue_for_rep_scrub_resched(m_pg,
-					  m_replica_request_priority,
-					  m_flags.priority,
-					  m_current_token);
+      if (delay > 0ms) {
+	// a stale token is ignored if the request is gone by then
+	schedule_callback_after(
+	  delay,
+	  [this, token = m_current_token, prio = m_replica_request_priority,
+	   qu_prio = m_flags.priority] {
+	    m_osds->queue_for_rep_scrub_resched(m_pg, prio, qu_prio, token);
+	  });
+      } else {
+	m_osds->queue_for_rep_scrub_resched(m_pg,
+					    m_replica_request_priority,
+					    m_flags.priority,
+					    m_current_token);
+      }
       break;
 
     case 0: {
@@ -1142,6 +1172,8 @@ int PgScrubber::build_scrub_map_chunk(ScrubMap& map,
   dout(10) << __func__ << " [" << start << "," << end << ") "
 	   << " pos " << pos << " Deep: " << deep << dendl;
 
+  pos.start_slice(deep ? deep_scrub_slice_budget() : 0);
+
   // start
   while (pos.empty()) {
 
@@ -1190,6 +1222,33 @@ int PgScrubber::build_scrub_map_chunk(ScrubMap& map,
   return 0;
 }
 
+uint64_t PgScrubber::deep_scrub_slice_budget() const
+{
+  const auto stream_bytes =
+    get_pg_cct()->_conf.get_val<Option::size_t>("osd_deep_scrub_stream_bytes");
+  if (stream_bytes == 0) {
+    return 0;
+  }
+  // less of it as the clients get busier, but at least a stride
+  const double factor =
+    m_osds->get_scrub_services().deep_scrub_load_factor();
+  return std::max<uint64_t>(stream_bytes * factor,
+			    get_pg_cct()->_conf->osd_deep_scrub_stride);
+}
+
+std::chrono::milliseconds PgScrubber::deep_scrub_throttle(
+  const ScrubMapBuilder& pos)
+{
+  if (pos.slice_bytes == 0) {
+    return 0ms;
+  }
+  auto delay = m_osds->get_scrub_services().deep_scrub_throttle(
+    pos.slice_bytes);
+  dout(20) << __func__ << " read " << pos.slice_bytes << " bytes, wait "
+	   << delay << dendl;
+  return delay;
+}
+
 /// \todo consider moving repair_oinfo_oid() back to the backend
 void PgScrubber::repair_oinfo_oid(ScrubMap& smap)
 {
@@ -2031,6 +2090,14 @@ void PgScrubber::dump_active_scrubber(ceph::Formatter* f, bool is_deep) const
   f->dump_int("shallow_errors", m_shallow_errors);
   f->dump_int("deep_errors", m_deep_errors);
   f->dump_int("fixed", m_fixed_count);
+  if (is_deep) {
+    f->dump_unsigned("bytes_read", m_deep_scrub_bytes);
+    const double elapsed = ceph_clock_now() - scrub_begin_stamp;
+    f->dump_float("read_bandwidth",
+		  elapsed > 0 ? m_deep_scrub_bytes / elapsed : 0.0);
+    f->dump_float("throttled_seconds",
+		  m_deep_scrub_throttled.count() / 1000.0);
+  }
   {
     f->open_array_section("waiting_on_whom");
     for (const auto& p : m_maps_status.get_awaited()) {
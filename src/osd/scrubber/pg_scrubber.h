@@ -733,6 +733,16 @@ class PgScrubber : public ScrubPgIF,
 			    hobject_t end,
 			    bool deep);
 
+  /// the object data the next slice of a deep scrub may read back to back
+  uint64_t deep_scrub_slice_budget() const;
+
+  /**
+   * charge the object data read in the last slice to the OSD's deep scrub
+   * throttle.
+   * @returns how long to wait before starting the next slice
+   */
+  std::chrono::milliseconds deep_scrub_throttle(const ScrubMapBuilder& pos);
+
   std::unique_ptr<Scrub::ScrubMachine> m_fsm;
   /// the FSM state, as a string for logging
   const char* m_fsm_state_name{nullptr};
@@ -814,6 +824,8 @@ class PgScrubber : public ScrubPgIF,
   int m_shallow_errors{0};
   int m_deep_errors{0};
   int m_fixed_count{0};
+  uint64_t m_deep_scrub_bytes{0};  ///< object data read (primary)
+  std::chrono::milliseconds m_deep_scrub_throttled{0};  ///< and waited for
 
  protected:
   /**
@@ -201,16 +201,31 @@ public:
 	   cb::list& out) override;
 };
 
-std::unique_lock<std::mutex> Objecter::OSDSession::get_lock(object_t& oid)
+Objecter::OSDSession::CompletionTicket
+Objecter::OSDSession::get_completion_ticket(const object_t& oid)
 {
-  if (oid.name.empty())
-    return {};
-
   static constexpr uint32_t HASH_PRIME = 1021;
   uint32_t h = ceph_str_hash_linux(oid.name.c_str(), oid.name.size())
     % HASH_PRIME;
+  CompletionSlot *slot = &completion_slots[h % num_completion_slots];
+  return {slot, slot->next_ticket++};
+}
 
-  return {completion_locks[h % num_locks], std::defer_lock};
+void Objecter::OSDSession::run_completion(CompletionTicket t,
+					  decltype(Op::onfinish)&& onfinish,
+					  int rc)
+{
+  CompletionSlot *slot = t.slot;
+  {
+    std::unique_lock l(slot->lock);
+    slot->cond.wait(l, [slot, &t] { return slot->serving == t.ticket; });
+  }
+  Op::complete(std::move(onfinish), osdcode(rc), rc);
+  {
+    std::lock_guard l(slot->lock);
+    ++slot->serving;
+  }
+  slot->cond.notify_all();
 }
 
 const char** Objecter::get_tracked_conf_keys() const
@@ -1571,6 +1586,7 @@ void Objecter::_check_op_pool_dne(Op *op, std::unique_lock<std::shared_mutex> *s
 	op->complete(osdc_errc::pool_dne, -ENOENT);
       }
 
+      ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
       OSDSession *s = op->session;
       if (s) {
 	ceph_assert(s != NULL);
@@ -1606,6 +1622,7 @@ void Objecter::_check_op_pool_eio(Op *op, std::unique_lock<std::shared_mutex> *s
     op->complete(osdc_errc::pool_eio, -EIO);
   }
 
+  ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
   OSDSession *s = op->session;
   if (s) {
     ceph_assert(s != NULL);
@@ -2513,6 +2530,7 @@ int Objecter::op_cancel(OSDSession *s, ceph_tid_t tid, int r)
     op->complete(osdcode(r), r);
   }
   _op_cancel_map_check(op);
+  ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
   _finish_op(op, r);
   sl.unlock();
 
@@ -3157,6 +3175,7 @@ void Objecter::_cancel_linger_op(Op *op)
     num_in_flight--;
   }
 
+  ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
   _finish_op(op, 0);
 }
 
@@ -3180,7 +3199,9 @@ void Objecter::_finish_op(Op *op, int r)
 
   logger->dec(l_osdc_op_active);
 
-  ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
+  // no check of check_latest_map_ops here: it is changed under rwlock,
+  // which handle_osd_op_reply() does not always hold, so the callers
+  // that do check it
 
   inflight_ops--;
 
@@ -3373,7 +3394,6 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   // get pio
   ceph_tid_t tid = m->get_tid();
 
-  shunique_lock sul(rwlock, ceph::acquire_shared);
   if (!initialized) {
     m->put();
     return;
@@ -3382,13 +3402,28 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   ConnectionRef con = m->get_connection();
   auto priv = con->get_priv();
   auto s = static_cast<OSDSession*>(priv.get());
-  if (!s || s->con != con) {
+  if (!s) {
     ldout(cct, 7) << __func__ << " no session on con " << con << dendl;
     m->put();
     return;
   }
 
-  unique_lock sl(s->lock);
+  // Most replies just finish the op, which only needs the session lock
+  // (s->con is only changed with it held, and ops are only removed from
+  // s->ops with it held).  Replies which make us resubmit the op need
+  // rwlock too, which is ordered before the session lock, so we drop
+  // the session lock and look the op up again with both held.
+  shunique_lock<ceph::shared_mutex> sul(rwlock, std::defer_lock);
+  unique_lock sl(s->lock, std::defer_lock);
+
+ retry:
+  sl.lock();
+  if (s->con != con) {
+    ldout(cct, 7) << __func__ << " no session on con " << con << dendl;
+    sl.unlock();
+    m->put();
+    return;
+  }
 
   map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
   if (iter == s->ops.end()) {
@@ -3409,6 +3444,21 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
 		<< " attempt " << m->get_retry_attempt()
 		<< dendl;
   Op *op = iter->second;
+
+  if (!sul.owns_lock() &&
+      ((retry_writes_after_first_reply && op->attempts == 1 &&
+	(op->target.flags & CEPH_OSD_FLAG_WRITE)) ||
+       m->is_redirect_reply() || m->get_result() == -EAGAIN)) {
+    ldout(cct, 20) << __func__ << " tid " << tid << " needs rwlock" << dendl;
+    sl.unlock();
+    sul.lock_shared();
+    if (!initialized) {
+      m->put();
+      return;
+    }
+    goto retry;
+  }
+
   op->trace.event("osd op reply");
 
   if (retry_writes_after_first_reply && op->attempts == 1 &&
@@ -3482,7 +3532,9 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
-  sul.unlock();
+  if (sul.owns_lock()) {
+    sul.unlock();
+  }
 
   if (op->objver)
     *op->objver = m->get_user_version();
@@ -3572,25 +3624,25 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   logger->set(l_osdc_op_inflight, num_in_flight);
 
   /* get it before we call _finish_op() */
-  auto completion_lock = s->get_lock(op->target.base_oid);
+  OSDSession::CompletionTicket ticket;
+  bool has_completion = Op::has_completion(onfinish);
+  if (has_completion) {
+    ticket = s->get_completion_ticket(op->target.base_oid);
+  }
 
   ldout(cct, 15) << "handle_osd_op_reply completed tid " << tid << dendl;
+  if (sul.owns_lock()) {
+    ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
+  }
   _finish_op(op, 0);
 
   ldout(cct, 5) << num_in_flight << " in flight" << dendl;
 
-  // serialize completions
-  if (completion_lock.mutex()) {
-    completion_lock.lock();
-  }
   sl.unlock();
 
-  // do callbacks
-  if (Op::has_completion(onfinish)) {
-    Op::complete(std::move(onfinish), osdcode(rc), rc);
-  }
-  if (completion_lock.mutex()) {
-    completion_lock.unlock();
+  // do callbacks, serialized per object
+  if (has_completion) {
+    s->run_completion(ticket, std::move(onfinish), rc);
   }
 
   m->put();
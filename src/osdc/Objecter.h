@@ -1740,7 +1740,8 @@ private:
 
   mutable ceph::shared_mutex rwlock =
 	   ceph::make_shared_mutex("Objecter::rwlock");
-  ceph::timer<ceph::coarse_mono_clock> timer;
+  // one event per op with a timeout, nearly all of them cancelled
+  ceph::wheel_timer<ceph::coarse_mono_clock> timer;
 
   PerfCounters* logger = nullptr;
 
@@ -2395,19 +2396,40 @@ public:
 
     int incarnation;
     ConnectionRef con;
-    int num_locks;
-    std::unique_ptr<std::mutex[]> completion_locks;
+
+    // Completions of the replies to an object run in the order the
+    // replies were handled.  A reply takes a ticket from the object's
+    // slot with lock held, and without it waits for the earlier tickets
+    // of the slot to run before it runs its own completion.  No thread
+    // runs a completion it did not queue, and the session lock is never
+    // held while waiting for a completion.
+    struct CompletionSlot {
+      std::mutex lock;
+      std::condition_variable cond;
+      uint64_t next_ticket = 0;  ///< under OSDSession::lock
+      uint64_t serving = 0;      ///< under CompletionSlot::lock
+    };
+    struct CompletionTicket {
+      CompletionSlot *slot = nullptr;
+      uint64_t ticket = 0;
+    };
+    int num_completion_slots;
+    std::unique_ptr<CompletionSlot[]> completion_slots;
 
     OSDSession(CephContext *cct, int o) :
       osd(o), incarnation(0), con(NULL),
-      num_locks(cct->_conf->objecter_completion_locks_per_session),
-      completion_locks(new std::mutex[num_locks]) {}
+      num_completion_slots(cct->_conf->objecter_completion_locks_per_session),
+      completion_slots(new CompletionSlot[num_completion_slots]) {}
 
     ~OSDSession() override;
 
     bool is_homeless() { return (osd == -1); }
 
-    std::unique_lock<std::mutex> get_lock(object_t& oid);
+    /// lock is held
+    CompletionTicket get_completion_ticket(const object_t& oid);
+    /// without lock: run onfinish after the earlier tickets of its slot
+    void run_completion(CompletionTicket t,
+			decltype(Op::onfinish)&& onfinish, int rc);
   };
   std::map<int,OSDSession*> osd_sessions;
 
@@ -1830,7 +1830,10 @@ int RGWRados::Bucket::List::list_objects_ordered(
 					   &cls_filtered,
 					   &cur_marker,
                                            y,
-					   params.force_check_filter);
+					   params.force_check_filter,
+					   cur_end_marker_valid ?
+					     cur_end_marker : rgw_obj_index_key(),
+					   &cursors);
     if (r < 0) {
       return r;
     }
@@ -1933,6 +1936,7 @@ int RGWRados::Bucket::List::list_objects_ordered(
 		  ": stopping early with common prefix \"" << entry.key <<
 		  "\" because requested number (" << max <<
 		  ") reached (cls filtered)" << dendl;
+		cursors.put_back(ent_map, eiter);
 		goto done;
 	      }
 
@@ -1963,6 +1967,7 @@ int RGWRados::Bucket::List::list_objects_ordered(
 		  ": stopping early with common prefix \"" << entry.key <<
 		  "\" because requested number (" << max <<
 		  ") reached (not cls filtered)" << dendl;
+		cursors.put_back(ent_map, eiter);
 		goto done;
 	      }
 	      next_marker = prefix_key;
@@ -1985,6 +1990,8 @@ int RGWRados::Bucket::List::list_objects_ordered(
 	  ": stopping early with entry \"" << entry.key <<
 	  "\" because requested number (" << max <<
 	  ") reached" << dendl;
+	// the rest of this batch starts the next page of this listing
+	cursors.put_back(ent_map, eiter);
         goto done;
       }
 
@@ -8899,6 +8906,15 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(const DoutPrefixProvider *dpp, RGWB
 }
 
 
+// We want to minimize the chances that when num_shards >>
+// num_entries that we return much fewer than num_entries to the
+// client. Given all the overhead of making a cls call to the osd,
+// returning a few entries is not much more work than returning one
+// entry. This minimum might be better tuned based on future
+// experiments where num_shards >> num_entries. (Note: ">>" should
+// be interpreted as "much greater than".)
+static constexpr uint32_t min_ordered_list_read = 8;
+
 // returns 0 if there is an error in calculation
 uint32_t RGWRados::calc_ordered_bucket_list_per_shard(uint32_t num_entries,
 						      uint32_t num_shards)
@@ -8909,15 +8925,6 @@ uint32_t RGWRados::calc_ordered_bucket_list_per_shard(uint32_t num_entries,
     return 0;
   }
 
-  // We want to minimize the chances that when num_shards >>
-  // num_entries that we return much fewer than num_entries to the
-  // client. Given all the overhead of making a cls call to the osd,
-  // returning a few entries is not much more work than returning one
-  // entry. This minimum might be better tuned based on future
-  // experiments where num_shards >> num_entries. (Note: ">>" should
-  // be interpreted as "much greater than".)
-  constexpr uint32_t min_read = 8;
-
   // The following is based on _"Balls into Bins" -- A Simple and
   // Tight Analysis_ by Raab and Steger. We add 1 as a way to handle
   // cases when num_shards >> num_entries (it almost serves as a
@@ -8932,129 +8939,101 @@ uint32_t RGWRados::calc_ordered_bucket_list_per_shard(uint32_t num_entries,
 			  sqrt((2 * num_entries) *
 			       log(num_shards) / num_shards));
 
-  return std::max(min_read, calc_read);
-}
-
-
-int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
-                                      RGWBucketInfo& bucket_info,
-                                      const rgw::bucket_index_layout_generation& idx_layout,
-                                      const int shard_id,
-				      const rgw_obj_index_key& start_after,
-				      const std::string& prefix,
-				      const std::string& delimiter,
-				      const uint32_t num_entries,
-				      const bool list_versions,
-				      const uint16_t expansion_factor,
-				      ent_map_t& m,
-				      bool* is_truncated,
-				      bool* cls_filtered,
-				      rgw_obj_index_key* last_entry,
-                                      optional_yield y,
-				      RGWBucketListNameFilter force_check_filter)
-{
-  const bool bitx = cct->_conf->rgw_bucket_index_transaction_instrumentation;
-
-  /* expansion_factor allows the number of entries to read to grow
-   * exponentially; this is used when earlier reads are producing too
-   * few results, perhaps due to filtering or to a series of
-   * namespaced entries */
-
-  ldout_bitx(bitx, dpp, 10) << "ENTERING " << __func__ << ": " << bucket_info.bucket <<
-    " start_after=\"" << start_after.to_string() <<
-    "\", prefix=\"" << prefix <<
-    ", delimiter=\"" << delimiter <<
-    "\", shard_id=" << shard_id <<
-    "\", num_entries=" << num_entries <<
-    ", shard_id=" << shard_id <<
-    ", list_versions=" << list_versions <<
-    ", expansion_factor=" << expansion_factor <<
-    ", force_check_filter is " <<
-    (force_check_filter ? "set" : "unset") << dendl_bitx;
-  ldout_bitx(bitx, dpp, 25) << "BACKTRACE: " << __func__ << ": " << ClibBackTrace(0) << dendl_bitx;
-
-  m.clear();
-
-  RGWSI_RADOS::Pool index_pool;
-  // key   - oid (for different shards if there is any)
-  // value - list result for the corresponding oid (shard), it is filled by
-  //         the AIO callback
-  std::map<int, std::string> shard_oids;
-  int r = svc.bi_rados->open_bucket_index(dpp, bucket_info, shard_id, idx_layout,
-					  &index_pool, &shard_oids,
-					  nullptr);
-  if (r < 0) {
-    ldpp_dout(dpp, 0) << __func__ <<
-      ": open_bucket_index for " << bucket_info.bucket << " failed" << dendl;
-    return r;
-  }
-
-  const uint32_t shard_count = shard_oids.size();
-  if (shard_count == 0) {
-    ldpp_dout(dpp, 0) << "ERROR: " << __func__ <<
-      ": the bucket index shard count appears to be 0, "
-      "which is an illegal value" << dendl;
-    return -ERR_INVALID_BUCKET_STATE;
-  }
-
-  uint32_t num_entries_per_shard;
-  if (expansion_factor == 0) {
-    num_entries_per_shard =
-      calc_ordered_bucket_list_per_shard(num_entries, shard_count);
-  } else if (expansion_factor <= 11) {
-    // we'll max out the exponential multiplication factor at 1024 (2<<10)
-    num_entries_per_shard =
-      std::min(num_entries,
-	       (uint32_t(1 << (expansion_factor - 1)) *
-		calc_ordered_bucket_list_per_shard(num_entries, shard_count)));
-  } else {
-    num_entries_per_shard = num_entries;
-  }
-
-  if (num_entries_per_shard == 0) {
-    ldpp_dout(dpp, 0) << "ERROR: " << __func__ <<
-      ": unable to calculate the number of entries to read from each "
-      "bucket index shard" << dendl;
-    return -ERR_INVALID_BUCKET_STATE;
+  return std::max(min_ordered_list_read, calc_read);
+}
+
+
+bool RGWBucketListCursors::can_resume(
+  int _shard_id,
+  const std::string& _prefix,
+  const std::string& _delimiter,
+  const rgw_obj_index_key& _end_key,
+  bool _list_versions,
+  const rgw_obj_index_key& start_after,
+  const std::map<int, std::string>& shard_oids,
+  ceph::coarse_mono_time now) const
+{
+  if (shard_id != _shard_id ||
+      prefix != _prefix ||
+      delimiter != _delimiter ||
+      end_key != _end_key ||
+      list_versions != _list_versions ||
+      position != start_after ||
+      now - stamp > max_age ||
+      shards.size() != shard_oids.size()) {
+    return false;
+  }
+  for (const auto& [id, oid] : shard_oids) {
+    auto s = shards.find(id);
+    if (s == shards.end() || s->second.oid != oid) {
+      return false;
+    }
   }
-
-  ldpp_dout(dpp, 10) << __func__ <<
-    ": request from each of " << shard_count <<
-    " shard(s) for " << num_entries_per_shard << " entries to get " <<
-    num_entries << " total entries" << dendl;
-
-  auto& ioctx = index_pool.ioctx();
-  std::map<int, rgw_cls_list_ret> shard_list_results;
-  cls_rgw_obj_key start_after_key(start_after.name, start_after.instance);
-  r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
-			    num_entries_per_shard,
-			    list_versions, shard_oids, shard_list_results,
-			    cct->_conf->rgw_bucket_index_max_aio)();
-  if (r < 0) {
-    ldpp_dout(dpp, 0) << __func__ <<
-      ": CLSRGWIssueBucketList for " << bucket_info.bucket <<
-      " failed" << dendl;
-    return r;
+  return true;
+}
+
+void RGWBucketListCursors::reset(
+  int _shard_id,
+  const std::string& _prefix,
+  const std::string& _delimiter,
+  const rgw_obj_index_key& _end_key,
+  bool _list_versions,
+  const rgw_obj_index_key& start_after,
+  const std::map<int, std::string>& shard_oids,
+  uint32_t batch,
+  ceph::coarse_mono_time now)
+{
+  clear();
+  for (const auto& [id, oid] : shard_oids) {
+    auto& shard = shards[id];
+    shard.oid = oid;
+    shard.marker = cls_rgw_obj_key(start_after.name, start_after.instance);
+    shard.batch = batch;
+  }
+  start = position = start_after;
+  stamp = now;
+  shard_id = _shard_id;
+  prefix = _prefix;
+  delimiter = _delimiter;
+  end_key = _end_key;
+  list_versions = _list_versions;
+}
+
+int RGWBucketListCursors::merge(
+  const DoutPrefixProvider* dpp,
+  uint32_t num_entries,
+  ent_map_t& m,
+  bool* is_truncated,
+  std::optional<rgw_obj_index_key>* last_visited,
+  const check_entry_t& check)
+{
+  // entries handed back sort before anything the shards still hold, so
+  // they go first
+  uint32_t count = 0;
+  {
+    auto i = put_back_entries.begin();
+    for (; i != put_back_entries.end() && count < num_entries; ++i) {
+      *last_visited = i->second.key;
+      m.insert_or_assign(m.end(), i->first, std::move(i->second));
+      ++count;
+    }
+    put_back_entries.erase(put_back_entries.begin(), i);
   }
 
-  // to manage the iterators through each shard's list results
+  // to manage the iterators through each shard's pending entries
   struct ShardTracker {
     const size_t shard_idx;
-    rgw_cls_list_ret& result;
-    const std::string& oid_name;
-    RGWRados::ent_map_t::iterator cursor;
-    RGWRados::ent_map_t::iterator end;
+    Shard& shard;
+    ent_map_t::iterator cursor;
+    ent_map_t::iterator end;
 
     // manages an iterator through a shard and provides other
     // accessors
-    ShardTracker(size_t _shard_idx,
-		 rgw_cls_list_ret& _result,
-		 const std::string& _oid_name):
+    ShardTracker(size_t _shard_idx, Shard& _shard):
       shard_idx(_shard_idx),
-      result(_result),
-      oid_name(_oid_name),
-      cursor(_result.dir.m.begin()),
-      end(_result.dir.m.end())
+      shard(_shard),
+      cursor(_shard.pending.begin()),
+      end(_shard.pending.end())
     {}
 
     inline const std::string& entry_name() const {
@@ -9064,7 +9043,7 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       return cursor->second;
     }
     inline bool is_truncated() const {
-      return result.is_truncated;
+      return shard.is_truncated;
     }
     inline ShardTracker& advance() {
       ++cursor;
@@ -9078,7 +9057,7 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
   }; // ShardTracker
 
   // add the next unique candidate, or return false if we reach the end
-  auto next_candidate = [] (CephContext *cct, ShardTracker& t,
+  auto next_candidate = [] (ShardTracker& t,
                             std::multimap<std::string, size_t>& candidates,
                             size_t tracker_idx) {
     if (!t.at_end()) {
@@ -9087,19 +9066,13 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     return;
   };
 
-  // one tracker per shard requested (may not be all shards)
+  // one tracker per shard that has entries to merge
   std::vector<ShardTracker> results_trackers;
-  results_trackers.reserve(shard_list_results.size());
-  for (auto& r : shard_list_results) {
-    results_trackers.emplace_back(r.first, r.second, shard_oids[r.first]);
-
-    // if any *one* shard's result is trucated, the entire result is
-    // truncated
-    *is_truncated = *is_truncated || r.second.is_truncated;
-
-    // unless *all* are shards are cls_filtered, the entire result is
-    // not filtered
-    *cls_filtered = *cls_filtered && r.second.cls_filtered;
+  results_trackers.reserve(shards.size());
+  for (auto& [id, shard] : shards) {
+    if (!shard.pending.empty()) {
+      results_trackers.emplace_back(id, shard);
+    }
   }
 
   // create a map to track the next candidate entry from ShardTracker
@@ -9109,21 +9082,16 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
   std::multimap<std::string, size_t> candidates;
   size_t tracker_idx = 0;
   std::vector<size_t> vidx;
-  vidx.reserve(shard_list_results.size());
+  vidx.reserve(results_trackers.size());
   for (auto& t : results_trackers) {
     // it's important that the values in the map refer to the index
-    // into the results_trackers vector, which may not be the same
-    // as the shard number (i.e., when not all shards are requested)
-    next_candidate(cct, t, candidates, tracker_idx);
+    // into the results_trackers vector, which is not the same as the
+    // shard number
+    next_candidate(t, candidates, tracker_idx);
     ++tracker_idx;
   }
 
-  rgw_bucket_dir_entry*
-    last_entry_visited = nullptr; // to set last_entry (marker)
-  std::map<std::string, bufferlist> updates;
-  uint32_t count = 0;
   while (count < num_entries && !candidates.empty()) {
-    r = 0;
     // select the next entry in lexical order (first key in map);
     // again tracker_idx is not necessarily shard number, but is index
     // into results_trackers vector
@@ -9136,35 +9104,13 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     ldpp_dout(dpp, 20) << __func__ << ": currently processing " <<
       dirent.key << " from shard " << tracker.shard_idx << dendl;
 
-    const bool force_check =
-      force_check_filter && force_check_filter(dirent.key.name);
-
-    if ((!dirent.exists &&
-	 !dirent.is_delete_marker() &&
-	 !dirent.is_common_prefix()) ||
-        !dirent.pending_map.empty() ||
-        force_check) {
-      /* there are uncommitted ops. We need to check the current
-       * state, and if the tags are old we need to do clean-up as
-       * well. */
-      librados::IoCtx sub_ctx;
-      sub_ctx.dup(ioctx);
-      ldout_bitx(bitx, dpp, 20) << "INFO: " << __func__ <<
-	" calling check_disk_state bucket=" << bucket_info.bucket <<
-	" entry=" << dirent.key << dendl_bitx;
-      r = check_disk_state(dpp, sub_ctx, bucket_info, dirent, dirent,
-			   updates[tracker.oid_name], y);
-      if (r < 0 && r != -ENOENT) {
-	ldpp_dout(dpp, 0) << __func__ <<
-	  ": check_disk_state for \"" << dirent.key <<
-	  "\" failed with r=" << r << dendl;
-	return r;
-      }
-    } else {
-      r = 0;
+    int r = check(tracker.shard, dirent);
+    if (r < 0 && r != -ENOENT) {
+      return r;
     }
 
     const cls_rgw_obj_key dirent_key = dirent.key;
+    *last_visited = dirent_key;
 
     // at this point either r >= 0 or r == -ENOENT
     if (r >= 0) { // i.e., if r != -ENOENT
@@ -9172,7 +9118,6 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
 	dirent_key << dendl;
 
       auto [it, inserted] = m.insert_or_assign(name, std::move(dirent));
-      last_entry_visited = &it->second;
       if (inserted) {
 	++count;
       } else {
@@ -9183,7 +9128,6 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     } else {
       ldpp_dout(dpp, 10) << __func__ << ": skipping " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
-      last_entry_visited = &tracker.dir_entry();
     }
 
     // refresh the candidates map
@@ -9197,7 +9141,7 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     for (auto idx : vidx) {
       auto& tracker_match = results_trackers.at(idx);
       tracker_match.advance();
-      next_candidate(cct, tracker_match, candidates, idx);
+      next_candidate(tracker_match, candidates, idx);
       if (tracker_match.at_end() && tracker_match.is_truncated()) {
         need_to_stop = true;
         break;
@@ -9216,6 +9160,245 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     }
   } // while we haven't provided requested # of result entries
 
+  // drop what was merged, and size each shard's next read by how much
+  // it contributed: a shard that ran dry is asked for more next time,
+  // one that contributed little of what it returned is asked for less
+  for (auto& t : results_trackers) {
+    auto& shard = t.shard;
+    const uint32_t consumed = t.cursor - shard.pending.begin();
+    shard.pending.erase(shard.pending.begin(), t.cursor);
+    if (shard.pending.empty()) {
+      if (shard.is_truncated) {
+	shard.batch = std::min(std::max(num_entries, min_ordered_list_read),
+			       shard.batch * 2);
+      }
+    } else if (consumed < shard.batch / 4) {
+      shard.batch = std::max(min_ordered_list_read, shard.batch / 2);
+    }
+    ldpp_dout(dpp, 20) << __func__ << ": shard " << t.shard_idx <<
+      " contributed " << consumed << " entries, holds " <<
+      shard.pending.size() << ", next batch " << shard.batch << dendl;
+  }
+
+  // determine truncation by checking if all the read entries are
+  // consumed or not
+  *is_truncated = !put_back_entries.empty();
+  for (const auto& [id, shard] : shards) {
+    if (!shard.pending.empty() || shard.is_truncated) {
+      *is_truncated = true;
+      break;
+    }
+  }
+  position = last_visited->value_or(start);
+  return 0;
+}
+
+int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
+                                      RGWBucketInfo& bucket_info,
+                                      const rgw::bucket_index_layout_generation& idx_layout,
+                                      const int shard_id,
+				      const rgw_obj_index_key& start_after,
+				      const std::string& prefix,
+				      const std::string& delimiter,
+				      const uint32_t num_entries,
+				      const bool list_versions,
+				      const uint16_t expansion_factor,
+				      ent_map_t& m,
+				      bool* is_truncated,
+				      bool* cls_filtered,
+				      rgw_obj_index_key* last_entry,
+                                      optional_yield y,
+				      RGWBucketListNameFilter force_check_filter,
+				      const rgw_obj_index_key& end_key,
+				      RGWBucketListCursors* cursors)
+{
+  const bool bitx = cct->_conf->rgw_bucket_index_transaction_instrumentation;
+
+  /* expansion_factor allows the number of entries to read to grow
+   * exponentially; this is used when earlier reads are producing too
+   * few results, perhaps due to filtering or to a series of
+   * namespaced entries */
+
+  ldout_bitx(bitx, dpp, 10) << "ENTERING " << __func__ << ": " << bucket_info.bucket <<
+    " start_after=\"" << start_after.to_string() <<
+    "\", prefix=\"" << prefix <<
+    ", delimiter=\"" << delimiter <<
+    "\", shard_id=" << shard_id <<
+    "\", num_entries=" << num_entries <<
+    ", shard_id=" << shard_id <<
+    ", list_versions=" << list_versions <<
+    ", expansion_factor=" << expansion_factor <<
+    ", end_key=\"" << end_key.to_string() <<
+    "\", force_check_filter is " <<
+    (force_check_filter ? "set" : "unset") <<
+    ", cursors are " << (cursors ? "set" : "unset") << dendl_bitx;
+  ldout_bitx(bitx, dpp, 25) << "BACKTRACE: " << __func__ << ": " << ClibBackTrace(0) << dendl_bitx;
+
+  m.clear();
+
+  RGWSI_RADOS::Pool index_pool;
+  // key   - oid (for different shards if there is any)
+  // value - list result for the corresponding oid (shard), it is filled by
+  //         the AIO callback
+  std::map<int, std::string> shard_oids;
+  int r = svc.bi_rados->open_bucket_index(dpp, bucket_info, shard_id, idx_layout,
+					  &index_pool, &shard_oids,
+					  nullptr);
+  if (r < 0) {
+    ldpp_dout(dpp, 0) << __func__ <<
+      ": open_bucket_index for " << bucket_info.bucket << " failed" << dendl;
+    return r;
+  }
+
+  const uint32_t shard_count = shard_oids.size();
+  if (shard_count == 0) {
+    ldpp_dout(dpp, 0) << "ERROR: " << __func__ <<
+      ": the bucket index shard count appears to be 0, "
+      "which is an illegal value" << dendl;
+    return -ERR_INVALID_BUCKET_STATE;
+  }
+
+  // state left by an earlier call can only serve this one if it is
+  // the same listing, picks up exactly where the state left off and is
+  // recent; the index layout may also have changed under a long-lived
+  // listing
+  RGWBucketListCursors local_cursors;
+  RGWBucketListCursors& state = cursors ? *cursors : local_cursors;
+  const auto now = ceph::coarse_mono_clock::now();
+  if (!state.empty() &&
+      !state.can_resume(shard_id, prefix, delimiter, end_key, list_versions,
+			start_after, shard_oids, now)) {
+    ldpp_dout(dpp, 20) << __func__ <<
+      ": discarding listing state at \"" << state.position <<
+      "\" for listing after \"" << start_after << "\"" << dendl;
+    state.clear();
+  }
+
+  if (state.empty()) {
+    uint32_t num_entries_per_shard;
+    if (expansion_factor == 0) {
+      num_entries_per_shard =
+	calc_ordered_bucket_list_per_shard(num_entries, shard_count);
+    } else if (expansion_factor <= 11) {
+      // we'll max out the exponential multiplication factor at 1024 (2<<10)
+      num_entries_per_shard =
+	std::min(num_entries,
+		 (uint32_t(1 << (expansion_factor - 1)) *
+		  calc_ordered_bucket_list_per_shard(num_entries, shard_count)));
+    } else {
+      num_entries_per_shard = num_entries;
+    }
+
+    if (num_entries_per_shard == 0) {
+      ldpp_dout(dpp, 0) << "ERROR: " << __func__ <<
+	": unable to calculate the number of entries to read from each "
+	"bucket index shard" << dendl;
+      return -ERR_INVALID_BUCKET_STATE;
+    }
+
+    ldpp_dout(dpp, 10) << __func__ <<
+      ": request from each of " << shard_count <<
+      " shard(s) for " << num_entries_per_shard << " entries to get " <<
+      num_entries << " total entries" << dendl;
+
+    state.reset(shard_id, prefix, delimiter, end_key, list_versions,
+		start_after, shard_oids, num_entries_per_shard, now);
+  }
+  state.start = start_after;
+
+  // only read the shards that ran dry, each from its own marker and
+  // with its own batch size; entries the caller handed back sort before
+  // anything the shards still hold, so they may be enough
+  auto& ioctx = index_pool.ioctx();
+  std::map<int, std::string> read_oids;
+  std::map<int, cls_rgw_bucket_list_cursor> read_cursors;
+  if (state.put_back_entries.size() < num_entries) {
+    for (const auto& [id, shard] : state.shards) {
+      if (shard.pending.empty() && shard.is_truncated) {
+	read_oids[id] = shard.oid;
+	read_cursors[id] = {shard.marker, shard.batch};
+      }
+    }
+  }
+  if (!read_oids.empty()) {
+    ldpp_dout(dpp, 20) << __func__ << ": reading " << read_oids.size() <<
+      " of " << shard_count << " shard(s)" << dendl;
+
+    std::map<int, rgw_cls_list_ret> shard_list_results;
+    cls_rgw_obj_key start_after_key(start_after.name, start_after.instance);
+    r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
+			      num_entries, list_versions, read_oids,
+			      shard_list_results,
+			      cct->_conf->rgw_bucket_index_max_aio,
+			      end_key, &read_cursors)();
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << __func__ <<
+	": CLSRGWIssueBucketList for " << bucket_info.bucket <<
+	" failed" << dendl;
+      state.clear();
+      return r;
+    }
+
+    for (auto& [id, result] : shard_list_results) {
+      auto& shard = state.shards.at(id);
+      shard.pending = std::move(result.dir.m);
+      shard.is_truncated = result.is_truncated;
+      if (result.is_truncated) {
+	// older osds do not return a marker; resume after the last
+	// entry they returned instead
+	if (!result.marker.empty()) {
+	  shard.marker = result.marker;
+	} else if (!shard.pending.empty()) {
+	  shard.marker = shard.pending.rbegin()->second.key;
+	}
+      }
+      // unless *all* are shards are cls_filtered, the entire result is
+      // not filtered
+      shard.cls_filtered = shard.cls_filtered && result.cls_filtered;
+    }
+  }
+
+  for (const auto& [id, shard] : state.shards) {
+    *cls_filtered = *cls_filtered && shard.cls_filtered;
+  }
+
+  std::map<std::string, bufferlist> updates;
+  auto check = [&] (const RGWBucketListCursors::Shard& shard,
+		    rgw_bucket_dir_entry& dirent) {
+    const bool force_check =
+      force_check_filter && force_check_filter(dirent.key.name);
+
+    if ((!dirent.exists &&
+	 !dirent.is_delete_marker() &&
+	 !dirent.is_common_prefix()) ||
+        !dirent.pending_map.empty() ||
+        force_check) {
+      /* there are uncommitted ops. We need to check the current
+       * state, and if the tags are old we need to do clean-up as
+       * well. */
+      librados::IoCtx sub_ctx;
+      sub_ctx.dup(ioctx);
+      ldout_bitx(bitx, dpp, 20) << "INFO: " << __func__ <<
+	" calling check_disk_state bucket=" << bucket_info.bucket <<
+	" entry=" << dirent.key << dendl_bitx;
+      int r = check_disk_state(dpp, sub_ctx, bucket_info, dirent, dirent,
+			       updates[shard.oid], y);
+      if (r < 0 && r != -ENOENT) {
+	ldpp_dout(dpp, 0) << __func__ <<
+	  ": check_disk_state for \"" << dirent.key <<
+	  "\" failed with r=" << r << dendl;
+      }
+      return r;
+    }
+    return 0;
+  };
+  std::optional<rgw_obj_index_key> last_key_visited; // to set last_entry
+  r = state.merge(dpp, num_entries, m, is_truncated, &last_key_visited, check);
+  if (r < 0) {
+    state.clear();
+    return r;
+  }
+
   // suggest updates if there are any
   for (auto& miter : updates) {
     if (miter.second.length()) {
@@ -9232,15 +9415,7 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     }
   } // updates loop
 
-  // determine truncation by checking if all the returned entries are
-  // consumed or not
-  *is_truncated = false;
-  for (const auto& t : results_trackers) {
-    if (!t.at_end() || t.is_truncated()) {
-      *is_truncated = true;
-      break;
-    }
-  }
+  const uint32_t count = m.size();
 
   ldpp_dout(dpp, 20) << __func__ <<
     ": returning, count=" << count << ", is_truncated=" << *is_truncated <<
@@ -9252,8 +9427,8 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       count << ", which is truncated" << dendl;
   }
 
-  if (last_entry_visited != nullptr && last_entry) {
-    *last_entry = last_entry_visited->key;
+  if (last_key_visited && last_entry) {
+    *last_entry = *last_key_visited;
     ldpp_dout(dpp, 20) << __func__ <<
       ": returning, last_entry=" << *last_entry << dendl;
   } else {
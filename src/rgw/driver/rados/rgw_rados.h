@@ -260,6 +260,96 @@ struct RGWListRawObjsCtx {
   RGWListRawObjsCtx() : initialized(false) {}
 };
 
+/* State of an ordered bucket listing carried from one call of
+ * RGWRados::cls_bucket_list_ordered() to the next: per index shard, the
+ * entries read but not merged yet, the marker to resume reading at and
+ * how many entries to ask for next time, plus merged entries that the
+ * caller read but did not consume and handed back.  Everything up to
+ * and including 'position' has been consumed, so the state can only
+ * serve a later call that starts right there, and only while what it
+ * holds is recent. */
+struct RGWBucketListCursors {
+  using ent_map_t =
+    boost::container::flat_map<std::string, rgw_bucket_dir_entry>;
+  // entries held longer than this may have changed in the index
+  static constexpr ceph::timespan max_age = std::chrono::seconds(10);
+
+  struct Shard {
+    std::string oid;
+    cls_rgw_obj_key marker;
+    ent_map_t pending;
+    bool is_truncated = true;
+    bool cls_filtered = true;
+    uint32_t batch = 0;
+  };
+  std::map<int, Shard> shards;
+  ent_map_t put_back_entries;
+
+  rgw_obj_index_key start;
+  rgw_obj_index_key position;
+  ceph::coarse_mono_time stamp;  ///< when the shards were first read
+
+  // the listing the state belongs to
+  int shard_id = -1;
+  std::string prefix;
+  std::string delimiter;
+  rgw_obj_index_key end_key;
+  bool list_versions = false;
+
+  bool empty() const {
+    return shards.empty();
+  }
+  void clear() {
+    shards.clear();
+    put_back_entries.clear();
+  }
+
+  /// whether the state can serve the listing after start_after at now
+  bool can_resume(int shard_id, const std::string& prefix,
+		  const std::string& delimiter,
+		  const rgw_obj_index_key& end_key, bool list_versions,
+		  const rgw_obj_index_key& start_after,
+		  const std::map<int, std::string>& shard_oids,
+		  ceph::coarse_mono_time now) const;
+
+  /// start a listing after start_after, reading batch entries per shard
+  void reset(int shard_id, const std::string& prefix,
+	     const std::string& delimiter,
+	     const rgw_obj_index_key& end_key, bool list_versions,
+	     const rgw_obj_index_key& start_after,
+	     const std::map<int, std::string>& shard_oids, uint32_t batch,
+	     ceph::coarse_mono_time now);
+
+  /* Called for each entry merge() is about to return; returns -ENOENT
+   * to skip it or another negative error to fail the merge. */
+  using check_entry_t =
+    std::function<int(const Shard&, rgw_bucket_dir_entry&)>;
+
+  /* Move up to num_entries entries into m in order: those handed back
+   * first, then those the shards hold, until one shard that may have
+   * more runs dry.  Sets *last_visited to the last entry looked at,
+   * which becomes the position, and resizes each shard's next batch by
+   * how much it contributed. */
+  int merge(const DoutPrefixProvider* dpp, uint32_t num_entries,
+	    ent_map_t& m, bool* is_truncated,
+	    std::optional<rgw_obj_index_key>* last_visited,
+	    const check_entry_t& check);
+
+  // hand back the entries of the last result from 'first' on
+  void put_back(ent_map_t& m, ent_map_t::iterator first) {
+    if (first == m.begin()) {
+      position = start;
+    } else {
+      position = std::prev(first)->second.key;
+    }
+    for (auto i = first; i != m.end(); ++i) {
+      put_back_entries.insert_or_assign(put_back_entries.end(), i->first,
+					std::move(i->second));
+    }
+    m.erase(first, m.end());
+  }
+};
+
 struct objexp_hint_entry {
   std::string tenant;
   std::string bucket_name;
@@ -995,6 +1085,7 @@ public:
 
       RGWRados::Bucket *target;
       rgw_obj_key next_marker;
+      RGWBucketListCursors cursors;
 
       int list_objects_ordered(const DoutPrefixProvider *dpp,
                                int64_t max,
@@ -1440,7 +1531,9 @@ public:
 			      bool* cls_filtered,
 			      rgw_obj_index_key *last_entry,
                               optional_yield y,
-			      RGWBucketListNameFilter force_check_filter = {});
+			      RGWBucketListNameFilter force_check_filter = {},
+			      const rgw_obj_index_key& end_key = {},
+			      RGWBucketListCursors* cursors = nullptr);
   int cls_bucket_list_unordered(const DoutPrefixProvider *dpp,
                                 RGWBucketInfo& bucket_info,
                                 const rgw::bucket_index_layout_generation& idx_layout,
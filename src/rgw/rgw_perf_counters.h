@@ -28,6 +28,8 @@ enum {
 
   l_rgw_cache_hit,
   l_rgw_cache_miss,
+  l_rgw_cache_shm_hit,
+  l_rgw_cache_shm_miss,
 
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
@@ -0,0 +1,398 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include "rgw_shm_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <thread>
+
+#include "common/dout.h"
+#include "common/errno.h"
+#include "include/ceph_hash.h"
+#include "include/intarith.h"
+
+#define dout_subsys ceph_subsys_rgw
+#undef dout_prefix
+#define dout_prefix *_dout << "rgw shm cache: "
+
+using namespace std;
+
+static constexpr uint64_t SHM_CACHE_MAGIC = 0x31656863616377ull; // "wcache1"
+static constexpr uint32_t SHM_CACHE_VERSION = 1;
+static constexpr size_t SHM_CACHE_ALIGN = 4096;
+
+// how many times invalidate() retries a slot that a writer holds; a
+// writer holds a slot only for a memcpy, so running out means the
+// writer died with the slot locked
+static constexpr int SHM_CACHE_LOCK_RETRIES = 1000;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+	      "the shared table needs address-free atomics");
+
+struct RGWShmCache::header_t {
+  std::atomic<uint64_t> magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint64_t num_sets;
+  uint32_t ways;
+  char fsid[64];
+  std::atomic<uint64_t> epoch;	// bumped by clear()
+};
+
+struct RGWShmCache::slot_t {
+  std::atomic<uint64_t> seq;	// odd while a writer owns the slot
+  uint64_t hash;
+  uint64_t stamp;		// mono clock when filled, in ns
+  uint64_t epoch;		// header epoch when filled
+  uint32_t key_len;		// 0 if the slot is empty
+  uint32_t val_len;
+  // followed by key_len bytes of name and val_len bytes of encoded
+  // ObjectCacheInfo
+
+  char *payload() {
+    return reinterpret_cast<char*>(this) + sizeof(*this);
+  }
+};
+
+RGWShmCache::~RGWShmCache()
+{
+  close();
+}
+
+int RGWShmCache::open(const string& path, uint64_t size, uint32_t _slot_size,
+		      const string& fsid)
+{
+  ceph_assert(!is_open());
+  if (_slot_size < sizeof(slot_t) + 256 || _slot_size % 64) {
+    ldout(cct, 0) << "ERROR: invalid slot size " << _slot_size << dendl;
+    return -EINVAL;
+  }
+  slot_size = _slot_size;
+  num_sets = size / (uint64_t(slot_size) * ways);
+  if (num_sets == 0) {
+    ldout(cct, 0) << "ERROR: size " << size << " is too small for "
+		  << ways << " slots of " << slot_size << " bytes" << dendl;
+    return -EINVAL;
+  }
+  const size_t gens_len = p2roundup(num_sets * sizeof(std::atomic<uint64_t>),
+				    SHM_CACHE_ALIGN);
+  map_size = SHM_CACHE_ALIGN + gens_len + num_sets * ways * slot_size;
+
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    int r = -errno;
+    ldout(cct, 0) << "ERROR: failed to open " << path << ": "
+		  << cpp_strerror(r) << dendl;
+    return r;
+  }
+
+  // the first process to get here sets the table up; the others wait
+  // for it and then check that they agree on its layout
+  if (::flock(fd, LOCK_EX) < 0) {
+    int r = -errno;
+    ldout(cct, 0) << "ERROR: failed to lock " << path << ": "
+		  << cpp_strerror(r) << dendl;
+    close();
+    return r;
+  }
+
+  int r = 0;
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    r = -errno;
+  } else if (st.st_size == 0 && ::ftruncate(fd, map_size) < 0) {
+    r = -errno;
+  } else if (st.st_size != 0 && (size_t)st.st_size != map_size) {
+    // the table may be mapped by running processes, so never resize it
+    ldout(cct, 0) << "ERROR: " << path << " is " << st.st_size
+		  << " bytes but the configuration needs " << map_size
+		  << "; remove it once no radosgw uses it" << dendl;
+    r = -EINVAL;
+  }
+  if (r == 0) {
+    base = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      base = nullptr;
+      r = -errno;
+    }
+  }
+  if (r < 0) {
+    if (r != -EINVAL) {
+      ldout(cct, 0) << "ERROR: failed to map " << path << ": "
+		    << cpp_strerror(r) << dendl;
+    }
+    ::flock(fd, LOCK_UN);
+    close();
+    return r;
+  }
+
+  header = static_cast<header_t*>(base);
+  set_gens = reinterpret_cast<std::atomic<uint64_t>*>(
+    static_cast<char*>(base) + SHM_CACHE_ALIGN);
+  slots = static_cast<char*>(base) + SHM_CACHE_ALIGN + gens_len;
+
+  if (header->magic.load(std::memory_order_acquire) != SHM_CACHE_MAGIC) {
+    // new, or its creator died before finishing; nobody can be using
+    // it since the magic is only set once it is ready
+    memset(base, 0, map_size);
+    header->version = SHM_CACHE_VERSION;
+    header->slot_size = slot_size;
+    header->num_sets = num_sets;
+    header->ways = ways;
+    strncpy(header->fsid, fsid.c_str(), sizeof(header->fsid) - 1);
+    header->magic.store(SHM_CACHE_MAGIC, std::memory_order_release);
+    ldout(cct, 1) << "created " << path << " with " << get_num_slots()
+		  << " slots of " << slot_size << " bytes" << dendl;
+  } else if (header->version != SHM_CACHE_VERSION ||
+	     header->slot_size != slot_size ||
+	     header->num_sets != num_sets ||
+	     header->ways != ways ||
+	     strncmp(header->fsid, fsid.c_str(), sizeof(header->fsid)) != 0) {
+    ldout(cct, 0) << "ERROR: " << path << " was set up by a radosgw with a "
+		  << "different version, layout or cluster fsid ("
+		  << header->fsid << ")" << dendl;
+    ::flock(fd, LOCK_UN);
+    close();
+    return -EINVAL;
+  } else {
+    // nobody may have been watching for invalidations while we were
+    // away, so don't trust what the table holds
+    clear();
+    ldout(cct, 1) << "attached to " << path << " with " << get_num_slots()
+		  << " slots of " << slot_size << " bytes" << dendl;
+  }
+  ::flock(fd, LOCK_UN);
+  return 0;
+}
+
+void RGWShmCache::close()
+{
+  if (base) {
+    ::munmap(base, map_size);
+    base = nullptr;
+  }
+  header = nullptr;
+  set_gens = nullptr;
+  slots = nullptr;
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+uint64_t RGWShmCache::hash(const string& name) const
+{
+  return (uint64_t(ceph_str_hash_rjenkins(name.data(), name.size())) << 32) |
+    ceph_str_hash_linux(name.data(), name.size());
+}
+
+RGWShmCache::slot_t *RGWShmCache::get_slot(uint64_t set, uint32_t way) const
+{
+  return reinterpret_cast<slot_t*>(slots + (set * ways + way) * slot_size);
+}
+
+bool RGWShmCache::lock_slot(slot_t *slot, uint64_t *seq)
+{
+  uint64_t s = slot->seq.load(std::memory_order_relaxed);
+  if (s & 1) {
+    return false;
+  }
+  if (!slot->seq.compare_exchange_strong(s, s + 1, std::memory_order_acq_rel)) {
+    return false;
+  }
+  *seq = s + 1;
+  return true;
+}
+
+void RGWShmCache::unlock_slot(slot_t *slot, uint64_t seq)
+{
+  slot->seq.store(seq + 1, std::memory_order_release);
+}
+
+int RGWShmCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask,
+		     ceph::timespan expiry)
+{
+  if (!is_open()) {
+    return -ENOENT;
+  }
+  const uint64_t h = hash(name);
+  const uint64_t set = h % num_sets;
+  const uint32_t max_len = slot_size - sizeof(slot_t);
+  const uint32_t key_len = name.size();
+  const uint64_t epoch = header->epoch.load(std::memory_order_acquire);
+
+  for (uint32_t way = 0; way < ways; ++way) {
+    slot_t *slot = get_slot(set, way);
+    const uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    if ((seq & 1) || slot->hash != h || slot->key_len != key_len ||
+	slot->epoch != epoch) {
+      continue;
+    }
+    const uint32_t val_len = slot->val_len;
+    const uint64_t stamp = slot->stamp;
+    if (val_len > max_len - key_len) {
+      continue; // torn by a writer
+    }
+    // copy the slot out, then check that no writer touched it meanwhile
+    bufferptr bp = buffer::create(key_len + val_len);
+    memcpy(bp.c_str(), slot->payload(), key_len + val_len);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    if (memcmp(bp.c_str(), name.data(), key_len) != 0) {
+      continue;
+    }
+    if (expiry.count() &&
+	ceph::mono_clock::now() - ceph::mono_time(std::chrono::nanoseconds(stamp)) > expiry) {
+      return -ENOENT;
+    }
+
+    bufferlist bl;
+    bl.append(bp, key_len, val_len);
+    ObjectCacheInfo found;
+    try {
+      auto p = bl.cbegin();
+      decode(found, p);
+    } catch (const buffer::error& e) {
+      ldout(cct, 0) << "ERROR: failed to decode entry for " << name << dendl;
+      return -ENOENT;
+    }
+    if ((found.flags & mask) != mask) {
+      return -ENOENT;
+    }
+    info = std::move(found);
+    return 0;
+  }
+  return -ENOENT;
+}
+
+uint64_t RGWShmCache::begin_fill(const string& name) const
+{
+  if (!is_open()) {
+    return 0;
+  }
+  return set_gens[hash(name) % num_sets].load(std::memory_order_acquire);
+}
+
+bool RGWShmCache::put(const string& name, const ObjectCacheInfo& info,
+		      uint64_t fill_gen)
+{
+  if (!is_open() || info.status < 0) {
+    return false;
+  }
+  bufferlist bl;
+  encode(info, bl);
+  const uint32_t max_len = slot_size - sizeof(slot_t);
+  if (name.size() + bl.length() > max_len) {
+    ldout(cct, 20) << "entry for " << name << " does not fit a slot" << dendl;
+    return false;
+  }
+
+  const uint64_t h = hash(name);
+  const uint64_t set = h % num_sets;
+  auto& gen = set_gens[set];
+  if (gen.load(std::memory_order_acquire) != fill_gen) {
+    return false;
+  }
+
+  // reuse the slot holding this name, else an empty one, else the
+  // one filled longest ago; slots from before a clear() count as empty
+  const uint64_t cur_epoch = header->epoch.load(std::memory_order_acquire);
+  auto is_empty = [cur_epoch](const slot_t *slot) {
+    return slot->key_len == 0 || slot->epoch != cur_epoch;
+  };
+  slot_t *victim = nullptr;
+  for (uint32_t way = 0; way < ways; ++way) {
+    slot_t *slot = get_slot(set, way);
+    if (slot->hash == h && slot->key_len == name.size()) {
+      victim = slot;
+      break;
+    }
+    if (!victim ||
+	(!is_empty(victim) &&
+	 (is_empty(slot) || slot->stamp < victim->stamp))) {
+      victim = slot;
+    }
+  }
+
+  uint64_t seq;
+  if (!lock_slot(victim, &seq)) {
+    return false;
+  }
+  // clear() bumps every generation before the epoch, so an epoch read
+  // before the generation check below is either the one clear() is
+  // about to retire, or the check fails
+  const uint64_t epoch = header->epoch.load(std::memory_order_seq_cst);
+  // invalidate() bumps the generation before it visits the slots, so
+  // seeing it unchanged once we own the slot means any invalidation
+  // still to come will find what we write
+  if (gen.load(std::memory_order_seq_cst) != fill_gen) {
+    victim->hash = 0;
+    victim->key_len = 0;
+    unlock_slot(victim, seq);
+    return false;
+  }
+  victim->hash = h;
+  victim->stamp = ceph::mono_clock::now().time_since_epoch().count();
+  victim->epoch = epoch;
+  victim->key_len = name.size();
+  victim->val_len = bl.length();
+  memcpy(victim->payload(), name.data(), name.size());
+  bl.cbegin().copy(bl.length(), victim->payload() + name.size());
+  unlock_slot(victim, seq);
+  return true;
+}
+
+void RGWShmCache::invalidate(const string& name)
+{
+  if (!is_open()) {
+    return;
+  }
+  const uint64_t h = hash(name);
+  const uint64_t set = h % num_sets;
+  set_gens[set].fetch_add(1, std::memory_order_acq_rel);
+
+  for (uint32_t way = 0; way < ways; ++way) {
+    slot_t *slot = get_slot(set, way);
+    uint64_t seq;
+    int retries = 0;
+    while (!lock_slot(slot, &seq)) {
+      if (++retries == SHM_CACHE_LOCK_RETRIES) {
+	break;
+      }
+      std::this_thread::yield();
+    }
+    if (retries == SHM_CACHE_LOCK_RETRIES) {
+      ldout(cct, 1) << "WARNING: slot " << set * ways + way
+		    << " is stuck locked, skipping it" << dendl;
+      continue;
+    }
+    if (slot->hash == h && slot->key_len == name.size() &&
+	memcmp(slot->payload(), name.data(), name.size()) == 0) {
+      slot->hash = 0;
+      slot->key_len = 0;
+    }
+    unlock_slot(slot, seq);
+  }
+}
+
+void RGWShmCache::clear()
+{
+  if (!is_open()) {
+    return;
+  }
+  // fills in flight drop their put, then everything already in the
+  // table stops matching the epoch
+  for (uint64_t set = 0; set < num_sets; ++set) {
+    set_gens[set].fetch_add(1, std::memory_order_seq_cst);
+  }
+  header->epoch.fetch_add(1, std::memory_order_seq_cst);
+  ldout(cct, 10) << "cleared " << get_num_slots() << " slots" << dendl;
+}
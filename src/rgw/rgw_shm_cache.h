@@ -0,0 +1,89 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "include/common_fwd.h"
+#include "common/ceph_time.h"
+#include "rgw_cache.h"
+
+/*
+ * A host-local tier under ObjectCache, shared by the radosgw processes
+ * on one node through a file they all mmap.
+ *
+ * The file holds a set-associative hash table of fixed size slots.
+ * Each slot carries the cache name and the encoded ObjectCacheInfo,
+ * and is protected by a seqlock: a writer moves the slot sequence from
+ * even to odd with a compare-and-swap, fills it and releases it at the
+ * next even value; readers copy the slot out and retry or give up if
+ * the sequence moved under them.  Writers never wait for each other,
+ * a put that finds its slot busy is simply dropped.
+ *
+ * Each set also has an invalidation generation.  A process samples it
+ * with begin_fill() before reading an object from RADOS and passes it
+ * to put(); if the object was invalidated anywhere on the host in the
+ * meantime the put is dropped, so a slow reader cannot publish a copy
+ * older than a concurrent update.
+ *
+ * clear() drops the whole table at once by bumping an epoch in the
+ * header that every slot records when filled, after bumping every
+ * set's generation so no fill in flight survives it.
+ */
+class RGWShmCache {
+public:
+  struct header_t;
+  struct slot_t;
+
+  explicit RGWShmCache(CephContext *cct) : cct(cct) {}
+  ~RGWShmCache();
+
+  RGWShmCache(const RGWShmCache&) = delete;
+  RGWShmCache& operator=(const RGWShmCache&) = delete;
+
+  /// map the table at path, creating it if needed and clearing it
+  /// otherwise; fails if its geometry or cluster fsid do not match
+  int open(const std::string& path, uint64_t size, uint32_t slot_size,
+	   const std::string& fsid);
+  void close();
+  bool is_open() const {
+    return header != nullptr;
+  }
+
+  /// 0 on a hit that has all the flags in mask, -ENOENT otherwise
+  int get(const std::string& name, ObjectCacheInfo& info, uint32_t mask,
+	  ceph::timespan expiry);
+
+  uint64_t begin_fill(const std::string& name) const;
+  /// publish info for name unless name was invalidated since the
+  /// begin_fill() that returned fill_gen, or info does not fit a slot
+  bool put(const std::string& name, const ObjectCacheInfo& info,
+	   uint64_t fill_gen);
+  void invalidate(const std::string& name);
+  /// drop every entry, for all the processes sharing the table
+  void clear();
+
+  uint64_t get_num_slots() const {
+    return num_sets * ways;
+  }
+
+private:
+  CephContext *cct;
+  int fd = -1;
+  void *base = nullptr;
+  size_t map_size = 0;
+
+  header_t *header = nullptr;
+  std::atomic<uint64_t> *set_gens = nullptr;
+  char *slots = nullptr;
+  uint32_t slot_size = 0;
+  uint64_t num_sets = 0;
+  static constexpr uint32_t ways = 4;
+
+  uint64_t hash(const std::string& name) const;
+  slot_t *get_slot(uint64_t set, uint32_t way) const;
+  bool lock_slot(slot_t *slot, uint64_t *seq);
+  void unlock_slot(slot_t *slot, uint64_t seq);
+};
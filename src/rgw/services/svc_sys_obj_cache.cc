@@ -3,6 +3,7 @@
 // vim: ts=8 sw=2 smarttab ft=cpp
 
 #include "common/admin_socket.h"
+#include "common/errno.h"
 
 #include "svc_sys_obj_cache.h"
 #include "svc_zone.h"
@@ -10,6 +11,7 @@
 
 #include "rgw_zone.h"
 #include "rgw_tools.h"
+#include "rgw_perf_counters.h"
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -52,6 +54,23 @@ int RGWSI_SysObj_Cache::do_start(optional_yield y, const DoutPrefixProvider *dpp
 
   assert(notify_svc->is_started());
 
+  const uint64_t shm_size =
+    cct->_conf.get_val<Option::size_t>("rgw_cache_shm_size");
+  if (shm_size > 0) {
+    shm_cache = std::make_unique<RGWShmCache>(cct);
+    r = shm_cache->open(cct->_conf.get_val<std::string>("rgw_cache_shm_path"),
+                        shm_size,
+                        cct->_conf.get_val<Option::size_t>("rgw_cache_shm_slot_size"),
+                        rados_svc->cluster_fsid());
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << "WARNING: running without the host shared metadata cache: "
+                        << cpp_strerror(r) << dendl;
+      shm_cache.reset();
+    }
+    shm_cache_expiry = std::chrono::seconds(
+      cct->_conf.get_val<uint64_t>("rgw_cache_expiry_interval"));
+  }
+
   cb.reset(new RGWSI_SysObj_Cache_CB(this));
 
   notify_svc->register_watch_cb(cb.get());
@@ -63,6 +82,7 @@ void RGWSI_SysObj_Cache::shutdown()
 {
   asocket.shutdown();
   RGWSI_SysObj_Core::shutdown();
+  shm_cache_enabled = false;
 }
 
 static string normal_name(rgw_pool& pool, const std::string& oid) {
@@ -96,6 +116,7 @@ int RGWSI_SysObj_Cache::remove(const DoutPrefixProvider *dpp,
 
   string name = normal_name(pool, oid);
   cache.invalidate_remove(dpp, name);
+  shm_cache_invalidate(name);
 
   ObjectCacheInfo info;
   int r = distribute_cache(dpp, name, obj, info, INVALIDATE_OBJ, y);
@@ -139,7 +160,12 @@ int RGWSI_SysObj_Cache::read(const DoutPrefixProvider *dpp,
   if (attrs)
     flags |= CACHE_FLAG_XATTRS;
   
+  uint64_t fill_gen = 0;
   int r = cache.get(dpp, name, info, flags, cache_info);
+  if (r == -ENOENT &&
+      shm_cache_get(dpp, name, info, flags, cache_info, &fill_gen)) {
+    r = 0;
+  }
   if (r == 0 &&
       (!refresh_version || !info.version.compare(&(*refresh_version)))) {
     if (info.status < 0)
@@ -171,6 +197,11 @@ int RGWSI_SysObj_Cache::read(const DoutPrefixProvider *dpp,
   }
   if(r == -ENODATA)
     return -ENOENT;
+  if (r == 0 && shm_cache_enabled) {
+    // a hit older than refresh_version; it may have come from the
+    // local tier, which never sampled the shared one
+    fill_gen = shm_cache->begin_fill(name);
+  }
 
   // if we only ask for one of mtime or size, ask for the other too so we can
   // satisfy CACHE_FLAG_META
@@ -232,6 +263,7 @@ int RGWSI_SysObj_Cache::read(const DoutPrefixProvider *dpp,
     }
   }
   cache.put(dpp, name, info, cache_info);
+  shm_cache_put(dpp, name, info, fill_gen);
   return r;
 }
 
@@ -251,7 +283,12 @@ int RGWSI_SysObj_Cache::get_attr(const DoutPrefixProvider *dpp,
 
   uint32_t flags = CACHE_FLAG_XATTRS;
 
+  uint64_t fill_gen = 0;
   int r = cache.get(dpp, name, info, flags, nullptr);
+  if (r == -ENOENT &&
+      shm_cache_get(dpp, name, info, flags, nullptr, &fill_gen)) {
+    r = 0;
+  }
   if (r == 0) {
     if (info.status < 0)
       return info.status;
@@ -300,6 +337,7 @@ int RGWSI_SysObj_Cache::set_attrs(const DoutPrefixProvider *dpp,
       ldpp_dout(dpp, 0) << "ERROR: failed to distribute cache for " << obj << dendl;
   } else {
     cache.invalidate_remove(dpp, name);
+    shm_cache_invalidate(name);
   }
 
   return ret;
@@ -344,6 +382,7 @@ int RGWSI_SysObj_Cache::write(const DoutPrefixProvider *dpp,
       ldpp_dout(dpp, 0) << "ERROR: failed to distribute cache for " << obj << dendl;
   } else {
     cache.invalidate_remove(dpp, name);
+    shm_cache_invalidate(name);
   }
 
   return ret;
@@ -379,6 +418,7 @@ int RGWSI_SysObj_Cache::write_data(const DoutPrefixProvider *dpp,
       ldpp_dout(dpp, 0) << "ERROR: failed to distribute cache for " << obj << dendl;
   } else {
     cache.invalidate_remove(dpp, name);
+    shm_cache_invalidate(name);
   }
 
   return ret;
@@ -403,7 +443,12 @@ int RGWSI_SysObj_Cache::raw_stat(const DoutPrefixProvider *dpp, const rgw_raw_ob
   uint32_t flags = CACHE_FLAG_META | CACHE_FLAG_XATTRS;
   if (objv_tracker)
     flags |= CACHE_FLAG_OBJV;
+  uint64_t fill_gen = 0;
   int r = cache.get(dpp, name, info, flags, NULL);
+  if (r == -ENOENT &&
+      shm_cache_get(dpp, name, info, flags, nullptr, &fill_gen)) {
+    r = 0;
+  }
   if (r == 0) {
     if (info.status < 0)
       return info.status;
@@ -435,6 +480,7 @@ int RGWSI_SysObj_Cache::raw_stat(const DoutPrefixProvider *dpp, const rgw_raw_ob
     info.version = objv_tracker->read_version;
   }
   cache.put(dpp, name, info, NULL);
+  shm_cache_put(dpp, name, info, fill_gen);
 done:
   if (psize)
     *psize = size;
@@ -451,6 +497,10 @@ int RGWSI_SysObj_Cache::distribute_cache(const DoutPrefixProvider *dpp,
                                          ObjectCacheInfo& obj_info, int op,
                                          optional_yield y)
 {
+  // the other processes on this host drop it when the notification
+  // reaches them, but our own next read should not find it either
+  shm_cache_invalidate(normal_name);
+
   RGWCacheNotifyInfo info;
   info.op = op;
   info.obj_info = obj_info;
@@ -482,12 +532,16 @@ int RGWSI_SysObj_Cache::watch_cb(const DoutPrefixProvider *dpp,
   normalize_pool_and_obj(info.obj.pool, info.obj.oid, pool, oid);
   string name = normal_name(pool, oid);
   
+  // the shared tier only holds whole objects as read from rados, so
+  // updates invalidate it rather than patch it
   switch (info.op) {
   case UPDATE_OBJ:
     cache.put(dpp, name, info.obj_info, NULL);
+    shm_cache_invalidate(name);
     break;
   case INVALIDATE_OBJ:
     cache.invalidate_remove(dpp, name);
+    shm_cache_invalidate(name);
     break;
   default:
     ldpp_dout(dpp, 0) << "WARNING: got unknown notification op: " << info.op << dendl;
@@ -500,6 +554,61 @@ int RGWSI_SysObj_Cache::watch_cb(const DoutPrefixProvider *dpp,
 void RGWSI_SysObj_Cache::set_enabled(bool status)
 {
   cache.set_enabled(status);
+  // without notifications we would miss invalidations, and could
+  // publish stale entries to the other processes; by the same token
+  // whatever was published while a watch was down (including across
+  // a reconnect) can't be trusted once they are back
+  if (status && shm_cache) {
+    shm_cache->clear();
+  }
+  shm_cache_enabled = status && shm_cache;
+}
+
+bool RGWSI_SysObj_Cache::shm_cache_get(const DoutPrefixProvider *dpp,
+                                       const string& name,
+                                       ObjectCacheInfo& info, uint32_t flags,
+                                       rgw_cache_entry_info *cache_info,
+                                       uint64_t *fill_gen)
+{
+  if (!shm_cache_enabled) {
+    return false;
+  }
+  // sample the generation before the caller goes to rados, so an
+  // invalidation racing with that read keeps its result out
+  *fill_gen = shm_cache->begin_fill(name);
+  if (shm_cache->get(name, info, flags, shm_cache_expiry) < 0) {
+    ldpp_dout(dpp, 10) << "shm cache get: name=" << name << " : miss" << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_cache_shm_miss);
+    }
+    return false;
+  }
+  ldpp_dout(dpp, 10) << "shm cache get: name=" << name << " : hit" << dendl;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_cache_shm_hit);
+  }
+  cache.put(dpp, name, info, cache_info);
+  return true;
+}
+
+void RGWSI_SysObj_Cache::shm_cache_put(const DoutPrefixProvider *dpp,
+                                       const string& name,
+                                       const ObjectCacheInfo& info,
+                                       uint64_t fill_gen)
+{
+  if (!shm_cache_enabled) {
+    return;
+  }
+  if (shm_cache->put(name, info, fill_gen)) {
+    ldpp_dout(dpp, 10) << "shm cache put: name=" << name << dendl;
+  }
+}
+
+void RGWSI_SysObj_Cache::shm_cache_invalidate(const string& name)
+{
+  if (shm_cache) {
+    shm_cache->invalidate(name);
+  }
 }
 
 bool RGWSI_SysObj_Cache::chain_cache_entry(const DoutPrefixProvider *dpp,
@@ -660,11 +769,15 @@ int RGWSI_SysObj_Cache::ASocketHandler::call_inspect(const std::string& target,
 
 int RGWSI_SysObj_Cache::ASocketHandler::call_erase(const std::string& target)
 {
+  svc->shm_cache_invalidate(target);
   return svc->cache.invalidate_remove(dpp, target);
 }
 
 int RGWSI_SysObj_Cache::ASocketHandler::call_zap()
 {
+  if (svc->shm_cache) {
+    svc->shm_cache->clear();
+  }
   svc->cache.invalidate_all();
   return 0;
 }
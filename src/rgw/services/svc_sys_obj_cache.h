@@ -6,6 +6,7 @@
 #include "common/RWLock.h"
 #include "rgw_service.h"
 #include "rgw_cache.h"
+#include "rgw_shm_cache.h"
 
 #include "svc_sys_obj_core.h"
 
@@ -23,9 +24,22 @@ class RGWSI_SysObj_Cache : public RGWSI_SysObj_Core
   RGWSI_Notify *notify_svc{nullptr};
   ObjectCache cache;
 
+  // host-local tier shared with the other radosgw processes, only
+  // consulted while the notifications that invalidate it are flowing
+  std::unique_ptr<RGWShmCache> shm_cache;
+  std::atomic<bool> shm_cache_enabled{false};
+  ceph::timespan shm_cache_expiry;
+
   std::shared_ptr<RGWSI_SysObj_Cache_CB> cb;
 
   void normalize_pool_and_obj(const rgw_pool& src_pool, const std::string& src_obj, rgw_pool& dst_pool, std::string& dst_obj);
+
+  bool shm_cache_get(const DoutPrefixProvider *dpp, const std::string& name,
+                     ObjectCacheInfo& info, uint32_t flags,
+                     rgw_cache_entry_info *cache_info, uint64_t *fill_gen);
+  void shm_cache_put(const DoutPrefixProvider *dpp, const std::string& name,
+                     const ObjectCacheInfo& info, uint64_t fill_gen);
+  void shm_cache_invalidate(const std::string& name);
 protected:
   void init(RGWSI_RADOS *_rados_svc,
             RGWSI_Zone *_zone_svc,
@@ -118,7 +118,8 @@ static int basic_timer_test(T &timer, ceph::mutex *lock)
   return ret;
 }
 
-static int test_out_of_order_insertion(SafeTimer &timer, ceph::mutex *lock)
+template <typename T>
+static int test_out_of_order_insertion(T &timer, ceph::mutex *lock)
 {
   int ret = 0;
   memset(&test_array, 0, sizeof(test_array));
@@ -161,7 +162,8 @@ static int test_out_of_order_insertion(SafeTimer &timer, ceph::mutex *lock)
   return ret;
 }
 
-static int safe_timer_cancel_all_test(SafeTimer &safe_timer,
+template <typename T>
+static int safe_timer_cancel_all_test(T &safe_timer,
                                       ceph::mutex& safe_timer_lock)
 {
   cout << __PRETTY_FUNCTION__ << std::endl;
@@ -199,7 +201,8 @@ static int safe_timer_cancel_all_test(SafeTimer &safe_timer,
   return ret;
 }
 
-static int safe_timer_cancellation_test(SafeTimer &safe_timer,
+template <typename T>
+static int safe_timer_cancellation_test(T &safe_timer,
                                         ceph::mutex& safe_timer_lock)
 {
   cout << __PRETTY_FUNCTION__ << std::endl;
@@ -244,10 +247,11 @@ static int safe_timer_cancellation_test(SafeTimer &safe_timer,
   return ret;
 }
 
+template <typename T>
 class TestLoopContext : public Context
 {
 public:
-  explicit TestLoopContext(SafeTimer &_t,
+  explicit TestLoopContext(T &_t,
                            ceph::mono_clock::time_point _deadline,
                            double _interval,
                            bool& _test_finished)
@@ -278,13 +282,14 @@ public:
   }
 
 protected:
-  SafeTimer &t;
+  T &t;
   ceph::mono_clock::time_point deadline;
   double interval;
   bool& test_finished;
 };
 
-static int safe_timer_loop_test(SafeTimer &safe_timer,
+template <typename T>
+static int safe_timer_loop_test(T &safe_timer,
                                 ceph::mutex& safe_timer_lock) {
   // TODO: consider using gtest.
   cout << __PRETTY_FUNCTION__ << std::endl;
@@ -294,7 +299,7 @@ static int safe_timer_loop_test(SafeTimer &safe_timer,
   double tick_interval = 0.00004;
   auto deadline = ceph::mono_clock::now() +
                   std::chrono::seconds(test_duration);
-  TestLoopContext* ctx = new TestLoopContext(
+  auto ctx = new TestLoopContext<T>(
     safe_timer,
     deadline,
     tick_interval,
@@ -310,21 +315,13 @@ static int safe_timer_loop_test(SafeTimer &safe_timer,
   }
 }
 
-int main(int argc, const char **argv)
+template <typename T>
+static int run_tests(T &safe_timer, ceph::mutex& safe_timer_lock)
 {
-  auto args = argv_to_vec(argc, argv);
-
-  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
-                         CODE_ENVIRONMENT_UTILITY,
-			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
-  common_init_finish(g_ceph_context);
-
   int ret;
-  ceph::mutex safe_timer_lock = ceph::make_mutex("safe_timer_lock");
-  SafeTimer safe_timer(g_ceph_context, safe_timer_lock);
   safe_timer.init();
 
-  ret = basic_timer_test <SafeTimer>(safe_timer, &safe_timer_lock);
+  ret = basic_timer_test <T>(safe_timer, &safe_timer_lock);
   if (ret)
     goto done;
 
@@ -345,7 +342,30 @@ int main(int argc, const char **argv)
     goto done;
 
 done:
+  std::lock_guard l{safe_timer_lock};
   safe_timer.shutdown();
+  return ret;
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+                         CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  int ret;
+  ceph::mutex safe_timer_lock = ceph::make_mutex("safe_timer_lock");
+  {
+    SafeTimer safe_timer(g_ceph_context, safe_timer_lock);
+    ret = run_tests(safe_timer, safe_timer_lock);
+  }
+  if (ret == 0) {
+    WheelTimer wheel_timer(g_ceph_context, safe_timer_lock);
+    ret = run_tests(wheel_timer, safe_timer_lock);
+  }
   print_status(argv[0], ret);
   return ret;
 }
@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Throughput of Finisher vs. ShardedFinisher with many threads queueing
+ * completions at once.  Every context checks that it completes after
+ * the previous one of its producer.
+ */
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "common/Finisher.h"
+#include "common/Clock.h"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+
+using namespace std;
+
+struct Producer {
+  uint64_t completed = 0;  // only touched by the finisher thread
+  bool out_of_order = false;
+};
+
+struct C_Count : public Context {
+  Producer *p;
+  uint64_t seq;
+  C_Count(Producer *p, uint64_t seq) : p(p), seq(seq) {}
+  void finish(int) override {
+    if (p->completed != seq) {
+      p->out_of_order = true;
+    }
+    p->completed = seq + 1;
+  }
+};
+
+template <typename F>
+bool run(const char *name, F& fin, int threads, int num, int batch)
+{
+  fin.start();
+  vector<Producer> producers(threads);
+
+  utime_t start = ceph_clock_now();
+  vector<std::thread> ts;
+  for (int i = 0; i < threads; i++) {
+    ts.emplace_back([&fin, &p = producers[i], num, batch] {
+      if (batch <= 1) {
+	for (int n = 0; n < num; n++) {
+	  fin.queue(new C_Count(&p, n));
+	}
+	return;
+      }
+      list<Context*> ls;
+      for (int n = 0; n < num; n++) {
+	ls.push_back(new C_Count(&p, n));
+	if ((int)ls.size() == batch) {
+	  fin.queue(ls);
+	}
+      }
+      fin.queue(ls);
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  utime_t queued = ceph_clock_now() - start;
+  fin.wait_for_empty();
+  utime_t done = ceph_clock_now() - start;
+  fin.stop();
+
+  bool ok = true;
+  for (auto& p : producers) {
+    if (p.out_of_order || p.completed != (uint64_t)num) {
+      ok = false;
+    }
+  }
+  uint64_t total = (uint64_t)threads * num;
+  cout << name << ": queued " << total << " in " << queued
+       << " (" << (uint64_t)(total / (double)queued) << "/s), completed in "
+       << done << " (" << (uint64_t)(total / (double)done) << "/s)"
+       << (ok ? "" : ", OUT OF ORDER OR LOST") << std::endl;
+  return ok;
+}
+
+void usage(const char *name) {
+  cout << name << " <threads> <contexts> [batch] [shards]\n"
+       << "\t threads: the number of threads queueing contexts.\n"
+       << "\t contexts: the number of contexts queued by each thread.\n"
+       << "\t batch: queue lists of this many contexts (default 1).\n"
+       << "\t shards: shards of the ShardedFinisher (default "
+       << ShardedFinisher::DEFAULT_SHARDS << ").\n";
+}
+
+int main(int argc, const char **argv)
+{
+  if (argc < 3) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  int threads = atoi(argv[1]);
+  int num = atoi(argv[2]);
+  int batch = argc > 3 ? atoi(argv[3]) : 1;
+  unsigned shards = argc > 4 ? atoi(argv[4]) : ShardedFinisher::DEFAULT_SHARDS;
+
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  cout << threads << " threads, " << num << " contexts per thread, batch "
+       << batch << ", " << shards << " shards" << std::endl;
+
+  bool ok = true;
+  {
+    Finisher fin(g_ceph_context, "bench", "fn_bench");
+    ok = run("Finisher", fin, threads, num, batch) && ok;
+  }
+  {
+    ShardedFinisher fin(g_ceph_context, "bench_sharded", "fn_bench", shards);
+    ok = run("ShardedFinisher", fin, threads, num, batch) && ok;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
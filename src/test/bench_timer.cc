@@ -0,0 +1,197 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Scheduling cost of the multimap timers (SafeTimer, ceph::timer)
+ * against their timing wheel counterparts (WheelTimer,
+ * ceph::wheel_timer) with lots of timers pending:
+ *
+ *  - schedule: add <pending> timeouts between 10s and 1h out
+ *  - churn:    with those pending, add and cancel <churn> more, the
+ *              way op timeouts come and go
+ *  - cancel:   cancel the <pending> ones one by one
+ *  - expire:   schedule <pending> / 10 due within the next second and
+ *              wait for them all to fire
+ */
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "common/Timer.h"
+#include "common/ceph_timer.h"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "include/Context.h"
+
+using namespace std;
+using namespace std::chrono_literals;
+
+using clock_type = ceph::mono_clock;
+
+static double ns_per(clock_type::time_point start, uint64_t n)
+{
+  return std::chrono::duration<double, std::nano>(
+    clock_type::now() - start).count() / n;
+}
+
+static void report(const char *name, const char *what, double ns)
+{
+  cout << name << ": " << what << " " << ns << " ns/op" << std::endl;
+}
+
+static vector<ceph::timespan> make_delays(uint64_t n, ceph::timespan lo,
+					  ceph::timespan hi)
+{
+  std::mt19937_64 rng(0);
+  std::uniform_int_distribution<int64_t> d(lo.count(), hi.count());
+  vector<ceph::timespan> delays;
+  delays.reserve(n);
+  for (uint64_t i = 0; i < n; i++) {
+    delays.push_back(ceph::timespan(d(rng)));
+  }
+  return delays;
+}
+
+struct C_Count : public Context {
+  std::atomic<uint64_t>& fired;
+  explicit C_Count(std::atomic<uint64_t>& fired) : fired(fired) {}
+  void finish(int) override {
+    ++fired;
+  }
+};
+
+template <typename T>
+void run_safe(const char *name, uint64_t pending, uint64_t churn)
+{
+  ceph::mutex lock = ceph::make_mutex("bench_timer");
+  T timer(g_ceph_context, lock);
+  timer.init();
+  std::atomic<uint64_t> fired = 0;
+
+  auto delays = make_delays(pending, 10s, 1h);
+  vector<Context*> events;
+  events.reserve(pending);
+  {
+    std::lock_guard l{lock};
+    auto start = clock_type::now();
+    for (auto& d : delays) {
+      events.push_back(timer.add_event_after(d, new C_Count(fired)));
+    }
+    report(name, "schedule", ns_per(start, pending));
+  }
+
+  auto churn_delays = make_delays(churn, 1s, 30s);
+  {
+    std::lock_guard l{lock};
+    auto start = clock_type::now();
+    for (auto& d : churn_delays) {
+      auto c = timer.add_event_after(d, new C_Count(fired));
+      timer.cancel_event(c);
+    }
+    report(name, "churn (add+cancel)", ns_per(start, churn));
+  }
+
+  {
+    std::lock_guard l{lock};
+    auto start = clock_type::now();
+    for (auto c : events) {
+      timer.cancel_event(c);
+    }
+    report(name, "cancel", ns_per(start, pending));
+  }
+
+  uint64_t expiring = std::max<uint64_t>(pending / 10, 1);
+  auto soon = make_delays(expiring, 0s, 1s);
+  auto start = clock_type::now();
+  {
+    std::lock_guard l{lock};
+    for (auto& d : soon) {
+      timer.add_event_after(d, new C_Count(fired));
+    }
+  }
+  while (fired < expiring) {
+    std::this_thread::sleep_for(1ms);
+  }
+  cout << name << ": expired " << expiring << " in "
+       << std::chrono::duration<double>(clock_type::now() - start).count()
+       << "s" << std::endl;
+
+  std::lock_guard l{lock};
+  timer.shutdown();
+}
+
+template <typename T>
+void run_ceph(const char *name, uint64_t pending, uint64_t churn)
+{
+  T timer;
+  std::atomic<uint64_t> fired = 0;
+
+  auto delays = make_delays(pending, 10s, 1h);
+  vector<uint64_t> events;
+  events.reserve(pending);
+  auto start = clock_type::now();
+  for (auto& d : delays) {
+    events.push_back(timer.add_event(d, [&fired] { ++fired; }));
+  }
+  report(name, "schedule", ns_per(start, pending));
+
+  auto churn_delays = make_delays(churn, 1s, 30s);
+  start = clock_type::now();
+  for (auto& d : churn_delays) {
+    timer.cancel_event(timer.add_event(d, [&fired] { ++fired; }));
+  }
+  report(name, "churn (add+cancel)", ns_per(start, churn));
+
+  start = clock_type::now();
+  for (auto id : events) {
+    timer.cancel_event(id);
+  }
+  report(name, "cancel", ns_per(start, pending));
+
+  uint64_t expiring = std::max<uint64_t>(pending / 10, 1);
+  auto soon = make_delays(expiring, 0s, 1s);
+  start = clock_type::now();
+  for (auto& d : soon) {
+    timer.add_event(d, [&fired] { ++fired; });
+  }
+  while (fired < expiring) {
+    std::this_thread::sleep_for(1ms);
+  }
+  cout << name << ": expired " << expiring << " in "
+       << std::chrono::duration<double>(clock_type::now() - start).count()
+       << "s" << std::endl;
+}
+
+void usage(const char *name) {
+  cout << name << " [pending] [churn]\n"
+       << "\t pending: the number of timers kept pending (default 1000000).\n"
+       << "\t churn: timers added and cancelled with those pending "
+       << "(default 1000000).\n";
+}
+
+int main(int argc, const char **argv)
+{
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    usage(argv[0]);
+    return EXIT_SUCCESS;
+  }
+  uint64_t pending = argc > 1 ? atoll(argv[1]) : 1000000;
+  uint64_t churn = argc > 2 ? atoll(argv[2]) : 1000000;
+
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  cout << pending << " pending timers, " << churn << " added and cancelled"
+       << std::endl;
+
+  run_safe<SafeTimer>("SafeTimer", pending, churn);
+  run_safe<WheelTimer>("WheelTimer", pending, churn);
+  run_ceph<ceph::timer<clock_type>>("ceph::timer", pending, churn);
+  run_ceph<ceph::wheel_timer<clock_type>>("ceph::wheel_timer", pending, churn);
+  return EXIT_SUCCESS;
+}
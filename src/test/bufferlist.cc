@@ -124,6 +124,76 @@ TEST(Buffer, constructors) {
   }
 }
 
+TEST(Buffer, hugepage_pooled) {
+  auto& pool = mempool::get_pool(mempool::mempool_buffer_hugepage);
+  const size_t items = pool.allocated_items();
+  //
+  // disabled pool falls back to create_aligned
+  //
+  buffer::set_hugepage_pool_max_bytes(0);
+  {
+    bufferptr ptr(buffer::create_hugepage_pooled(CEPH_PAGE_SIZE, CEPH_PAGE_SIZE));
+    EXPECT_EQ(CEPH_PAGE_SIZE, ptr.length());
+    EXPECT_TRUE(ptr.is_page_aligned());
+    EXPECT_EQ(items, pool.allocated_items());
+  }
+  buffer::set_hugepage_pool_max_bytes(16 << 20);
+  //
+  // chunks are accounted in their own mempool and recycled
+  //
+  const char *data;
+  {
+    bufferptr ptr(buffer::create_hugepage_pooled(CEPH_PAGE_SIZE, CEPH_PAGE_SIZE));
+    EXPECT_EQ(CEPH_PAGE_SIZE, ptr.length());
+    EXPECT_TRUE(ptr.is_page_aligned());
+    EXPECT_EQ(items + 1, pool.allocated_items());
+    ::memset(ptr.c_str(), 'X', ptr.length());
+    data = ptr.c_str();
+  }
+  EXPECT_EQ(items, pool.allocated_items());
+  {
+    bufferptr ptr(buffer::create_hugepage_pooled(CEPH_PAGE_SIZE, CEPH_PAGE_SIZE));
+    EXPECT_EQ(data, ptr.c_str());
+  }
+  //
+  // 4M chunks are slab aligned
+  //
+  {
+    bufferptr ptr(buffer::create_hugepage_pooled(4 << 20, CEPH_PAGE_SIZE));
+    EXPECT_EQ(items + 1, pool.allocated_items());
+    EXPECT_EQ(0u, (uintptr_t)ptr.c_str() & ((2 << 20) - 1));
+  }
+  //
+  // sizes in between get the next power of two, not the next 4M
+  //
+  {
+    const uint64_t mapped = buffer::get_hugepage_pool_mapped_bytes();
+    std::vector<bufferptr> ptrs;
+    for (unsigned i = 0; i < 16; ++i) {
+      ptrs.emplace_back(buffer::create_hugepage_pooled((64 << 10) + 1, CEPH_PAGE_SIZE));
+    }
+    EXPECT_EQ(items + 16, pool.allocated_items());
+    EXPECT_GE(mapped + (2 << 20), buffer::get_hugepage_pool_mapped_bytes());
+  }
+  //
+  // oversized and exhausted requests fall back
+  //
+  {
+    bufferptr ptr(buffer::create_hugepage_pooled((4 << 20) + 1, CEPH_PAGE_SIZE));
+    EXPECT_EQ(items, pool.allocated_items());
+  }
+  EXPECT_GE(16u << 20, buffer::get_hugepage_pool_mapped_bytes());
+  {
+    std::vector<bufferptr> ptrs;
+    for (unsigned i = 0; i < 8; ++i) {
+      ptrs.emplace_back(buffer::create_hugepage_pooled(4 << 20, CEPH_PAGE_SIZE));
+    }
+    EXPECT_GT(items + 8, pool.allocated_items());
+  }
+  EXPECT_GE(16u << 20, buffer::get_hugepage_pool_mapped_bytes());
+  buffer::set_hugepage_pool_max_bytes(0);
+}
+
 void bench_buffer_alloc(int size, int num)
 {
   utime_t start = ceph_clock_now();
@@ -617,6 +617,87 @@ TEST_F(cls_rgw, index_list_delimited)
 }
 
 
+/*
+ * This case tests that bucket index list stops at the end key it is
+ * given, including when entries roll up into common prefixes.
+ */
+TEST_F(cls_rgw, index_list_end_key)
+{
+  string bucket_oid = str_int("bucket", 9);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  uint64_t epoch = 1;
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = RGWObjCategory::None;
+  meta.size = 1024;
+
+  const std::vector<std::string> prefixes = { "a", "b/", "c" };
+  for (const auto& p : prefixes) {
+    for (int i = 0; i < 10; i++) {
+      string tag = str_int("tag", i);
+      string loc = str_int("loc", i);
+      const string obj = str_int(p, i);
+
+      index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc,
+		    0 /* bi_flags */, false /* log_op */);
+
+      index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, epoch, obj, meta,
+		     0 /* bi_flags */, false /* log_op */);
+    }
+  }
+
+  map<int, string> oids = { {0, bucket_oid} };
+  map<int, struct rgw_cls_list_ret> list_results;
+  cls_rgw_obj_key start_key("", "");
+  const string empty_prefix;
+  const string empty_delimiter;
+  int r = CLSRGWIssueBucketList(ioctx, start_key,
+				empty_prefix, empty_delimiter,
+				1000, true, oids, list_results, 1,
+				cls_rgw_obj_key("a-5"))();
+  ASSERT_EQ(r, 0);
+  ASSERT_EQ(1u, list_results.size());
+
+  auto it = list_results.begin();
+  ASSERT_EQ(5u, it->second.dir.m.size());
+  ASSERT_EQ("a-0", it->second.dir.m.cbegin()->first);
+  ASSERT_EQ("a-4", it->second.dir.m.crbegin()->first);
+  ASSERT_FALSE(it->second.is_truncated) <<
+    "Reaching the end key should not report more entries.";
+
+  // the common prefix sorts before the end key even though all the
+  // entries it covers sort after it
+  oids = { {0, bucket_oid} };
+  list_results.clear();
+  r = CLSRGWIssueBucketList(ioctx, start_key,
+			    empty_prefix, "/",
+			    1000, true, oids, list_results, 1,
+			    cls_rgw_obj_key("b/+"))();
+  ASSERT_EQ(r, 0);
+
+  it = list_results.begin();
+  ASSERT_EQ(11u, it->second.dir.m.size()) <<
+    "We should get 10 top-level entries and one common prefix.";
+  ASSERT_EQ("b/", it->second.dir.m.crbegin()->first);
+  ASSERT_FALSE(it->second.is_truncated);
+
+  // a page that stops short of the end key is still truncated
+  oids = { {0, bucket_oid} };
+  list_results.clear();
+  r = CLSRGWIssueBucketList(ioctx, start_key,
+			    empty_prefix, empty_delimiter,
+			    3, true, oids, list_results, 1,
+			    cls_rgw_obj_key("c-5"))();
+  ASSERT_EQ(r, 0);
+
+  it = list_results.begin();
+  ASSERT_EQ(3u, it->second.dir.m.size());
+  ASSERT_TRUE(it->second.is_truncated);
+}
+
 TEST_F(cls_rgw, bi_list)
 {
   string bucket_oid = str_int("bucket", 5);
@@ -24,11 +24,11 @@
 using namespace std::literals;
 
 namespace {
-template<typename TC>
+template<typename TC, template<typename> class Timer = ceph::timer>
 void run_some()
 {
   static constexpr auto MAX_FUTURES = 5;
-  ceph::timer<TC> timer;
+  Timer<TC> timer;
   std::vector<std::future<void>> futures;
   for (auto i = 0; i < MAX_FUTURES; ++i) {
     auto t = TC::now() + 2s;
@@ -42,10 +42,10 @@ void run_some()
     f.get();
 }
 
-template<typename TC>
+template<typename TC, template<typename> class Timer = ceph::timer>
 void run_orderly()
 {
-  ceph::timer<TC> timer;
+  Timer<TC> timer;
 
   std::future<typename TC::time_point> first;
   std::future<typename TC::time_point> second;
@@ -98,10 +98,10 @@ struct Destructo {
   }
 };
 
-template<typename TC>
+template<typename TC, template<typename> class Timer = ceph::timer>
 void cancel_all()
 {
-  ceph::timer<TC> timer;
+  Timer<TC> timer;
   static constexpr auto MAX_FUTURES = 5;
   std::vector<std::future<void>> futures;
   for (auto i = 0; i < MAX_FUTURES; ++i) {
@@ -114,10 +114,10 @@ void cancel_all()
     f.get();
 }
 
-template<typename TC>
+template<typename TC, template<typename> class Timer = ceph::timer>
 void cancellation()
 {
-  ceph::timer<TC> timer;
+  Timer<TC> timer;
   {
     std::promise<void> p;
     auto f = p.get_future();
@@ -135,8 +135,8 @@ void cancellation()
   }
 }
 
-template<typename TC>
-void tick(ceph::timer<TC>* t,
+template<typename TC, template<typename> class Timer = ceph::timer>
+void tick(Timer<TC>* t,
           typename TC::time_point deadline,
           double interval,
           bool* test_finished,
@@ -187,10 +187,11 @@ TEST(CancelAll, Wall)
   cancel_all<std::chrono::system_clock>();
 }
 
-TEST(TimerLoopTest, TimerLoop)
+template<template<typename> class Timer>
+void timer_loop()
 {
   using TC = ceph::coarse_mono_clock;
-  ceph::timer<TC> t;
+  Timer<TC> t;
   bool test_finished = false;
   int test_duration = 10;
   double tick_interval = 0.00004;
@@ -204,7 +205,7 @@ TEST(TimerLoopTest, TimerLoop)
 
   t.add_event(
     ceph::make_timespan(tick_interval),
-    &tick<TC>,
+    &tick<TC, Timer>,
     &t,
     test_deadline,
     tick_interval,
@@ -225,3 +226,68 @@ TEST(TimerLoopTest, TimerLoop)
     << ", second last tp: " << second_last_tp
     << ", deadline tp: " << test_deadline;
 }
+
+TEST(TimerLoopTest, TimerLoop)
+{
+  timer_loop<ceph::timer>();
+}
+
+TEST(WheelTimer, RunSome)
+{
+  run_some<std::chrono::steady_clock, ceph::wheel_timer>();
+  run_some<std::chrono::system_clock, ceph::wheel_timer>();
+}
+
+TEST(WheelTimer, RunOrderly)
+{
+  run_orderly<std::chrono::steady_clock, ceph::wheel_timer>();
+  run_orderly<std::chrono::system_clock, ceph::wheel_timer>();
+}
+
+TEST(WheelTimer, CancelAll)
+{
+  cancel_all<std::chrono::steady_clock, ceph::wheel_timer>();
+}
+
+TEST(WheelTimer, Cancellation)
+{
+  cancellation<std::chrono::steady_clock, ceph::wheel_timer>();
+}
+
+TEST(WheelTimer, SameTickInOrder)
+{
+  ceph::wheel_timer<std::chrono::steady_clock> timer(ceph::construct_suspended);
+  std::vector<int> order;
+  std::promise<void> p;
+  auto f = p.get_future();
+  auto when = std::chrono::steady_clock::now() + 10ms;
+  for (int i = 0; i < 100; ++i) {
+    timer.add_event(when, [&order, i] { order.push_back(i); });
+  }
+  timer.add_event(when, [p = std::move(p)]() mutable { p.set_value(); });
+  timer.resume();
+  f.get();
+  ASSERT_EQ(100u, order.size());
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(i, order[i]);
+  }
+}
+
+TEST(WheelTimer, Adjust)
+{
+  ceph::wheel_timer<std::chrono::steady_clock> timer;
+  std::promise<std::chrono::steady_clock::time_point> p;
+  auto f = p.get_future();
+  auto start = std::chrono::steady_clock::now();
+  auto e = timer.add_event(100s, [&p] {
+    p.set_value(std::chrono::steady_clock::now());
+  });
+  EXPECT_TRUE(timer.adjust_event(e, 1s));
+  EXPECT_LE(start + 1s, f.get());
+  EXPECT_FALSE(timer.adjust_event(e, 1s));
+}
+
+TEST(WheelTimer, TimerLoop)
+{
+  timer_loop<ceph::wheel_timer>();
+}
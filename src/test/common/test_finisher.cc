@@ -0,0 +1,146 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <list>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/Finisher.h"
+#include "global/global_context.h"
+
+using namespace std;
+
+namespace {
+
+struct C_Record : public Context {
+  vector<int>& done;
+  int id;
+  C_Record(vector<int>& done, int id) : done(done), id(id) {}
+  void finish(int r) override {
+    done.push_back(id + r);
+  }
+};
+
+} // anonymous namespace
+
+TEST(ShardedFinisher, single_producer_order)
+{
+  ShardedFinisher fin(g_ceph_context, 4);
+  fin.start();
+  vector<int> done;
+  list<Context*> ls;
+  for (int i = 0; i < 1000; i++) {
+    if (i % 3) {
+      fin.queue(new C_Record(done, i));
+    } else {
+      ls.push_back(new C_Record(done, i));
+      fin.queue(ls);
+    }
+  }
+  fin.queue(new C_Record(done, 999), 1);
+  fin.wait_for_empty();
+  fin.stop();
+  ASSERT_EQ(1001u, done.size());
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(i, done[i]);
+  }
+  ASSERT_EQ(1000, done[1000]);
+}
+
+TEST(ShardedFinisher, per_producer_order)
+{
+  ShardedFinisher fin(g_ceph_context, "test_sharded", "fn_test", 3);
+  fin.start();
+
+  const int producers = 8;
+  const int num = 10000;
+  vector<vector<int>> done(producers);
+  vector<thread> ts;
+  for (int p = 0; p < producers; p++) {
+    ts.emplace_back([&fin, &d = done[p]] {
+      for (int i = 0; i < num; i++) {
+	fin.queue(new C_Record(d, i));
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  fin.wait_for_empty();
+  fin.stop();
+
+  for (auto& d : done) {
+    ASSERT_EQ((size_t)num, d.size());
+    for (int i = 0; i < num; i++) {
+      ASSERT_EQ(i, d[i]);
+    }
+  }
+}
+
+TEST(ShardedFinisher, restart)
+{
+  ShardedFinisher fin(g_ceph_context);
+  vector<int> done;
+  fin.start();
+  fin.queue(new C_Record(done, 0));
+  fin.wait_for_empty();
+  fin.stop();
+  fin.start();
+  fin.queue(new C_Record(done, 1));
+  fin.wait_for_empty();
+  fin.stop();
+  ASSERT_EQ((vector<int>{0, 1}), done);
+}
+
+TEST(ContextQueue, order)
+{
+  ceph::mutex lock = ceph::make_mutex("ContextQueue::test");
+  ceph::condition_variable cond;
+  ContextQueue q(lock, cond);
+  vector<int> done;
+
+  ASSERT_TRUE(q.empty());
+  for (int i = 0; i < 10; i += 2) {
+    list<Context*> ls{new C_Record(done, i), new C_Record(done, i + 1)};
+    q.queue(ls);
+    ASSERT_TRUE(ls.empty());
+  }
+  ASSERT_FALSE(q.empty());
+
+  list<Context*> ls;
+  q.move_to(ls);
+  ASSERT_TRUE(q.empty());
+  finish_contexts(g_ceph_context, ls);
+  ASSERT_EQ((vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), done);
+}
+
+TEST(ContextQueue, wakes_up_consumer)
+{
+  ceph::mutex lock = ceph::make_mutex("ContextQueue::test");
+  ceph::condition_variable cond;
+  ContextQueue q(lock, cond);
+  vector<int> done;
+
+  thread consumer([&] {
+    std::unique_lock l(lock);
+    cond.wait(l, [&q] { return !q.empty(); });
+    l.unlock();
+    list<Context*> ls;
+    q.move_to(ls);
+    finish_contexts(g_ceph_context, ls);
+  });
+  list<Context*> ls{new C_Record(done, 7)};
+  q.queue(ls);
+  consumer.join();
+  ASSERT_EQ((vector<int>{7}), done);
+}
@@ -0,0 +1,184 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/timer_wheel.h"
+
+using ceph::timer_wheel;
+using tick_t = timer_wheel::tick_t;
+
+namespace {
+
+struct item : timer_wheel::entry {
+  int id;
+  explicit item(int id) : id(id) {}
+};
+
+std::vector<int> advance(timer_wheel& w, tick_t now)
+{
+  std::vector<int> fired;
+  w.advance(now, [&fired](timer_wheel::entry& e) {
+    fired.push_back(static_cast<item&>(e).id);
+  });
+  return fired;
+}
+
+} // anonymous namespace
+
+TEST(TimerWheel, basic)
+{
+  timer_wheel w(1000);
+  item a(0), b(1), c(2);
+  w.add(a, 1005);
+  w.add(b, 1005 + 300);
+  w.add(c, 1000 + 100000);
+  ASSERT_EQ(3u, w.size());
+  ASSERT_EQ(1005u, w.next_tick());
+
+  ASSERT_TRUE(advance(w, 1004).empty());
+  ASSERT_EQ(std::vector<int>{0}, advance(w, 1005));
+  ASSERT_FALSE(a.is_linked());
+  ASSERT_EQ(std::vector<int>{1}, advance(w, 1400));
+  ASSERT_TRUE(advance(w, 1000 + 99999).empty());
+  ASSERT_EQ(std::vector<int>{2}, advance(w, 1000 + 100000));
+  ASSERT_TRUE(w.empty());
+}
+
+TEST(TimerWheel, remove)
+{
+  timer_wheel w;
+  item a(0), b(1);
+  w.add(a, 50000);
+  w.add(b, 50000);
+  w.remove(a);
+  ASSERT_FALSE(a.is_linked());
+  ASSERT_EQ(std::vector<int>{1}, advance(w, 50000));
+  ASSERT_TRUE(w.empty());
+
+  w.add(a, 60000);
+  w.update(a, 50001);
+  ASSERT_EQ(std::vector<int>{0}, advance(w, 50001));
+}
+
+TEST(TimerWheel, overdue)
+{
+  timer_wheel w;
+  advance(w, 100);
+  item a(0);
+  w.add(a, 10);
+  ASSERT_EQ(w.current(), w.next_tick());
+  ASSERT_EQ(std::vector<int>{0}, advance(w, w.current()));
+}
+
+// what was cascaded down must not overtake what was added to the
+// slot directly
+TEST(TimerWheel, same_tick_in_order)
+{
+  timer_wheel w;
+  item a(0), b(1), c(2);
+  w.add(a, 300);  // goes to level 1
+  advance(w, 100);
+  w.add(b, 300);  // level 0
+  w.add(c, 299);
+  ASSERT_EQ((std::vector<int>{2, 0, 1}), advance(w, 300));
+}
+
+TEST(TimerWheel, far_future)
+{
+  timer_wheel w;
+  item a(0);
+  const tick_t far = (tick_t(1) << 33) + 12345;
+  w.add(a, far);
+  tick_t now = 0;
+  while (!w.empty()) {
+    tick_t next = w.next_tick();
+    ASSERT_LE(next, far);
+    now = next;
+    auto fired = advance(w, now);
+    if (!fired.empty()) {
+      ASSERT_EQ(far, now);
+    }
+  }
+  ASSERT_EQ(far, now);
+}
+
+TEST(TimerWheel, add_from_callback)
+{
+  timer_wheel w;
+  item a(0), b(1), c(2);
+  w.add(a, 10);
+  std::vector<int> fired;
+  w.advance(20, [&](timer_wheel::entry& e) {
+    auto& i = static_cast<item&>(e);
+    fired.push_back(i.id);
+    if (i.id == 0) {
+      w.add(b, 15);   // later this pass
+      w.add(c, 10);   // overdue, this pass too
+    }
+  });
+  ASSERT_EQ((std::vector<int>{0, 2, 1}), fired);
+}
+
+TEST(TimerWheel, random)
+{
+  std::mt19937_64 rng(42);
+  timer_wheel w(rng() % (tick_t(1) << 40));
+  std::vector<std::unique_ptr<item>> items;
+  std::multimap<tick_t, int> expected;  // by the tick each is due
+  std::map<int, std::multimap<tick_t, int>::iterator> pending;
+  tick_t now = w.current();
+
+  for (int step = 0; step < 100000; ++step) {
+    int op = rng() % 10;
+    if (op < 5) {
+      static const tick_t ranges[] = {300, 20000, tick_t(1) << 27,
+				      tick_t(1) << 34};
+      tick_t when = now + rng() % ranges[rng() % 4];
+      items.push_back(std::make_unique<item>(items.size()));
+      w.add(*items.back(), when);
+      pending[items.back()->id] =
+	expected.emplace(std::max(when, w.current()), items.back()->id);
+    } else if (op < 7 && !pending.empty()) {
+      auto p = pending.begin();
+      std::advance(p, rng() % std::min<size_t>(pending.size(), 50));
+      w.remove(*items[p->first]);
+      expected.erase(p->second);
+      pending.erase(p);
+    } else {
+      tick_t to = now + rng() % 100000;
+      if (!w.empty() && rng() % 2) {
+	to = std::max(now, w.next_tick());
+      }
+      now = to;
+      w.advance(now, [&](timer_wheel::entry& e) {
+	auto p = pending.find(static_cast<item&>(e).id);
+	ASSERT_NE(p, pending.end());
+	ASSERT_LE(p->second->first, now);  // not early
+	expected.erase(p->second);
+	pending.erase(p);
+      });
+      ASSERT_EQ(expected.size(), w.size());
+      if (!expected.empty()) {
+	ASSERT_GT(expected.begin()->first, now);  // not late
+	ASSERT_LE(w.next_tick(), expected.begin()->first);
+      }
+    }
+  }
+  w.clear();
+  ASSERT_TRUE(w.empty());
+}
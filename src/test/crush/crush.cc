@@ -530,6 +530,67 @@ TEST_F(CRUSHTest, straw2_stddev)
   }
 }
 
+TEST_F(CRUSHTest, straw2_batch) {
+  // the batch mapper must produce exactly the scalar mappings
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  c->create();
+  c->set_type_name(2, "root");
+  c->set_type_name(1, "host");
+  c->set_type_name(0, "osd");
+
+  int rootno;
+  c->add_bucket(0, CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+		2, 0, NULL, NULL, &rootno);
+  c->set_item_name(rootno, "default");
+
+  // odd bucket sizes so the hashes do not fill whole SIMD blocks
+  const int num_host = 13, num_osd = 11;
+  map<string,string> loc;
+  loc["root"] = "default";
+  int osd = 0;
+  for (int h = 0; h < num_host; ++h) {
+    loc["host"] = string("host-") + stringify(h);
+    for (int o = 0; o < num_osd; ++o, ++osd) {
+      c->insert_item(cct, osd, 1.0 + (osd % 5) * 0.5,
+		     string("osd.") + stringify(osd), loc);
+    }
+  }
+  EXPECT_EQ(0, c->add_simple_rule("rep", "default", "host", "",
+				  "firstn", pg_pool_t::TYPE_REPLICATED));
+  EXPECT_EQ(1, c->add_simple_rule("ec", "default", "osd", "",
+				  "indep", pg_pool_t::TYPE_ERASURE));
+  c->finalize();
+
+  vector<__u32> weight(osd, 0x10000);
+  for (int i = 0; i < osd; ++i) {
+    if (i % 13 == 0)
+      weight[i] = 0;
+    else if (i % 7 == 0)
+      weight[i] = 0x8000;
+  }
+
+  vector<int> xs;
+  for (int x = 0; x < 10000; ++x) {
+    xs.push_back(x);
+  }
+  for (int rule = 0; rule < 2; ++rule) {
+    for (int maxout : {3, 6}) {
+      vector<vector<int>> scalar, batch;
+      c->do_rule_batch(rule, xs, scalar, maxout, weight, 0, false);
+      c->do_rule_batch(rule, xs, batch, maxout, weight, 0);
+      ASSERT_EQ(xs.size(), scalar.size());
+      ASSERT_EQ(xs.size(), batch.size());
+      for (size_t i = 0; i < xs.size(); ++i) {
+	// do_rule() takes the vectorized path by default
+	vector<int> out;
+	c->do_rule(rule, xs[i], out, maxout, weight, 0);
+	ASSERT_EQ(scalar[i], batch[i]) << "rule " << rule << " x " << xs[i];
+	ASSERT_EQ(scalar[i], out) << "rule " << rule << " x " << xs[i];
+      }
+    }
+  }
+}
+
 TEST_F(CRUSHTest, straw2_reweight) {
   // when we adjust the weight of an item in a straw2 bucket,
   // we should *only* see movement from or to that item, never
@@ -876,6 +876,64 @@ TEST_F(IsaErasureCodeTest, isa_xor_codec)
   EXPECT_EQ(5, cnt_cf);
 }
 
+TEST_F(IsaErasureCodeTest, parity_delta)
+{
+  const struct {
+    int matrix;
+    const char *m;
+  } profiles[] = {
+    { ErasureCodeIsa::kVandermonde, "3" },
+    { ErasureCodeIsa::kCauchy, "3" },
+    { ErasureCodeIsa::kVandermonde, "1" },
+  };
+  for (auto &&p : profiles) {
+    ErasureCodeIsaDefault Isa(tcache, p.matrix);
+    ErasureCodeProfile profile;
+    profile["k"] = "4";
+    profile["m"] = p.m;
+    ASSERT_EQ(0, Isa.init(profile, &cerr));
+    ASSERT_TRUE(Isa.supports_parity_delta());
+    const int k = Isa.get_data_chunk_count();
+    const int n = Isa.get_chunk_count();
+    set<int> want_to_encode;
+    for (int i = 0; i < n; i++)
+      want_to_encode.insert(i);
+
+    string payload(8192, 'X');
+    for (unsigned i = 0; i < payload.size(); i++)
+      payload[i] = i * 7 + 3;
+    bufferlist in;
+    in.append(payload);
+    map<int, bufferlist> encoded;
+    ASSERT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+    unsigned length = encoded[0].length();
+
+    // overwrite part of the first and the last data chunks
+    for (unsigned i = 10; i < 200; i++)
+      payload[i] = ~payload[i];
+    for (unsigned i = (k - 1) * length; i < (k - 1) * length + 100; i++)
+      payload[i] = ~payload[i];
+    bufferlist changed;
+    changed.append(payload);
+    map<int, bufferlist> reencoded;
+    ASSERT_EQ(0, Isa.encode(want_to_encode, changed, &reencoded));
+
+    map<int, bufferptr> deltas;
+    for (int i : { 0, k - 1 }) {
+      bufferptr delta(buffer::create_aligned(length, EC_ISA_ADDRESS_ALIGNMENT));
+      Isa.encode_delta(bufferptr(encoded[i].c_str(), length),
+		       bufferptr(reencoded[i].c_str(), length),
+		       &delta);
+      deltas[i] = delta;
+    }
+    // only update the last coding chunk when there are several
+    map<int, bufferptr> coding;
+    coding[n - 1] = bufferptr(encoded[n - 1].c_str(), length);
+    Isa.apply_delta(deltas, coding);
+    EXPECT_EQ(0, memcmp(coding[n - 1].c_str(), reencoded[n - 1].c_str(), length));
+  }
+}
+
 TEST_F(IsaErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
@@ -278,6 +278,62 @@ TEST(ErasureCodeTest, encode)
   }
 }
 
+template <typename T>
+static void check_parity_delta(ErasureCodeProfile profile)
+{
+  T jerasure;
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+  ASSERT_TRUE(jerasure.supports_parity_delta());
+  const int k = jerasure.get_data_chunk_count();
+  const int n = jerasure.get_chunk_count();
+  set<int> want_to_encode;
+  for (int i = 0; i < n; i++)
+    want_to_encode.insert(i);
+
+  string payload(8192, 'X');
+  for (unsigned i = 0; i < payload.size(); i++)
+    payload[i] = i * 7 + 3;
+  bufferlist in;
+  in.append(payload);
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+  unsigned length = encoded[0].length();
+  ASSERT_LT(200u, length);
+
+  // overwrite part of the second data chunk only
+  for (unsigned i = length + 10; i < length + 200; i++)
+    payload[i] = ~payload[i];
+  bufferlist changed;
+  changed.append(payload);
+  map<int, bufferlist> reencoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, changed, &reencoded));
+
+  bufferptr old_data(encoded[1].c_str(), length);
+  bufferptr new_data(reencoded[1].c_str(), length);
+  bufferptr delta(buffer::create(length));
+  jerasure.encode_delta(old_data, new_data, &delta);
+  map<int, bufferptr> deltas = { { 1, delta } };
+  map<int, bufferptr> coding;
+  for (int j = k; j < n; j++)
+    coding[j] = bufferptr(encoded[j].c_str(), length);
+  jerasure.apply_delta(deltas, coding);
+  for (int j = k; j < n; j++)
+    EXPECT_EQ(0, memcmp(coding[j].c_str(), reencoded[j].c_str(), length));
+}
+
+TEST(ErasureCodeTest, parity_delta)
+{
+  for (const char *w : { "8", "16", "32" }) {
+    check_parity_delta<ErasureCodeJerasureReedSolomonVandermonde>(
+      { { "k", "4" }, { "m", "3" }, { "w", w } });
+    check_parity_delta<ErasureCodeJerasureReedSolomonRAID6>(
+      { { "k", "4" }, { "m", "2" }, { "w", w } });
+  }
+  // bitmatrix techniques re-encode the whole stripe
+  ErasureCodeJerasureCauchyGood cauchy;
+  EXPECT_FALSE(cauchy.supports_parity_delta());
+}
+
 TEST(ErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
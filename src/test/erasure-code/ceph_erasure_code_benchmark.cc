@@ -15,6 +15,10 @@
  *
  */
 
+#include <memory>
+#include <numeric>
+#include <thread>
+
 #include <boost/scoped_ptr.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/program_options/option.hpp>
@@ -35,6 +39,7 @@
 #include "erasure-code/ErasureCode.h"
 #include "ceph_erasure_code_benchmark.h"
 
+using ceph::Formatter;
 using std::endl;
 using std::cerr;
 using std::cout;
@@ -59,9 +64,10 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run either encode, decode or rmw (partial stripe read-modify-write)")
     ("erasures,e", po::value<int>()->default_value(1),
-     "number of erasures when decoding")
+     "number of erasures when decoding, or number of chunks missing when "
+     "the rmw workload reads the stripe back")
     ("erased", po::value<vector<int> >(),
      "erased chunk (repeat if more than one chunk is erased)")
     ("erasures-generation,E", po::value<string>()->default_value("random"),
@@ -71,6 +77,22 @@ int ErasureCodeBench::setup(int argc, char** argv) {
      " the first chunk, then the second etc.)")
     ("parameter,P", po::value<vector<string> >(),
      "add a parameter to the erasure code profile")
+    ("threads,t", po::value<int>()->default_value(1),
+     "number of threads running the workload concurrently, each with its "
+     "own erasure code instance and --iterations runs")
+    ("rmw-size", po::value<int>()->default_value(4096),
+     "number of bytes overwritten in the stripe by each rmw run")
+    ("format,f", po::value<string>()->default_value("plain"),
+     "output format: plain, json or json-pretty")
+    ("sweep", "run encode, rmw and single and multiple erasure decode for "
+     "every combination of --sweep-plugins, --sweep-km and "
+     "--sweep-chunk-sizes, --parameter being added to every profile")
+    ("sweep-plugins", po::value<string>()->default_value("jerasure,isa,clay,shec,lrc"),
+     "comma separated list of plugins for --sweep")
+    ("sweep-km", po::value<string>()->default_value("2+1,4+2,8+3"),
+     "comma separated list of k+m for --sweep")
+    ("sweep-chunk-sizes", po::value<string>()->default_value("4096,65536,1048576"),
+     "comma separated list of chunk sizes for --sweep")
     ;
 
   po::variables_map vm;
@@ -130,7 +152,53 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     exhaustive_erasures = false;
   if (vm.count("erased") > 0)
     erased = vm["erased"].as<vector<int> >();
-  
+  threads = vm["threads"].as<int>();
+  if (threads < 1) {
+    cout << "--threads is " << threads << ". But it needs to be > 0." << endl;
+    return -EINVAL;
+  }
+  rmw_size = vm["rmw-size"].as<int>();
+  if (rmw_size < 1) {
+    cout << "--rmw-size is " << rmw_size << ". But it needs to be > 0." << endl;
+    return -EINVAL;
+  }
+  format = vm["format"].as<string>();
+  verbose = vm.count("verbose") > 0 ? true : false;
+
+  sweep = vm.count("sweep") > 0;
+  if (sweep) {
+    if (format == "plain")
+      format = "json-pretty";
+    vector<string> strs;
+    boost::split(sweep_plugins, vm["sweep-plugins"].as<string>(),
+		 boost::is_any_of(","));
+    boost::split(strs, vm["sweep-km"].as<string>(), boost::is_any_of(","));
+    for (const auto &km : strs) {
+      vector<string> v;
+      boost::split(v, km, boost::is_any_of("+"));
+      try {
+	if (v.size() != 2)
+	  throw std::invalid_argument("expected k+m");
+	sweep_km.emplace_back(stoi(v[0]), stoi(v[1]));
+      } catch (const std::logic_error& e) {
+	cout << "Invalid --sweep-km " << km << " (" << e.what() << ")" << endl;
+	return -EINVAL;
+      }
+    }
+    boost::split(strs, vm["sweep-chunk-sizes"].as<string>(),
+		 boost::is_any_of(","));
+    for (const auto &size : strs) {
+      try {
+	sweep_chunk_sizes.push_back(stoi(size));
+      } catch (const std::logic_error& e) {
+	cout << "Invalid --sweep-chunk-sizes " << size
+	     << " (" << e.what() << ")" << endl;
+	return -EINVAL;
+      }
+    }
+    return 0;
+  }
+
   try {
     k = stoi(profile["k"]);
     m = stoi(profile["m"]);
@@ -147,8 +215,6 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     return -EINVAL;
   } 
 
-  verbose = vm.count("verbose") > 0 ? true : false;
-
   return 0;
 }
 
@@ -156,41 +222,227 @@ int ErasureCodeBench::run() {
   ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
   instance.disable_dlclose = true;
 
+  if (sweep)
+    return run_sweep();
+
+  std::unique_ptr<Formatter> f(Formatter::create(format, "json-pretty", ""));
+  int code = run_workload(plugin, profile, workload, erasures, in_size, f.get());
+  if (f) {
+    f->flush(cout);
+    cout << endl;
+  }
+  return code;
+}
+
+void ErasureCodeBench::StartGate::wait()
+{
+  std::unique_lock l(lock);
+  if (++waiting == expected) {
+    open = true;
+    cond.notify_all();
+  } else {
+    cond.wait(l, [this] { return open; });
+  }
+}
+
+void ErasureCodeBench::Worker::start()
+{
+  gate->wait();
+  started = true;
+  begin = ceph_clock_now();
+}
+
+void ErasureCodeBench::Worker::stop()
+{
+  elapsed = ceph_clock_now() - begin;
+}
+
+int ErasureCodeBench::run_workload(const string &plugin,
+				   const ErasureCodeProfile &profile,
+				   const string &workload,
+				   int erasures,
+				   int in_size,
+				   Formatter *f)
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  StartGate gate(threads);
+  vector<Worker> workers;
+  workers.reserve(threads);
+  for (int t = 0; t < threads; t++) {
+    ErasureCodeInterfaceRef erasure_code;
+    ErasureCodeProfile p = profile;
+    stringstream messages;
+    int code = instance.factory(plugin,
+				g_conf().get_val<std::string>("erasure_code_dir"),
+				p, &erasure_code, &messages);
+    if (code) {
+      cerr << messages.str() << endl;
+      return code;
+    }
+    workers.emplace_back(erasure_code, &gate, in_size, erasures);
+  }
+
+  int (ErasureCodeBench::*fn)(Worker &);
   if (workload == "encode")
-    return encode();
+    fn = &ErasureCodeBench::encode;
+  else if (workload == "rmw")
+    fn = &ErasureCodeBench::rmw;
   else
-    return decode();
+    fn = &ErasureCodeBench::decode;
+
+  auto body = [this, fn](Worker &w) {
+    w.code = (this->*fn)(w);
+    // a worker failing during setup must not hold back the others
+    if (!w.started)
+      w.gate->wait();
+  };
+  if (threads == 1) {
+    body(workers.front());
+  } else {
+    vector<std::thread> running;
+    for (auto &w : workers)
+      running.emplace_back(body, std::ref(w));
+    for (auto &t : running)
+      t.join();
+  }
+
+  int code = 0;
+  utime_t elapsed;
+  uint64_t bytes = 0;
+  for (const auto &w : workers) {
+    if (w.code && !code)
+      code = w.code;
+    if (w.elapsed > elapsed)
+      elapsed = w.elapsed;
+    bytes += w.bytes;
+  }
+
+  if (!f) {
+    if (code)
+      return code;
+    cout << elapsed << "\t" << (bytes / 1024) << endl;
+    return 0;
+  }
+
+  ErasureCodeInterfaceRef erasure_code = workers.front().erasure_code;
+  f->open_object_section("benchmark");
+  f->dump_string("plugin", plugin);
+  f->open_object_section("profile");
+  for (const auto &[key, value] : erasure_code->get_profile())
+    f->dump_string(key.c_str(), value);
+  f->close_section();
+  f->dump_string("workload", workload);
+  f->dump_int("size", in_size);
+  f->dump_unsigned("chunk_size", erasure_code->get_chunk_size(in_size));
+  f->dump_int("erasures", workload == "encode" ? 0 : erasures);
+  if (workload == "rmw")
+    f->dump_int("rmw_size", rmw_size);
+  f->dump_int("threads", threads);
+  f->dump_int("iterations", max_iterations);
+  f->dump_int("code", code);
+  f->dump_float("seconds", (double)elapsed);
+  f->dump_unsigned("bytes", bytes);
+  f->dump_float("throughput_mib", (double)elapsed > 0 ?
+		bytes / (double)elapsed / (1024 * 1024) : 0);
+  f->close_section();
+  return code;
+}
+
+int ErasureCodeBench::sweep_profile(const string &plugin, int k, int m,
+				    ErasureCodeProfile *p)
+{
+  int max_erasures = m;
+  (*p)["k"] = std::to_string(k);
+  (*p)["m"] = std::to_string(m);
+  if (plugin == "jerasure" || plugin == "isa") {
+    (*p)["technique"] = "reed_sol_van";
+  } else if (plugin == "shec") {
+    // shec only guarantees recovery from c erasures
+    max_erasures = std::min(m, 2);
+    (*p)["c"] = std::to_string(max_erasures);
+  } else if (plugin == "lrc") {
+    // as many local groups as allowed by k and m
+    (*p)["l"] = std::to_string((k + m) / std::gcd(k, m));
+  }
+  for (const auto &[key, value] : profile)
+    (*p)[key] = value;
+  return max_erasures;
 }
 
-int ErasureCodeBench::encode()
+int ErasureCodeBench::run_sweep()
 {
   ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
-  ErasureCodeInterfaceRef erasure_code;
-  stringstream messages;
-  int code = instance.factory(plugin,
-			      g_conf().get_val<std::string>("erasure_code_dir"),
-			      profile, &erasure_code, &messages);
-  if (code) {
-    cerr << messages.str() << endl;
-    return code;
+  std::unique_ptr<Formatter> f(Formatter::create(format, "json-pretty",
+						 "json-pretty"));
+  int ret = 0;
+  f->open_array_section("benchmarks");
+  for (const auto &plugin : sweep_plugins) {
+    for (const auto &[k, m] : sweep_km) {
+      ErasureCodeProfile p;
+      int max_erasures = sweep_profile(plugin, k, m, &p);
+
+      // not every plugin supports every k+m: report and move on
+      ErasureCodeInterfaceRef erasure_code;
+      ErasureCodeProfile tmp = p;
+      stringstream messages;
+      int code = instance.factory(plugin,
+				  g_conf().get_val<std::string>("erasure_code_dir"),
+				  tmp, &erasure_code, &messages);
+      if (code) {
+	f->open_object_section("benchmark");
+	f->dump_string("plugin", plugin);
+	f->open_object_section("profile");
+	for (const auto &[key, value] : p)
+	  f->dump_string(key.c_str(), value);
+	f->close_section();
+	f->dump_int("code", code);
+	f->dump_string("error", messages.str());
+	f->close_section();
+	continue;
+      }
+
+      for (int chunk_size : sweep_chunk_sizes) {
+	int size = chunk_size * k;
+	vector<std::pair<string, int>> workloads = {
+	  { "encode", 0 },
+	  { "rmw", 0 },
+	  { "decode", 1 },
+	};
+	if (max_erasures > 1)
+	  workloads.emplace_back("decode", max_erasures);
+	for (const auto &[w, e] : workloads) {
+	  code = run_workload(plugin, p, w, e, size, f.get());
+	  if (code && !ret)
+	    ret = code;
+	}
+      }
+    }
   }
+  f->close_section();
+  f->flush(cout);
+  cout << endl;
+  return ret;
+}
 
+int ErasureCodeBench::encode(Worker &w)
+{
+  ErasureCodeInterfaceRef erasure_code = w.erasure_code;
   bufferlist in;
-  in.append(string(in_size, 'X'));
+  in.append(string(w.in_size, 'X'));
   in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
   set<int> want_to_encode;
-  for (int i = 0; i < k + m; i++) {
+  for (unsigned int i = 0; i < erasure_code->get_chunk_count(); i++) {
     want_to_encode.insert(i);
   }
-  utime_t begin_time = ceph_clock_now();
+  w.start();
   for (int i = 0; i < max_iterations; i++) {
     std::map<int,bufferlist> encoded;
-    code = erasure_code->encode(want_to_encode, in, &encoded);
+    int code = erasure_code->encode(want_to_encode, in, &encoded);
     if (code)
       return code;
+    w.bytes += w.in_size;
   }
-  utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  w.stop();
   return 0;
 }
 
@@ -257,30 +509,21 @@ int ErasureCodeBench::decode_erasures(const map<int,bufferlist> &all_chunks,
   return 0;
 }
 
-int ErasureCodeBench::decode()
+int ErasureCodeBench::decode(Worker &w)
 {
-  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
-  ErasureCodeInterfaceRef erasure_code;
-  stringstream messages;
-  int code = instance.factory(plugin,
-			      g_conf().get_val<std::string>("erasure_code_dir"),
-			      profile, &erasure_code, &messages);
-  if (code) {
-    cerr << messages.str() << endl;
-    return code;
-  }
-
+  ErasureCodeInterfaceRef erasure_code = w.erasure_code;
+  const int chunk_count = erasure_code->get_chunk_count();
   bufferlist in;
-  in.append(string(in_size, 'X'));
+  in.append(string(w.in_size, 'X'));
   in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
 
   set<int> want_to_encode;
-  for (int i = 0; i < k + m; i++) {
+  for (int i = 0; i < chunk_count; i++) {
     want_to_encode.insert(i);
   }
 
   map<int,bufferlist> encoded;
-  code = erasure_code->encode(want_to_encode, in, &encoded);
+  int code = erasure_code->encode(want_to_encode, in, &encoded);
   if (code)
     return code;
 
@@ -291,13 +534,14 @@ int ErasureCodeBench::decode()
 	 i != erased.end();
 	 ++i)
       encoded.erase(*i);
-    display_chunks(encoded, erasure_code->get_chunk_count());
+    if (format == "plain")
+      display_chunks(encoded, erasure_code->get_chunk_count());
   }
 
-  utime_t begin_time = ceph_clock_now();
+  w.start();
   for (int i = 0; i < max_iterations; i++) {
     if (exhaustive_erasures) {
-      code = decode_erasures(encoded, encoded, 0, erasures, erasure_code);
+      code = decode_erasures(encoded, encoded, 0, w.erasures, erasure_code);
       if (code)
 	return code;
     } else if (erased.size() > 0) {
@@ -307,10 +551,10 @@ int ErasureCodeBench::decode()
 	return code;
     } else {
       map<int,bufferlist> chunks = encoded;
-      for (int j = 0; j < erasures; j++) {
+      for (int j = 0; j < w.erasures; j++) {
 	int erasure;
 	do {
-	  erasure = rand() % ( k + m );
+	  erasure = rand() % chunk_count;
 	} while(chunks.count(erasure) == 0);
 	chunks.erase(erasure);
       }
@@ -319,9 +563,75 @@ int ErasureCodeBench::decode()
       if (code)
 	return code;
     }
+    w.bytes += w.in_size;
+  }
+  w.stop();
+  return 0;
+}
+
+/*
+ * Overwrite rmw_size bytes of an encoded stripe the way an EC pool
+ * handles a partial stripe write: read the data back (from a degraded
+ * set of chunks when erasures > 0), patch the range and encode the
+ * whole stripe again.
+ */
+int ErasureCodeBench::rmw(Worker &w)
+{
+  ErasureCodeInterfaceRef erasure_code = w.erasure_code;
+  const int chunk_count = erasure_code->get_chunk_count();
+  bufferlist in;
+  in.append(string(w.in_size, 'X'));
+  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+
+  set<int> want_to_encode;
+  for (int i = 0; i < chunk_count; i++) {
+    want_to_encode.insert(i);
+  }
+
+  map<int,bufferlist> encoded;
+  int code = erasure_code->encode(want_to_encode, in, &encoded);
+  if (code)
+    return code;
+
+  const unsigned stripe_width = erasure_code->get_data_chunk_count() *
+    encoded.begin()->second.length();
+  const unsigned len = std::min<unsigned>(rmw_size, stripe_width);
+  bufferlist update;
+  update.append(string(len, 'Y'));
+
+  w.start();
+  for (int i = 0; i < max_iterations; i++) {
+    map<int,bufferlist> chunks = encoded;
+    for (int j = 0; j < w.erasures; j++) {
+      int erasure;
+      do {
+	erasure = rand() % chunk_count;
+      } while(chunks.count(erasure) == 0);
+      chunks.erase(erasure);
+    }
+    bufferlist stripe;
+    code = erasure_code->decode_concat(chunks, &stripe);
+    if (code)
+      return code;
+
+    const unsigned offset = (uint64_t)i * len % (stripe_width - len + 1);
+    bufferlist modified;
+    modified.substr_of(stripe, 0, offset);
+    modified.append(update);
+    if (offset + len < stripe.length()) {
+      bufferlist tail;
+      tail.substr_of(stripe, offset + len, stripe.length() - offset - len);
+      modified.claim_append(tail);
+    }
+    modified.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+
+    encoded.clear();
+    code = erasure_code->encode(want_to_encode, modified, &encoded);
+    if (code)
+      return code;
+    w.bytes += len;
   }
-  utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  w.stop();
   return 0;
 }
 
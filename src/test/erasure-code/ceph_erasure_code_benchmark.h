@@ -18,6 +18,8 @@
 #ifndef CEPH_ERASURE_CODE_BENCHMARK_H
 #define CEPH_ERASURE_CODE_BENCHMARK_H
 
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <map>
 #include <vector>
@@ -27,6 +29,8 @@
 #include "include/buffer.h"
 
 #include "common/ceph_context.h"
+#include "common/Formatter.h"
+#include "include/utime.h"
 
 #include "erasure-code/ErasureCodeInterface.h"
 
@@ -36,17 +40,67 @@ class ErasureCodeBench {
   int erasures;
   int k;
   int m;
+  int threads;
+  int rmw_size;
 
   std::string plugin;
 
   bool exhaustive_erasures;
   std::vector<int> erased;
   std::string workload;
+  std::string format;
+
+  bool sweep;
+  std::vector<std::string> sweep_plugins;
+  std::vector<std::pair<int, int>> sweep_km;
+  std::vector<int> sweep_chunk_sizes;
 
   ceph::ErasureCodeProfile profile;
 
   bool verbose;
   boost::intrusive_ptr<CephContext> cct;
+
+  /// released once every worker has finished its setup
+  class StartGate {
+    std::mutex lock;
+    std::condition_variable cond;
+    unsigned waiting = 0;
+    unsigned expected;
+    bool open = false;
+  public:
+    explicit StartGate(unsigned expected) : expected(expected) {}
+    void wait();
+  };
+
+  /// state of one benchmark thread
+  struct Worker {
+    ErasureCodeInterfaceRef erasure_code;
+    StartGate *gate;
+    int in_size;
+    int erasures;
+    bool started = false;
+    utime_t begin;
+    utime_t elapsed;
+    uint64_t bytes = 0;
+    int code = 0;
+
+    Worker(ErasureCodeInterfaceRef erasure_code, StartGate *gate,
+	   int in_size, int erasures)
+      : erasure_code(erasure_code), gate(gate),
+	in_size(in_size), erasures(erasures) {}
+    void start();
+    void stop();
+  };
+
+  int run_workload(const std::string &plugin,
+		   const ceph::ErasureCodeProfile &profile,
+		   const std::string &workload,
+		   int erasures,
+		   int in_size,
+		   ceph::Formatter *f);
+  int sweep_profile(const std::string &plugin, int k, int m,
+		    ceph::ErasureCodeProfile *profile);
+  int run_sweep();
 public:
   int setup(int argc, char** argv);
   int run();
@@ -55,8 +109,9 @@ public:
 		      unsigned i,
 		      unsigned want_erasures,
 		      ErasureCodeInterfaceRef erasure_code);
-  int decode();
-  int encode();
+  int decode(Worker &w);
+  int encode(Worker &w);
+  int rmw(Worker &w);
 };
 
 #endif
@@ -0,0 +1,199 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Many-files cap churn between two clients, run once with
+ * mds_cap_batch_max=0 and once with the configured batch size.  Client
+ * A keeps N files open for buffered writes, client B stats them (A's
+ * Fwb is revoked) and A writes again (and gets it granted back).  The
+ * number of file caps churned is reported next to the number of caps
+ * messages the MDS actually sent for them.
+ *
+ * The file count can be changed with CEPH_TEST_CAPS_BATCH_FILES.
+ */
+
+#include "gtest/gtest.h"
+#include "include/cephfs/libcephfs.h"
+#include "include/ceph_assert.h"
+#include "common/ceph_time.h"
+#include "json_spirit/json_spirit.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+int mds_command(struct ceph_mount_info *cmount, const string& cmd,
+		json_spirit::mValue *out = nullptr)
+{
+  const char *cmdv[] = {cmd.c_str()};
+  char *outb = nullptr, *outs = nullptr;
+  size_t outb_len = 0, outs_len = 0;
+  int r = ceph_mds_command(cmount, "0", cmdv, 1, nullptr, 0,
+			   &outb, &outb_len, &outs, &outs_len);
+  if (r == 0 && out &&
+      !json_spirit::read(string(outb, outb_len), *out)) {
+    r = -EINVAL;
+  }
+  if (outb) {
+    ceph_buffer_free(outb);
+  }
+  if (outs) {
+    ceph_buffer_free(outs);
+  }
+  return r;
+}
+
+map<string, uint64_t> cap_counters(struct ceph_mount_info *cmount)
+{
+  map<string, uint64_t> counters;
+  json_spirit::mValue dump;
+  if (mds_command(cmount, R"({"prefix": "perf dump", "logger": "mds", "format": "json"})",
+		  &dump) < 0) {
+    return counters;
+  }
+  auto& mds = dump.get_obj()["mds"].get_obj();
+  for (auto name : {"ceph_cap_op_revoke", "ceph_cap_op_grant",
+		    "ceph_cap_batch", "ceph_cap_batched"}) {
+    auto p = mds.find(name);
+    counters[name] = p != mds.end() ? p->second.get_uint64() : 0;
+  }
+  return counters;
+}
+
+string get_batch_max(struct ceph_mount_info *cmount)
+{
+  json_spirit::mValue out;
+  if (mds_command(cmount,
+	R"({"prefix": "config get", "var": "mds_cap_batch_max", "format": "json"})",
+	&out) < 0) {
+    return "";
+  }
+  return out.get_obj()["mds_cap_batch_max"].get_str();
+}
+
+int set_batch_max(struct ceph_mount_info *cmount, const string& val)
+{
+  return mds_command(cmount,
+    R"({"prefix": "config set", "var": "mds_cap_batch_max", "val": [")" +
+    val + R"("]})");
+}
+
+struct ChurnResult {
+  double seconds = 0;
+  uint64_t caps = 0;      // revokes + grants
+  uint64_t messages = 0;  // what went out for them
+};
+
+ChurnResult churn(struct ceph_mount_info *ca, struct ceph_mount_info *cb,
+		  const vector<int>& fds, const vector<string>& paths)
+{
+  auto before = cap_counters(ca);
+  auto start = ceph::mono_clock::now();
+
+  for (auto& path : paths) {
+    struct ceph_statx stx;
+    ceph_assert(0 == ceph_statx(cb, path.c_str(), &stx,
+				CEPH_STATX_SIZE | CEPH_STATX_MTIME, 0));
+  }
+  for (auto fd : fds) {
+    ceph_assert(1 == ceph_write(ca, fd, "b", 1, -1));
+  }
+  for (auto fd : fds) {
+    ceph_assert(0 == ceph_fsync(ca, fd, 0));
+  }
+
+  ChurnResult res;
+  res.seconds = std::chrono::duration<double>(
+    ceph::mono_clock::now() - start).count();
+  auto after = cap_counters(ca);
+  res.caps = (after["ceph_cap_op_revoke"] - before["ceph_cap_op_revoke"]) +
+    (after["ceph_cap_op_grant"] - before["ceph_cap_op_grant"]);
+  uint64_t batches = after["ceph_cap_batch"] - before["ceph_cap_batch"];
+  uint64_t batched = after["ceph_cap_batched"] - before["ceph_cap_batched"];
+  res.messages = res.caps - batched + batches;
+  return res;
+}
+
+} // anonymous namespace
+
+TEST(LibCephFSCapsBatch, ManyFiles) {
+  int nfiles = 1000;
+  if (const char *s = getenv("CEPH_TEST_CAPS_BATCH_FILES")) {
+    nfiles = atoi(s);
+  }
+
+  struct ceph_mount_info *ca, *cb;
+  ASSERT_EQ(0, ceph_create(&ca, NULL));
+  ASSERT_EQ(0, ceph_conf_read_file(ca, NULL));
+  ASSERT_EQ(0, ceph_conf_parse_env(ca, NULL));
+  ASSERT_EQ(0, ceph_mount(ca, NULL));
+  ASSERT_EQ(0, ceph_create(&cb, NULL));
+  ASSERT_EQ(0, ceph_conf_read_file(cb, NULL));
+  ASSERT_EQ(0, ceph_conf_parse_env(cb, NULL));
+  ASSERT_EQ(0, ceph_mount(cb, NULL));
+
+  char dir[64];
+  sprintf(dir, "/caps_batch_%d", getpid());
+  ASSERT_EQ(0, ceph_mkdir(ca, dir, 0777));
+
+  vector<int> fds;
+  vector<string> paths;
+  for (int i = 0; i < nfiles; ++i) {
+    paths.push_back(string(dir) + "/f" + std::to_string(i));
+    int fd = ceph_open(ca, paths.back().c_str(), O_CREAT|O_RDWR, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(1, ceph_write(ca, fd, "a", 1, 0));
+    fds.push_back(fd);
+  }
+
+  string saved = get_batch_max(ca);
+  ASSERT_FALSE(saved.empty());
+
+  ASSERT_EQ(0, set_batch_max(ca, "0"));
+  auto unbatched = churn(ca, cb, fds, paths);
+  ASSERT_EQ(0, set_batch_max(ca, saved));
+  auto batched = churn(ca, cb, fds, paths);
+
+  for (auto& [name, r] : {std::pair{"unbatched", unbatched},
+			  std::pair{"batched", batched}}) {
+    std::cout << name << ": " << nfiles << " files, " << r.caps
+	      << " cap updates in " << r.messages << " messages, "
+	      << r.seconds << "s" << std::endl;
+  }
+  // nothing may get lost on the way
+  for (auto& path : paths) {
+    struct ceph_statx stx;
+    ASSERT_EQ(0, ceph_statx(cb, path.c_str(), &stx, CEPH_STATX_SIZE, 0));
+    ASSERT_EQ(3u, stx.stx_size);
+  }
+  if (std::stoi(saved) > 1) {
+    ASSERT_LE(batched.messages, unbatched.messages);
+  }
+
+  for (size_t i = 0; i < fds.size(); ++i) {
+    ASSERT_EQ(0, ceph_close(ca, fds[i]));
+    ASSERT_EQ(0, ceph_unlink(ca, paths[i].c_str()));
+  }
+  ASSERT_EQ(0, ceph_rmdir(ca, dir));
+  ceph_shutdown(cb);
+  ceph_shutdown(ca);
+}
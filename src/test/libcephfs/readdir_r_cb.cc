@@ -18,6 +18,8 @@
 #include "include/fs_types.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <set>
+#include <string>
 
 TEST(LibCephFS, ReaddirRCB) {
   struct ceph_mount_info *cmount;
@@ -63,3 +65,135 @@ TEST(LibCephFS, ReaddirRCB) {
   ASSERT_EQ(0, ceph_unmount(cmount));
   ASSERT_EQ(0, ceph_release(cmount));
 }
+
+TEST(LibCephFS, ReaddirPrefetch) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(0, ceph_create(&cmount, NULL));
+  ASSERT_EQ(0, ceph_conf_read_file(cmount, NULL));
+  ASSERT_EQ(0, ceph_mount(cmount, "/"));
+
+  char c_dir[256];
+  sprintf(c_dir, "/readdir_prefetch_tests_%d", getpid());
+  ASSERT_EQ(0, ceph_mkdirs(cmount, c_dir, 0777));
+  const int nfiles = 2000;
+  for (int i = 0; i < nfiles; i++) {
+    std::string path = std::string(c_dir) + "/f" + std::to_string(i);
+    int fd = ceph_open(cmount, path.c_str(), O_CREAT, 0644);
+    ASSERT_LT(0, fd);
+    ASSERT_EQ(0, ceph_close(cmount, fd));
+  }
+
+  // spread it over 8 dirfrags so that there is something to read ahead
+  std::string split = std::string("{\"prefix\": \"dirfrag split\", \"path\": \"") +
+    c_dir + "\", \"frag\": \"0/0\", \"bits\": 3}";
+  const char *cmd[] = {split.c_str()};
+  char *outb = NULL, *outs = NULL;
+  size_t outb_len = 0, outs_len = 0;
+  if (ceph_mds_command(cmount, "0", cmd, 1, NULL, 0,
+		       &outb, &outb_len, &outs, &outs_len) == 0) {
+    ceph_buffer_free(outb);
+    ceph_buffer_free(outs);
+  }
+  ASSERT_EQ(0, ceph_unmount(cmount));
+  ASSERT_EQ(0, ceph_release(cmount));
+
+  for (const char *dense : {"false", "true"}) {
+    // a fresh client, so that nothing comes from its readdir cache
+    ASSERT_EQ(0, ceph_create(&cmount, NULL));
+    ASSERT_EQ(0, ceph_conf_read_file(cmount, NULL));
+    ASSERT_EQ(0, ceph_conf_set(cmount, "client_readdir_prefetch", "4"));
+    ASSERT_EQ(0, ceph_conf_set(cmount, "client_readdir_dense", dense));
+    ASSERT_EQ(0, ceph_mount(cmount, "/"));
+
+    struct ceph_dir_result *dirp;
+    ASSERT_EQ(0, ceph_opendir(cmount, c_dir, &dirp));
+    std::set<std::string> names;
+    struct dirent *de;
+    while ((de = ceph_readdir(cmount, dirp)) != NULL) {
+      if (strcmp(de->d_name, ".") && strcmp(de->d_name, ".."))
+	ASSERT_TRUE(names.insert(de->d_name).second) << de->d_name;
+    }
+    ASSERT_EQ(nfiles, (int)names.size());
+
+    // and again, half way and back
+    ceph_rewinddir(cmount, dirp);
+    for (int i = 0; i < nfiles / 2; i++)
+      ASSERT_NE((struct dirent *)NULL, ceph_readdir(cmount, dirp));
+    int64_t pos = ceph_telldir(cmount, dirp);
+    int left = 0;
+    while (ceph_readdir(cmount, dirp) != NULL)
+      left++;
+    ceph_seekdir(cmount, dirp, pos);
+    int again = 0;
+    while (ceph_readdir(cmount, dirp) != NULL)
+      again++;
+    ASSERT_EQ(left, again);
+    ASSERT_LE(0, ceph_closedir(cmount, dirp));
+
+    if (!strcmp(dense, "true")) {
+      for (int i = 0; i < nfiles; i++) {
+	std::string path = std::string(c_dir) + "/f" + std::to_string(i);
+	ASSERT_EQ(0, ceph_unlink(cmount, path.c_str()));
+      }
+      ASSERT_EQ(0, ceph_rmdir(cmount, c_dir));
+    }
+    ASSERT_EQ(0, ceph_unmount(cmount));
+    ASSERT_EQ(0, ceph_release(cmount));
+  }
+}
+
+TEST(LibCephFS, ReaddirDenseXattrs) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(0, ceph_create(&cmount, NULL));
+  ASSERT_EQ(0, ceph_conf_read_file(cmount, NULL));
+  ASSERT_EQ(0, ceph_conf_set(cmount, "client_readdir_dense", "true"));
+  ASSERT_EQ(0, ceph_mount(cmount, "/"));
+
+  struct ceph_mount_info *cmount2;
+  ASSERT_EQ(0, ceph_create(&cmount2, NULL));
+  ASSERT_EQ(0, ceph_conf_read_file(cmount2, NULL));
+  ASSERT_EQ(0, ceph_mount(cmount2, "/"));
+
+  char c_dir[256], c_file[300], c_file2[300];
+  sprintf(c_dir, "/readdir_dense_xattrs_%d", getpid());
+  sprintf(c_file, "%s/f", c_dir);
+  sprintf(c_file2, "%s/g", c_dir);
+  ASSERT_EQ(0, ceph_mkdirs(cmount, c_dir, 0777));
+  int fd = ceph_open(cmount, c_file, O_CREAT, 0644);
+  ASSERT_LT(0, fd);
+  ASSERT_EQ(0, ceph_close(cmount, fd));
+  ASSERT_EQ(0, ceph_setxattr(cmount, c_file, "user.v", "one", 3, 0));
+
+  auto list = [&]() {
+    struct ceph_dir_result *dirp;
+    ASSERT_EQ(0, ceph_opendir(cmount, c_dir, &dirp));
+    while (ceph_readdir(cmount, dirp) != NULL)
+      ;
+    ASSERT_LE(0, ceph_closedir(cmount, dirp));
+  };
+  char buf[16];
+  list();
+  ASSERT_EQ(3, ceph_getxattr(cmount, c_file, "user.v", buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "one", 3));
+
+  // another client changes the xattr, and adds an entry so the next
+  // listing has to go to the mds rather than come from the cache
+  ASSERT_EQ(0, ceph_setxattr(cmount2, c_file, "user.v", "two", 3, 0));
+  fd = ceph_open(cmount2, c_file2, O_CREAT, 0644);
+  ASSERT_LT(0, fd);
+  ASSERT_EQ(0, ceph_close(cmount2, fd));
+
+  // the dense reply leaves the new xattrs out, so it must not hand out
+  // Xs to vouch for the old ones
+  list();
+  ASSERT_EQ(3, ceph_getxattr(cmount, c_file, "user.v", buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "two", 3));
+
+  ASSERT_EQ(0, ceph_unlink(cmount, c_file));
+  ASSERT_EQ(0, ceph_unlink(cmount, c_file2));
+  ASSERT_EQ(0, ceph_rmdir(cmount, c_dir));
+  ASSERT_EQ(0, ceph_unmount(cmount2));
+  ASSERT_EQ(0, ceph_release(cmount2));
+  ASSERT_EQ(0, ceph_unmount(cmount));
+  ASSERT_EQ(0, ceph_release(cmount));
+}
@@ -0,0 +1,142 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mds/HeatBalancer.h"
+
+#include "common/config.h"
+#include "global/global_context.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+class HeatBalancerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    auto& conf = g_ceph_context->_conf;
+    conf.set_val_or_die("mds_bal_heat_window", "3");
+    conf.set_val_or_die("mds_bal_heat_high_watermark", "0.2");
+    conf.set_val_or_die("mds_bal_heat_low_watermark", "0.05");
+    conf.set_val_or_die("mds_bal_heat_client_dominance", "0.8");
+  }
+
+  // two ranks; top is the busiest client's share of each rank's load
+  static map<mds_rank_t, HeatBalancer::rank_heat_t> loads(
+    double a, double b, double top = 0.1) {
+    map<mds_rank_t, HeatBalancer::rank_heat_t> heat;
+    heat[0].load = a;
+    heat[0].client_heat = a;
+    heat[0].top_client_heat = a * top;
+    heat[1].load = b;
+    heat[1].client_heat = b;
+    heat[1].top_client_heat = b * top;
+    return heat;
+  }
+};
+
+TEST_F(HeatBalancerTest, waits_for_a_full_window)
+{
+  HeatBalancer bal(g_ceph_context);
+  ASSERT_TRUE(bal.rebalance(1, loads(300, 100)).empty());
+  ASSERT_TRUE(bal.rebalance(2, loads(300, 100)).empty());
+  auto plan = bal.rebalance(3, loads(300, 100));
+  ASSERT_EQ(1u, plan.size());
+  ASSERT_DOUBLE_EQ(100.0, plan[0][1]);
+}
+
+TEST_F(HeatBalancerTest, ignores_a_burst)
+{
+  HeatBalancer bal(g_ceph_context);
+  bal.rebalance(1, loads(100, 100));
+  bal.rebalance(2, loads(100, 100));
+  // a single hot epoch pulls the average up but was not sustained
+  ASSERT_TRUE(bal.rebalance(3, loads(400, 100)).empty());
+  ASSERT_TRUE(bal.rebalance(4, loads(100, 100)).empty());
+}
+
+TEST_F(HeatBalancerTest, hysteresis)
+{
+  HeatBalancer bal(g_ceph_context);
+  for (int e = 1; e <= 3; ++e) {
+    bal.rebalance(e, loads(300, 100));
+  }
+  // 10% over target: under the high watermark, but still exporting
+  // until the low one is reached
+  for (int e = 4; e <= 6; ++e) {
+    bal.rebalance(e, loads(110, 90));
+  }
+  auto plan = bal.rebalance(7, loads(110, 90));
+  ASSERT_EQ(1u, plan.count(0));
+  for (int e = 8; e <= 10; ++e) {
+    bal.rebalance(e, loads(102, 98));
+  }
+  ASSERT_TRUE(bal.rebalance(11, loads(102, 98)).empty());
+  // and it takes a full window over the high watermark to start again
+  bal.rebalance(12, loads(130, 70));
+  ASSERT_TRUE(bal.rebalance(13, loads(130, 70)).empty());
+  plan = bal.rebalance(14, loads(130, 70));
+  ASSERT_EQ(1u, plan.count(0));
+}
+
+TEST_F(HeatBalancerTest, importer_cools_down)
+{
+  HeatBalancer bal(g_ceph_context);
+  for (int e = 1; e <= 3; ++e) {
+    bal.rebalance(e, loads(300, 100));
+  }
+  // mds.1 just imported; it must not start exporting right away even
+  // though the tables have turned
+  for (int e = 4; e <= 5; ++e) {
+    bal.rebalance(e, loads(100, 300));
+  }
+  auto plan = bal.rebalance(6, loads(100, 300));
+  ASSERT_EQ(0u, plan.count(1));
+  plan = bal.rebalance(7, loads(100, 300));
+  ASSERT_EQ(1u, plan.count(1));
+}
+
+TEST_F(HeatBalancerTest, dominant_client)
+{
+  HeatBalancer bal(g_ceph_context);
+  for (int e = 1; e <= 2; ++e) {
+    bal.rebalance(e, loads(300, 100, 0.9));
+  }
+  auto plan = bal.rebalance(3, loads(300, 100, 0.9));
+  // half of the way from the dominance threshold to a single client
+  ASSERT_DOUBLE_EQ(50.0, plan[0][1]);
+
+  bal.reset();
+  for (int e = 1; e <= 2; ++e) {
+    bal.rebalance(e, loads(300, 100, 1.0));
+  }
+  ASSERT_TRUE(bal.rebalance(3, loads(300, 100, 1.0)).empty());
+}
+
+TEST_F(HeatBalancerTest, rank_changes_restart_the_window)
+{
+  HeatBalancer bal(g_ceph_context);
+  bal.rebalance(1, loads(300, 100));
+  bal.rebalance(2, loads(300, 100));
+  auto heat = loads(300, 100);
+  heat[2].load = 100;
+  ASSERT_TRUE(bal.rebalance(3, heat).empty());
+}
+
+TEST_F(HeatBalancerTest, migration_cost)
+{
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("mds_bal_heat_inode_cost", "0.001");
+  conf.set_val_or_die("mds_bal_heat_cap_cost", "0.01");
+  HeatBalancer bal(g_ceph_context);
+  ASSERT_DOUBLE_EQ(20.0, bal.migration_cost(10000, 1000));
+  ASSERT_TRUE(bal.worth_migrating(25.0, 10000, 1000));
+  ASSERT_FALSE(bal.worth_migrating(15.0, 10000, 1000));
+}
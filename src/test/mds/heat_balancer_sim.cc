@@ -0,0 +1,341 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Replay a heat trace through the MDS balancer policies offline.
+ *
+ * A trace is a text file with one line per subtree, client and epoch:
+ *
+ *   <epoch> <subtree> <rank> <heat> <inodes> <caps> <client>
+ *
+ * <rank> is the rank that holds the subtree when it first shows up;
+ * after that the simulator decides where it lives.  <heat> is the load
+ * the client puts on the subtree during that epoch, in mds_load()
+ * units; a subtree with several clients has several lines.  Lines
+ * starting with '#' are ignored.  Traces can be assembled from periodic
+ * "dump loads" output of each rank, which has both the dirfrag
+ * popularity and the per-rank client heat.
+ *
+ * Without --trace a synthetic workload is generated: a few clients
+ * hammer one subtree each and hop to another subtree every so often,
+ * on top of background load spread over all subtrees.
+ *
+ * Each epoch the per-rank loads go through HeatBalancer, and every
+ * exporter hands over its hottest subtrees that fit the amount the way
+ * MDBalancer::find_exports() would.  --policy classic approximates the
+ * single-epoch balancer with the same code: a one epoch window, no
+ * hysteresis, no client or migration cost awareness.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include "global/global_init.h"
+#include "mds/HeatBalancer.h"
+
+using namespace std;
+
+struct Sample {
+  int epoch;
+  string subtree;
+  mds_rank_t rank;
+  double heat;
+  uint64_t inodes;
+  uint64_t caps;
+  int64_t client;
+};
+
+static int read_trace(const string& path, vector<Sample>* trace)
+{
+  ifstream in(path);
+  if (!in.is_open()) {
+    cerr << "cannot open " << path << std::endl;
+    return -ENOENT;
+  }
+  string line;
+  int lineno = 0;
+  while (getline(in, line)) {
+    ++lineno;
+    if (line.empty() || line[0] == '#')
+      continue;
+    istringstream ss(line);
+    Sample s;
+    if (!(ss >> s.epoch >> s.subtree >> s.rank >> s.heat >> s.inodes
+	  >> s.caps >> s.client)) {
+      cerr << path << ":" << lineno << ": malformed line" << std::endl;
+      return -EINVAL;
+    }
+    trace->push_back(s);
+  }
+  return 0;
+}
+
+static void generate_trace(int ranks, int subtrees, int clients, int epochs,
+			   int hop, unsigned seed, vector<Sample>* trace)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> noise(0.5, 1.5);
+  std::uniform_int_distribution<int> pick(0, subtrees - 1);
+  std::uniform_int_distribution<uint64_t> size(100, 100000);
+
+  vector<uint64_t> inodes(subtrees);
+  for (auto& i : inodes)
+    i = size(rng);
+  vector<int> hot(clients);
+  for (auto& h : hot)
+    h = pick(rng);
+
+  for (int e = 0; e < epochs; ++e) {
+    if (e > 0 && e % hop == 0) {
+      hot[pick(rng) % clients] = pick(rng);
+    }
+    for (int t = 0; t < subtrees; ++t) {
+      string name = "/dir" + to_string(t);
+      mds_rank_t rank = t % ranks;
+      // background load from a crowd of small clients
+      trace->push_back({e, name, rank, 10.0 * noise(rng), inodes[t],
+			inodes[t] / 100, 1000 + t});
+      for (int c = 0; c < clients; ++c) {
+	if (hot[c] == t) {
+	  trace->push_back({e, name, rank, 200.0 * noise(rng), inodes[t],
+			    inodes[t] / 10, c});
+	}
+      }
+    }
+  }
+}
+
+struct Result {
+  int epochs = 0;
+  int migrations = 0;
+  int bounces = 0;
+  uint64_t inodes_moved = 0;
+  uint64_t caps_moved = 0;
+  double cost = 0.0;
+  double imbalance = 0.0;   // sum over epochs of max / mean load
+};
+
+static Result simulate(CephContext *cct, const vector<Sample>& trace,
+		       double inode_cost, double cap_cost, bool verbose)
+{
+  const double need_min = cct->_conf->mds_bal_need_min;
+  const double need_max = cct->_conf->mds_bal_need_max;
+
+  HeatBalancer balancer(cct);
+  Result r;
+  map<string, mds_rank_t> owner;
+  // subtree -> (rank it left, epoch)
+  map<string, pair<mds_rank_t, int>> last_move;
+  set<mds_rank_t> ranks;
+  for (const auto& s : trace) {
+    ranks.insert(s.rank);
+  }
+
+  for (auto p = trace.begin(); p != trace.end(); ) {
+    int epoch = p->epoch;
+    map<string, double> subtree_heat;
+    map<string, pair<uint64_t, uint64_t>> subtree_size;
+    map<mds_rank_t, map<int64_t, double>> client_heat;
+    for (; p != trace.end() && p->epoch == epoch; ++p) {
+      auto o = owner.emplace(p->subtree, p->rank).first;
+      subtree_heat[p->subtree] += p->heat;
+      subtree_size[p->subtree] = {p->inodes, p->caps};
+      client_heat[o->second][p->client] += p->heat;
+    }
+
+    map<mds_rank_t, HeatBalancer::rank_heat_t> heat;
+    for (auto rank : ranks) {
+      heat[rank];
+    }
+    for (const auto& [subtree, h] : subtree_heat) {
+      heat[owner[subtree]].load += h;
+    }
+    for (const auto& [rank, clients] : client_heat) {
+      for (const auto& [client, h] : clients) {
+	heat[rank].client_heat += h;
+	heat[rank].top_client_heat = std::max(heat[rank].top_client_heat, h);
+      }
+    }
+
+    double total = 0.0, max_load = 0.0;
+    for (const auto& [rank, h] : heat) {
+      total += h.load;
+      max_load = std::max(max_load, h.load);
+    }
+    if (total > 0) {
+      r.imbalance += max_load / (total / heat.size());
+    }
+    ++r.epochs;
+
+    const auto& plan = balancer.rebalance(epoch, heat);
+    for (const auto& [from, targets] : plan) {
+      // the exporter's subtrees, hottest first
+      multimap<double, string, std::greater<double>> mine;
+      for (const auto& [subtree, rank] : owner) {
+	if (rank == from && subtree_heat.count(subtree)) {
+	  mine.emplace(subtree_heat[subtree], subtree);
+	}
+      }
+      for (const auto& [to, amount] : targets) {
+	double have = 0.0;
+	for (auto m = mine.begin(); m != mine.end() && have < amount * need_min; ) {
+	  auto [pop, subtree] = *m;
+	  auto [inodes, caps] = subtree_size[subtree];
+	  if (pop > (amount - have) * need_max ||
+	      !balancer.worth_migrating(pop, inodes, caps)) {
+	    ++m;
+	    continue;
+	  }
+	  have += pop;
+	  owner[subtree] = to;
+	  ++r.migrations;
+	  r.inodes_moved += inodes;
+	  r.caps_moved += caps;
+	  r.cost += inodes * inode_cost + caps * cap_cost;
+	  auto l = last_move.find(subtree);
+	  if (l != last_move.end() && l->second.first == to) {
+	    ++r.bounces;
+	  }
+	  last_move[subtree] = {from, epoch};
+	  if (verbose) {
+	    cout << "epoch " << epoch << ": " << subtree << " (" << pop
+		 << ") mds." << from << " -> mds." << to << std::endl;
+	  }
+	  m = mine.erase(m);
+	}
+      }
+    }
+  }
+  return r;
+}
+
+static void usage(const char *name)
+{
+  cout << "usage: " << name << " [options]\n"
+       << "  --trace FILE       replay FILE (default: synthetic workload)\n"
+       << "  --policy P         heat, classic or both (default both)\n"
+       << "  --verbose          print every migration\n"
+       << " synthetic workload:\n"
+       << "  --ranks N          active ranks (default 4)\n"
+       << "  --subtrees N       subtrees (default 32)\n"
+       << "  --clients N        hot clients (default 4)\n"
+       << "  --epochs N         heartbeat epochs (default 500)\n"
+       << "  --hop N            a hot client moves every N epochs (default 7)\n"
+       << "  --seed N           random seed (default 1)\n"
+       << " mds_bal_heat_* and mds_bal_need_* options are read from the\n"
+       << " usual config sources, e.g. --mds_bal_heat_window 10\n"
+       << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  string trace_path;
+  string policy = "both";
+  bool verbose = false;
+  int ranks = 4;
+  int subtrees = 32;
+  int clients = 4;
+  int epochs = 500;
+  int hop = 7;
+  int seed = 1;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &trace_path, "--trace", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &policy, "--policy", (char*)NULL)) {
+    } else if (ceph_argparse_witharg(args, i, &ranks, err, "--ranks", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &subtrees, err, "--subtrees", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &clients, err, "--clients", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &epochs, err, "--epochs", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &hop, err, "--hop", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &seed, err, "--seed", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << argv[0] << ": " << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+    } else if (ceph_argparse_flag(args, i, "--verbose", (char*)NULL)) {
+      verbose = true;
+    } else if (ceph_argparse_flag(args, i, "-h", "--help", (char*)NULL)) {
+      usage(argv[0]);
+      return 0;
+    } else {
+      cerr << "unknown option " << *i << std::endl;
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (policy != "heat" && policy != "classic" && policy != "both") {
+    cerr << argv[0] << ": unknown policy " << policy << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vector<Sample> trace;
+  if (!trace_path.empty()) {
+    int r = read_trace(trace_path, &trace);
+    if (r < 0) {
+      return EXIT_FAILURE;
+    }
+    std::stable_sort(trace.begin(), trace.end(),
+		     [](const Sample& a, const Sample& b) {
+		       return a.epoch < b.epoch;
+		     });
+  } else {
+    if (ranks < 1 || subtrees < 1 || clients < 1 || epochs < 1 || hop < 1) {
+      cerr << argv[0] << ": arguments must be positive" << std::endl;
+      return EXIT_FAILURE;
+    }
+    generate_trace(ranks, subtrees, clients, epochs, hop, seed, &trace);
+  }
+
+  // both policies are charged with the configured migration cost
+  const double inode_cost =
+    cct->_conf.get_val<double>("mds_bal_heat_inode_cost");
+  const double cap_cost = cct->_conf.get_val<double>("mds_bal_heat_cap_cost");
+  auto run = [&](const string& name) {
+    auto& conf = cct->_conf;
+    if (name == "classic") {
+      // everything the heat policy adds, turned off
+      conf.set_val_or_die("mds_bal_heat_window", "1");
+      conf.set_val_or_die("mds_bal_heat_high_watermark",
+			  std::to_string(conf->mds_bal_min_rebalance));
+      conf.set_val_or_die("mds_bal_heat_low_watermark",
+			  std::to_string(conf->mds_bal_min_rebalance));
+      conf.set_val_or_die("mds_bal_heat_client_dominance", "1");
+      conf.set_val_or_die("mds_bal_heat_inode_cost", "0");
+      conf.set_val_or_die("mds_bal_heat_cap_cost", "0");
+    }
+    Result r = simulate(cct.get(), trace, inode_cost, cap_cost, verbose);
+    cout << name
+	 << "\tepochs " << r.epochs
+	 << "\tmigrations " << r.migrations
+	 << "\tbounces " << r.bounces
+	 << "\tinodes_moved " << r.inodes_moved
+	 << "\tcaps_moved " << r.caps_moved
+	 << "\tcost " << std::fixed << std::setprecision(1) << r.cost
+	 << "\tavg_max/mean " << std::setprecision(3)
+	 << (r.epochs ? r.imbalance / r.epochs : 0.0)
+	 << std::defaultfloat << std::endl;
+  };
+  // heat first: the classic run overrides the heat options
+  if (policy != "classic") {
+    run("heat");
+  }
+  if (policy != "heat") {
+    run("classic");
+  }
+  return 0;
+}
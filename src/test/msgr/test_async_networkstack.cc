@@ -22,6 +22,8 @@
 #include <string>
 #include <set>
 #include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
 
 #include "acconfig.h"
@@ -436,6 +438,139 @@ TEST_P(NetworkWorkerTest, AcceptAndCloseTest) {
   });
 }
 
+static bool kernel_supports_zerocopy()
+{
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  int sd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (sd < 0) {
+    return false;
+  }
+  int flag = 1;
+  int r = ::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, &flag, sizeof(flag));
+  ::close(sd);
+  return r == 0;
+#else
+  return false;
+#endif
+}
+
+TEST_P(NetworkWorkerTest, ZeroCopySendTest) {
+  if (strcmp(GetParam(), "posix") || !kernel_supports_zerocopy()) {
+    GTEST_SKIP() << "no MSG_ZEROCOPY support";
+  }
+  g_ceph_context->_conf.set_val("ms_async_zerocopy", "true");
+  g_ceph_context->_conf.set_val("ms_async_zerocopy_min_size", "65536");
+
+  entity_addr_t bind_addr;
+  ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
+  const unsigned len = 1 << 20;
+  auto make_payload = [len](char c) {
+    bufferptr bp = buffer::create_page_aligned(len);
+    memset(bp.c_str(), c, len);
+    return bp;
+  };
+  bufferptr payload = make_payload('a');
+  bufferptr lingering = make_payload('b');
+
+  Worker *worker = get_worker(0);
+  PerfCounters *logger = worker->get_perf_counter();
+  uint64_t zerocopy_bytes = logger->get(l_msgr_send_zerocopy_bytes);
+
+  auto f = [&](Worker *) {
+    EventCenter *center = &worker->center;
+    SocketOptions options;
+    ServerSocket bind_socket;
+    ASSERT_EQ(0, worker->listen(bind_addr, 0, options, &bind_socket));
+
+    auto connect = [&](ConnectedSocket *cli, ConnectedSocket *srv) {
+      entity_addr_t cli_addr;
+      ASSERT_EQ(0, worker->connect(bind_addr, options, cli));
+      int r;
+      for (int i = 0; i < 5000; ++i) {
+	r = bind_socket.accept(srv, options, &cli_addr, worker);
+	if (r != -EAGAIN) {
+	  break;
+	}
+	center->process_events(1000);
+      }
+      ASSERT_EQ(0, r);
+      for (int i = 0; i < 5000; ++i) {
+	r = cli->is_connected();
+	if (r) {
+	  break;
+	}
+	center->process_events(1000);
+      }
+      ASSERT_EQ(1, r);
+    };
+    // send all of bl, reading it on the other end as we go
+    auto transfer = [&](ConnectedSocket *cli, ConnectedSocket *srv,
+			bufferlist bl) {
+      bufferlist expected = bl;
+      std::string received;
+      char buf[65536];
+      for (int i = 0; i < 100000 && received.size() < expected.length(); ++i) {
+	if (bl.length()) {
+	  ssize_t r = cli->send(bl, false);
+	  ASSERT_LE(0, r);
+	}
+	ssize_t r = srv->read(buf, sizeof(buf));
+	if (r > 0) {
+	  received.append(buf, r);
+	} else {
+	  ASSERT_EQ(-EAGAIN, r);
+	  usleep(100);
+	}
+      }
+      ASSERT_EQ(0u, bl.length());
+      ASSERT_EQ(expected.to_str(), received);
+    };
+
+    // the payload is handed to the kernel without copying, so the socket
+    // keeps it until the kernel reports it done with it
+    ConnectedSocket cli, srv;
+    connect(&cli, &srv);
+    {
+      bufferlist bl;
+      bl.append("header", 6);
+      bl.append(payload);
+      transfer(&cli, &srv, std::move(bl));
+    }
+    ASSERT_LT(zerocopy_bytes, logger->get(l_msgr_send_zerocopy_bytes));
+    ASSERT_LE(2, payload.raw_nref());
+    for (int i = 0; i < 5000 && payload.raw_nref() > 1; ++i) {
+      usleep(1000);
+      cli.reap_send_completions();
+    }
+    ASSERT_EQ(1, payload.raw_nref());
+
+    // closing the socket does not release what the kernel may still read
+    zerocopy_bytes = logger->get(l_msgr_send_zerocopy_bytes);
+    ConnectedSocket cli2, srv2;
+    connect(&cli2, &srv2);
+    {
+      bufferlist bl;
+      bl.append(lingering);
+      transfer(&cli2, &srv2, std::move(bl));
+    }
+    ASSERT_LT(zerocopy_bytes, logger->get(l_msgr_send_zerocopy_bytes));
+    cli2.close();
+    ASSERT_LE(2, lingering.raw_nref());
+    bind_socket.abort_accept();
+  };
+  C_dispatch<decltype(f)> e(worker, std::move(f));
+  worker->center.dispatch_event_external(&e);
+  e.wait();
+
+  // until the worker sees the kernel is done
+  for (int i = 0; i < 5000 && lingering.raw_nref() > 1; ++i) {
+    usleep(1000);
+  }
+  ASSERT_EQ(1, lingering.raw_nref());
+
+  g_ceph_context->_conf.set_val("ms_async_zerocopy", "false");
+}
+
 TEST_P(NetworkWorkerTest, ComplexTest) {
   entity_addr_t bind_addr;
   std::atomic_bool listen_done(false);
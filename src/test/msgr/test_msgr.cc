@@ -20,9 +20,11 @@
 #include <memory>
 #include <set>
 #include <stdlib.h>
+#include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/random/binomial_distribution.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int.hpp>
@@ -32,6 +34,7 @@
 
 #include "common/ceph_argparse.h"
 #include "common/ceph_mutex.h"
+#include "common/perf_counters_collection.h"
 #include "global/global_init.h"
 #include "messages/MCommand.h"
 #include "messages/MPing.h"
@@ -2082,6 +2085,75 @@ TEST_P(MessengerTest, SyntheticStressTest1) {
   test_msg.wait_for_done();
 }
 
+static bool kernel_supports_zerocopy()
+{
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  int sd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (sd < 0) {
+    return false;
+  }
+  int flag = 1;
+  int r = ::setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, &flag, sizeof(flag));
+  ::close(sd);
+  return r == 0;
+#else
+  return false;
+#endif
+}
+
+static uint64_t get_msgr_send_zerocopy_bytes()
+{
+  uint64_t bytes = 0;
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [&bytes](const PerfCountersCollectionImpl::CounterMap &by_path) {
+      for (auto& [path, ref] : by_path) {
+	if (boost::algorithm::ends_with(path, ".msgr_send_zerocopy_bytes")) {
+	  bytes += ref.data->u64;
+	}
+      }
+    });
+  return bytes;
+}
+
+TEST_P(MessengerTest, SyntheticZeroCopyTest) {
+  if (strcmp(GetParam(), "async+posix") || !kernel_supports_zerocopy()) {
+    GTEST_SKIP() << "no MSG_ZEROCOPY support";
+  }
+  g_ceph_context->_conf.set_val("ms_async_zerocopy", "true");
+  g_ceph_context->_conf.set_val("ms_async_zerocopy_min_size", "4096");
+  uint64_t zerocopy_bytes = get_msgr_send_zerocopy_bytes();
+  SyntheticWorkload test_msg(4, 16, GetParam(), 100,
+                             Messenger::Policy::stateful_server(0),
+                             Messenger::Policy::lossless_client(0));
+  for (int i = 0; i < 10; ++i) {
+    test_msg.generate_connection();
+  }
+  gen_type rng(time(NULL));
+  for (int i = 0; i < 2000; ++i) {
+    if (!(i % 10)) {
+      lderr(g_ceph_context) << "Op " << i << ": " << dendl;
+      test_msg.print_internal_state();
+    }
+    boost::uniform_int<> true_false(0, 99);
+    int val = true_false(rng);
+    if (val > 95) {
+      test_msg.generate_connection();
+    } else if (val > 90) {
+      test_msg.drop_connection();
+    } else if (val > 10) {
+      test_msg.send_message();
+    } else {
+      usleep(rand() % 1000 + 500);
+    }
+  }
+  test_msg.wait_for_done();
+  // message payloads went out without being copied, at least until the
+  // kernel told each socket that loopback copies them anyway
+  ASSERT_LT(zerocopy_bytes, get_msgr_send_zerocopy_bytes());
+  g_ceph_context->_conf.set_val("ms_async_zerocopy", "false");
+  g_ceph_context->_conf.set_val("ms_async_zerocopy_min_size", "65536");
+}
+
 
 TEST_P(MessengerTest, SyntheticInjectTest) {
   uint64_t dispatch_throttle_bytes = g_ceph_context->_conf->ms_dispatch_throttle_bytes;
@@ -4,7 +4,9 @@
  * In memory space allocator benchmarks.
  * Author: Igor Fedotov, ifedotov@suse.com
  */
+#include <atomic>
 #include <iostream>
+#include <thread>
 #include <boost/scoped_ptr.hpp>
 #include <gtest/gtest.h>
 
@@ -328,6 +330,74 @@ TEST_P(AllocTest, test_alloc_bench_10_300)
   doOverwriteTest(capacity, prefill, overwrite);
 }
 
+// OSD shards allocating at once: each thread keeps up to a slice of the
+// capacity allocated, releasing random extents of its own to make room
+void doParallelTest(Allocator* alloc, uint64_t capacity, unsigned threads,
+		    uint64_t ops_per_thread)
+{
+  uint64_t alloc_unit = 4096;
+  uint64_t held_max = capacity / 2 / threads;
+  std::atomic<uint64_t> failed = 0;
+
+  auto worker = [&](unsigned seed) {
+    gen_type rng(seed);
+    boost::uniform_int<> u1(0, 6); // 4K-256K
+    PExtentVector held, tmp;
+    uint64_t held_bytes = 0;
+    for (uint64_t i = 0; i < ops_per_thread; i++) {
+      while (held_bytes >= held_max && !held.empty()) {
+	size_t pos = rng() % held.size();
+	interval_set<uint64_t> release_set;
+	release_set.insert(held[pos].offset, held[pos].length);
+	alloc->release(release_set);
+	held_bytes -= held[pos].length;
+	held[pos] = held.back();
+	held.pop_back();
+      }
+      uint64_t want = alloc_unit << u1(rng);
+      tmp.clear();
+      auto r = alloc->allocate(want, alloc_unit, 0, 0, &tmp);
+      if (r < (int64_t)want) {
+	++failed;
+      }
+      for (auto& e : tmp) {
+	held.push_back(e);
+	held_bytes += e.length;
+      }
+    }
+    alloc->release(held);
+  };
+
+  utime_t start = ceph_clock_now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back(worker, t);
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  utime_t elapsed = ceph_clock_now() - start;
+  std::cout << threads << " threads: " << threads * ops_per_thread
+	    << " allocations in " << elapsed << " ("
+	    << threads * ops_per_thread / (double)elapsed << " per sec), "
+	    << failed << " short" << std::endl;
+  EXPECT_EQ(0u, failed);
+  EXPECT_EQ(capacity, alloc->get_free());
+  std::cout << "fragmentation score " << alloc->get_fragmentation_score()
+	    << std::endl;
+}
+
+TEST_P(AllocTest, test_alloc_bench_parallel)
+{
+  uint64_t capacity = uint64_t(256) * 1024 * 1024 * 1024;
+  for (unsigned threads : {16, 32}) {
+    init_alloc(capacity, 4096);
+    alloc->init_add_free(0, capacity);
+    doParallelTest(alloc.get(), capacity, threads, 200000);
+    init_close();
+  }
+}
+
 TEST_P(AllocTest, mempoolAccounting)
 {
   uint64_t bytes = mempool::bluestore_alloc::allocated_bytes();
@@ -365,4 +435,4 @@ TEST_P(AllocTest, mempoolAccounting)
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap", "avl", "btree", "hybrid"));
+  ::testing::Values("stupid", "bitmap", "avl", "btree", "hybrid", "sharded"));
@@ -13,6 +13,7 @@
 #include "include/stringify.h"
 #include "include/Context.h"
 #include "os/bluestore/Allocator.h"
+#include "os/bluestore/ShardedAllocator.h"
 
 using namespace std;
 
@@ -632,6 +633,104 @@ TEST_P(AllocTest, test_alloc_50656_first_fit)
   EXPECT_EQ(got, 0x400000);
 }
 
+TEST(ShardedAllocator, regions)
+{
+  uint64_t block = 0x10000;
+  uint64_t region = ShardedAllocator::MIN_REGION_SIZE;
+  uint64_t capacity = 4 * region;
+  ShardedAllocator alloc(g_ceph_context, "avl", capacity, block, 16, "");
+  // no region smaller than the minimum
+  ASSERT_EQ(4u, alloc.get_num_shards());
+
+  alloc.init_add_free(0, capacity);
+  ASSERT_EQ(capacity, alloc.get_free());
+  // spans regions, is still reported as one piece
+  EXPECT_EQ(0, alloc.get_fragmentation_score());
+  size_t n = 0;
+  alloc.foreach([&](uint64_t offset, uint64_t length) {
+    EXPECT_EQ(0u, offset);
+    EXPECT_EQ(capacity, length);
+    ++n;
+  });
+  EXPECT_EQ(1u, n);
+
+  // fill it up, stealing from the other regions as ours runs dry
+  PExtentVector extents;
+  uint64_t allocated = 0;
+  while (allocated < capacity) {
+    auto r = alloc.allocate(64 * block, block, 0, 0, &extents);
+    ASSERT_EQ(64 * block, r);
+    allocated += r;
+  }
+  EXPECT_EQ(0u, alloc.get_free());
+  PExtentVector more;
+  EXPECT_EQ(-ENOSPC, alloc.allocate(block, block, 0, 0, &more));
+
+  // release across the boundary of two regions in one go
+  interval_set<uint64_t> release_set;
+  release_set.insert(region - 2 * block, 4 * block);
+  alloc.release(release_set);
+  EXPECT_EQ(4 * block, alloc.get_free());
+  n = 0;
+  alloc.foreach([&](uint64_t offset, uint64_t length) {
+    EXPECT_EQ(region - 2 * block, offset);
+    EXPECT_EQ(4 * block, length);
+    ++n;
+  });
+  EXPECT_EQ(1u, n);
+
+  // and get it back from both
+  more.clear();
+  EXPECT_EQ(4 * block, alloc.allocate(4 * block, block, 0, 0, &more));
+  interval_set<uint64_t> got;
+  for (auto& e : more) {
+    got.insert(e.offset, e.length);
+  }
+  EXPECT_EQ(release_set, got);
+  alloc.shutdown();
+}
+
+TEST(ShardedAllocator, small_device)
+{
+  uint64_t block = 0x1000;
+  uint64_t capacity = 1024 * 1024 * block;
+  ShardedAllocator alloc(g_ceph_context, "bitmap", capacity, block, 8, "");
+  ASSERT_EQ(4u, alloc.get_num_shards());
+  ShardedAllocator tiny(g_ceph_context, "bitmap", 1024 * block, block, 8, "");
+  ASSERT_EQ(1u, tiny.get_num_shards());
+  tiny.init_add_free(0, 1024 * block);
+  PExtentVector extents;
+  EXPECT_EQ(16 * block, tiny.allocate(16 * block, block, 0, 0, &extents));
+  EXPECT_EQ(1008 * block, tiny.get_free());
+  tiny.shutdown();
+  alloc.shutdown();
+}
+
+TEST(ShardedAllocator, unit_alignment)
+{
+  // regions of an uneven device must not start off the alloc unit
+  uint64_t block = 0x1000;
+  uint64_t unit = 0x10000;
+  uint64_t capacity = 5 * ShardedAllocator::MIN_REGION_SIZE + 0x123000;
+  ShardedAllocator alloc(g_ceph_context, "avl", capacity, block, 4, "");
+  ASSERT_LT(1u, alloc.get_num_shards());
+  alloc.init_add_free(0, capacity);
+
+  PExtentVector extents;
+  uint64_t allocated = 0;
+  int64_t r;
+  while ((r = alloc.allocate(256 * unit, unit, 0, 0, &extents)) > 0) {
+    allocated += r;
+  }
+  EXPECT_EQ(-ENOSPC, r);
+  EXPECT_EQ(p2align(capacity, unit), allocated);
+  for (auto& e : extents) {
+    ASSERT_EQ(0u, e.offset % unit) << e;
+    ASSERT_EQ(0u, e.length % unit) << e;
+  }
+  alloc.shutdown();
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
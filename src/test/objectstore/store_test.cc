@@ -17,6 +17,7 @@
 #include <string.h>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <time.h>
 #include <sys/mount.h>
 #include <boost/random/mersenne_twister.hpp>
@@ -2115,6 +2116,228 @@ TEST_P(StoreTestSpecificAUSize, BluestoreStatFSTest) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, BluestoreRecompress) {
+  if(string(GetParam()) != "bluestore")
+    return;
+  if (smr) {
+    cout << "TODO: fix this for smr" << std::endl;
+    return;
+  }
+  StartDeferred(4096);
+  // inline compression only when hinted
+  SetVal(g_conf(), "bluestore_compression_mode", "passive");
+  SetVal(g_conf(), "bluestore_recompression_algorithm", "zlib");
+  SetVal(g_conf(), "bluestore_fsck_on_umount", "true");
+  g_conf().apply_changes(nullptr);
+  int r;
+
+  int poolid = 4373;
+  coll_t cid = coll_t(spg_t(pg_t(0, poolid), shard_id_t::NO_SHARD));
+  ghobject_t text(hobject_t(sobject_t("text", CEPH_NOSNAP),
+			    string(), 0, poolid, string()));
+  ghobject_t noise(hobject_t(sobject_t("noise", CEPH_NOSNAP),
+			     string(), 1, poolid, string()));
+  const unsigned size = 0x40000;
+  bufferlist text_bl, noise_bl;
+  while (text_bl.length() < size) {
+    text_bl.append("the quick brown fox jumps over the lazy dog\n");
+  }
+  text_bl.splice(size, text_bl.length() - size);
+  {
+    std::mt19937 rng(0);
+    bufferptr p(size);
+    for (unsigned i = 0; i < size; ++i) {
+      p.c_str()[i] = rng();
+    }
+    noise_bl.append(p);
+  }
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.write(cid, text, 0, size, text_bl);
+    t.write(cid, noise, 0, size, noise_bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto remount = [&]() {
+    ch.reset();
+    EXPECT_EQ(store->umount(), 0);
+    EXPECT_EQ(store->mount(), 0);
+    ch = store->open_collection(cid);
+  };
+  auto compressed_original = [&]() {
+    struct store_statfs_t statfs;
+    bool per_pool_omap;
+    EXPECT_EQ(0, store->pool_statfs(poolid, &statfs, &per_pool_omap));
+    return statfs.data_compressed_original;
+  };
+  ASSERT_EQ(0, compressed_original());
+
+  uint64_t bytes = 0;
+  // just written, so not cold yet
+  ASSERT_EQ(0, store->recompress(ch, text, &bytes));
+  ASSERT_EQ(0u, bytes);
+
+  remount();
+  ASSERT_EQ(0, store->recompress(ch, text, &bytes));
+  ASSERT_EQ(size, bytes);
+  ASSERT_EQ(size, compressed_original());
+  ASSERT_EQ(0, store->recompress(ch, noise, &bytes));
+  ASSERT_EQ(size, bytes);
+  ASSERT_EQ(size, compressed_original());
+  {
+    ghobject_t missing(hobject_t(sobject_t("missing", CEPH_NOSNAP),
+				 string(), 2, poolid, string()));
+    ASSERT_EQ(-ENOENT, store->recompress(ch, missing, &bytes));
+  }
+
+  // neither is looked at again until written to
+  remount();
+  {
+    bufferlist bl;
+    r = store->read(ch, text, 0, size, bl);
+    ASSERT_EQ((int)size, r);
+    ASSERT_TRUE(bl_eq(text_bl, bl));
+  }
+  remount();
+  ASSERT_EQ(0, store->recompress(ch, text, &bytes));
+  ASSERT_EQ(0u, bytes);
+  ASSERT_EQ(0, store->recompress(ch, noise, &bytes));
+  ASSERT_EQ(0u, bytes);
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.substr_of(noise_bl, 0, 0x10000);
+    t.write(cid, noise, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  remount();
+  ASSERT_EQ(0, store->recompress(ch, noise, &bytes));
+  ASSERT_EQ(size, bytes);
+
+  // nor in pools that are not to be compressed
+  {
+    ObjectStore::Transaction t;
+    t.write(cid, text, 0, size, text_bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  SetVal(g_conf(), "bluestore_compression_mode", "none");
+  g_conf().apply_changes(nullptr);
+  remount();
+  ASSERT_EQ(0, store->recompress(ch, text, &bytes));
+  ASSERT_EQ(0u, bytes);
+  ASSERT_EQ(0, compressed_original());
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, text);
+    t.remove(cid, noise);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTestSpecificAUSize, BluestoreRecompressAdaptive) {
+  if(string(GetParam()) != "bluestore")
+    return;
+  if (smr) {
+    cout << "TODO: fix this for smr" << std::endl;
+    return;
+  }
+  StartDeferred(4096);
+  SetVal(g_conf(), "bluestore_compression_mode", "passive");
+  SetVal(g_conf(), "bluestore_compression_algorithm", "zlib");
+  SetVal(g_conf(), "bluestore_compression_adaptive", "true");
+  SetVal(g_conf(), "bluestore_recompression_algorithm", "zlib");
+  SetVal(g_conf(), "bluestore_recompression_required_ratio", "0.3");
+  g_conf().apply_changes(nullptr);
+  int r;
+
+  int poolid = 4374;
+  coll_t cid = coll_t(spg_t(pg_t(0, poolid), shard_id_t::NO_SHARD));
+  ghobject_t text(hobject_t(sobject_t("text", CEPH_NOSNAP),
+			    string(), 0, poolid, string()));
+  const unsigned size = 0x40000;
+  const string line = "the quick brown fox jumps over the lazy dog\n";
+  bufferlist text_bl;
+  while (text_bl.length() < size) {
+    text_bl.append(line);
+  }
+  text_bl.splice(size, text_bl.length() - size);
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.write(cid, text, 0, size, text_bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ch.reset();
+  EXPECT_EQ(store->umount(), 0);
+  EXPECT_EQ(store->mount(), 0);
+  ch = store->open_collection(cid);
+
+  // teach the collection that data with the entropy of text compresses
+  // to about half inline: the same letters shuffled within each line
+  SetVal(g_conf(), "bluestore_compression_mode", "aggressive");
+  g_conf().apply_changes(nullptr);
+  std::mt19937 rng(0);
+  for (unsigned i = 0; i < 8; ++i) {
+    ghobject_t oid(hobject_t(sobject_t("shuffled" + stringify(i), CEPH_NOSNAP),
+			     string(), 1 + i, poolid, string()));
+    bufferlist bl;
+    while (bl.length() < size) {
+      string l = line;
+      std::shuffle(l.begin(), l.end(), rng);
+      bl.append(l);
+    }
+    bl.splice(size, bl.length() - size);
+    ObjectStore::Transaction t;
+    t.write(cid, oid, 0, size, bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  SetVal(g_conf(), "bluestore_compression_mode", "passive");
+  g_conf().apply_changes(nullptr);
+
+  // recompression tried the text itself and saw it pass, so that must
+  // not be second guessed by what inline compression learnt
+  struct store_statfs_t statfs;
+  bool per_pool_omap;
+  ASSERT_EQ(0, store->pool_statfs(poolid, &statfs, &per_pool_omap));
+  const uint64_t compressed_original = statfs.data_compressed_original;
+  uint64_t bytes = 0;
+  ASSERT_EQ(0, store->recompress(ch, text, &bytes));
+  ASSERT_EQ(size, bytes);
+  ASSERT_EQ(0, store->pool_statfs(poolid, &statfs, &per_pool_omap));
+  ASSERT_EQ(compressed_original + size, statfs.data_compressed_original);
+  {
+    bufferlist bl;
+    r = store->read(ch, text, 0, size, bl);
+    ASSERT_EQ((int)size, r);
+    ASSERT_TRUE(bl_eq(text_bl, bl));
+  }
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, text);
+    for (unsigned i = 0; i < 8; ++i) {
+      t.remove(cid, ghobject_t(hobject_t(
+        sobject_t("shuffled" + stringify(i), CEPH_NOSNAP),
+        string(), 1 + i, poolid, string())));
+    }
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BluestoreFragmentedBlobTest) {
   if(string(GetParam()) != "bluestore")
     return;
@@ -2862,6 +3085,68 @@ TEST_P(StoreTest, ZeroVsObjectSize) {
   ASSERT_EQ(100200, stat.st_size);
 }
 
+TEST_P(StoreTest, ReadCrc32c) {
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("foo", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // data, a hole, and a partial block of data at the end
+  auto make_data = [](unsigned len, char seed) {
+    bufferlist bl;
+    bufferptr bp(len);
+    for (unsigned i = 0; i < len; ++i) {
+      bp.c_str()[i] = seed + i * 7 + (i >> 9);
+    }
+    bl.append(bp);
+    return bl;
+  };
+  {
+    ObjectStore::Transaction t;
+    t.write(cid, hoid, 0, 0x10000, make_data(0x10000, 'a'));
+    t.write(cid, hoid, 0x30000, 0x1234, make_data(0x1234, 'z'));
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // start off with nothing cached, to read what is on disk
+  ch.reset();
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+  ch = store->open_collection(cid);
+  const std::pair<uint64_t, uint64_t> ranges[] = {
+    {0, 0x40000}, {0, 0x10000}, {0x123, 0x8000}, {0x8000, 0x30000},
+    {0x30001, 0x1000}, {0x31000, 0x1000}, {0x50000, 0x1000}};
+  for (uint32_t flags : {0u, (uint32_t)CEPH_OSD_OP_FLAG_FADVISE_WILLNEED,
+			 (uint32_t)CEPH_OSD_OP_FLAG_BYPASS_CLEAN_CACHE}) {
+    for (auto [off, len] : ranges) {
+      for (uint32_t seed : {0xffffffffu, 0u, 0x12345678u}) {
+	bufferlist bl, expected;
+	uint32_t crc = seed;
+	r = store->read_crc32c(ch, hoid, off, len, bl, &crc, flags);
+	ASSERT_GE(r, 0);
+	ASSERT_EQ((unsigned)r, bl.length());
+	ASSERT_EQ(r, store->read(ch, hoid, off, len, expected));
+	ASSERT_TRUE(bl.contents_equal(expected));
+	ASSERT_EQ(expected.crc32c(seed), crc)
+	  << std::hex << off << "~" << len << " seed " << seed
+	  << " flags " << flags;
+      }
+    }
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, ZeroLengthWrite) {
   int r;
   coll_t cid;
@@ -3637,6 +3922,98 @@ TEST_P(StoreTest, OmapSimple) {
   }
 }
 
+TEST_P(StoreTest, OmapGetValuesRange) {
+  int r;
+  coll_t cid;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ghobject_t hoid(hobject_t(sobject_t("omap_range_obj", CEPH_NOSNAP),
+			    "key", 123, -1, ""));
+  map<string,bufferlist> km;
+  for (int i = 0; i < 100; ++i) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%03d", i);
+    km[key].append(string(i, 'v'));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.touch(cid, hoid);
+    t.omap_setkeys(cid, hoid, km);
+    bufferlist header;
+    header.append("header");
+    t.omap_setheader(cid, hoid, header);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto list = [&](const string& from, bool inclusive, size_t max) {
+    map<string,bufferlist> out;
+    string last;
+    int r = store->omap_get_values_range(
+      ch, hoid, from, inclusive, 4096,
+      [&](std::string_view k, std::string_view v) {
+	EXPECT_LT(last, string(k));
+	last = k;
+	out[string(k)].append(v.data(), v.size());
+	return out.size() < max;
+      });
+    EXPECT_EQ(0, r);
+    return out;
+  };
+  {
+    auto out = list(string(), false, 1000);
+    ASSERT_EQ(km.size(), out.size());
+    for (auto& [k, v] : km) {
+      ASSERT_TRUE(bl_eq(v, out[k]));
+    }
+  }
+  {
+    auto out = list("key050", true, 1000);
+    ASSERT_EQ(50u, out.size());
+    ASSERT_EQ("key050", out.begin()->first);
+    out = list("key050", false, 1000);
+    ASSERT_EQ(49u, out.size());
+    ASSERT_EQ("key051", out.begin()->first);
+    out = list("key0505", false, 1000);
+    ASSERT_EQ("key051", out.begin()->first);
+    out = list("key010", false, 10);
+    ASSERT_EQ(10u, out.size());
+    ASSERT_EQ("key020", out.rbegin()->first);
+    out = list("key099", false, 1000);
+    ASSERT_TRUE(out.empty());
+  }
+  {
+    // by key, some missing
+    set<string> keys = {"key000", "key042", "key0420", "key099", "nokey"};
+    map<string,bufferlist> out;
+    r = store->omap_get_values(ch, hoid, keys, &out);
+    ASSERT_EQ(0, r);
+    ASSERT_EQ(3u, out.size());
+    for (auto& [k, v] : out) {
+      ASSERT_TRUE(bl_eq(km[k], v));
+    }
+  }
+  {
+    ghobject_t missing(hobject_t(sobject_t("omap_range_missing", CEPH_NOSNAP),
+				 "key", 123, -1, ""));
+    r = store->omap_get_values_range(
+      ch, missing, string(), false, 0,
+      [](std::string_view, std::string_view) { return true; });
+    ASSERT_EQ(-ENOENT, r);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, OmapCloneTest) {
   int r;
   coll_t cid;
@@ -7195,6 +7572,69 @@ TEST_P(StoreTestSpecificAUSize, OnodeSizeTracking) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, OnodeHotTier) {
+
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  StartDeferred(block_size);
+  SetVal(g_conf(), "bluestore_onode_cache_hot_ratio", "0.5");
+  SetVal(g_conf(), "bluestore_onode_cache_hot_promote_hits", "2");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t("test_hot_onode", "", CEPH_NOSNAP, 0, -1, ""));
+  const PerfCounters* logger = store->get_perf_counters();
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(std::string(block_size, 'a'));
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto promotes = logger->get(l_bluestore_onode_hot_promotes);
+  for (size_t i = 0; i < 16; ++i) {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, block_size, bl);
+    ASSERT_EQ(r, (int)block_size);
+  }
+  ASSERT_GT(logger->get(l_bluestore_onode_hot_promotes), promotes);
+  ASSERT_GT(logger->get(l_bluestore_onode_hot_hits), 0u);
+
+  // disabling the tier demotes everything on the next trim, which is
+  // triggered by adding another onode to the cache
+  SetVal(g_conf(), "bluestore_onode_cache_hot_ratio", "0");
+  g_conf().apply_changes(nullptr);
+  ghobject_t hoid2(hobject_t("test_hot_onode2", "", CEPH_NOSNAP, 0, -1, ""));
+  {
+    ObjectStore::Transaction t;
+    t.touch(cid, hoid2);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_GT(logger->get(l_bluestore_onode_hot_demotes), 0u);
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove(cid, hoid2);
+    t.remove_collection(cid);
+    cerr << "Cleaning" << std::endl;
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BlobReuseOnOverwrite) {
 
   if (string(GetParam()) != "bluestore")
@@ -12,7 +12,10 @@
 #include "include/stringify.h"
 #include "common/errno.h"
 
+#include "include/scope_guard.h"
+
 #include "blk/BlockDevice.h"
+#include "blk/kernel/io_uring.h"
 
 using namespace std;
 
@@ -91,6 +94,158 @@ TEST(KernelDevice, Ticket45337) {
   b->close();
 }
 
+#ifdef HAVE_LIBAIO
+static bufferlist make_pattern(uint64_t off, uint64_t len)
+{
+  bufferptr p = buffer::create_small_page_aligned(len);
+  for (uint64_t i = 0; i < len; i += sizeof(uint64_t)) {
+    uint64_t v = off + i;
+    memcpy(p.c_str() + i, &v, sizeof(v));
+  }
+  bufferlist bl;
+  bl.append(std::move(p));
+  return bl;
+}
+
+TEST(KernelDevice, IoringFixedBuffers) {
+  if (!ioring_queue_t::supported()) {
+    GTEST_SKIP() << "io_uring is not supported";
+  }
+  TempBdev bdev{ 1048576 };
+  int fd = ::open(bdev.path.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  std::vector<int> fds = { fd };
+
+  const size_t buffer_size = 65536;
+  ioring_queue_t q(16, false, false, 0, 4 * buffer_size, buffer_size);
+  ASSERT_EQ(0, q.init(fds));
+  if (q.get_fixed_buffer_size() == 0) {
+    q.shutdown();
+    ::close(fd);
+    GTEST_SKIP() << "could not register fixed buffers";
+  }
+  ASSERT_EQ(buffer_size, q.get_fixed_buffer_size());
+
+  // too large for a buffer
+  ASSERT_FALSE(q.create_fixed_buffer(buffer_size + 1));
+  {
+    std::vector<bufferptr> held;
+    for (unsigned i = 0; i < 4; ++i) {
+      auto raw = q.create_fixed_buffer(4096 * (i + 1));
+      ASSERT_TRUE(raw);
+      held.emplace_back(std::move(raw));
+      ASSERT_EQ(4096u * (i + 1), held.back().length());
+    }
+    // all of them are in use
+    ASSERT_FALSE(q.create_fixed_buffer(4096));
+    held.pop_back();
+    auto raw = q.create_fixed_buffer(buffer_size);
+    ASSERT_TRUE(raw);
+    bufferptr p(std::move(raw));
+    ASSERT_FALSE(q.create_fixed_buffer(4096));
+  }
+  // released buffers are handed out again, and outlive the ring
+  auto raw = q.create_fixed_buffer(4096);
+  ASSERT_TRUE(raw);
+  q.shutdown();
+  bufferptr p(std::move(raw));
+  memset(p.c_str(), 'x', p.length());
+  ::close(fd);
+}
+
+TEST(KernelDevice, IoringFixedBufferReads) {
+  if (!ioring_queue_t::supported()) {
+    GTEST_SKIP() << "io_uring is not supported";
+  }
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val("bdev_ioring", "true");
+  conf.set_val("bdev_ioring_fixed_buffers", "256K");
+  conf.set_val("bdev_ioring_fixed_buffer_size", "64K");
+  conf.apply_changes(nullptr);
+  auto restore = make_scope_guard([&conf] {
+    conf.rm_val("bdev_ioring");
+    conf.rm_val("bdev_ioring_fixed_buffers");
+    conf.rm_val("bdev_ioring_fixed_buffer_size");
+    conf.apply_changes(nullptr);
+  });
+
+  const uint64_t size = 4 * 1048576;
+  TempBdev bdev{ size };
+  std::unique_ptr<BlockDevice> b(
+    BlockDevice::create(g_ceph_context, bdev.path, NULL, NULL,
+      [](void* handle, void* aio) {}, NULL));
+  if (b->open(bdev.path) < 0) {
+    GTEST_SKIP() << "open " << bdev.path << " failed";
+  }
+
+  {
+    IOContext ioc(g_ceph_context, NULL);
+    bufferlist bl = make_pattern(0, 1048576);
+    ASSERT_EQ(0, b->aio_write(0, bl, &ioc, false));
+    b->aio_submit(&ioc);
+    ioc.aio_wait();
+    ASSERT_EQ(0, ioc.get_return_value());
+  }
+
+  // a read which may be cached leaves the context cacheable
+  {
+    IOContext ioc(g_ceph_context, NULL);
+    bufferlist bl;
+    ASSERT_EQ(0, b->aio_read(65536, 65536, &bl, &ioc));
+    if (ioc.has_pending_aios()) {
+      b->aio_submit(&ioc);
+      ioc.aio_wait();
+    }
+    ASSERT_EQ(0, ioc.get_return_value());
+    ASSERT_FALSE(ioc.skip_cache());
+    ASSERT_TRUE(bl.contents_equal(make_pattern(65536, 65536)));
+  }
+
+  // more uncached reads than there are fixed buffers, and one larger
+  // than a buffer; those that find none free fall back to other memory
+  {
+    IOContext ioc(g_ceph_context, NULL);
+    ioc.flags |= IOContext::FLAG_DONT_CACHE;
+    std::vector<bufferlist> bls(9);
+    for (unsigned i = 0; i < 8; ++i) {
+      ASSERT_EQ(0, b->aio_read(i * 65536, 65536, &bls[i], &ioc));
+    }
+    ASSERT_EQ(0, b->aio_read(524288, 131072, &bls[8], &ioc));
+    if (ioc.has_pending_aios()) {
+      b->aio_submit(&ioc);
+      ioc.aio_wait();
+    }
+    ASSERT_EQ(0, ioc.get_return_value());
+    for (unsigned i = 0; i < 8; ++i) {
+      ASSERT_TRUE(bls[i].contents_equal(make_pattern(i * 65536, 65536)));
+    }
+    ASSERT_TRUE(bls[8].contents_equal(make_pattern(524288, 131072)));
+  }
+
+  // a misaligned write is copied into a fixed buffer before it is sent
+  {
+    bufferlist src = make_pattern(1048576, 65536 + 4096);
+    bufferlist bl;
+    bl.substr_of(src, 8, 65536);
+    ASSERT_FALSE(bl.is_aligned_size_and_memory(4096, 4096));
+    bufferlist expected;
+    expected.substr_of(src, 8, 65536);
+
+    IOContext ioc(g_ceph_context, NULL);
+    ASSERT_EQ(0, b->aio_write(1048576, bl, &ioc, false));
+    b->aio_submit(&ioc);
+    ioc.aio_wait();
+    ASSERT_EQ(0, ioc.get_return_value());
+
+    bufferlist out;
+    ASSERT_EQ(0, b->read(1048576, 65536, &out, &ioc, false));
+    ASSERT_TRUE(out.contents_equal(expected));
+  }
+
+  b->close();
+}
+#endif
+
 int main(int argc, char **argv) {
   auto args = argv_to_vec(argc, argv);
   map<string,string> defaults = {
@@ -1401,6 +1401,83 @@ TEST(BlueFS, test_concurrent_dir_link_and_compact_log_56210) {
   }
 }
 
+TEST(BlueFS, test_compaction_async_stall) {
+  uint64_t size = 1048576 * 256;
+  TempBdev bdev{size};
+  ConfSaver conf(g_ceph_context->_conf);
+
+  conf.SetVal("bluefs_alloc_size", "65536");
+  conf.SetVal("bluefs_compact_log_sync", "false");
+  conf.ApplyChanges();
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false, 1048576));
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.maybe_verify_layout({ BlueFS::BDEV_DB, false, false }));
+
+  // lots of metadata for the compaction to capture
+  const int num_files = 2000;
+  ASSERT_EQ(0, fs.mkdir("db"));
+  for (int i = 0; i < num_files; ++i) {
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("db", "sst." + to_string(i), &h, false));
+    h->append("data", 4);
+    fs.fsync(h);
+    fs.close_writer(h);
+  }
+
+  // a wal writer keeps fsyncing and files keep being created while the
+  // log is compacted over and over
+  const int num_compactions = 20;
+  atomic_bool stop{false};
+  atomic_bool started_creating{false};
+  std::thread create_thread(create_files, std::ref(fs),
+			    std::ref(stop), std::ref(started_creating));
+  mono_clock::duration max_fsync = mono_clock::zero().time_since_epoch();
+  std::thread wal_thread([&] {
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("db", "wal", &h, false));
+    while (!stop.load()) {
+      h->append("x", 1);
+      auto t0 = mono_clock::now();
+      fs.fsync(h);
+      max_fsync = std::max(max_fsync, mono_clock::now() - t0);
+    }
+    fs.close_writer(h);
+  });
+  for (int i = 0; i < num_compactions; ++i) {
+    fs.compact_log();
+  }
+  stop = true;
+  do_join(create_thread);
+  do_join(wal_thread);
+
+  auto snapshot = fs.get_perf_counters()->get_tavg_ns(
+    l_bluefs_compaction_snapshot_lat);
+  auto switch_over = fs.get_perf_counters()->get_tavg_ns(
+    l_bluefs_compaction_switch_lat);
+  ASSERT_GE(snapshot.second, (uint64_t)num_compactions);
+  ASSERT_EQ(snapshot.second, switch_over.second);
+  std::cout << "compactions " << snapshot.second
+	    << " avg snapshot " << snapshot.first / snapshot.second << "ns"
+	    << " avg switch " << switch_over.first / switch_over.second << "ns"
+	    << " max wal fsync "
+	    << std::chrono::duration_cast<std::chrono::microseconds>(
+	      max_fsync).count() << "us" << std::endl;
+
+  fs.umount(true); //do not compact on exit!
+  ASSERT_EQ(0, fs.mount());
+  for (int i = 0; i < num_files; ++i) {
+    uint64_t file_size;
+    utime_t mtime;
+    ASSERT_EQ(0, fs.stat("db", "sst." + to_string(i), &file_size, &mtime));
+    ASSERT_EQ(4u, file_size);
+  }
+  fs.umount();
+}
+
 TEST(BlueFS, test_log_runway) {
   uint64_t max_log_runway = 65536;
   ConfSaver conf(g_ceph_context->_conf);
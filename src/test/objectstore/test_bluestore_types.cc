@@ -14,6 +14,7 @@
 #include "global/global_context.h"
 #include "perfglue/heap_profiler.h"
 
+#include <random>
 #include <sstream>
 
 #define _STR(x) #x
@@ -2335,6 +2336,82 @@ TEST(bluestore_blob_use_tracker_t, mempool_stats_test)
   }
 }
 
+TEST(bluestore_compressibility_t, entropy)
+{
+  bufferlist zeros;
+  zeros.append_zero(65536);
+  ASSERT_EQ(0.0, bluestore_compressibility_t::estimate_entropy(zeros, 4096));
+
+  bufferlist text;
+  while (text.length() < 65536) {
+    text.append("the quick brown fox jumps over the lazy dog\n");
+  }
+  double e = bluestore_compressibility_t::estimate_entropy(text, 4096);
+  ASSERT_GT(e, 3.0);
+  ASSERT_LT(e, 5.0);
+
+  // random data spread over many small buffers
+  bufferlist noise;
+  std::mt19937 rng(0);
+  for (unsigned i = 0; i < 256; ++i) {
+    bufferptr p(256);
+    for (unsigned j = 0; j < 256; ++j) {
+      p.c_str()[j] = rng();
+    }
+    noise.append(p);
+  }
+  ASSERT_GT(bluestore_compressibility_t::estimate_entropy(noise, 4096), 7.0);
+  // more samples, better estimate
+  ASSERT_GT(bluestore_compressibility_t::estimate_entropy(noise, 65536), 7.9);
+
+  // shorter than the sample
+  bufferlist tiny;
+  tiny.append("ab");
+  ASSERT_EQ(1.0, bluestore_compressibility_t::estimate_entropy(tiny, 4096));
+  ASSERT_EQ(0.0, bluestore_compressibility_t::estimate_entropy(bufferlist(),
+							       4096));
+}
+
+TEST(bluestore_compressibility_t, learn)
+{
+  using namespace std::chrono_literals;
+  bluestore_compressibility_t c;
+  const double crr = 0.875;
+
+  // nothing is skipped until a band has seen enough
+  for (unsigned i = 0; i < bluestore_compressibility_t::MIN_SAMPLES; ++i) {
+    ASSERT_FALSE(c.should_skip(7.9, crr));
+    c.learn(7.9, 65536, 65000, 1ms);
+  }
+  ASSERT_GT(c.get_ratio(7.9), crr);
+
+  // ... after which most, but not all, of it is
+  unsigned skipped = 0;
+  for (unsigned i = 0; i < 10 * bluestore_compressibility_t::EXPLORE_EVERY;
+       ++i) {
+    skipped += c.should_skip(7.9, crr);
+  }
+  ASSERT_EQ(9u * bluestore_compressibility_t::EXPLORE_EVERY + 6, skipped);
+
+  // other bands are unaffected
+  ASSERT_FALSE(c.should_skip(4.0, crr));
+  ASSERT_EQ(1.0, c.get_ratio(4.0));
+  // a laxer ratio lets it through
+  ASSERT_FALSE(c.should_skip(7.9, 1.0));
+
+  // cost is per byte compressed
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    c.estimate_cost(65536)).count();
+  ASSERT_NEAR(1000000, ns, 1000);
+
+  // once the data changes the band comes back
+  for (unsigned i = 0; i < 4 * bluestore_compressibility_t::MIN_SAMPLES; ++i) {
+    c.learn(7.9, 65536, 16384, 1ms);
+  }
+  ASSERT_LT(c.get_ratio(7.9), crr);
+  ASSERT_FALSE(c.should_skip(7.9, crr));
+}
+
 int main(int argc, char **argv) {
   auto args = argv_to_vec(argc, argv);
   auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
@@ -55,6 +55,14 @@ int OmapBench::setup(int argc, const char** argv) {
 	}
       } else if (strcmp(args[i], "--name") == 0) {
 	rados_id = args[i+1];
+      } else if (strcmp(args[i], "--test") == 0) {
+	if (strcmp("read", args[i+1]) == 0) {
+	  test = &OmapBench::test_read_objects;
+	} else if (strcmp("write", args[i+1]) == 0) {
+	  test = &OmapBench::test_write_objects_in_parallel;
+	}
+      } else if (strcmp(args[i], "--pagesize") == 0) {
+	page_size = atoi(args[i+1]);
       }
     } else if (strcmp(args[i], "--help") == 0) {
       cout << "\nUsage: ostorebench [options]\n"
@@ -85,6 +93,11 @@ int OmapBench::setup(int argc, const char** argv) {
            << "                        (default uniform)\n";
       cout << "	--name          the rados id to use (default "<< rados_id
            << ")\n";
+      cout << "	--test          write to time writing the omaps, read to "
+	   << "write them and then\n"
+	   << "                        time listing them back (default write)\n"
+	   << "	--pagesize      entries to list per read (default all "
+	   << "entries of an object)\n";
       exit(1);
     }
   }
@@ -165,20 +178,28 @@ void AioWriter::set_aioc(librados::callback_t complete) {
 void OmapBench::aio_is_complete(rados_completion_t c, void *arg) {
   AioWriter *aiow = reinterpret_cast<AioWriter *>(arg);
   aiow->stop_time();
-  ceph::mutex * data_lock = &aiow->ob->data_lock;
   ceph::mutex * thread_is_free_lock = &aiow->ob->thread_is_free_lock;
   ceph::condition_variable* thread_is_free = &aiow->ob->thread_is_free;
   int &busythreads_count = aiow->ob->busythreads_count;
-  o_bench_data &data = aiow->ob->data;
-  int INCREMENT = aiow->ob->increment;
   int err = aiow->get_aioc()->get_return_value();
   if (err < 0) {
     cout << "error writing AioCompletion";
     return;
   }
   double time = aiow->get_time();
+  OmapBench *ob = aiow->ob;
   delete aiow;
-  data_lock->lock();
+  ob->record_latency(time);
+
+  thread_is_free_lock->lock();
+  busythreads_count--;
+  thread_is_free->notify_all();
+  thread_is_free_lock->unlock();
+}
+
+void OmapBench::record_latency(double time) {
+  int INCREMENT = increment;
+  std::lock_guard l{data_lock};
   data.avg_latency = (data.avg_latency * data.completed_ops + time)
       / (data.completed_ops + 1);
   data.completed_ops++;
@@ -194,12 +215,6 @@ void OmapBench::aio_is_complete(rados_completion_t c, void *arg) {
     data.mode.first = time/INCREMENT;
     data.mode.second = data.freq_map[time/INCREMENT];
   }
-  data_lock->unlock();
-
-  thread_is_free_lock->lock();
-  busythreads_count--;
-  thread_is_free->notify_all();
-  thread_is_free_lock->unlock();
 }
 
 string OmapBench::random_string(int len) {
@@ -263,6 +278,9 @@ void OmapBench::print_results() {
   cout << "\nEntries per kvmap:\t\t" << entries_per_omap;
   cout << "\nCharacters per key:\t" << key_size;
   cout << "\nCharacters per val:\t" << value_size;
+  if (test == &OmapBench::test_read_objects) {
+    cout << "\nEntries per read:\t" << (page_size ? page_size : entries_per_omap);
+  }
   cout << std::endl;
   cout << std::endl;
   cout << "Average latency:\t" << data.avg_latency;
@@ -397,6 +415,45 @@ int OmapBench::test_write_objects_in_parallel(omap_generator_t omap_gen) {
   return 0;
 }
 
+int OmapBench::test_read_objects(omap_generator_t omap_gen) {
+  int err = test_write_objects_in_parallel(omap_gen);
+  if (err < 0) {
+    return err;
+  }
+  {
+    std::lock_guard l{data_lock};
+    data = o_bench_data();
+  }
+
+  int max_return = page_size ? page_size : entries_per_omap;
+  for (int i = 1; i <= objects; i++) {
+    std::stringstream objstrm;
+    objstrm << prefix << i;
+    string start_after;
+    bool more = true;
+    while (more) {
+      librados::ObjectReadOperation read;
+      map<string, bufferlist> vals;
+      int rval = 0;
+      read.omap_get_vals2(start_after, max_return, &vals, &more, &rval);
+      utime_t begin = ceph_clock_now();
+      err = io_ctx.operate(objstrm.str(), &read, NULL);
+      utime_t end = ceph_clock_now();
+      if (err < 0 || rval < 0) {
+	cout << "reading omap failed with code " << (err < 0 ? err : rval);
+	cout << std::endl;
+	return err < 0 ? err : rval;
+      }
+      record_latency((end - begin) * 1000);
+      if (vals.empty()) {
+	break;
+      }
+      start_after = vals.rbegin()->first;
+    }
+  }
+  return 0;
+}
+
 /**
  * runs the specified test with the specified parameters and generates
  * a histogram of latencies
@@ -102,6 +102,7 @@ protected:
   int entries_per_omap;
   int key_size;
   int value_size;
+  int page_size;
   double increment;
 
   friend class Writer;
@@ -117,7 +118,7 @@ public:
       rados_id("admin"),
       prefix(rados_id+".obj."),
       threads(3), objects(100), entries_per_omap(10), key_size(10),
-      value_size(100), increment(10)
+      value_size(100), page_size(0), increment(10)
   {}
   /**
    * Parses command line args, initializes rados and ioctx
@@ -134,6 +135,11 @@ public:
    */
   static void aio_is_complete(rados_completion_t c, void *arg);
 
+  /**
+   * Adds an op that took time ms to the latency statistics.
+   */
+  void record_latency(double time);
+
   /**
    * Generates a random string len characters long
    */
@@ -198,6 +204,15 @@ public:
    */
   int test_write_objects_in_parallel(omap_generator_t omap_gen);
 
+  /*
+   * Writes the objects as test_write_objects_in_parallel does, then lists
+   * back the omap of each, page_size entries per omap_get_vals2 call,
+   * timing each call.
+   *
+   * @param omap_gen the method used to generate the omaps.
+   */
+  int test_read_objects(omap_generator_t omap_gen);
+
 };
 
 
@@ -16,6 +16,8 @@
 #include <sstream>
 #include <errno.h>
 #include <signal.h>
+#include "common/ceph_context.h"
+#include "erasure-code/ErasureCode.h"
 #include "osd/ECBackend.h"
 #include "gtest/gtest.h"
 
@@ -60,3 +62,160 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECUtil, StripeBatchPool)
+{
+  ECUtil::StripeBatchPool pool(nullptr, 3);
+  pool.start();
+
+  // every batch runs exactly once, including with concurrent callers
+  const unsigned batches = 64;
+  vector<std::atomic<unsigned>> runs(4 * batches);
+  vector<std::thread> callers;
+  for (unsigned c = 0; c < 4; ++c) {
+    callers.emplace_back([&pool, &runs, c] {
+      for (int i = 0; i < 100; ++i) {
+	pool.run(batches, [&runs, c](unsigned b) {
+	  ++runs[c * batches + b];
+	});
+      }
+    });
+  }
+  for (auto &t : callers) {
+    t.join();
+  }
+  for (auto &r : runs) {
+    ASSERT_EQ(100u, r);
+  }
+
+  // a stopped pool runs the batches on the caller
+  pool.stop();
+  unsigned ran = 0;
+  pool.run(batches, [&ran](unsigned) { ++ran; });
+  ASSERT_EQ(batches, ran);
+}
+
+namespace {
+
+/// k data chunks and one xor parity chunk
+class ErasureCodeXor : public ceph::ErasureCode {
+public:
+  static constexpr unsigned k = 3;
+
+  int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override {
+    return 0;
+  }
+  unsigned int get_chunk_count() const override {
+    return k + 1;
+  }
+  unsigned int get_data_chunk_count() const override {
+    return k;
+  }
+  unsigned int get_chunk_size(unsigned int object_size) const override {
+    return object_size / k;
+  }
+  int encode_chunks(const std::set<int> &want_to_encode,
+		    std::map<int, bufferlist> *encoded) override {
+    xor_into(k, *encoded);
+    return 0;
+  }
+  int decode_chunks(const std::set<int> &want_to_read,
+		    const std::map<int, bufferlist> &chunks,
+		    std::map<int, bufferlist> *decoded) override {
+    for (unsigned i = 0; i <= k; ++i) {
+      if (!chunks.count(i)) {
+	xor_into(i, *decoded);
+      }
+    }
+    return 0;
+  }
+
+private:
+  static void xor_into(unsigned to, std::map<int, bufferlist> &chunks) {
+    char *p = chunks[to].c_str();
+    unsigned len = chunks[to].length();
+    memset(p, 0, len);
+    for (unsigned i = 0; i <= k; ++i) {
+      if (i == to) {
+	continue;
+      }
+      const char *q = chunks[i].c_str();
+      for (unsigned j = 0; j < len; ++j) {
+	p[j] ^= q[j];
+      }
+    }
+  }
+};
+
+bufferlist make_data(unsigned len, unsigned seed)
+{
+  bufferptr bp(len);
+  for (unsigned i = 0; i < len; ++i) {
+    bp[i] = (char)(i * 131 + seed * 7 + i / 251);
+  }
+  bufferlist bl;
+  bl.append(std::move(bp));
+  return bl;
+}
+
+} // anonymous namespace
+
+TEST(ECUtil, StripeBatchPoolMatchesSerial)
+{
+  const unsigned chunk_size = 512;
+  const unsigned stripe_width = ErasureCodeXor::k * chunk_size;
+  ECUtil::stripe_info_t sinfo(ErasureCodeXor::k, stripe_width);
+  ceph::ErasureCodeInterfaceRef ec_impl(new ErasureCodeXor);
+
+  CephContext *cct = (new CephContext(CEPH_ENTITY_TYPE_OSD))->get();
+  // a batch may be as small as a single stripe
+  ASSERT_EQ(0, cct->_conf.set_val("osd_ec_stripe_batch_min_bytes",
+				  std::to_string(stripe_width)));
+  ECUtil::StripeBatchPool pool(cct, 3);
+  pool.start();
+
+  const std::set<int> want = {0, 1, 2, 3};
+  // stripe counts that do and do not split evenly across the batches
+  for (unsigned stripes : {1, 2, 3, 4, 5, 7, 9, 17, 64, 101}) {
+    SCOPED_TRACE(stripes);
+    bufferlist in = make_data(stripes * stripe_width, stripes);
+    if (stripes > 1) {
+      ASSERT_LT(1u, pool.get_num_batches(ec_impl, in.length()));
+    }
+
+    std::map<int, bufferlist> serial, batched;
+    ASSERT_EQ(0, ECUtil::encode(sinfo, ec_impl, in, want, &serial));
+    ASSERT_EQ(0, ECUtil::encode(sinfo, ec_impl, in, want, &batched, &pool));
+    ASSERT_EQ(serial.size(), batched.size());
+    for (auto &&[shard, bl] : serial) {
+      ASSERT_EQ(stripes * chunk_size, bl.length());
+      ASSERT_TRUE(bl.contents_equal(batched[shard])) << "shard " << shard;
+    }
+
+    // reassemble the object without each shard in turn
+    for (int lost = 0; lost <= (int)ErasureCodeXor::k; ++lost) {
+      SCOPED_TRACE(lost);
+      std::map<int, bufferlist> to_decode = serial;
+      to_decode.erase(lost);
+
+      bufferlist serial_out, batched_out;
+      ASSERT_EQ(0, ECUtil::decode(sinfo, ec_impl, to_decode, &serial_out));
+      ASSERT_EQ(0, ECUtil::decode(sinfo, ec_impl, to_decode, &batched_out,
+				  &pool));
+      ASSERT_TRUE(serial_out.contents_equal(in));
+      ASSERT_TRUE(batched_out.contents_equal(in));
+
+      bufferlist serial_shard, batched_shard;
+      std::map<int, bufferlist*> serial_map = {{lost, &serial_shard}};
+      std::map<int, bufferlist*> batched_map = {{lost, &batched_shard}};
+      ASSERT_EQ(0, ECUtil::decode(sinfo, ec_impl, to_decode, serial_map));
+      ASSERT_EQ(0, ECUtil::decode(sinfo, ec_impl, to_decode, batched_map,
+				  &pool));
+      ASSERT_TRUE(serial_shard.contents_equal(serial[lost]));
+      ASSERT_TRUE(batched_shard.contents_equal(serial[lost]));
+    }
+  }
+
+  pool.stop();
+  cct->put();
+}
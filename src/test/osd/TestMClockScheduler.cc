@@ -9,6 +9,7 @@
 #include "common/common_init.h"
 
 #include "osd/scheduler/mClockScheduler.h"
+#include "osd/scheduler/mClockCalibrator.h"
 #include "osd/scheduler/OpSchedulerItem.h"
 
 using namespace ceph::osd::scheduler;
@@ -258,3 +259,113 @@ TEST_F(mClockSchedulerTest, TestAllQueuesEnqueueDequeue) {
 
   ASSERT_TRUE(q.empty());
 }
+
+TEST_F(mClockSchedulerTest, TestSetCapacityModel) {
+  // the configured cost per io until the next enqueue picks up the new one
+  auto configured = mClockCalibrator::get_configured_model(
+    g_ceph_context, is_rotational);
+  ASSERT_EQ(static_cast<uint32_t>(configured.cost_per_io) + 1,
+	    q.calc_scaled_cost(1));
+
+  q.set_capacity_model(configured.cost_per_io * 2, configured.bandwidth);
+  ASSERT_EQ(static_cast<uint32_t>(configured.cost_per_io) + 1,
+	    q.calc_scaled_cost(1));
+
+  q.enqueue(create_item(100, client1, op_scheduler_class::client));
+  ASSERT_EQ(static_cast<uint32_t>(configured.cost_per_io * 2) + 1,
+	    q.calc_scaled_cost(1));
+  q.dequeue();
+  ASSERT_TRUE(q.empty());
+}
+
+namespace {
+
+/// ops of ios x bytes each, served in io_time * ios + byte_time * bytes
+void add_ops(mClockCalibrator::io_service_stats_t::buckets_t &b,
+	     uint64_t ops, uint64_t ios, uint64_t bytes,
+	     double io_time, double byte_time)
+{
+  using io_service_stats_t = mClockCalibrator::io_service_stats_t;
+  auto &bucket = b[io_service_stats_t::get_bucket(ios, bytes)];
+  bucket.ops += ops;
+  bucket.ios += ops * ios;
+  bucket.bytes += ops * bytes;
+  bucket.nsec += ops * (io_time * ios + byte_time * bytes) * 1e9;
+}
+
+}
+
+TEST(mClockCalibrator, Fit) {
+  const double io_time = 0.0001;            // 100us per io
+  const double byte_time = 1.0 / (500 << 20); // 500 MiB/s
+
+  mClockCalibrator::io_service_stats_t::buckets_t b;
+  add_ops(b, 1000, 1, 4096, io_time, byte_time);
+  add_ops(b, 500, 1, 65536, io_time, byte_time);
+  add_ops(b, 100, 4, 4 << 20, io_time, byte_time);
+  auto fit = mClockCalibrator::fit(b, 0);
+  ASSERT_TRUE(fit.valid());
+  ASSERT_EQ(1600u, fit.ops);
+  ASSERT_NEAR(io_time, fit.io_time, io_time * 0.01);
+  ASSERT_NEAR(byte_time, fit.byte_time, byte_time * 0.01);
+
+  // one size of op can't separate the two; byte_time is held
+  mClockCalibrator::io_service_stats_t::buckets_t one;
+  add_ops(one, 1000, 1, 4096, io_time, byte_time);
+  fit = mClockCalibrator::fit(one, byte_time);
+  ASSERT_TRUE(fit.valid());
+  ASSERT_EQ(byte_time, fit.byte_time);
+  ASSERT_NEAR(io_time, fit.io_time, io_time * 0.01);
+
+  // nothing to fit
+  fit = mClockCalibrator::fit(
+    mClockCalibrator::io_service_stats_t::buckets_t(), byte_time);
+  ASSERT_FALSE(fit.valid());
+  ASSERT_EQ(0u, fit.ops);
+}
+
+TEST(mClockCalibrator, BoundedStep) {
+  mClockCalibrator c(g_ceph_context, false);
+  auto configured = c.get_model();
+  const double max_step = g_ceph_context->_conf.get_val<double>(
+    "osd_mclock_calibration_max_step");
+  const double max_adjust = g_ceph_context->_conf.get_val<double>(
+    "osd_mclock_calibration_max_adjust");
+
+  // a device whose ios cost far more than configured
+  const double byte_time = 1.0 / configured.bandwidth;
+  const double io_time = 100 * configured.cost_per_io * byte_time;
+
+  mClockCalibrator::io_service_stats_t stats;
+  ASSERT_FALSE(c.update(stats));
+  ASSERT_FALSE(c.is_calibrated());
+
+  // too few ops to fit
+  add_ops(stats.read, 10, 1, 4096, io_time, byte_time);
+  ASSERT_FALSE(c.update(stats));
+
+  double last = configured.cost_per_io;
+  for (int i = 0; i < 100; ++i) {
+    add_ops(stats.read, 2000, 1, 4096, io_time, byte_time);
+    add_ops(stats.read, 2000, 1, 1 << 20, io_time, byte_time);
+    add_ops(stats.write, 2000, 1, 4096, io_time, byte_time);
+    add_ops(stats.write, 2000, 2, 1 << 20, io_time, byte_time);
+    ASSERT_TRUE(c.update(stats));
+    auto model = c.get_model();
+    ASSERT_LE(model.cost_per_io, last * (1 + max_step) * 1.000001);
+    ASSERT_GE(model.cost_per_io, last);
+    ASSERT_LE(model.cost_per_io,
+	      configured.cost_per_io * max_adjust * 1.000001);
+    // byte_time never moved from the first fit
+    ASSERT_NEAR(configured.bandwidth, model.bandwidth,
+		configured.bandwidth * 0.01);
+    last = model.cost_per_io;
+  }
+  ASSERT_TRUE(c.is_calibrated());
+  ASSERT_NEAR(configured.cost_per_io * max_adjust, last,
+	      configured.cost_per_io * 0.01);
+
+  c.reset();
+  ASSERT_FALSE(c.is_calibrated());
+  ASSERT_EQ(configured.cost_per_io, c.get_model().cost_per_io);
+}
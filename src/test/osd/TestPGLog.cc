@@ -2673,6 +2673,64 @@ TEST_F(PGLogMergeDupsTest, Superset) {
   check_index();
 }
 
+TEST_F(PGLogMergeDupsTest, TrimIsOneRangeDelete) {
+  const auto dups_tracked =
+    g_ceph_context->_conf.get_val<uint64_t>("osd_pg_log_dups_tracked");
+  hobject_t hoid;
+  hoid.pool = 1;
+  hoid.oid = "log";
+  ghobject_t log_oid(hoid);
+  auto ch = store->open_collection(test_coll);
+  auto write = [&]() {
+    ObjectStore::Transaction t;
+    map<string, bufferlist> km;
+    write_log_and_missing(t, &km, test_coll, log_oid, false);
+    if (!km.empty()) {
+      t.omap_setkeys(test_coll, log_oid, km);
+    }
+    return store->queue_transaction(ch, std::move(t));
+  };
+
+  for (unsigned i = 1; i <= 4; ++i) {
+    add_dups(9, i);
+  }
+  for (unsigned i = 1; i <= 6; ++i) {
+    log.add(PGLogTestBase::mk_ple_mod(PGLogTestBase::mk_obj(i),
+				      eversion_t(10, i), eversion_t(10, i - 1)));
+  }
+  log.skip_can_rollback_to_to_head();
+  index();
+  mark_log_for_rewrite();
+  ASSERT_EQ(0, write());
+
+  // entries 1-4 go, and so do the two oldest dups
+  g_ceph_context->_conf.set_val_or_die("osd_pg_log_dups_tracked", "2");
+  log.trim(g_ceph_context, eversion_t(10, 4), &trimmed, &trimmed_dups,
+	   &write_from_dups);
+  g_ceph_context->_conf.set_val_or_die("osd_pg_log_dups_tracked",
+				       std::to_string(dups_tracked));
+  EXPECT_EQ(4u, trimmed.size());
+  EXPECT_EQ(eversion_t(10, 1), trimmed.first);
+  EXPECT_EQ(eversion_t(10, 4), trimmed.last);
+  EXPECT_EQ(2u, trimmed_dups.size());
+  EXPECT_EQ(eversion_t(9, 1), trimmed_dups.first);
+  EXPECT_EQ(eversion_t(9, 2), trimmed_dups.last);
+  ASSERT_EQ(0, write());
+
+  set<string> keys;
+  ASSERT_EQ(0, store->omap_get_keys(ch, log_oid, &keys));
+  set<string> expected;
+  for (auto& e : log.log) {
+    expected.insert(e.get_key_name());
+  }
+  for (auto& d : log.dups) {
+    expected.insert(d.get_key_name());
+  }
+  EXPECT_EQ(2u, log.log.size());
+  EXPECT_EQ(2u, log.dups.size());
+  EXPECT_EQ(expected, keys);
+}
+
 
 struct PGLogTrimTest :
   public ::testing::Test,
@@ -2717,8 +2775,8 @@ TEST_F(PGLogTrimTest, TestPartialTrim)
   log.add(mk_ple_mod(mk_obj(4), mk_evt(21, 165), mk_evt(26, 160)));
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
-  std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  PGLog::TrimmedRange trimmed;
+  PGLog::TrimmedRange trimmed_dups;
   eversion_t write_from_dups = eversion_t::max();
 
   log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups, &write_from_dups);
@@ -2731,8 +2789,8 @@ TEST_F(PGLogTrimTest, TestPartialTrim)
 
   SetUp(15);
 
-  std::set<eversion_t> trimmed2;
-  std::set<std::string> trimmed_dups2;
+  PGLog::TrimmedRange trimmed2;
+  PGLog::TrimmedRange trimmed_dups2;
   eversion_t write_from_dups2 = eversion_t::max();
 
   log.trim(cct, mk_evt(20, 164), &trimmed2, &trimmed_dups2, &write_from_dups2);
@@ -2784,8 +2842,8 @@ TEST_F(PGLogTrimTest, TestTrimNoDups)
   log.add(mk_ple_mod(mk_obj(4), mk_evt(21, 165), mk_evt(26, 160)));
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
-  std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  PGLog::TrimmedRange trimmed;
+  PGLog::TrimmedRange trimmed_dups;
   eversion_t write_from_dups = eversion_t::max();
 
   log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups, &write_from_dups);
@@ -2812,8 +2870,8 @@ TEST_F(PGLogTrimTest, TestNoTrim)
   log.add(mk_ple_mod(mk_obj(4), mk_evt(21, 165), mk_evt(26, 160)));
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
-  std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  PGLog::TrimmedRange trimmed;
+  PGLog::TrimmedRange trimmed_dups;
   eversion_t write_from_dups = eversion_t::max();
 
   log.trim(cct, mk_evt(9, 99), &trimmed, &trimmed_dups, &write_from_dups);
@@ -2841,8 +2899,8 @@ TEST_F(PGLogTrimTest, TestTrimAll)
   log.add(mk_ple_mod(mk_obj(4), mk_evt(21, 165), mk_evt(26, 160)));
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
-  std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  PGLog::TrimmedRange trimmed;
+  PGLog::TrimmedRange trimmed_dups;
   eversion_t write_from_dups = eversion_t::max();
 
   log.trim(cct, mk_evt(22, 180), &trimmed, &trimmed_dups, &write_from_dups);
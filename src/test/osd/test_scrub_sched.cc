@@ -41,6 +41,7 @@ int main(int argc, char** argv)
   return RUN_ALL_TESTS();
 }
 
+using namespace std::chrono_literals;
 using schedule_result_t = Scrub::schedule_result_t;
 using ScrubJobRef = ScrubQueue::ScrubJobRef;
 using qu_state_t = ScrubQueue::qu_state_t;
@@ -107,13 +108,18 @@ class FakeOsd : public Scrub::ScrubSchedListener {
     return m_next_response[pgid];
   }
 
+  uint64_t get_queued_client_ops() const final { return m_client_ops; }
+
   void set_initiation_response(spg_t pgid, schedule_result_t result)
   {
     m_next_response[pgid] = result;
   }
 
+  void set_queued_client_ops(uint64_t ops) { m_client_ops = ops; }
+
  private:
   int m_osd_num;
+  uint64_t m_client_ops{0};
   std::map<spg_t, schedule_result_t> m_next_response;
 };
 
@@ -400,3 +406,45 @@ TEST_F(TestScrubSched, ready_list)
   EXPECT_EQ(4, ripe_jobs.size());
   debug_print_jobs("ready_list", ripe_jobs);
 }
+
+/// deep scrubs back off as client ops queue up
+TEST_F(TestScrubSched, deep_scrub_throttle)
+{
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("osd_deep_scrub_client_load_ops", "100");
+
+  // not throttled by default
+  EXPECT_EQ(0ms, m_sched->deep_scrub_throttle(100 << 20));
+
+  conf.set_val_or_die("osd_deep_scrub_bandwidth_max", "100M");
+  conf.set_val_or_die("osd_deep_scrub_bandwidth_min", "10M");
+
+  m_osds.set_queued_client_ops(0);
+  EXPECT_DOUBLE_EQ(1.0, m_sched->deep_scrub_load_factor());
+  // 10M at 100M/s: a tenth of a second, give or take the time passing
+  auto delay = m_sched->deep_scrub_throttle(10 << 20);
+  EXPECT_GE(delay, 90ms);
+  EXPECT_LE(delay, 100ms);
+  // the next reads wait behind the ones already charged
+  delay = m_sched->deep_scrub_throttle(10 << 20);
+  EXPECT_GE(delay, 190ms);
+  EXPECT_LE(delay, 200ms);
+
+  m_osds.set_queued_client_ops(50);
+  EXPECT_DOUBLE_EQ(0.5, m_sched->deep_scrub_load_factor());
+
+  // fully loaded: down to the minimum bandwidth
+  m_osds.set_queued_client_ops(1000);
+  EXPECT_DOUBLE_EQ(0.0, m_sched->deep_scrub_load_factor());
+  delay = m_sched->deep_scrub_throttle(1 << 20);
+  // 1M at 10M/s, after the 20M charged above
+  EXPECT_GE(delay, 190ms + 100ms);
+  EXPECT_LE(delay, 200ms + 100ms);
+
+  conf.set_val_or_die("osd_deep_scrub_client_load_ops", "0");
+  EXPECT_DOUBLE_EQ(1.0, m_sched->deep_scrub_load_factor());
+
+  conf.rm_val("osd_deep_scrub_bandwidth_max");
+  conf.rm_val("osd_deep_scrub_bandwidth_min");
+  conf.rm_val("osd_deep_scrub_client_load_ops");
+}
@@ -0,0 +1,239 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Measure the Objecter reply path against a local stand-in for the OSDs:
+ * client threads register ops on a set of OSDSessions and then complete
+ * them the way handle_osd_op_reply() does.  With --global-lock the
+ * replies also take a shared rwlock and serialize completions by holding
+ * per-object mutexes across them, as the reply path used to.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "include/ceph_hash.h"
+#include "include/Context.h"
+#include "osdc/Objecter.h"
+
+using namespace std;
+
+struct Object {
+  std::string name;
+  uint64_t next = 0;
+  std::atomic<uint64_t> completed = {0};
+};
+
+struct Stats {
+  std::atomic<uint64_t> completed = {0};
+  std::atomic<uint64_t> misordered = {0};
+};
+
+class C_Reply : public Context {
+  Object *obj;
+  uint64_t seq;
+  Stats *stats;
+public:
+  C_Reply(Object *obj, uint64_t seq, Stats *stats)
+    : obj(obj), seq(seq), stats(stats) {}
+  void finish(int r) override {
+    if (obj->completed.load(std::memory_order_relaxed) != seq) {
+      stats->misordered++;
+    }
+    obj->completed.store(seq + 1, std::memory_order_relaxed);
+    stats->completed++;
+  }
+};
+
+struct Bench {
+  CephContext *cct;
+  bool global_lock;
+  unsigned batch;
+  uint64_t ops_per_thread;
+  unsigned objects_per_thread;
+
+  std::vector<Objecter::OSDSession*> sessions;
+  std::shared_mutex rwlock;
+  static constexpr unsigned num_completion_locks = 32;
+  std::unique_ptr<std::mutex[]> completion_locks{
+    new std::mutex[num_completion_locks]};
+  Stats stats;
+
+  Bench(CephContext *cct, bool global_lock, unsigned num_sessions,
+	unsigned batch, uint64_t ops_per_thread, unsigned objects_per_thread)
+    : cct(cct), global_lock(global_lock), batch(batch),
+      ops_per_thread(ops_per_thread), objects_per_thread(objects_per_thread) {
+    for (unsigned i = 0; i < num_sessions; ++i) {
+      sessions.push_back(new Objecter::OSDSession(cct, i));
+    }
+  }
+  ~Bench() {
+    for (auto s : sessions) {
+      s->put();
+    }
+  }
+
+  void reply(Objecter::OSDSession *s, ceph_tid_t tid, Object *obj,
+	     uint64_t seq) {
+    std::shared_lock<std::shared_mutex> rl(rwlock, std::defer_lock);
+    if (global_lock) {
+      rl.lock();
+    }
+    std::unique_lock sl(s->lock);
+    auto p = s->ops.find(tid);
+    ceph_assert(p != s->ops.end());
+    s->ops.erase(p);
+    decltype(Objecter::Op::onfinish) onfinish =
+      static_cast<Context*>(new C_Reply(obj, seq, &stats));
+    if (global_lock) {
+      rl.unlock();
+      uint32_t h = ceph_str_hash_linux(obj->name.c_str(), obj->name.size());
+      std::unique_lock cl(completion_locks[h % num_completion_locks]);
+      sl.unlock();
+      Objecter::Op::complete(std::move(onfinish), {}, 0);
+    } else {
+      auto ticket = s->get_completion_ticket(object_t(obj->name));
+      sl.unlock();
+      s->run_completion(ticket, std::move(onfinish), 0);
+    }
+  }
+
+  void run(unsigned t) {
+    std::vector<Object> objects(objects_per_thread);
+    for (unsigned i = 0; i < objects.size(); ++i) {
+      objects[i].name = "t" + std::to_string(t) + "_obj" + std::to_string(i);
+    }
+    // each object maps to one session, as it would to one primary
+    struct Pending {
+      Objecter::OSDSession *s;
+      ceph_tid_t tid;
+      Object *obj;
+      uint64_t seq;
+    };
+    std::vector<Pending> pending;
+    pending.reserve(batch);
+    ceph_tid_t tid = (ceph_tid_t)t << 40;
+    for (uint64_t done = 0; done < ops_per_thread; done += batch) {
+      for (unsigned i = 0; i < batch; ++i) {
+	Object *obj = &objects[(done + i) % objects.size()];
+	auto s = sessions[(t + (done + i) % objects.size()) % sessions.size()];
+	{
+	  std::shared_lock rl(rwlock);
+	  std::unique_lock sl(s->lock);
+	  s->ops[++tid] = nullptr;
+	}
+	pending.push_back({s, tid, obj, obj->next++});
+      }
+      for (auto& p : pending) {
+	reply(p.s, p.tid, p.obj, p.seq);
+      }
+      pending.clear();
+    }
+  }
+};
+
+static int run_bench(CephContext *cct, bool global_lock, unsigned threads,
+		     unsigned sessions, unsigned batch, uint64_t ops,
+		     unsigned objects)
+{
+  Bench bench(cct, global_lock, sessions, batch, ops, objects);
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&bench, t] { bench.run(t); });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  std::chrono::duration<double> secs =
+    std::chrono::steady_clock::now() - start;
+  uint64_t total = bench.stats.completed;
+  cout << (global_lock ? "global-lock" : "session-ticket")
+       << "\tthreads " << threads
+       << "\tops " << total
+       << "\tsecs " << secs.count()
+       << "\tops/sec " << (uint64_t)(total / secs.count())
+       << std::endl;
+  if (total != (uint64_t)threads * ((ops + batch - 1) / batch) * batch) {
+    cerr << "lost completions" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (bench.stats.misordered) {
+    cerr << bench.stats.misordered << " completions out of order" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
+
+static void usage(const char *name)
+{
+  cout << "usage: " << name << " [options]\n"
+       << "  --threads N        run with 1, 2, 4 ... N client threads (default 8)\n"
+       << "  --sessions N       number of OSD sessions (default 16)\n"
+       << "  --ops N            ops per thread (default 1000000)\n"
+       << "  --batch N          ops in flight per thread (default 16)\n"
+       << "  --objects N        objects per thread (default 64)\n"
+       << "  --global-lock      also take a shared rwlock and per-object\n"
+       << "                     completion locks in the reply path\n"
+       << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  int threads = 8;
+  int sessions = 16;
+  long long ops = 1000000;
+  int batch = 16;
+  int objects = 64;
+  bool global_lock = false;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &threads, err, "--threads", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &sessions, err, "--sessions", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &ops, err, "--ops", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &batch, err, "--batch", (char*)NULL) ||
+	ceph_argparse_witharg(args, i, &objects, err, "--objects", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << argv[0] << ": " << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+    } else if (ceph_argparse_flag(args, i, "--global-lock", (char*)NULL)) {
+      global_lock = true;
+    } else if (ceph_argparse_flag(args, i, "-h", "--help", (char*)NULL)) {
+      usage(argv[0]);
+      return 0;
+    } else {
+      cerr << "unknown option " << *i << std::endl;
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (threads < 1 || sessions < 1 || ops < 1 || batch < 1 || objects < 1) {
+    cerr << argv[0] << ": arguments must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (int t = 1; t <= threads; t *= 2) {
+    int r = run_bench(cct.get(), global_lock, t, sessions, batch, ops,
+		      objects);
+    if (r) {
+      return r;
+    }
+  }
+  return 0;
+}
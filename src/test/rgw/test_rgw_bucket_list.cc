@@ -0,0 +1,201 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw_rados.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+#define dout_subsys ceph_subsys_rgw
+
+using ent_map_t = RGWBucketListCursors::ent_map_t;
+
+static rgw_bucket_dir_entry make_entry(const std::string& name)
+{
+  rgw_bucket_dir_entry e;
+  e.key.name = name;
+  e.exists = true;
+  return e;
+}
+
+static void set_pending(RGWBucketListCursors::Shard& shard,
+			std::initializer_list<const char*> names,
+			bool is_truncated)
+{
+  shard.pending.clear();
+  for (auto name : names) {
+    shard.pending.emplace(name, make_entry(name));
+  }
+  shard.is_truncated = is_truncated;
+}
+
+static std::string names(const ent_map_t& m)
+{
+  std::string s;
+  for (const auto& [name, e] : m) {
+    s += name;
+  }
+  return s;
+}
+
+class TestBucketListCursors : public ::testing::Test {
+protected:
+  const NoDoutPrefix dpp{g_ceph_context, dout_subsys};
+  const std::map<int, std::string> shard_oids = {
+    {0, "index.0"}, {1, "index.1"}, {2, "index.2"}};
+  const ceph::coarse_mono_time now = ceph::coarse_mono_clock::now();
+  RGWBucketListCursors cursors;
+
+  static int keep(const RGWBucketListCursors::Shard&, rgw_bucket_dir_entry&) {
+    return 0;
+  }
+
+  void SetUp() override {
+    cursors.reset(-1, "", "", rgw_obj_index_key(), false,
+		  rgw_obj_index_key(), shard_oids, 8, now);
+    set_pending(cursors.shards[0], {"a", "d", "g"}, false);
+    set_pending(cursors.shards[1], {"b", "e", "h"}, false);
+    set_pending(cursors.shards[2], {"c", "f"}, true);
+  }
+
+  int merge(uint32_t num_entries, ent_map_t& m, bool* is_truncated,
+	    const RGWBucketListCursors::check_entry_t& check = keep) {
+    std::optional<rgw_obj_index_key> last;
+    m.clear();
+    cursors.start = cursors.position;
+    int r = cursors.merge(&dpp, num_entries, m, is_truncated, &last, check);
+    if (r == 0) {
+      EXPECT_EQ(last.value_or(cursors.start), cursors.position);
+    }
+    return r;
+  }
+};
+
+TEST_F(TestBucketListCursors, MergeInOrder)
+{
+  ent_map_t m;
+  bool is_truncated = false;
+  ASSERT_EQ(0, merge(4, m, &is_truncated));
+  ASSERT_EQ("abcd", names(m));
+  ASSERT_TRUE(is_truncated);
+  ASSERT_EQ("d", cursors.position.name);
+
+  // stops once a shard which may have more runs dry
+  ASSERT_EQ(0, merge(100, m, &is_truncated));
+  ASSERT_EQ("ef", names(m));
+  ASSERT_TRUE(is_truncated);
+  ASSERT_EQ("f", cursors.position.name);
+  ASSERT_EQ(1u, cursors.shards[0].pending.size());
+  ASSERT_EQ(1u, cursors.shards[1].pending.size());
+  ASSERT_TRUE(cursors.shards[2].pending.empty());
+  // the shard that ran dry is asked for more next time
+  ASSERT_EQ(16u, cursors.shards[2].batch);
+
+  set_pending(cursors.shards[2], {"i"}, false);
+  ASSERT_EQ(0, merge(100, m, &is_truncated));
+  ASSERT_EQ("ghi", names(m));
+  ASSERT_FALSE(is_truncated);
+}
+
+TEST_F(TestBucketListCursors, MergeCheck)
+{
+  ent_map_t m;
+  bool is_truncated = false;
+  auto skip_b = [] (const RGWBucketListCursors::Shard& shard,
+		    rgw_bucket_dir_entry& e) {
+    if (e.key.name != "b") {
+      return 0;
+    }
+    EXPECT_EQ("index.1", shard.oid);
+    return -ENOENT;
+  };
+  ASSERT_EQ(0, merge(3, m, &is_truncated, skip_b));
+  ASSERT_EQ("acd", names(m));
+  ASSERT_EQ("d", cursors.position.name);
+
+  auto fail_e = [] (const RGWBucketListCursors::Shard&,
+		    rgw_bucket_dir_entry& e) {
+    return e.key.name == "e" ? -EIO : 0;
+  };
+  ASSERT_EQ(-EIO, merge(3, m, &is_truncated, fail_e));
+}
+
+TEST_F(TestBucketListCursors, PutBack)
+{
+  ent_map_t m;
+  bool is_truncated = false;
+  ASSERT_EQ(0, merge(100, m, &is_truncated));
+  ASSERT_EQ("abcdef", names(m));
+
+  // the caller consumed up to c
+  cursors.put_back(m, m.find("d"));
+  ASSERT_EQ("abc", names(m));
+  ASSERT_EQ("c", cursors.position.name);
+  ASSERT_EQ("def", names(cursors.put_back_entries));
+
+  // handed back entries come first, without touching the shards
+  ASSERT_EQ(0, merge(2, m, &is_truncated));
+  ASSERT_EQ("de", names(m));
+  ASSERT_TRUE(is_truncated);
+  ASSERT_EQ(1u, cursors.shards[0].pending.size());
+
+  // nothing consumed: everything goes back
+  cursors.put_back(m, m.begin());
+  ASSERT_EQ("c", cursors.position.name);
+  ASSERT_EQ("def", names(cursors.put_back_entries));
+
+  set_pending(cursors.shards[2], {"i"}, false);
+  ASSERT_EQ(0, merge(100, m, &is_truncated));
+  ASSERT_EQ("defghi", names(m));
+  ASSERT_FALSE(is_truncated);
+  ASSERT_TRUE(cursors.put_back_entries.empty());
+}
+
+TEST_F(TestBucketListCursors, CanResume)
+{
+  ent_map_t m;
+  bool is_truncated = false;
+  ASSERT_EQ(0, merge(4, m, &is_truncated));
+  rgw_obj_index_key d("d");
+  rgw_obj_index_key c("c");
+  rgw_obj_index_key e("e");
+
+  ASSERT_TRUE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), false,
+				 d, shard_oids, now));
+  // only where the state left off
+  ASSERT_FALSE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), false,
+				  c, shard_oids, now));
+  ASSERT_FALSE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), false,
+				  e, shard_oids, now));
+  // only the same listing
+  ASSERT_FALSE(cursors.can_resume(-1, "x", "", rgw_obj_index_key(), false,
+				  d, shard_oids, now));
+  ASSERT_FALSE(cursors.can_resume(-1, "", "/", rgw_obj_index_key(), false,
+				  d, shard_oids, now));
+  ASSERT_FALSE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), true,
+				  d, shard_oids, now));
+  ASSERT_FALSE(cursors.can_resume(1, "", "", rgw_obj_index_key(), false,
+				  d, shard_oids, now));
+  // only on the same index shards
+  auto resharded = shard_oids;
+  resharded[2] = "index.new.2";
+  ASSERT_FALSE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), false,
+				  d, resharded, now));
+  // only while what it holds is recent
+  ASSERT_TRUE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), false,
+				 d, shard_oids,
+				 now + RGWBucketListCursors::max_age));
+  ASSERT_FALSE(cursors.can_resume(-1, "", "", rgw_obj_index_key(), false,
+				  d, shard_oids,
+				  now + RGWBucketListCursors::max_age +
+				  std::chrono::seconds(1)));
+}
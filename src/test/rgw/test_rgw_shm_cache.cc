@@ -0,0 +1,208 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include "rgw_shm_cache.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "global/global_context.h"
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+class ShmCacheTest : public ::testing::Test {
+protected:
+  std::string path;
+  static constexpr uint64_t size = 1 << 20;
+  static constexpr uint32_t slot_size = 4096;
+  static constexpr auto fsid = "e2f6a7c8-4a8e-4c3b-9f23-0b7a2f5d6c11";
+
+  void SetUp() override {
+    path = "/tmp/test_rgw_shm_cache." + std::to_string(::getpid());
+    ::unlink(path.c_str());
+  }
+  void TearDown() override {
+    ::unlink(path.c_str());
+  }
+
+  static ObjectCacheInfo make_info(const std::string& data) {
+    ObjectCacheInfo info;
+    info.flags = CACHE_FLAG_DATA | CACHE_FLAG_META;
+    info.data.append(data);
+    info.meta.size = data.size();
+    info.version.ver = 7;
+    return info;
+  }
+};
+
+TEST_F(ShmCacheTest, put_get)
+{
+  RGWShmCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.open(path, size, slot_size, fsid));
+
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ENOENT, cache.get("pool++obj", info, 0, 0s));
+
+  ASSERT_TRUE(cache.put("pool++obj", make_info("hello"),
+			cache.begin_fill("pool++obj")));
+  ASSERT_EQ(0, cache.get("pool++obj", info, CACHE_FLAG_DATA, 0s));
+  ASSERT_EQ("hello", info.data.to_str());
+  ASSERT_EQ(7u, info.version.ver);
+
+  // an entry without the requested flags is a miss
+  ASSERT_EQ(-ENOENT, cache.get("pool++obj", info, CACHE_FLAG_XATTRS, 0s));
+
+  // negative entries are never shared
+  ObjectCacheInfo enoent;
+  enoent.status = -ENOENT;
+  ASSERT_FALSE(cache.put("pool++missing", enoent,
+			 cache.begin_fill("pool++missing")));
+}
+
+TEST_F(ShmCacheTest, shared_between_mappings)
+{
+  RGWShmCache a(g_ceph_context);
+  RGWShmCache b(g_ceph_context);
+  ASSERT_EQ(0, a.open(path, size, slot_size, fsid));
+  ASSERT_EQ(0, b.open(path, size, slot_size, fsid));
+
+  ASSERT_TRUE(a.put("pool++obj", make_info("v1"), a.begin_fill("pool++obj")));
+  ObjectCacheInfo info;
+  ASSERT_EQ(0, b.get("pool++obj", info, CACHE_FLAG_DATA, 0s));
+  ASSERT_EQ("v1", info.data.to_str());
+
+  b.invalidate("pool++obj");
+  ASSERT_EQ(-ENOENT, a.get("pool++obj", info, CACHE_FLAG_DATA, 0s));
+}
+
+TEST_F(ShmCacheTest, mismatched_layout)
+{
+  RGWShmCache a(g_ceph_context);
+  ASSERT_EQ(0, a.open(path, size, slot_size, fsid));
+
+  RGWShmCache b(g_ceph_context);
+  ASSERT_EQ(-EINVAL, b.open(path, size * 2, slot_size, fsid));
+  ASSERT_FALSE(b.is_open());
+  ASSERT_EQ(-EINVAL, b.open(path, size, slot_size, "another-cluster"));
+  ASSERT_FALSE(b.is_open());
+}
+
+TEST_F(ShmCacheTest, invalidate_during_fill)
+{
+  RGWShmCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.open(path, size, slot_size, fsid));
+
+  // a reader starts filling, then the object is updated elsewhere
+  uint64_t gen = cache.begin_fill("pool++obj");
+  cache.invalidate("pool++obj");
+  ASSERT_FALSE(cache.put("pool++obj", make_info("stale"), gen));
+
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ENOENT, cache.get("pool++obj", info, 0, 0s));
+}
+
+TEST_F(ShmCacheTest, clear)
+{
+  RGWShmCache a(g_ceph_context);
+  RGWShmCache b(g_ceph_context);
+  ASSERT_EQ(0, a.open(path, size, slot_size, fsid));
+  ASSERT_EQ(0, b.open(path, size, slot_size, fsid));
+
+  ASSERT_TRUE(a.put("pool++obj", make_info("v1"), a.begin_fill("pool++obj")));
+  uint64_t gen = a.begin_fill("pool++other");
+  b.clear();
+
+  // the entry is gone for every mapping, and a fill that started
+  // before the clear can't publish
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ENOENT, a.get("pool++obj", info, 0, 0s));
+  ASSERT_EQ(-ENOENT, b.get("pool++obj", info, 0, 0s));
+  ASSERT_FALSE(a.put("pool++other", make_info("stale"), gen));
+
+  ASSERT_TRUE(a.put("pool++obj", make_info("v2"), a.begin_fill("pool++obj")));
+  ASSERT_EQ(0, b.get("pool++obj", info, CACHE_FLAG_DATA, 0s));
+  ASSERT_EQ("v2", info.data.to_str());
+}
+
+TEST_F(ShmCacheTest, attach_clears)
+{
+  RGWShmCache a(g_ceph_context);
+  ASSERT_EQ(0, a.open(path, size, slot_size, fsid));
+  ASSERT_TRUE(a.put("pool++obj", make_info("v1"), a.begin_fill("pool++obj")));
+  a.close();
+
+  // what was left behind may have missed invalidations meanwhile
+  RGWShmCache b(g_ceph_context);
+  ASSERT_EQ(0, b.open(path, size, slot_size, fsid));
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ENOENT, b.get("pool++obj", info, 0, 0s));
+}
+
+TEST_F(ShmCacheTest, too_big)
+{
+  RGWShmCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.open(path, size, slot_size, fsid));
+
+  ASSERT_FALSE(cache.put("pool++big", make_info(std::string(slot_size, 'x')),
+			 cache.begin_fill("pool++big")));
+}
+
+TEST_F(ShmCacheTest, eviction)
+{
+  RGWShmCache cache(g_ceph_context);
+  ASSERT_EQ(0, cache.open(path, size, slot_size, fsid));
+
+  // fill well past capacity; every lookup must either miss or return
+  // the entry that was stored under that name
+  const int n = cache.get_num_slots() * 4;
+  for (int i = 0; i < n; ++i) {
+    auto name = "pool++obj" + std::to_string(i);
+    cache.put(name, make_info(name), cache.begin_fill(name));
+  }
+  int hits = 0;
+  for (int i = 0; i < n; ++i) {
+    auto name = "pool++obj" + std::to_string(i);
+    ObjectCacheInfo info;
+    if (cache.get(name, info, CACHE_FLAG_DATA, 0s) == 0) {
+      ASSERT_EQ(name, info.data.to_str());
+      ++hits;
+    }
+  }
+  ASSERT_GT(hits, 0);
+  ASSERT_LE(hits, (int)cache.get_num_slots());
+}
+
+TEST_F(ShmCacheTest, concurrent_readers_and_writers)
+{
+  RGWShmCache writer(g_ceph_context);
+  RGWShmCache reader(g_ceph_context);
+  ASSERT_EQ(0, writer.open(path, size, slot_size, fsid));
+  ASSERT_EQ(0, reader.open(path, size, slot_size, fsid));
+
+  // readers must never see a torn entry: the data always matches the
+  // size recorded with it
+  std::atomic<bool> stop = false;
+  std::atomic<int> torn = 0;
+  std::thread t([&] {
+    while (!stop) {
+      ObjectCacheInfo info;
+      if (reader.get("pool++obj", info, CACHE_FLAG_DATA, 0s) == 0 &&
+	  info.data.length() != info.meta.size) {
+	++torn;
+      }
+    }
+  });
+  for (int i = 0; i < 20000; ++i) {
+    writer.put("pool++obj", make_info(std::string(i % 1000, 'a' + i % 26)),
+	       writer.begin_fill("pool++obj"));
+    if (i % 100 == 0) {
+      writer.invalidate("pool++obj");
+    }
+  }
+  stop = true;
+  t.join();
+  ASSERT_EQ(0, torn);
+}
@@ -117,6 +117,9 @@ MESSAGE(MClientCapRelease)
 #include "messages/MClientCaps.h"
 MESSAGE(MClientCaps)
 
+#include "messages/MClientCapsBatch.h"
+MESSAGE(MClientCapsBatch)
+
 #include "messages/MClientLease.h"
 MESSAGE(MClientLease)
 